@@ -1,12 +1,17 @@
 #include "bench_framework.hpp"
+#include <mapnik/boolean.hpp>
 #include <mapnik/font_engine_freetype.hpp>
 #include <boost/format.hpp>
 
 class test : public benchmark::test_case
 {
+    // go through a fresh face_manager per iteration, like a renderer does
+    bool face_manager_;
+
   public:
     test(mapnik::parameters const& params)
         : test_case(params)
+        , face_manager_(*params.get<mapnik::boolean_type>("face_manager", false))
     {}
     bool validate() const
     {
@@ -37,14 +42,17 @@ class test : public benchmark::test_case
             mapnik::freetype_engine::font_file_mapping_type font_file_mapping;
             mapnik::freetype_engine::font_memory_cache_type font_cache;
             mapnik::font_library library;
+            mapnik::face_manager manager(library, font_file_mapping, font_cache);
             for (std::string const& name : mapnik::freetype_engine::face_names())
             {
-                mapnik::face_ptr f = mapnik::freetype_engine::create_face(name,
-                                                                          library,
-                                                                          font_file_mapping,
-                                                                          font_cache,
-                                                                          mapnik::freetype_engine::get_mapping(),
-                                                                          mapnik::freetype_engine::get_cache());
+                mapnik::face_ptr f = face_manager_ ? manager.get_face(name)
+                                                   : mapnik::freetype_engine::create_face(
+                                                       name,
+                                                       library,
+                                                       font_file_mapping,
+                                                       font_cache,
+                                                       mapnik::freetype_engine::get_mapping(),
+                                                       mapnik::freetype_engine::get_cache());
                 if (f)
                     ++count;
             }
@@ -70,5 +78,9 @@ int main(int argc, char** argv)
     }
     std::size_t face_count = mapnik::freetype_engine::face_names().size();
     test test_runner(params);
-    return run(test_runner, (boost::format("font_engine: creating %ld faces") % (face_count)).str());
+    bool face_manager = *params.get<mapnik::boolean_type>("face_manager", false);
+    return run(test_runner,
+               (boost::format("font_engine: creating %ld faces%s") % (face_count) %
+                (face_manager ? " through face_manager" : ""))
+                 .str());
 }
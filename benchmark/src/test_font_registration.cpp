@@ -1,19 +1,48 @@
 #include "bench_framework.hpp"
 #include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/util/fs.hpp>
 #include <boost/format.hpp>
 
 class test : public benchmark::test_case
 {
+    std::string registry_cache_;
+
   public:
     test(mapnik::parameters const& params)
         : test_case(params)
-    {}
-    bool validate() const { return mapnik::freetype_engine::register_fonts("./fonts", true); }
+        , registry_cache_(*params.get<std::string>("registry_cache", ""))
+    {
+        if (!registry_cache_.empty() && mapnik::util::exists(registry_cache_))
+        {
+            mapnik::util::remove(registry_cache_);
+        }
+    }
+    ~test()
+    {
+        if (!registry_cache_.empty() && mapnik::util::exists(registry_cache_))
+        {
+            mapnik::util::remove(registry_cache_);
+        }
+    }
+    bool validate() const
+    {
+        // with a registry cache this first (cold) registration writes the cache
+        if (!registry_cache_.empty())
+        {
+            mapnik::freetype_engine::set_registry_cache(registry_cache_);
+        }
+        return mapnik::freetype_engine::register_fonts("./fonts", true);
+    }
     bool operator()() const
     {
         unsigned long count = 0;
         for (unsigned i = 0; i < iterations_; ++i)
         {
+            if (!registry_cache_.empty())
+            {
+                // reload the cache file like a freshly started process would
+                mapnik::freetype_engine::set_registry_cache(registry_cache_);
+            }
             mapnik::freetype_engine::register_fonts("./fonts", true);
             count++;
         }
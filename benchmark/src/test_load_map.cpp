@@ -0,0 +1,82 @@
+#include "bench_framework.hpp"
+#include <mapnik/map.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/util/fs.hpp>
+#include <stdexcept>
+
+class test : public benchmark::test_case
+{
+    std::string xml_;
+    std::string cache_;
+
+  public:
+    test(mapnik::parameters const& params)
+        : test_case(params)
+        , xml_()
+        , cache_(*params.get<std::string>("cache", ""))
+    {
+        boost::optional<std::string> map = params.get<std::string>("map");
+        if (!map)
+        {
+            throw std::runtime_error("please provide a --map <path to xml> arg");
+        }
+        xml_ = *map;
+        if (!cache_.empty())
+        {
+            mapnik::compile_map(xml_, cache_, true);
+        }
+    }
+    ~test()
+    {
+        if (!cache_.empty() && mapnik::util::exists(cache_))
+        {
+            mapnik::util::remove(cache_);
+        }
+    }
+    bool validate() const
+    {
+        mapnik::Map m(256, 256);
+        mapnik::load_map(m, xml_, true, "", cache_);
+        return !m.layers().empty();
+    }
+    bool operator()() const
+    {
+        for (unsigned i = 0; i < iterations_; ++i)
+        {
+            mapnik::Map m(256, 256);
+            mapnik::load_map(m, xml_, true, "", cache_);
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::setup();
+    int return_value = 0;
+    try
+    {
+        mapnik::parameters params;
+        benchmark::handle_args(argc, argv, params);
+        boost::optional<std::string> name = params.get<std::string>("name");
+        if (!name)
+        {
+            std::clog << "please provide a name for this test\n";
+            return -1;
+        }
+        mapnik::freetype_engine::register_fonts("./fonts/", true);
+        mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
+        {
+            test test_runner(params);
+            return_value = run(test_runner, *name);
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        return -1;
+    }
+    return return_value;
+}
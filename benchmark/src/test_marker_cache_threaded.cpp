@@ -0,0 +1,65 @@
+#include "bench_framework.hpp"
+#include <mapnik/marker_cache.hpp>
+#include <mapnik/marker.hpp>
+
+// Lookups against a warm cache, the common case while rendering. Run with
+// --threads N to compare throughput per thread as N grows.
+class test : public benchmark::test_case
+{
+    std::vector<std::string> markers_;
+    std::vector<std::shared_ptr<mapnik::marker const>> expected_;
+
+  public:
+    test(mapnik::parameters const& params)
+        : test_case(params)
+        , markers_{"shape://ellipse",
+                   "shape://arrow",
+                   "image://square",
+                   "./test/data/images/dummy.png",
+                   "./test/data/images/dummy.tif",
+                   "./test/data/svg/octocat.svg",
+                   "./test/data/svg/place-of-worship-24.svg",
+                   "./test/data/svg/point_sm.svg",
+                   "./test/data/svg/point.svg",
+                   "./test/data/svg/airfield-12.svg"}
+    {
+        for (auto const& uri : markers_)
+        {
+            expected_.push_back(mapnik::marker_cache::instance().find(uri, true));
+        }
+    }
+
+    bool validate() const
+    {
+        for (std::size_t i = 0; i < markers_.size(); ++i)
+        {
+            if (mapnik::marker_cache::instance().find(markers_[i], true) != expected_[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool operator()() const
+    {
+        std::size_t hits = 0;
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            for (std::size_t j = 0; j < markers_.size(); ++j)
+            {
+                auto marker = mapnik::marker_cache::instance().find(markers_[j], true);
+                if (marker == expected_[j])
+                    ++hits;
+                if (marker->is<mapnik::marker_svg>())
+                {
+                    // scales as seen by a markers symbolizer with transforms
+                    mapnik::marker_cache::instance().find_flattened(
+                      mapnik::util::get<mapnik::marker_svg>(*marker).get_data(),
+                      1.0 + static_cast<double>(i % 4));
+                }
+            }
+        }
+        return hits == iterations_ * markers_.size();
+    }
+};
+
+BENCHMARK(test, "marker cache threaded")
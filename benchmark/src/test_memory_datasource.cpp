@@ -0,0 +1,84 @@
+#include "bench_framework.hpp"
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/geometry.hpp>
+#include <random>
+
+// Queries tile sized boxes against a memory datasource holding --features
+// random points. With the spatial index the cost per query follows the number
+// of hits, not the number of features in the datasource.
+class test : public benchmark::test_case
+{
+    std::size_t features_;
+    double tile_size_;
+    std::shared_ptr<mapnik::memory_datasource> ds_;
+
+  public:
+    test(mapnik::parameters const& params)
+        : test_case(params)
+        , features_(mapnik::safe_cast<std::size_t>(*params.get<mapnik::value_integer>("features", 100000)))
+        , tile_size_(*params.get<mapnik::value_double>("tile_size", 16.0))
+        , ds_()
+    {
+        mapnik::parameters ds_params;
+        ds_params["type"] = "memory";
+        ds_ = std::make_shared<mapnik::memory_datasource>(ds_params);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        std::mt19937 engine(42);
+        std::uniform_real_distribution<double> uniform_dist(0, 4096);
+        for (std::size_t i = 0; i < features_; ++i)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i));
+            feature->set_geometry(mapnik::geometry::point<double>(uniform_dist(engine), uniform_dist(engine)));
+            ds_->push(feature);
+        }
+        // build the index outside of the timed section
+        ds_->features(mapnik::query(mapnik::box2d<double>(0, 0, 1, 1)));
+    }
+
+    std::size_t run(std::size_t iterations) const
+    {
+        std::mt19937 engine(7);
+        std::uniform_real_distribution<double> uniform_dist(0, 4096 - tile_size_);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            double x = uniform_dist(engine);
+            double y = uniform_dist(engine);
+            mapnik::query q(mapnik::box2d<double>(x, y, x + tile_size_, y + tile_size_));
+            auto fs = ds_->features(q);
+            while (fs && fs->next())
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    bool validate() const
+    {
+        // every returned feature must lie inside the query box
+        mapnik::box2d<double> box(1000, 1000, 1000 + tile_size_, 1000 + tile_size_);
+        auto fs = ds_->features(mapnik::query(box));
+        std::size_t count = 0;
+        while (auto feature = fs->next())
+        {
+            auto const& pt = feature->get_geometry().get<mapnik::geometry::point<double>>();
+            if (!box.contains(pt.x, pt.y))
+                return false;
+            ++count;
+        }
+        std::clog << "features: " << features_ << ", hits in validation box: " << count << "\n";
+        return true;
+    }
+
+    bool operator()() const
+    {
+        run(iterations_);
+        return true;
+    }
+};
+
+BENCHMARK(test, "memory_datasource query")
@@ -0,0 +1,159 @@
+#include "bench_framework.hpp"
+#include <mapnik/map.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/mvt/mvt_renderer.hpp>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+// Renders a single web mercator tile either straight from the datasources
+// referenced by the map, or from an MVT tile encoded from those same
+// datasources up front, so both paths can be compared per tile.
+class test : public benchmark::test_case
+{
+    std::string xml_;
+    std::string source_;
+    std::string tile_file_;
+    mapnik::box2d<double> extent_;
+    mapnik::value_integer width_;
+    mapnik::value_integer height_;
+    std::shared_ptr<mapnik::Map> m_;
+    double scale_factor_;
+
+  public:
+    test(mapnik::parameters const& params)
+        : test_case(params)
+        , xml_()
+        , source_(*params.get<std::string>("source", "original"))
+        , tile_file_(*params.get<std::string>("tile_file", "/tmp/mapnik-benchmark-tile.mvt"))
+        , extent_()
+        , width_(*params.get<mapnik::value_integer>("width", 256))
+        , height_(*params.get<mapnik::value_integer>("height", 256))
+        , m_(new mapnik::Map(width_, height_))
+        , scale_factor_(*params.get<mapnik::value_double>("scale_factor", 1.0))
+    {
+        boost::optional<std::string> map = params.get<std::string>("map");
+        if (!map)
+        {
+            throw std::runtime_error("please provide a --map=<path to xml> arg");
+        }
+        xml_ = *map;
+        mapnik::load_map(*m_, xml_, true);
+
+        mapnik::value_integer z = *params.get<mapnik::value_integer>("z", 0);
+        mapnik::value_integer x = *params.get<mapnik::value_integer>("x", 0);
+        mapnik::value_integer y = *params.get<mapnik::value_integer>("y", 0);
+        if (z < 0 || z > 30 || x < 0 || y < 0 || x >= (1ll << z) || y >= (1ll << z))
+        {
+            throw std::runtime_error("invalid tile coordinates");
+        }
+        double tile_size = 2.0 * mapnik::MERC_MAX_EXTENT / static_cast<double>(1ll << z);
+        double minx = -mapnik::MERC_MAX_EXTENT + x * tile_size;
+        double maxy = mapnik::MERC_MAX_EXTENT - y * tile_size;
+        extent_.init(minx, maxy - tile_size, minx + tile_size, maxy);
+
+        if (source_ == "mvt")
+        {
+            std::string tile;
+            mapnik::request req(width_, height_, extent_);
+            req.set_buffer_size(m_->buffer_size());
+            mapnik::attributes variables;
+            mapnik::mvt_renderer ren(*m_, req, variables, tile, mapnik::mvt::default_extent, scale_factor_);
+            ren.apply();
+            {
+                std::ofstream out(tile_file_.c_str(), std::ios::out | std::ios::binary);
+                if (!out)
+                {
+                    throw std::runtime_error("could not write " + tile_file_);
+                }
+                out.write(tile.data(), static_cast<std::streamsize>(tile.size()));
+            }
+            for (auto& lyr : m_->layers())
+            {
+                mapnik::parameters p;
+                p["type"] = "mvt";
+                p["file"] = tile_file_;
+                p["layer"] = lyr.name();
+                p["z"] = z;
+                p["x"] = x;
+                p["y"] = y;
+                lyr.set_datasource(mapnik::datasource_cache::instance().create(p));
+                lyr.set_srs(m_->srs());
+            }
+            std::clog << "encoded " << m_->layers().size() << " layer(s) into a " << tile.size()
+                      << " byte tile\n";
+        }
+        else if (source_ != "original")
+        {
+            throw std::runtime_error("`source` must be one of `original` or `mvt`");
+        }
+    }
+
+    ~test()
+    {
+        if (source_ == "mvt")
+        {
+            std::remove(tile_file_.c_str());
+        }
+    }
+
+    bool validate() const
+    {
+        mapnik::request m_req(width_, height_, extent_);
+        mapnik::image_rgba8 im(m_->width(), m_->height());
+        mapnik::attributes variables;
+        m_req.set_buffer_size(m_->buffer_size());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(*m_, m_req, variables, im, scale_factor_);
+        ren.apply(m_req);
+        return true;
+    }
+
+    bool operator()() const
+    {
+        for (unsigned i = 0; i < iterations_; ++i)
+        {
+            mapnik::request m_req(width_, height_, extent_);
+            mapnik::image_rgba8 im(m_->width(), m_->height());
+            mapnik::attributes variables;
+            m_req.set_buffer_size(m_->buffer_size());
+            mapnik::agg_renderer<mapnik::image_rgba8> ren(*m_, m_req, variables, im, scale_factor_);
+            ren.apply(m_req);
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::setup();
+    int return_value = 0;
+    try
+    {
+        mapnik::parameters params;
+        benchmark::handle_args(argc, argv, params);
+        boost::optional<std::string> name = params.get<std::string>("name");
+        if (!name)
+        {
+            std::clog << "please provide a name for this test\n";
+            return -1;
+        }
+        mapnik::freetype_engine::register_fonts("./fonts/", true);
+        mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
+        {
+            test test_runner(params);
+            return_value = run(test_runner, *name);
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        return -1;
+    }
+    return return_value;
+}
@@ -1,52 +1,112 @@
 #include "bench_framework.hpp"
+#include <mapnik/boolean.hpp>
 #include <mapnik/quad_tree.hpp>
 #include <random>
 
 using quad_tree_type = mapnik::quad_tree<std::size_t>;
 
+// Builds a quad_tree from random boxes, either by inserting them one at a
+// time or by bulk loading them, then runs random bounding box queries against
+// it through query_in_box() or the allocation free visit_in_box().
 class test : public benchmark::test_case
 {
+    bool bulk_;
+    bool visit_;
+    std::vector<quad_tree_type::item_type> items_;
+    std::vector<mapnik::box2d<double>> queries_;
+
   public:
     test(mapnik::parameters const& params)
         : test_case(params)
-    {}
-
-    bool validate() const { return true; }
-
-    bool operator()() const
+        , bulk_(*params.get<mapnik::boolean_type>("bulk", false))
+        , visit_(*params.get<mapnik::boolean_type>("visit", false))
+        , items_()
+        , queries_()
     {
-        std::random_device rd;
-        std::default_random_engine engine(rd());
+        std::default_random_engine engine(42);
         std::uniform_int_distribution<int> uniform_dist(0, 2048);
-        quad_tree_type tree(mapnik::box2d<double>(0, 0, 2048, 2048));
-        // populate
+        items_.reserve(iterations_);
+        queries_.reserve(iterations_);
         for (size_t i = 0; i < iterations_; ++i)
         {
             int cx = uniform_dist(engine);
             int cy = uniform_dist(engine);
             int sx = 0.2 * uniform_dist(engine);
             int sy = 0.2 * uniform_dist(engine);
-            mapnik::box2d<double> box(cx - sx, cy - sy, cx + sx, cy + sy);
-            tree.insert(i, box);
+            items_.emplace_back(i, mapnik::box2d<double>(cx - sx, cy - sy, cx + sx, cy + sy));
         }
-        // bounding box query
-        std::size_t count = 0;
         for (size_t i = 0; i < iterations_; ++i)
         {
             int cx = uniform_dist(engine);
             int cy = uniform_dist(engine);
             int sx = 0.4 * uniform_dist(engine);
             int sy = 0.4 * uniform_dist(engine);
-            mapnik::box2d<double> box(cx - sx, cy - sy, cx + sx, cy + sy);
-            auto itr = tree.query_in_box(box);
-            auto end = tree.query_end();
-            for (; itr != end; ++itr)
+            queries_.emplace_back(cx - sx, cy - sy, cx + sx, cy + sy);
+        }
+    }
+
+    bool validate() const
+    {
+        mapnik::box2d<double> extent(0, 0, 2048, 2048);
+        quad_tree_type tree(extent);
+        for (auto const& item : items_)
+        {
+            tree.insert(item.first, item.second);
+        }
+        tree.trim();
+        quad_tree_type packed(extent, items_);
+        for (auto const& box : queries_)
+        {
+            std::size_t expected = 0;
+            for (auto itr = tree.query_in_box(box); itr != tree.query_end(); ++itr)
             {
-                ++count;
+                expected += *itr;
             }
+            std::size_t visited = 0;
+            packed.visit_in_box(box, [&visited](std::size_t v) { visited += v; });
+            if (visited != expected)
+                return false;
         }
         return true;
     }
+
+    bool operator()() const
+    {
+        mapnik::box2d<double> extent(0, 0, 2048, 2048);
+        std::unique_ptr<quad_tree_type> tree;
+        // populate
+        if (bulk_)
+        {
+            tree = std::make_unique<quad_tree_type>(extent, items_);
+        }
+        else
+        {
+            tree = std::make_unique<quad_tree_type>(extent);
+            for (auto const& item : items_)
+            {
+                tree->insert(item.first, item.second);
+            }
+        }
+        // bounding box query
+        std::size_t count = 0;
+        for (auto const& box : queries_)
+        {
+            if (visit_)
+            {
+                tree->visit_in_box(box, [&count](std::size_t) { ++count; });
+            }
+            else
+            {
+                auto itr = tree->query_in_box(box);
+                auto end = tree->query_end();
+                for (; itr != end; ++itr)
+                {
+                    ++count;
+                }
+            }
+        }
+        return count > 0;
+    }
 };
 
 BENCHMARK(test, "quad_tree creation")
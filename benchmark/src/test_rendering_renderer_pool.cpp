@@ -0,0 +1,192 @@
+#include "bench_framework.hpp"
+#include <mapnik/map.hpp>
+#include <mapnik/boolean.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/scale_denominator.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+// count every byte requested from the global heap so the benchmark can report
+// per-request allocation volume with and without agg_renderer_pool
+static std::atomic<std::size_t> allocated_bytes(0);
+
+void* operator new(std::size_t size)
+{
+    allocated_bytes += size;
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using renderer_type = mapnik::agg_renderer<mapnik::image_rgba8>;
+using pool_type = mapnik::agg_renderer_pool<mapnik::image_rgba8>;
+
+template<typename Renderer>
+void process_layers(Renderer& ren,
+                    mapnik::request const& m_req,
+                    mapnik::projection const& map_proj,
+                    std::vector<mapnik::layer> const& layers,
+                    double scale_denom)
+{
+    for (mapnik::layer const& lyr : layers)
+    {
+        if (lyr.visible(scale_denom))
+        {
+            std::set<std::string> names;
+            ren.apply_to_layer(lyr,
+                               ren,
+                               map_proj,
+                               m_req.scale(),
+                               scale_denom,
+                               m_req.width(),
+                               m_req.height(),
+                               m_req.extent(),
+                               m_req.buffer_size(),
+                               names);
+        }
+    }
+}
+
+class test : public benchmark::test_case
+{
+    std::string xml_;
+    mapnik::box2d<double> extent_;
+    mapnik::value_integer width_;
+    mapnik::value_integer height_;
+    std::shared_ptr<mapnik::Map> m_;
+    double scale_factor_;
+    bool use_pool_;
+    mutable pool_type pool_;
+
+  public:
+    test(mapnik::parameters const& params)
+        : test_case(params)
+        , xml_()
+        , extent_()
+        , width_(*params.get<mapnik::value_integer>("width", 256))
+        , height_(*params.get<mapnik::value_integer>("height", 256))
+        , m_(new mapnik::Map(width_, height_))
+        , scale_factor_(*params.get<mapnik::value_double>("scale_factor", 1.0))
+        , use_pool_(*params.get<mapnik::boolean_type>("pool", true))
+        , pool_()
+    {
+        boost::optional<std::string> map = params.get<std::string>("map");
+        if (!map)
+        {
+            throw std::runtime_error("please provide a --map=<path to xml> arg");
+        }
+        xml_ = *map;
+
+        boost::optional<std::string> ext = params.get<std::string>("extent");
+        mapnik::load_map(*m_, xml_, true);
+        if (ext && !ext->empty())
+        {
+            if (!extent_.from_string(*ext))
+                throw std::runtime_error("could not parse `extent` string" + *ext);
+        }
+        else
+        {
+            m_->zoom_all();
+            extent_ = m_->get_current_extent();
+        }
+    }
+
+    void render(bool pooled) const
+    {
+        mapnik::request m_req(width_, height_, extent_);
+        mapnik::image_rgba8 im(m_->width(), m_->height());
+        mapnik::attributes variables;
+        m_req.set_buffer_size(m_->buffer_size());
+        mapnik::projection map_proj(m_->srs(), true);
+        double scale_denom = mapnik::scale_denominator(m_req.scale(), map_proj.is_geographic());
+        scale_denom *= scale_factor_;
+        pool_type::scratch_ptr scratch;
+        if (pooled)
+        {
+            scratch = pool_.acquire(m_req.width(), m_req.height());
+        }
+        renderer_type ren(*m_, m_req, variables, im, scratch, scale_factor_);
+        ren.start_map_processing(*m_);
+        process_layers(ren, m_req, map_proj, m_->layers(), scale_denom);
+        ren.end_map_processing(*m_);
+    }
+
+    bool validate() const
+    {
+        std::size_t const requests = 10;
+        std::size_t start = allocated_bytes;
+        for (std::size_t i = 0; i < requests; ++i)
+        {
+            render(false);
+        }
+        std::size_t unpooled = (allocated_bytes - start) / requests;
+        render(true); // warm up the pool
+        start = allocated_bytes;
+        for (std::size_t i = 0; i < requests; ++i)
+        {
+            render(true);
+        }
+        std::size_t pooled = (allocated_bytes - start) / requests;
+        std::clog << "bytes allocated per request: " << unpooled << " (fresh renderer) vs " << pooled
+                  << " (pooled renderer), " << pool_.created() << " scratch buffers created\n";
+        return pooled <= unpooled;
+    }
+
+    bool operator()() const
+    {
+        for (unsigned i = 0; i < iterations_; ++i)
+        {
+            render(use_pool_);
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::setup();
+    int return_value = 0;
+    try
+    {
+        mapnik::parameters params;
+        benchmark::handle_args(argc, argv, params);
+        boost::optional<std::string> name = params.get<std::string>("name");
+        if (!name)
+        {
+            std::clog << "please provide a name for this test\n";
+            return -1;
+        }
+        mapnik::freetype_engine::register_fonts("./fonts/", true);
+        mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
+        {
+            test test_runner(params);
+            return_value = run(test_runner, *name);
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        return -1;
+    }
+    return return_value;
+}
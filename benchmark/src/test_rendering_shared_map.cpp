@@ -12,35 +12,6 @@
 #include <mapnik/datasource_cache.hpp>
 #include <stdexcept>
 
-template<typename Renderer>
-void process_layers(Renderer& ren,
-                    mapnik::request const& m_req,
-                    mapnik::projection const& map_proj,
-                    std::vector<mapnik::layer> const& layers,
-                    double scale_denom)
-{
-    unsigned layers_size = layers.size();
-    for (unsigned i = 0; i < layers_size; ++i)
-    {
-        mapnik::layer const& lyr = layers[i];
-        if (lyr.visible(scale_denom))
-        {
-            std::set<std::string> names;
-            mapnik::layer l(lyr);
-            ren.apply_to_layer(l,
-                               ren,
-                               map_proj,
-                               m_req.scale(),
-                               scale_denom,
-                               m_req.width(),
-                               m_req.height(),
-                               m_req.extent(),
-                               m_req.buffer_size(),
-                               names);
-        }
-    }
-}
-
 class test : public benchmark::test_case
 {
     std::string xml_;
@@ -92,14 +63,8 @@ class test : public benchmark::test_case
         mapnik::request m_req(width_, height_, extent_);
         mapnik::attributes variables;
         m_req.set_buffer_size(m_->buffer_size());
-        mapnik::projection map_proj(m_->srs(), true);
-        double scale_denom = mapnik::scale_denominator(m_req.scale(), map_proj.is_geographic());
-        scale_denom *= scale_factor_;
         mapnik::agg_renderer<mapnik::image_rgba8> ren(*m_, m_req, variables, im_, scale_factor_);
-        ren.start_map_processing(*m_);
-        std::vector<mapnik::layer> const& layers = m_->layers();
-        process_layers(ren, m_req, map_proj, layers, scale_denom);
-        ren.end_map_processing(*m_);
+        ren.apply(m_req);
         if (!preview_.empty())
         {
             std::clog << "preview available at " << preview_ << "\n";
@@ -120,14 +85,8 @@ class test : public benchmark::test_case
             mapnik::image_rgba8 im(m_->width(), m_->height());
             mapnik::attributes variables;
             m_req.set_buffer_size(m_->buffer_size());
-            mapnik::projection map_proj(m_->srs(), true);
-            double scale_denom = mapnik::scale_denominator(m_req.scale(), map_proj.is_geographic());
-            scale_denom *= scale_factor_;
             mapnik::agg_renderer<mapnik::image_rgba8> ren(*m_, m_req, variables, im, scale_factor_);
-            ren.start_map_processing(*m_);
-            std::vector<mapnik::layer> const& layers = m_->layers();
-            process_layers(ren, m_req, map_proj, layers, scale_denom);
-            ren.end_map_processing(*m_);
+            ren.apply(m_req);
             bool diff = false;
             mapnik::image_rgba8 const& dest = im;
             mapnik::image_rgba8 const& src = im_;
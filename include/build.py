@@ -37,6 +37,7 @@ subdirglobs = [
     ('group',                'mapnik/group/*.hpp'),
     ('json',                 'mapnik/json/*.hpp'),
     ('markers_placements',   'mapnik/markers_placements/*.hpp'),
+    ('mvt',                  'mapnik/mvt/*.hpp'),
     ('renderer_common',      'mapnik/renderer_common/*.hpp'),
     ('sparsehash',           '../deps/mapnik/sparsehash/*'),
     ('sparsehash/internal',  '../deps/mapnik/sparsehash/internal/*'),
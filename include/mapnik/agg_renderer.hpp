@@ -36,9 +36,15 @@
 #include <mapnik/symbolizer_enumerations.hpp>
 #include <mapnik/renderer_common.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/text/label_placement_cache.hpp>
+#include <mapnik/simplified_geometry_cache.hpp>
 // stl
+#include <map>
 #include <memory>
+#include <mutex>
 #include <stack>
+#include <utility>
+#include <vector>
 
 // fwd declaration to avoid dependence on agg headers
 namespace agg {
@@ -52,10 +58,12 @@ class feature_impl;
 class feature_type_style;
 class label_collision_detector4;
 class layer;
+class text_symbolizer_helper;
 class color;
 struct marker;
 class proj_transform;
 struct rasterizer;
+class label_worker_pool;
 struct rgba8_t;
 template<typename T>
 class image;
@@ -99,6 +107,13 @@ class buffer_stack
 
     T& top() const { return *position_; }
 
+    // mark all buffers as free, e.g. after an aborted render
+    void reset() { position_ = buffers_.end(); }
+
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    std::size_t size() const { return buffers_.size(); }
+
   private:
     const std::size_t width_;
     const std::size_t height_;
@@ -106,6 +121,135 @@ class buffer_stack
     typename std::deque<T>::iterator position_;
 };
 
+// Rasterizer and off-screen buffers used by agg_renderer. They only depend
+// on the output dimensions, so they can outlive a renderer and be handed to
+// the next one via agg_renderer_pool.
+template<typename T>
+class MAPNIK_DECL agg_renderer_scratch : private util::noncopyable
+{
+  public:
+    agg_renderer_scratch(std::size_t width, std::size_t height);
+    ~agg_renderer_scratch();
+    // restore the state a freshly constructed scratch would have
+    void reset();
+    std::size_t width() const { return internal_buffers.width(); }
+    std::size_t height() const { return internal_buffers.height(); }
+
+    buffer_stack<T> internal_buffers;
+    std::unique_ptr<T> inflated_buffer;
+    std::unique_ptr<rasterizer> ras_ptr;
+    // created on first use by set_label_threads() renders, kept across renders
+    std::unique_ptr<label_worker_pool> label_workers;
+};
+
+// Thread-safe pool of agg_renderer_scratch instances keyed by
+// (width, height). Scratch objects acquired from the pool return to it
+// when the last shared_ptr referencing them goes away.
+template<typename T>
+class agg_renderer_pool : private util::noncopyable
+{
+  public:
+    using scratch_type = agg_renderer_scratch<T>;
+    using scratch_ptr = std::shared_ptr<scratch_type>;
+
+    explicit agg_renderer_pool(std::size_t max_idle_per_key = 16)
+        : state_(std::make_shared<state>(max_idle_per_key))
+    {}
+
+    scratch_ptr acquire(unsigned width, unsigned height)
+    {
+        key_type key(width, height);
+        std::unique_ptr<scratch_type> scratch;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex_);
+            auto itr = state_->idle_.find(key);
+            if (itr != state_->idle_.end() && !itr->second.empty())
+            {
+                scratch = std::move(itr->second.back());
+                itr->second.pop_back();
+                ++state_->reused_;
+            }
+            else
+            {
+                ++state_->created_;
+            }
+        }
+        if (!scratch)
+        {
+            scratch = std::make_unique<scratch_type>(width, height);
+        }
+        else
+        {
+            scratch->reset();
+        }
+        return scratch_ptr(scratch.release(), recycler{state_, key});
+    }
+
+    std::size_t created() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        return state_->created_;
+    }
+
+    std::size_t reused() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        return state_->reused_;
+    }
+
+    std::size_t idle() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        std::size_t count = 0;
+        for (auto const& kv : state_->idle_)
+            count += kv.second.size();
+        return count;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        state_->idle_.clear();
+    }
+
+  private:
+    using key_type = std::pair<unsigned, unsigned>;
+
+    struct state
+    {
+        explicit state(std::size_t max_idle)
+            : max_idle_(max_idle)
+            , created_(0)
+            , reused_(0)
+        {}
+        std::mutex mutex_;
+        std::map<key_type, std::vector<std::unique_ptr<scratch_type>>> idle_;
+        std::size_t max_idle_;
+        std::size_t created_;
+        std::size_t reused_;
+    };
+
+    struct recycler
+    {
+        std::weak_ptr<state> state_;
+        key_type key_;
+        void operator()(scratch_type* ptr) const
+        {
+            std::unique_ptr<scratch_type> scratch(ptr);
+            std::shared_ptr<state> s = state_.lock();
+            if (s)
+            {
+                std::lock_guard<std::mutex> lock(s->mutex_);
+                auto& idle = s->idle_[key_];
+                if (idle.size() < s->max_idle_)
+                    idle.push_back(std::move(scratch));
+            }
+        }
+    };
+
+    std::shared_ptr<state> state_;
+};
+
 template<typename T0, typename T1 = label_collision_detector4>
 class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T0>>,
                                  private util::noncopyable
@@ -114,6 +258,8 @@ class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T0>
     using buffer_type = T0;
     using processor_impl_type = agg_renderer<T0>;
     using detector_type = T1;
+    using scratch_type = agg_renderer_scratch<T0>;
+    using scratch_ptr = std::shared_ptr<scratch_type>;
     // create with default, empty placement detector
     agg_renderer(Map const& m,
                  buffer_type& pixmap,
@@ -135,6 +281,15 @@ class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T0>
                  double scale_factor = 1.0,
                  unsigned offset_x = 0,
                  unsigned offset_y = 0);
+    // as above, reusing rasterizer and buffers from agg_renderer_pool
+    agg_renderer(Map const& m,
+                 request const& req,
+                 attributes const& vars,
+                 buffer_type& pixmap,
+                 scratch_ptr scratch,
+                 double scale_factor = 1.0,
+                 unsigned offset_x = 0,
+                 unsigned offset_y = 0);
     ~agg_renderer();
     void start_map_processing(Map const& map);
     void end_map_processing(Map const& map);
@@ -170,6 +325,24 @@ class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T0>
         return false;
     }
 
+    // Number of threads used to lay out the labels of a style before they
+    // are placed, 1 (the default) places every label as it is processed.
+    void set_label_threads(unsigned threads) { label_threads_ = threads; }
+    unsigned label_threads() const { return label_threads_; }
+
+    // Share label placements with other renders of the same zoom level through
+    // cache: labels it holds for a feature are reused instead of placed again,
+    // and the ones around the rendered extent are added to the detector first.
+    void set_label_placement_cache(std::shared_ptr<label_placement_cache> cache, int zoom);
+
+    // Share simplified geometries of static datasources with other renders
+    // through cache, so that features are not simplified again at each tile.
+    void set_simplified_geometry_cache(std::shared_ptr<simplified_geometry_cache> cache);
+
+    using typename feature_style_processor<agg_renderer<T0>>::label_list;
+    bool batch_labels(feature_type_style const& st) const;
+    void process_labels(label_list const& labels, proj_transform const& prj_trans);
+
     void painted(bool painted);
     bool painted();
 
@@ -179,6 +352,8 @@ class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T0>
 
     inline attributes const& variables() const { return common_.vars_; }
 
+    inline view_transform const& transform() const { return common_.t_; }
+
   protected:
     template<typename R>
     void debug_draw_box(R& buf, box2d<double> const& extent, double x, double y, double angle = 0.0);
@@ -186,16 +361,26 @@ class MAPNIK_DECL agg_renderer : public feature_style_processor<agg_renderer<T0>
     void draw_geo_extent(box2d<double> const& extent, mapnik::color const& color);
 
   private:
+    void render_labels(text_symbolizer const& sym, feature_impl& feature, text_symbolizer_helper const& helper);
+    label_placement_cache::key_type const& next_placement_key(feature_impl const& feature);
+    void render_labels(shield_symbolizer const& sym, feature_impl& feature, text_symbolizer_helper const& helper);
+
     std::stack<std::reference_wrapper<buffer_type>> buffers_;
-    buffer_stack<buffer_type> internal_buffers_;
-    std::unique_ptr<buffer_type> inflated_buffer_;
-    const std::unique_ptr<rasterizer> ras_ptr;
+    const scratch_ptr scratch_;
+    buffer_stack<buffer_type>& internal_buffers_;
+    std::unique_ptr<buffer_type>& inflated_buffer_;
+    std::unique_ptr<rasterizer> const& ras_ptr;
     gamma_method_enum gamma_method_;
     double gamma_;
+    unsigned label_threads_;
+    std::shared_ptr<label_placement_cache> placement_cache_;
+    label_placement_cache::key_type placement_key_;
+    feature_impl const* placement_feature_;
     renderer_common common_;
     void setup(Map const& m, buffer_type& pixmap);
 };
 
+extern template class MAPNIK_DECL agg_renderer_scratch<image<rgba8_t>>;
 extern template class MAPNIK_DECL agg_renderer<image<rgba8_t>>;
 
 } // namespace mapnik
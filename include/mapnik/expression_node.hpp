@@ -185,6 +185,8 @@ struct MAPNIK_DECL regex_match_node
     regex_match_node(transcoder const& tr, expr_node const& a, std::string const& ustr);
     mapnik::value apply(mapnik::value const& v) const;
     std::string to_string() const;
+    // utf-8 pattern as passed to the constructor
+    std::string pattern() const;
     expr_node expr;
     // TODO - use unique_ptr once https://github.com/mapnik/mapnik/issues/2457 is fixed
     std::shared_ptr<_regex_match_impl> impl_;
@@ -195,6 +197,9 @@ struct MAPNIK_DECL regex_replace_node
     regex_replace_node(transcoder const& tr, expr_node const& a, std::string const& ustr, std::string const& f);
     mapnik::value apply(mapnik::value const& v) const;
     std::string to_string() const;
+    // utf-8 pattern and format as passed to the constructor
+    std::string pattern() const;
+    std::string format() const;
     expr_node expr;
     // TODO - use unique_ptr once https://github.com/mapnik/mapnik/issues/2457 is fixed
     std::shared_ptr<_regex_replace_impl> impl_;
@@ -32,6 +32,7 @@
 #include <mapnik/geometry/envelope.hpp>
 //
 #include <mapnik/feature_kv_iterator.hpp>
+#include <mapnik/feature_arena.hpp>
 #include <mapnik/util/noncopyable.hpp>
 
 // stl
@@ -98,13 +99,14 @@ class MAPNIK_DECL feature_impl : private util::noncopyable
   public:
 
     using value_type = mapnik::value;
-    using cont_type = std::vector<value_type>;
+    using allocator_type = arena_allocator<value_type>;
+    using cont_type = std::vector<value_type, allocator_type>;
     using iterator = feature_kv_iterator;
 
-    feature_impl(context_ptr const& ctx, mapnik::value_integer _id)
+    feature_impl(context_ptr const& ctx, mapnik::value_integer _id, allocator_type const& alloc = allocator_type())
         : id_(_id)
         , ctx_(ctx)
-        , data_(ctx_->mapping_.size())
+        , data_(ctx_->mapping_.size(), value_type(), alloc)
         , geom_(geometry::geometry_empty())
         , raster_()
     {}
@@ -0,0 +1,181 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FEATURE_ARENA_HPP
+#define MAPNIK_FEATURE_ARENA_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik {
+
+namespace detail {
+
+// Monotonic block allocator backing a feature_arena. Memory is only handed
+// back when the last allocator referring to it goes away, so features that
+// escape the render (e.g. into a datasource cache) stay valid. Escaped
+// features may grow their attribute storage on other threads, so allocation
+// is serialized.
+class MAPNIK_DECL arena_resource : private util::noncopyable
+{
+  public:
+    explicit arena_resource(std::size_t block_size);
+    void* allocate(std::size_t size, std::size_t alignment);
+    std::size_t bytes_allocated() const;
+    std::size_t bytes_reserved() const;
+
+  private:
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+    std::size_t block_size_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_;
+    std::size_t remaining_;
+    std::size_t bytes_allocated_;
+    std::size_t bytes_reserved_;
+};
+
+} // namespace detail
+
+// Allocator handed out by feature_arena. A default constructed allocator
+// falls back to the global heap, which keeps containers using it usable
+// outside of an arena scope.
+template<typename T>
+class arena_allocator
+{
+    template<typename U>
+    friend class arena_allocator;
+
+  public:
+    using value_type = T;
+
+    arena_allocator() noexcept
+        : resource_()
+    {}
+
+    explicit arena_allocator(std::shared_ptr<detail::arena_resource> const& resource) noexcept
+        : resource_(resource)
+    {}
+
+    template<typename U>
+    arena_allocator(arena_allocator<U> const& other) noexcept
+        : resource_(other.resource_)
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        if (resource_)
+        {
+            return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept
+    {
+        // arena memory is released in one shot with the arena itself
+        if (!resource_)
+            ::operator delete(p);
+    }
+
+    template<typename U>
+    bool operator==(arena_allocator<U> const& other) const noexcept
+    {
+        return resource_ == other.resource_;
+    }
+
+    template<typename U>
+    bool operator!=(arena_allocator<U> const& other) const noexcept
+    {
+        return resource_ != other.resource_;
+    }
+
+  private:
+    std::shared_ptr<detail::arena_resource> resource_;
+};
+
+// Per-request monotonic arena for features and their attribute storage.
+//
+//   mapnik::feature_arena arena;
+//   {
+//       mapnik::feature_arena::scope guard(arena);
+//       ren.apply();
+//   }
+//
+// While a scope is active on the current thread feature_factory::create()
+// allocates from the arena instead of the global heap, so features built by
+// any datasource during the render are released together.
+//
+// feature_style_processor opens a scope of its own while it buffers the
+// features of a layer with cache-features or group-by set, since those are
+// held in memory until the layer (or group) is rendered anyway. Streamed
+// layers keep allocating from the heap so their peak memory stays flat.
+class MAPNIK_DECL feature_arena : private util::noncopyable
+{
+  public:
+    static constexpr std::size_t default_block_size = 64 * 1024;
+
+    class MAPNIK_DECL scope : private util::noncopyable
+    {
+      public:
+        explicit scope(feature_arena& arena);
+        ~scope();
+
+      private:
+        feature_arena* previous_;
+    };
+
+    explicit feature_arena(std::size_t block_size = default_block_size);
+
+    template<typename T>
+    arena_allocator<T> allocator() const
+    {
+        return arena_allocator<T>(resource_);
+    }
+
+    // drop all blocks; features still referencing them keep them alive
+    void release();
+    std::size_t bytes_allocated() const { return resource_->bytes_allocated(); }
+    std::size_t bytes_reserved() const { return resource_->bytes_reserved(); }
+
+    // arena bound to the calling thread or nullptr
+    static feature_arena* current();
+
+  private:
+    std::size_t block_size_;
+    std::shared_ptr<detail::arena_resource> resource_;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_FEATURE_ARENA_HPP
@@ -25,20 +25,31 @@
 
 // mapnik
 #include <mapnik/feature.hpp>
+#include <mapnik/feature_arena.hpp>
 #include <mapnik/value/types.hpp>
 
-// boost
-//#include <boost/pool/pool_alloc.hpp>
-
 namespace mapnik {
 struct feature_factory
 {
     static std::shared_ptr<feature_impl> create(context_ptr const& ctx, mapnik::value_integer fid)
     {
-        // return boost::allocate_shared<feature_impl>(boost::pool_allocator<feature_impl>(),fid);
-        // return boost::allocate_shared<feature_impl>(boost::fast_pool_allocator<feature_impl>(),fid);
+        feature_arena* arena = feature_arena::current();
+        if (arena != nullptr)
+        {
+            return create(ctx, fid, *arena);
+        }
         return std::make_shared<feature_impl>(ctx, fid);
     }
+
+    static std::shared_ptr<feature_impl>
+      create(context_ptr const& ctx, mapnik::value_integer fid, feature_arena const& arena)
+    {
+        // feature, control block and attribute storage all come from the arena
+        return std::allocate_shared<feature_impl>(arena.allocator<feature_impl>(),
+                                                  ctx,
+                                                  fid,
+                                                  arena.allocator<feature_impl::value_type>());
+    }
 };
 } // namespace mapnik
 
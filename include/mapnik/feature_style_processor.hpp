@@ -33,14 +33,17 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <utility>
 
 namespace mapnik {
 
 class Map;
 class layer;
+class request;
 class projection;
 class proj_transform;
 class feature_type_style;
+class rule;
 class rule_cache;
 struct layer_rendering_material;
 
@@ -62,6 +65,14 @@ class feature_style_processor
      */
     void apply(mapnik::layer const& lyr, std::set<std::string>& names, double scale_denom_override = 0.0);
 
+    /*!
+     * \brief apply renderer to all map layers using the extent, size, buffer size and
+     *        layer mask of a request instead of the Map's, leaving the Map untouched.
+     *        The renderer must have been constructed with the same extent,
+     *        std::runtime_error is thrown otherwise.
+     */
+    void apply(request const& req, double scale_denom_override = 0.0);
+
     /*!
      * \brief render a layer given a projection and scale.
      */
@@ -76,6 +87,21 @@ class feature_style_processor
                         int buffer_size,
                         std::set<std::string>& names);
 
+    // features and the matching rule of a style whose labels are placed together
+    using label_list = std::vector<std::pair<feature_ptr, rule const*>>;
+
+    /*!
+     * \brief whether the symbolizers of a style are handed to process_labels()
+     *        once all of its features are read. Processors opt in by defining
+     *        their own batch_labels() and process_labels().
+     */
+    bool batch_labels(feature_type_style const&) const { return false; }
+
+    /*!
+     * \brief process collected labels, in the order they were collected.
+     */
+    void process_labels(label_list const& labels, proj_transform const& prj_trans);
+
   private:
     /*!
      * \brief renders a featureset with the given styles.
@@ -86,11 +112,29 @@ class feature_style_processor
                       featureset_ptr features,
                       proj_transform const& prj_trans);
 
+    /*!
+     * \brief render all map layers with the given extent and size, shared by apply()
+     *        and apply(request).
+     */
+    void render_map(double scale,
+                    double scale_denom,
+                    unsigned width,
+                    unsigned height,
+                    box2d<double> const& extent,
+                    int buffer_size,
+                    request const* req);
+
     void prepare_layers(layer_rendering_material& parent_mat,
                         std::vector<layer> const& layers,
                         feature_style_context_map& ctx_map,
                         Processor& p,
-                        double scale_denom);
+                        double scale,
+                        double scale_denom,
+                        unsigned width,
+                        unsigned height,
+                        box2d<double> const& extent,
+                        int buffer_size,
+                        request const* req = nullptr);
 
     /*!
      * \brief prepare features for rendering asynchronously.
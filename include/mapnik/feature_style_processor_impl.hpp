@@ -29,6 +29,7 @@
 #include <mapnik/map.hpp>
 #include <mapnik/debug.hpp>
 #include <mapnik/feature.hpp>
+#include <mapnik/feature_arena.hpp>
 #include <mapnik/feature_style_processor.hpp>
 #include <mapnik/query.hpp>
 #include <mapnik/datasource.hpp>
@@ -42,6 +43,8 @@
 #include <mapnik/scale_denominator.hpp>
 #include <mapnik/projection.hpp>
 #include <mapnik/proj_transform_cache.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/view_transform.hpp>
 #include <mapnik/util/featureset_buffer.hpp>
 #include <mapnik/util/variant.hpp>
 #include <mapnik/symbolizer_dispatch.hpp>
@@ -89,30 +92,31 @@ void feature_style_processor<Processor>::prepare_layers(layer_rendering_material
                                                         std::vector<layer> const& layers,
                                                         feature_style_context_map& ctx_map,
                                                         Processor& p,
-                                                        double scale_denom)
+                                                        double scale,
+                                                        double scale_denom,
+                                                        unsigned width,
+                                                        unsigned height,
+                                                        box2d<double> const& extent,
+                                                        int buffer_size,
+                                                        request const* req)
 {
+    std::size_t index = 0;
     for (layer const& lyr : layers)
     {
-        if (lyr.visible(scale_denom))
+        // the request layer mask only applies to top-level layers
+        bool enabled = req == nullptr || req->layer_enabled(index);
+        ++index;
+        if (enabled && lyr.visible(scale_denom))
         {
             std::set<std::string> names;
             layer_rendering_material mat(lyr, parent_mat.proj0_);
 
-            prepare_layer(mat,
-                          ctx_map,
-                          p,
-                          m_.scale(),
-                          scale_denom,
-                          m_.width(),
-                          m_.height(),
-                          m_.get_current_extent(),
-                          m_.buffer_size(),
-                          names);
+            prepare_layer(mat, ctx_map, p, scale, scale_denom, width, height, extent, buffer_size, names);
 
             // Store active material
             if (!mat.active_styles_.empty())
             {
-                prepare_layers(mat, lyr.layers(), ctx_map, p, scale_denom);
+                prepare_layers(mat, lyr.layers(), ctx_map, p, scale, scale_denom, width, height, extent, buffer_size);
                 parent_mat.materials_.emplace_back(std::move(mat));
             }
         }
@@ -121,13 +125,38 @@ void feature_style_processor<Processor>::prepare_layers(layer_rendering_material
 
 template<typename Processor>
 void feature_style_processor<Processor>::apply(double scale_denom)
+{
+    render_map(m_.scale(), scale_denom, m_.width(), m_.height(), m_.get_current_extent(), m_.buffer_size(), nullptr);
+}
+
+template<typename Processor>
+void feature_style_processor<Processor>::apply(request const& req, double scale_denom)
+{
+    // the renderer projects geometries with the transform it was constructed
+    // with, querying another extent would misplace every feature
+    Processor const& p = static_cast<Processor const&>(*this);
+    if (req.extent() != p.transform().extent())
+    {
+        throw std::runtime_error("request extent must match the extent the renderer was constructed with");
+    }
+    render_map(req.scale(), scale_denom, req.width(), req.height(), req.extent(), req.buffer_size(), &req);
+}
+
+template<typename Processor>
+void feature_style_processor<Processor>::render_map(double scale,
+                                                    double scale_denom,
+                                                    unsigned width,
+                                                    unsigned height,
+                                                    box2d<double> const& extent,
+                                                    int buffer_size,
+                                                    request const* req)
 {
     Processor& p = static_cast<Processor&>(*this);
     p.start_map_processing(m_);
 
     projection proj(m_.srs(), true);
     if (scale_denom <= 0.0)
-        scale_denom = mapnik::scale_denominator(m_.scale(), proj.is_geographic());
+        scale_denom = mapnik::scale_denominator(scale, proj.is_geographic());
     scale_denom *= p.scale_factor(); // FIXME - we might want to comment this out
 
     // Asynchronous query supports:
@@ -143,7 +172,17 @@ void feature_style_processor<Processor>::apply(double scale_denom)
     if (!m_.layers().empty())
     {
         layer_rendering_material root_mat(m_.layers().front(), proj);
-        prepare_layers(root_mat, m_.layers(), ctx_map, p, scale_denom);
+        prepare_layers(root_mat,
+                       m_.layers(),
+                       ctx_map,
+                       p,
+                       scale,
+                       scale_denom,
+                       width,
+                       height,
+                       extent,
+                       buffer_size,
+                       req);
 
         render_submaterials(root_mat, p);
     }
@@ -199,7 +238,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay,
 
     prepare_layer(mat, ctx_map, p, scale, scale_denom, width, height, extent, buffer_size, names);
 
-    prepare_layers(mat, lay.layers(), ctx_map, p, scale_denom);
+    prepare_layers(mat, lay.layers(), ctx_map, p, scale, scale_denom, width, height, extent, buffer_size);
 
     if (!mat.active_styles_.empty())
     {
@@ -493,8 +532,14 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             // Cache all features into the memory_datasource before rendering.
             std::shared_ptr<featureset_buffer> cache = std::make_shared<featureset_buffer>();
             feature_ptr feature, prev;
-
-            while ((feature = features->next()))
+            // buffered features of a group are allocated and released together
+            feature_arena arena;
+            auto next_feature = [&]() {
+                feature_arena::scope guard(arena);
+                return features->next();
+            };
+
+            while ((feature = next_feature()))
             {
                 if (prev && prev->get(group_by) != feature->get(group_by))
                 {
@@ -507,6 +552,9 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
                         render_style(p, style, rule_caches[i++], cache, *proj_trans_ptr);
                     }
                     cache->clear();
+                    // the current feature and any labels still hold on to
+                    // their blocks
+                    arena.release();
                 }
                 cache->push(feature);
                 prev = feature;
@@ -528,6 +576,9 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
         if (features)
         {
             // Cache all features into the memory_datasource before rendering.
+            // They live until the layer is done, so allocate them together.
+            feature_arena arena;
+            feature_arena::scope guard(arena);
             feature_ptr feature;
             while ((feature = features->next()))
             {
@@ -554,6 +605,24 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
     }
 }
 
+template<typename Processor>
+void feature_style_processor<Processor>::process_labels(label_list const& labels, proj_transform const& prj_trans)
+{
+    Processor& p = static_cast<Processor&>(*this);
+    for (auto const& label : labels)
+    {
+        feature_impl& feature = *label.first;
+        rule::symbolizers const& symbols = label.second->get_symbolizers();
+        if (!p.process(symbols, feature, prj_trans))
+        {
+            for (symbolizer const& sym : symbols)
+            {
+                util::apply_visitor(symbolizer_dispatch<Processor>(p, feature, prj_trans), sym);
+            }
+        }
+    }
+}
+
 template<typename Processor>
 void feature_style_processor<Processor>::render_style(Processor& p,
                                                       feature_type_style const* style,
@@ -570,6 +639,24 @@ void feature_style_processor<Processor>::render_style(Processor& p,
     mapnik::attributes vars = p.variables();
     feature_ptr feature;
     bool was_painted = false;
+    bool const batch = p.batch_labels(*style);
+    label_list labels;
+    auto render_rule = [&](rule const& r) {
+        was_painted = true;
+        if (batch)
+        {
+            labels.emplace_back(feature, &r);
+            return;
+        }
+        rule::symbolizers const& symbols = r.get_symbolizers();
+        if (!p.process(symbols, *feature, prj_trans))
+        {
+            for (symbolizer const& sym : symbols)
+            {
+                util::apply_visitor(symbolizer_dispatch<Processor>(p, *feature, prj_trans), sym);
+            }
+        }
+    };
     while ((feature = features->next()))
     {
         bool do_else = true;
@@ -581,17 +668,9 @@ void feature_style_processor<Processor>::render_style(Processor& p,
               util::apply_visitor(evaluate<feature_impl, value_type, attributes>(*feature, vars), *expr);
             if (result.to_bool())
             {
-                was_painted = true;
                 do_else = false;
                 do_also = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if (!p.process(symbols, *feature, prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p, *feature, prj_trans), sym);
-                    }
-                }
+                render_rule(*r);
                 if (style->get_filter_mode() == filter_mode_enum::FILTER_FIRST)
                 {
                     // Stop iterating over rules and proceed with next feature.
@@ -604,33 +683,21 @@ void feature_style_processor<Processor>::render_style(Processor& p,
         {
             for (rule const* r : rc.get_else_rules())
             {
-                was_painted = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if (!p.process(symbols, *feature, prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p, *feature, prj_trans), sym);
-                    }
-                }
+                render_rule(*r);
             }
         }
         if (do_also)
         {
             for (rule const* r : rc.get_also_rules())
             {
-                was_painted = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if (!p.process(symbols, *feature, prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p, *feature, prj_trans), sym);
-                    }
-                }
+                render_rule(*r);
             }
         }
     }
+    if (batch && !labels.empty())
+    {
+        p.process_labels(labels, prj_trans);
+    }
     p.painted(p.painted() | was_painted);
     p.end_style_processing(*style);
 }
@@ -31,10 +31,15 @@
 #include <mapnik/text/font_library.hpp>
 
 // stl
+#include <cstdint>
 #include <memory>
 #include <map>
+#include <string>
 #include <utility> // pair
 #include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
 
 namespace boost {
 template<class T>
@@ -63,6 +68,10 @@ class MAPNIK_DECL freetype_engine : public singleton<freetype_engine, CreateUsin
     static bool is_font_file(std::string const& file_name);
     static bool register_font(std::string const& file_name);
     static bool register_fonts(std::string const& dir, bool recurse = false);
+    // Keep the face names found in each registered font file in `cache_file`, keyed
+    // by path, size and modification time, so that later registrations (also in other
+    // processes) only open files that changed. An empty name disables the cache.
+    static void set_registry_cache(std::string const& cache_file);
     static std::vector<std::string> face_names();
     static font_file_mapping_type const& get_mapping();
     static font_memory_cache_type& get_cache();
@@ -79,6 +88,14 @@ class MAPNIK_DECL freetype_engine : public singleton<freetype_engine, CreateUsin
                                 freetype_engine::font_memory_cache_type& global_memory_fonts);
 
   private:
+    struct registry_entry
+    {
+        std::uintmax_t size;
+        std::int64_t mtime;
+        std::vector<std::pair<int, std::string>> faces; // face index -> "family style"
+    };
+    using registry_cache_type = std::map<std::string, registry_entry>;
+
     bool is_font_file_impl(std::string const& file_name);
     std::vector<std::string> face_names_impl();
     font_file_mapping_type const& get_mapping_impl();
@@ -104,16 +121,33 @@ class MAPNIK_DECL freetype_engine : public singleton<freetype_engine, CreateUsin
                              font_library& libary,
                              font_file_mapping_type& font_file_mapping,
                              bool recurse = false);
+    bool read_face_names(std::string const& file_name,
+                         font_library& library,
+                         std::vector<std::pair<int, std::string>>& faces);
+    void set_registry_cache_impl(std::string const& cache_file);
+    void save_registry_cache();
     font_file_mapping_type global_font_file_mapping_;
     font_memory_cache_type global_memory_fonts_;
+    std::string registry_cache_file_;
+    registry_cache_type registry_cache_;
+    bool registry_cache_dirty_ = false;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex registry_mutex_;
+#endif
 };
 
+// Faces for fonts that are not held in a map's own memory cache are shared by every
+// face_manager used on the same thread and kept for the lifetime of that thread, so
+// repeated renders do not re-create them (nor re-measure their glyphs). FT_Face is not
+// thread safe, so faces are never shared between threads.
 class MAPNIK_DECL face_manager
 {
   public:
     face_manager(font_library& library,
                  freetype_engine::font_file_mapping_type const& font_file_mapping,
                  freetype_engine::font_memory_cache_type const& font_cache);
+    // same fonts as `other`, loaded through `library` (e.g. one per thread)
+    face_manager(font_library& library, face_manager const& other);
     face_ptr get_face(std::string const& name);
     face_set_ptr get_face_set(std::string const& name);
     face_set_ptr get_face_set(font_set const& fset);
@@ -125,6 +159,8 @@ class MAPNIK_DECL face_manager
     using face_cache_ptr = std::shared_ptr<face_cache>;
 
     face_cache_ptr face_cache_;
+    // thread whose shared faces face_cache_ currently holds
+    void const* face_cache_owner_;
     font_library& library_;
     freetype_engine::font_file_mapping_type const& font_file_mapping_;
     freetype_engine::font_memory_cache_type const& font_memory_cache_;
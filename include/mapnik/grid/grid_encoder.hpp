@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_GRID_ENCODER_HPP
+#define MAPNIK_GRID_ENCODER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <string>
+
+namespace mapnik {
+
+// Encode a hit_grid as UTFGrid JSON: {"grid":[...],"keys":[...],"data":{...}}.
+// Every `resolution`-th pixel is sampled, grids that were rendered with a
+// hit resolution are already coarse and should be encoded with 1.
+// The output is appended to `output`.
+template<typename T>
+MAPNIK_DECL void encode_utfgrid(T const& grid, std::string& output, unsigned resolution = 1, bool add_features = true);
+
+template<typename T>
+MAPNIK_DECL std::string encode_utfgrid(T const& grid, unsigned resolution = 1, bool add_features = true);
+
+} // namespace mapnik
+
+#endif // MAPNIK_GRID_ENCODER_HPP
@@ -0,0 +1,159 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_GRID_HIT_INDEX_HPP
+#define MAPNIK_GRID_HIT_INDEX_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstdint>
+#include <vector>
+
+namespace agg {
+struct trans_affine;
+}
+
+namespace mapnik {
+
+// Vector alternative to rasterizing symbolizers into a full resolution
+// hit_grid. Shapes are recorded in pixel space, in drawing order, and
+// every cell of a (coarse) grid is answered directly by testing the
+// centre of the pixel that a downsampled raster grid would have kept.
+// Later shapes win, which matches the painter's order of the raster path.
+class MAPNIK_DECL grid_hit_index : private util::noncopyable
+{
+  public:
+    using value_type = grid::value_type;
+
+    enum fill_rule_e : std::uint8_t { fill_even_odd, fill_non_zero };
+
+    grid_hit_index(std::size_t width, std::size_t height, unsigned resolution);
+
+    // Begin a new shape, following add_path calls append its rings.
+    void start_polygon(value_type id, fill_rule_e rule = fill_even_odd);
+    // Lines are hit within half_width of their centre line, hairlines
+    // are widened to half a pixel so they stay hittable.
+    void start_line(value_type id, double half_width);
+    // Rectangle (e.g. marker or glyph box) transformed by tr
+    void add_box(value_type id, box2d<double> const& box, agg::trans_affine const& tr);
+    void add_box(value_type id, box2d<double> const& box);
+
+    // Processor interface used by vertex_converter::apply
+    template<typename VertexSource>
+    void add_path(VertexSource& path)
+    {
+        double x;
+        double y;
+        unsigned cmd;
+        path.rewind(0);
+        while ((cmd = path.vertex(&x, &y)) != SEG_END)
+        {
+            if (cmd == SEG_MOVETO)
+                move_to(x, y);
+            else if (cmd == SEG_LINETO)
+                line_to(x, y);
+            else if ((cmd & SEG_CLOSE) == SEG_CLOSE)
+                close_path();
+        }
+    }
+
+    // Answer every cell of `g` (sized width / resolution) and return
+    // true if at least one cell was hit.
+    bool fill(grid& g) const;
+
+    // Topmost id under the sample point of cell (x, y) or grid::base_mask.
+    value_type hit(std::size_t x, std::size_t y) const;
+
+    std::size_t size() const { return shapes_.size(); }
+    bool empty() const { return shapes_.empty(); }
+    unsigned resolution() const { return resolution_; }
+    void clear();
+
+  private:
+    enum shape_type : std::uint8_t { polygon_shape, line_shape };
+
+    struct vertex
+    {
+        double x;
+        double y;
+        bool move;
+    };
+
+    struct shape
+    {
+        value_type id;
+        shape_type type;
+        fill_rule_e rule;
+        double half_width;
+        std::size_t first;
+        std::size_t last;
+        box2d<double> bbox;
+    };
+
+    void move_to(double x, double y);
+    void line_to(double x, double y);
+    void close_path();
+    bool contains(shape const& s, double x, double y) const;
+    bool cell_range(shape const& s,
+                    std::size_t cols,
+                    std::size_t rows,
+                    std::size_t& x0,
+                    std::size_t& y0,
+                    std::size_t& x1,
+                    std::size_t& y1) const;
+    // Both fill helpers paint the cells of the range that are not done yet,
+    // without testing every cell against every edge of the shape.
+    bool fill_polygon(shape const& s,
+                      grid& g,
+                      std::vector<bool>& done,
+                      std::size_t cols,
+                      std::size_t x0,
+                      std::size_t y0,
+                      std::size_t x1,
+                      std::size_t y1) const;
+    bool fill_line(shape const& s,
+                   grid& g,
+                   std::vector<bool>& done,
+                   std::size_t cols,
+                   std::size_t x0,
+                   std::size_t y0,
+                   std::size_t x1,
+                   std::size_t y1) const;
+
+    std::size_t width_;
+    std::size_t height_;
+    unsigned resolution_;
+    std::vector<shape> shapes_;
+    std::vector<vertex> vertices_;
+    std::size_t ring_start_;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_GRID_HIT_INDEX_HPP
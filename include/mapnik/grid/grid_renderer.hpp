@@ -49,6 +49,8 @@ namespace mapnik {
 class Map;
 class feature_impl;
 class feature_type_style;
+class glyph_positions;
+class grid_hit_index;
 class label_collision_detector4;
 class layer;
 struct marker;
@@ -116,9 +118,26 @@ class MAPNIK_DECL grid_renderer : public feature_style_processor<grid_renderer<T
 
     inline attributes const& variables() const { return common_.vars_; }
 
+    inline view_transform const& transform() const { return common_.t_; }
+
+    // Answer the grid from a vector index of the rendered shapes instead of
+    // rasterizing every symbolizer at full resolution. The pixmap must be
+    // sized ceil(width / resolution) x ceil(height / resolution) and is then
+    // filled once in end_map_processing. 0 (the default) rasterizes.
+    void set_hit_resolution(unsigned resolution);
+
+    inline unsigned hit_resolution() const { return hit_resolution_; }
+
+    inline grid_hit_index* hit_index() { return hit_index_.get(); }
+
+    // Record the glyph boxes of a placement into the hit index
+    void record_glyphs(glyph_positions const& glyphs, value_integer feature_id);
+
   private:
     buffer_type& pixmap_;
     const std::unique_ptr<grid_rasterizer> ras_ptr;
+    unsigned hit_resolution_;
+    std::unique_ptr<grid_hit_index> hit_index_;
     renderer_common common_;
     void setup(Map const& m);
 };
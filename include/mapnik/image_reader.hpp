@@ -65,6 +65,15 @@ struct MAPNIK_DECL image_reader : private util::noncopyable
     virtual boost::optional<box2d<double>> bounding_box() const = 0;
     virtual void read(unsigned x, unsigned y, image_rgba8& image) = 0;
     virtual image_any read(unsigned x, unsigned y, unsigned width, unsigned height) = 0;
+    // Reads the same window at 1/reduction of full resolution, where reduction
+    // is 1, 2, 4 or 8 and x, y are multiples of it, into an image of
+    // ceil(width / reduction) by ceil(height / reduction) pixels. Readers that
+    // can't decode at a reduced resolution cheaply return the full resolution
+    // window, so callers must check the size of the result.
+    virtual image_any read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned /*reduction*/)
+    {
+        return read(x, y, width, height);
+    }
     virtual ~image_reader() {}
 };
 
@@ -23,12 +23,20 @@
 #ifndef MAPNIK_JSON_EXTRACT_BOUNDING_BOXES_X3_HPP
 #define MAPNIK_JSON_EXTRACT_BOUNDING_BOXES_X3_HPP
 
+#include <cstddef>
+
 namespace mapnik {
 namespace json {
 
 template<typename Iterator, typename Boxes>
 void extract_bounding_boxes(Iterator& start, Iterator const& end, Boxes& boxes);
 
+// As above, but a large FeatureCollection has its "features" array split into
+// runs of whole features which are parsed on `num_threads` threads. Boxes are
+// appended in document order, same as the sequential version.
+template<typename Iterator, typename Boxes>
+void extract_bounding_boxes(Iterator& start, Iterator const& end, Boxes& boxes, std::size_t num_threads);
+
 }
 } // namespace mapnik
 
@@ -32,8 +32,21 @@
 namespace mapnik {
 class Map;
 
-MAPNIK_DECL void load_map(Map& map, std::string const& filename, bool strict = false, std::string base_path = "");
+// With a non-empty `cache_filename`, a cache written by compile_map() for the
+// same `filename`, `strict` and `base_path` is loaded instead of parsing the XML,
+// as long as none of the files read by the parser has changed since.
+MAPNIK_DECL void load_map(Map& map,
+                          std::string const& filename,
+                          bool strict = false,
+                          std::string base_path = "",
+                          std::string const& cache_filename = "");
 MAPNIK_DECL void load_map_string(Map& map, std::string const& str, bool strict = false, std::string base_path = "");
+// Parses the stylesheet `filename` and writes the resulting styles, layers and
+// map settings to `cache_filename` for use by load_map().
+MAPNIK_DECL void compile_map(std::string const& filename,
+                             std::string const& cache_filename,
+                             bool strict = false,
+                             std::string const& base_path = "");
 } // namespace mapnik
 
 #endif // MAPNIK_LOAD_MAP_HPP
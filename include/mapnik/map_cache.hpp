@@ -0,0 +1,64 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_MAP_CACHE_HPP
+#define MAPNIK_MAP_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mapnik {
+class Map;
+
+// What a compiled map was built from. A cache is only used by a load_map()
+// call with the same stylesheet, base_path and strict flag, and only while
+// every dependency has the size and modification time it had when the cache
+// was written.
+struct map_cache_source
+{
+    std::string filename;
+    std::string base_path;
+    bool strict = false;
+    // files read while parsing: the stylesheet, XIncludes and external entities
+    std::vector<std::string> dependencies;
+    // attributes set on the <Map> element, only these are applied on load
+    std::set<std::string> map_attributes;
+};
+
+// Serializes the parsed styles, layers, fontsets and map settings of `map`.
+// Throws config_error if the map holds something that cannot be serialized.
+MAPNIK_DECL void write_map_cache(Map const& map, map_cache_source const& source, std::string const& cache_filename);
+
+// Loads a cache written by write_map_cache() into `map`. Returns false and
+// leaves `map` untouched if the cache is missing, stale or damaged, or was
+// written for another source.
+MAPNIK_DECL bool read_map_cache(Map& map, map_cache_source const& source, std::string const& cache_filename);
+
+} // namespace mapnik
+
+#endif // MAPNIK_MAP_CACHE_HPP
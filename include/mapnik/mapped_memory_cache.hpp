@@ -28,9 +28,17 @@
 #include <mapnik/util/singleton.hpp>
 #include <mapnik/util/noncopyable.hpp>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
 
 #include <mapnik/warning.hpp>
 MAPNIK_DISABLE_WARNING_PUSH
@@ -48,11 +56,57 @@ namespace mapnik {
 
 using mapped_region_ptr = std::shared_ptr<boost::interprocess::mapped_region>;
 
+// How a file is going to be read, applied when it is first mapped.
+enum class mapped_access : std::uint8_t {
+    normal,
+    sequential, // madvise(MADV_SEQUENTIAL)
+    random,     // madvise(MADV_RANDOM), e.g. data files read at offsets from an index
+    willneed,   // madvise(MADV_WILLNEED), start reading the whole file in the background
+    populate    // prefault the whole file when mapping it (MAP_POPULATE where available)
+};
+
+struct mapped_region_stats
+{
+    std::string key;
+    std::size_t size;
+    std::size_t resident; // bytes currently in the page cache, 0 where unknown
+    std::size_t hits;
+};
+
+namespace detail {
+struct mapped_region_entry
+{
+    explicit mapped_region_entry(mapped_region_ptr region_)
+        : region(std::move(region_))
+        , hits(0)
+    {}
+    mapped_region_ptr region;
+    std::atomic<std::size_t> hits;
+};
+} // namespace detail
+
 class MAPNIK_DECL mapped_memory_cache : public singleton<mapped_memory_cache, CreateStatic>,
                                         private util::noncopyable
 {
     friend class CreateStatic<mapped_memory_cache>;
-    std::unordered_map<std::string, mapped_region_ptr> cache_;
+    using entry_ptr = std::shared_ptr<detail::mapped_region_entry>;
+
+    struct shard
+    {
+#ifdef MAPNIK_THREADSAFE
+        mutable std::mutex mutex;
+#endif
+        std::unordered_map<std::string, entry_ptr> entries;
+    };
+
+    // Lookups are first answered from a per-thread view (weak references) of
+    // the entries the thread has seen; only misses lock, and only the shard
+    // owning the key. The shards are the only owners of the entries.
+    std::array<shard, 16> shards_;
+    // bumped by remove() and clear() so per-thread views drop stale keys
+    std::atomic<std::size_t> generation_{1};
+
+    shard& shard_for(std::string const& key);
 
   public:
     bool insert(std::string const& key, mapped_region_ptr);
@@ -64,8 +118,18 @@ class MAPNIK_DECL mapped_memory_cache : public singleton<mapped_memory_cache, Cr
      * @return false if the resource was not removed or wasn't in the cache
      */
     bool remove(std::string const& key);
-    boost::optional<mapped_region_ptr> find(std::string const& key, bool update_cache = false);
+    /**
+     * @brief returns the mapping of the file identified by key, mapping it if needed
+     *
+     * @param key path of the file
+     * @param update_cache keep a new mapping in the cache
+     * @param access access hint applied if the file gets mapped by this call
+     */
+    boost::optional<mapped_region_ptr>
+      find(std::string const& key, bool update_cache = false, mapped_access access = mapped_access::normal);
     void clear();
+    // size, page cache residency and lookup count of every cached mapping
+    std::vector<mapped_region_stats> stats() const;
 };
 
 extern template class MAPNIK_DECL singleton<mapped_memory_cache, CreateStatic>;
@@ -27,14 +27,19 @@
 #include <mapnik/util/singleton.hpp>
 #include <mapnik/config.hpp>
 #include <mapnik/util/noncopyable.hpp>
+#include <mapnik/marker.hpp>
 
+#include <atomic>
+#include <map>
 #include <unordered_map>
 #include <memory>
 #include <string>
 
 namespace mapnik {
 
-struct marker;
+namespace svg {
+class svg_flattened_path;
+}
 
 class MAPNIK_DECL marker_cache : public singleton<marker_cache, CreateUsingNew>,
                                  private util::noncopyable
@@ -45,9 +50,15 @@ class MAPNIK_DECL marker_cache : public singleton<marker_cache, CreateUsingNew>,
     marker_cache();
     ~marker_cache();
     bool insert_marker(std::string const& key, marker&& path);
+    std::shared_ptr<marker const> load(std::string const& uri, bool strict);
     std::unordered_map<std::string, std::shared_ptr<mapnik::marker const>> marker_cache_;
     bool insert_svg(std::string const& name, std::string const& svg_string);
     std::unordered_map<std::string, std::string> svg_cache_;
+    // flattened paths per cached svg marker and scale bucket
+    using flattened_buckets = std::map<int, std::shared_ptr<svg::svg_flattened_path const>>;
+    std::unordered_map<svg_storage_type const*, flattened_buckets> flattened_cache_;
+    // bumped by clear() so per-thread lookup caches drop their entries
+    std::atomic<std::size_t> generation_;
 
   public:
     std::string known_svg_prefix_;
@@ -55,7 +66,12 @@ class MAPNIK_DECL marker_cache : public singleton<marker_cache, CreateUsingNew>,
     inline bool is_uri(std::string const& path) { return is_svg_uri(path) || is_image_uri(path); }
     bool is_svg_uri(std::string const& path);
     bool is_image_uri(std::string const& path);
+    // Cached markers are answered from a per-thread copy of the cache, so
+    // lookups after warm-up don't contend on the cache mutex.
     std::shared_ptr<marker const> find(std::string const& key, bool update_cache = false, bool strict = false);
+    // Curve-flattened paths of a cached svg marker for the scale bucket of
+    // `scale`, built on first use. Null for svg data the cache doesn't own.
+    std::shared_ptr<svg::svg_flattened_path const> find_flattened(svg_path_ptr const& path, double scale);
     void clear();
 };
 
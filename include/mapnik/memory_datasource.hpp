@@ -30,6 +30,8 @@
 
 // stl
 #include <deque>
+#include <memory>
+#include <mutex>
 
 namespace mapnik {
 
@@ -37,6 +39,8 @@ DATASOURCE_PLUGIN_DEF(memory_datasource_plugin, memory)
 class MAPNIK_DECL memory_datasource : public datasource
 {
     friend class memory_featureset;
+    friend class memory_index_featureset;
+    struct spatial_index;
 
   public:
     memory_datasource(parameters const& params);
@@ -55,7 +59,12 @@ class MAPNIK_DECL memory_datasource : public datasource
     void clear();
 
   private:
+    featureset_ptr query_index(box2d<double> const& box) const;
     std::deque<feature_ptr> features_;
+    // packed R-tree over feature envelopes, bulk-loaded on the first query
+    // and updated incrementally by push() afterwards
+    mutable std::unique_ptr<spatial_index> index_;
+    mutable std::mutex index_mutex_;
     mapnik::layer_descriptor desc_;
     datasource::datasource_t type_;
     bool bbox_check_;
@@ -34,6 +34,7 @@
 #include <mapnik/raster.hpp>
 
 #include <deque>
+#include <vector>
 
 namespace mapnik {
 
@@ -97,6 +98,36 @@ class memory_featureset : public Featureset
     datasource::datasource_t type_;
     bool bbox_check_;
 };
+
+// iterates the features selected by a memory_datasource spatial index query,
+// `ids` are positions in the datasource and are returned in ascending order
+class memory_index_featureset : public Featureset
+{
+  public:
+    memory_index_featureset(memory_datasource const& ds, std::vector<std::size_t>&& ids)
+        : features_(ds.features_)
+        , ids_(std::move(ids))
+        , pos_(ids_.begin())
+        , end_(ids_.end())
+    {}
+
+    virtual ~memory_index_featureset() {}
+
+    feature_ptr next()
+    {
+        if (pos_ != end_)
+        {
+            return features_[*pos_++];
+        }
+        return feature_ptr();
+    }
+
+  private:
+    std::deque<feature_ptr> const& features_;
+    std::vector<std::size_t> ids_;
+    std::vector<std::size_t>::const_iterator pos_;
+    std::vector<std::size_t>::const_iterator end_;
+};
 } // namespace mapnik
 
 #endif // MAPNIK_MEMORY_FEATURESET_HPP
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_MVT_HPP
+#define MAPNIK_MVT_HPP
+
+// stl
+#include <cstdint>
+
+namespace mapnik {
+namespace mvt {
+
+// field numbers and enums of vector_tile.proto, version 2 of the
+// Mapbox Vector Tile specification
+
+enum tile_tag : std::uint32_t { TILE_LAYERS = 3 };
+
+enum layer_tag : std::uint32_t {
+    LAYER_NAME = 1,
+    LAYER_FEATURES = 2,
+    LAYER_KEYS = 3,
+    LAYER_VALUES = 4,
+    LAYER_EXTENT = 5,
+    LAYER_VERSION = 15
+};
+
+enum feature_tag : std::uint32_t { FEATURE_ID = 1, FEATURE_TAGS = 2, FEATURE_TYPE = 3, FEATURE_GEOMETRY = 4 };
+
+enum value_tag : std::uint32_t {
+    VALUE_STRING = 1,
+    VALUE_FLOAT = 2,
+    VALUE_DOUBLE = 3,
+    VALUE_INT = 4,
+    VALUE_UINT = 5,
+    VALUE_SINT = 6,
+    VALUE_BOOL = 7
+};
+
+enum geom_type : std::int32_t { GEOM_UNKNOWN = 0, GEOM_POINT = 1, GEOM_LINESTRING = 2, GEOM_POLYGON = 3 };
+
+enum command_type : std::uint32_t { CMD_MOVE_TO = 1, CMD_LINE_TO = 2, CMD_CLOSE_PATH = 7 };
+
+constexpr std::uint32_t layer_version = 2;
+constexpr std::uint32_t default_extent = 4096;
+
+inline std::uint32_t command_integer(std::uint32_t id, std::uint32_t count)
+{
+    return (id & 0x7) | (count << 3);
+}
+
+inline std::uint32_t command_id(std::uint32_t command)
+{
+    return command & 0x7;
+}
+
+inline std::uint32_t command_count(std::uint32_t command)
+{
+    return command >> 3;
+}
+
+inline std::uint32_t zigzag_encode(std::int32_t n)
+{
+    return (static_cast<std::uint32_t>(n) << 1) ^ static_cast<std::uint32_t>(n >> 31);
+}
+
+inline std::int32_t zigzag_decode(std::uint32_t n)
+{
+    return static_cast<std::int32_t>(n >> 1) ^ -static_cast<std::int32_t>(n & 1);
+}
+
+} // namespace mvt
+} // namespace mapnik
+
+#endif // MAPNIK_MVT_HPP
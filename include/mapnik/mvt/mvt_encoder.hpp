@@ -0,0 +1,101 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_MVT_ENCODER_HPP
+#define MAPNIK_MVT_ENCODER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/mvt/mvt.hpp>
+#include <mapnik/geometry/point.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mapnik {
+
+class feature_impl;
+
+namespace mvt {
+
+using tile_point = geometry::point<std::int32_t>;
+using tile_path = std::vector<tile_point>;
+
+// Encodes tile coordinates into the MoveTo/LineTo/ClosePath command stream
+// of a feature. The cursor carries over between parts of the same feature.
+class MAPNIK_DECL geometry_encoder
+{
+  public:
+    void add_points(tile_path const& points);
+    // needs at least two points
+    void add_line(tile_path const& line);
+    // needs at least three points, without repeating the first one at the end
+    void add_ring(tile_path const& ring);
+    std::vector<std::uint32_t> const& commands() const { return commands_; }
+    bool empty() const { return commands_.empty(); }
+    void clear();
+
+  private:
+    void add_vertices(tile_path const& path, std::size_t count);
+    std::vector<std::uint32_t> commands_;
+    std::int32_t x_ = 0;
+    std::int32_t y_ = 0;
+};
+
+// Collects the features of one tile layer, interning attribute keys and
+// values so that every distinct key or value is stored once per layer.
+class MAPNIK_DECL layer_builder : private util::noncopyable
+{
+  public:
+    layer_builder(std::string const& name, std::uint32_t extent = default_extent);
+    void add_feature(feature_impl const& feature, geom_type type, std::vector<std::uint32_t> const& geometry);
+    std::string const& name() const { return name_; }
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    // appends the layer to `tile` as a Tile.layers message
+    void write(std::string& tile) const;
+
+  private:
+    std::uint32_t key_index(std::string const& key);
+    bool value_index(value const& val, std::uint32_t& index);
+
+    std::string name_;
+    std::uint32_t extent_;
+    std::size_t count_ = 0;
+    std::string features_;
+    std::vector<std::string> keys_;
+    std::unordered_map<std::string, std::uint32_t> key_map_;
+    // values are keyed by their encoded Value message, so 1 and 1.0 stay distinct
+    std::vector<std::string> values_;
+    std::unordered_map<std::string, std::uint32_t> value_map_;
+    std::vector<std::uint32_t> tags_;
+};
+
+} // namespace mvt
+} // namespace mapnik
+
+#endif // MAPNIK_MVT_ENCODER_HPP
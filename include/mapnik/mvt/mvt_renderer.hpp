@@ -0,0 +1,114 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_MVT_RENDERER_HPP
+#define MAPNIK_MVT_RENDERER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/feature_style_processor.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/view_transform.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/mvt/mvt.hpp>
+
+// stl
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+// fwd declarations to speed up compile
+namespace mapnik {
+class Map;
+class feature_impl;
+class feature_type_style;
+class layer;
+class proj_transform;
+class request;
+namespace mvt {
+class layer_builder;
+}
+} // namespace mapnik
+
+namespace mapnik {
+
+// Runs the layers, filters and scale dependent rules of a Map and encodes
+// every feature matched by at least one rule into a Mapbox Vector Tile
+// (specification version 2). Each map layer becomes a tile layer of the
+// same name; the symbolizers themselves are ignored.
+//
+// Geometries are transformed into tile coordinates, clipped to the tile
+// extent grown by the map buffer, snapped to the integer grid and repaired
+// (repeated and degenerate vertices removed, ring winding order fixed).
+class MAPNIK_DECL mvt_renderer : public feature_style_processor<mvt_renderer>,
+                                 private util::noncopyable
+{
+  public:
+    using processor_impl_type = mvt_renderer;
+    mvt_renderer(Map const& m,
+                 std::string& output,
+                 unsigned tile_extent = mvt::default_extent,
+                 double scale_factor = 1.0);
+    mvt_renderer(Map const& m,
+                 request const& req,
+                 attributes const& vars,
+                 std::string& output,
+                 unsigned tile_extent = mvt::default_extent,
+                 double scale_factor = 1.0);
+    ~mvt_renderer();
+    void start_map_processing(Map const& map);
+    void end_map_processing(Map const& map);
+    void start_layer_processing(layer const& lay, box2d<double> const& query_extent);
+    void end_layer_processing(layer const& lay);
+    void start_style_processing(feature_type_style const& st);
+    void end_style_processing(feature_type_style const& st);
+
+    bool process(rule::symbolizers const& syms, mapnik::feature_impl& feature, proj_transform const& prj_trans);
+
+    bool painted() const { return painted_; }
+    void painted(bool _painted) { painted_ = _painted; }
+
+    inline eAttributeCollectionPolicy attribute_collection_policy() const { return COLLECT_ALL; }
+    inline double scale_factor() const { return scale_factor_; }
+    inline attributes const& variables() const { return vars_; }
+    inline view_transform const& transform() const { return t_; }
+
+  private:
+    std::string& output_;
+    unsigned tile_extent_;
+    double scale_factor_;
+    attributes vars_;
+    view_transform t_;
+    box2d<double> clip_box_;
+    bool painted_;
+    std::unique_ptr<mvt::layer_builder> layer_;
+    // features are encoded once per layer, even when matched by several styles or rules
+    std::unordered_set<value_integer> encoded_;
+    feature_impl const* last_feature_;
+    unsigned style_index_;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_MVT_RENDERER_HPP
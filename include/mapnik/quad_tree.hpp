@@ -28,11 +28,16 @@
 #include <mapnik/util/noncopyable.hpp>
 
 // stl
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <new>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 #include <type_traits>
 
+#include <cstdint>
 #include <cstring>
 
 namespace mapnik {
@@ -79,6 +84,25 @@ class quad_tree : util::noncopyable
         ~node() {}
     };
 
+    // Node of a bulk loaded tree. Nodes are stored breadth-first in a single
+    // array so the children of a node are always adjacent, and items are
+    // referenced as a [first, first + count) range in a shared item array.
+    struct packed_node
+    {
+        explicit packed_node(bbox_type const& ext)
+            : extent_(ext),
+              first_item_(0),
+              num_items_(0),
+              first_child_(0),
+              num_children_(0)
+        {}
+        bbox_type extent_;
+        std::uint32_t first_item_;
+        std::uint32_t num_items_;
+        std::uint32_t first_child_;
+        std::uint32_t num_children_;
+    };
+
     using nodes_type = std::vector<std::unique_ptr<node>>;
     using cont_type = typename node::cont_type;
     using node_data_iterator = typename cont_type::iterator;
@@ -88,19 +112,42 @@ class quad_tree : util::noncopyable
     using const_iterator = typename nodes_type::const_iterator;
     using result_type = typename std::vector<std::reference_wrapper<value_type>>;
     using query_iterator = typename result_type::iterator;
+    using item_type = std::pair<value_type, bbox_type>;
 
     explicit quad_tree(bbox_type const& ext, unsigned int max_depth = 8, double ratio = 0.55)
         : max_depth_(max_depth)
         , ratio_(ratio)
         , query_result_()
         , nodes_()
+        , packed_storage_()
+        , packed_nodes_(nullptr)
+        , num_packed_nodes_(0)
+        , packed_items_()
     {
         nodes_.push_back(std::make_unique<node>(ext));
         root_ = nodes_[0].get();
     }
 
+    // Bulk loads an immutable tree. Items are partitioned by quadrant level
+    // by level, giving the same tree insert() and trim() would, and the nodes
+    // are laid out breadth-first in one contiguous, cache line aligned array
+    // with the items in a second array. A bulk loaded tree can be queried,
+    // visited and written, but not inserted into.
+    quad_tree(bbox_type const& ext,
+              std::vector<item_type> const& items,
+              unsigned int max_depth = 8,
+              double ratio = 0.55)
+        : quad_tree(ext, max_depth, ratio)
+    {
+        bulk_load(items);
+    }
+
     void insert(value_type const& data, bbox_type const& box)
     {
+        if (packed_nodes_)
+        {
+            throw std::runtime_error("quad_tree: can not insert into a bulk loaded tree");
+        }
         unsigned int depth = 0;
         do_insert_data(data, box, root_, depth);
     }
@@ -108,35 +155,63 @@ class quad_tree : util::noncopyable
     query_iterator query_in_box(bbox_type const& box)
     {
         query_result_.clear();
-        query_node(box, query_result_, root_);
+        if (packed_nodes_)
+            query_packed_node(box, 0);
+        else
+            query_node(box, query_result_, root_);
         return query_result_.begin();
     }
 
     query_iterator query_end() { return query_result_.end(); }
 
+    // Calls `visitor(value_type const&)` for every item of every node whose
+    // extent intersects `box`, in the same order as query_in_box(), without
+    // allocating.
+    template<typename Visitor>
+    void visit_in_box(bbox_type const& box, Visitor&& visitor) const
+    {
+        if (packed_nodes_)
+            visit_packed_node(box, visitor, 0);
+        else
+            visit_node(box, visitor, root_);
+    }
+
+    // iterates over the nodes of an insert-built tree; empty when bulk loaded
     const_iterator begin() const { return nodes_.begin(); }
 
     const_iterator end() const { return nodes_.end(); }
 
     void clear()
     {
-        bbox_type ext = root_->extent_;
+        bbox_type ext = extent();
+        packed_storage_.reset();
+        packed_nodes_ = nullptr;
+        num_packed_nodes_ = 0;
+        packed_items_.clear();
         nodes_.clear();
         nodes_.push_back(std::make_unique<node>(ext));
         root_ = nodes_[0].get();
     }
 
-    bbox_type const& extent() const { return root_->extent_; }
+    bbox_type const& extent() const { return packed_nodes_ ? packed_nodes_[0].extent_ : root_->extent_; }
 
-    int count() const { return count_nodes(root_); }
+    int count() const { return packed_nodes_ ? static_cast<int>(num_packed_nodes_) : count_nodes(root_); }
 
     int count_items() const
     {
+        if (packed_nodes_)
+            return static_cast<int>(packed_items_.size());
         int _count = 0;
         count_items(root_, _count);
         return _count;
     }
-    void trim() { trim_tree(root_); }
+
+    // bulk loaded trees are trimmed while loading
+    void trim()
+    {
+        if (!packed_nodes_)
+            trim_tree(root_);
+    }
 
     template<typename OutputStream>
     void write(OutputStream& out)
@@ -147,11 +222,213 @@ class quad_tree : util::noncopyable
         std::memset(header, 0, 16);
         std::strcpy(header, "mapnik-index");
         out.write(header, 16);
-        write_node(out, root_);
+        if (packed_nodes_)
+            write_packed_node(out, 0);
+        else
+            write_node(out, root_);
     }
 
   private:
 
+    // Node of a bulk load in progress: items are a range of the partitioned
+    // item order, children are indices into the same vector.
+    struct bulk_node
+    {
+        explicit bulk_node(bbox_type const& ext)
+            : extent_(ext),
+              first_item_(0),
+              num_items_(0),
+              num_children_(0)
+        {}
+        bbox_type extent_;
+        std::size_t first_item_;
+        std::size_t num_items_;
+        std::size_t children_[4];
+        unsigned num_children_;
+    };
+
+    struct bulk_state
+    {
+        std::vector<item_type> const& items;
+        std::vector<std::uint32_t> order;
+        std::vector<std::uint32_t> scratch;
+        std::vector<std::uint8_t> quadrant;
+        std::vector<bulk_node> nodes;
+    };
+
+    void bulk_load(std::vector<item_type> const& items)
+    {
+        if (items.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("quad_tree: too many items to bulk load");
+        }
+        bulk_state state{items, {}, {}, {}, {}};
+        state.order.resize(items.size());
+        for (std::size_t i = 0; i < items.size(); ++i)
+        {
+            state.order[i] = static_cast<std::uint32_t>(i);
+        }
+        state.scratch.resize(items.size());
+        state.quadrant.resize(items.size());
+        std::size_t root = bulk_build(state, root_->extent_, 0, items.size(), 0);
+
+        constexpr std::size_t cache_line_size = 64;
+        std::size_t const num_nodes = state.nodes.size();
+        std::size_t const size = num_nodes * sizeof(packed_node);
+        std::size_t space = size + cache_line_size;
+        std::unique_ptr<char[]> storage(new char[space]);
+        void* ptr = storage.get();
+        packed_node* nodes = static_cast<packed_node*>(std::align(cache_line_size, size, ptr, space));
+        static_assert(std::is_trivially_destructible<packed_node>::value,
+                      "packed nodes are never destroyed individually");
+
+        packed_items_.reserve(items.size());
+        std::vector<std::size_t> queue;
+        queue.reserve(num_nodes);
+        queue.push_back(root);
+        for (std::size_t i = 0; i < queue.size(); ++i)
+        {
+            bulk_node const& n = state.nodes[queue[i]];
+            packed_node* p = new (nodes + i) packed_node(n.extent_);
+            p->first_item_ = static_cast<std::uint32_t>(packed_items_.size());
+            p->num_items_ = static_cast<std::uint32_t>(n.num_items_);
+            for (std::size_t k = n.first_item_; k < n.first_item_ + n.num_items_; ++k)
+            {
+                packed_items_.push_back(items[state.order[k]].first);
+            }
+            p->first_child_ = static_cast<std::uint32_t>(queue.size());
+            p->num_children_ = n.num_children_;
+            queue.insert(queue.end(), n.children_, n.children_ + n.num_children_);
+        }
+        packed_storage_ = std::move(storage);
+        packed_nodes_ = nodes;
+        num_packed_nodes_ = num_nodes;
+        nodes_.clear();
+        nodes_.shrink_to_fit();
+        root_ = nullptr;
+    }
+
+    // Builds the subtree for order[first, last) and returns its node index.
+    // Items stay in their input order within a node, and a node left with a
+    // single child and no items is replaced by that child, as in trim_tree().
+    std::size_t
+      bulk_build(bulk_state& state, bbox_type const& ext, std::size_t first, std::size_t last, unsigned int depth)
+    {
+        constexpr std::uint8_t here = 4;
+        std::size_t counts[5] = {0, 0, 0, 0, 0};
+        bbox_type sub[4];
+        bool const split = ++depth < max_depth_;
+        if (split)
+        {
+            split_box(ext, sub);
+        }
+        for (std::size_t i = first; i < last; ++i)
+        {
+            std::uint8_t q = here;
+            if (split)
+            {
+                bbox_type const& box = state.items[state.order[i]].second;
+                for (std::uint8_t k = 0; k < 4; ++k)
+                {
+                    if (sub[k].contains(box))
+                    {
+                        q = k;
+                        break;
+                    }
+                }
+            }
+            state.quadrant[i] = q;
+            ++counts[q];
+        }
+        // stable counting sort: items kept by this node first, then quadrants 0 to 3
+        std::size_t start[5];
+        start[here] = first;
+        start[0] = first + counts[here];
+        for (int k = 1; k < 4; ++k)
+        {
+            start[k] = start[k - 1] + counts[k - 1];
+        }
+        std::size_t next[5] = {start[0], start[1], start[2], start[3], start[here]};
+        for (std::size_t i = first; i < last; ++i)
+        {
+            state.scratch[next[state.quadrant[i]]++] = state.order[i];
+        }
+        std::copy(state.scratch.begin() + first, state.scratch.begin() + last, state.order.begin() + first);
+
+        std::size_t children[4];
+        unsigned num_children = 0;
+        for (int k = 0; k < 4; ++k)
+        {
+            if (counts[k] > 0)
+            {
+                children[num_children++] = bulk_build(state, sub[k], start[k], start[k] + counts[k], depth);
+            }
+        }
+        if (num_children == 1 && counts[here] == 0)
+        {
+            return children[0];
+        }
+        state.nodes.emplace_back(ext);
+        bulk_node& n = state.nodes.back();
+        n.first_item_ = first;
+        n.num_items_ = counts[here];
+        n.num_children_ = num_children;
+        std::copy(children, children + num_children, n.children_);
+        return state.nodes.size() - 1;
+    }
+
+    void query_packed_node(bbox_type const& box, std::uint32_t index)
+    {
+        packed_node const& n = packed_nodes_[index];
+        if (box.intersects(n.extent_))
+        {
+            for (std::uint32_t i = n.first_item_; i < n.first_item_ + n.num_items_; ++i)
+            {
+                query_result_.push_back(std::ref(packed_items_[i]));
+            }
+            for (std::uint32_t i = n.first_child_; i < n.first_child_ + n.num_children_; ++i)
+            {
+                query_packed_node(box, i);
+            }
+        }
+    }
+
+    template<typename Visitor>
+    void visit_packed_node(bbox_type const& box, Visitor& visitor, std::uint32_t index) const
+    {
+        packed_node const& n = packed_nodes_[index];
+        if (box.intersects(n.extent_))
+        {
+            for (std::uint32_t i = n.first_item_; i < n.first_item_ + n.num_items_; ++i)
+            {
+                visitor(packed_items_[i]);
+            }
+            for (std::uint32_t i = n.first_child_; i < n.first_child_ + n.num_children_; ++i)
+            {
+                visit_packed_node(box, visitor, i);
+            }
+        }
+    }
+
+    template<typename Visitor>
+    void visit_node(bbox_type const& box, Visitor& visitor, node const* node_) const
+    {
+        if (node_)
+        {
+            if (box.intersects(node_->extent()))
+            {
+                for (auto const& n : *node_)
+                {
+                    visitor(n);
+                }
+                for (int k = 0; k < 4; ++k)
+                {
+                    visit_node(box, visitor, node_->children_[k]);
+                }
+            }
+        }
+    }
+
     void query_node(bbox_type const& box, result_type& result, node* node_) const
     {
         if (node_)
@@ -273,35 +550,46 @@ class quad_tree : util::noncopyable
         return offset;
     }
 
+    int packed_subnode_offset(std::uint32_t index) const
+    {
+        int offset = 0;
+        packed_node const& n = packed_nodes_[index];
+        for (std::uint32_t i = n.first_child_; i < n.first_child_ + n.num_children_; ++i)
+        {
+            offset += sizeof(bbox_type) + (packed_nodes_[i].num_items_ * sizeof(value_type)) + 3 * sizeof(int);
+            offset += packed_subnode_offset(i);
+        }
+        return offset;
+    }
+
+    template<typename OutputStream>
+    void write_record(OutputStream& out,
+                      int offset,
+                      bbox_type const& extent,
+                      value_type const* items,
+                      int shape_count,
+                      int num_subnodes) const
+    {
+        int recsize = sizeof(bbox_type) + 3 * sizeof(int) + shape_count * sizeof(value_type);
+        std::unique_ptr<char[]> node_record(new char[recsize]);
+        std::memset(node_record.get(), 0, recsize);
+        std::memcpy(node_record.get(), &offset, 4);
+        std::memcpy(node_record.get() + 4, &extent, sizeof(bbox_type));
+        std::memcpy(node_record.get() + 4 + sizeof(bbox_type), &shape_count, 4);
+        for (int i = 0; i < shape_count; ++i)
+        {
+            memcpy(node_record.get() + 8 + sizeof(bbox_type) + i * sizeof(value_type), items + i, sizeof(value_type));
+        }
+        std::memcpy(node_record.get() + 8 + sizeof(bbox_type) + shape_count * sizeof(value_type), &num_subnodes, 4);
+        out.write(node_record.get(), recsize);
+    }
+
     template<typename OutputStream>
     void write_node(OutputStream& out, node const* n) const
     {
         if (n)
         {
-            int offset = subnode_offset(n);
-            int shape_count = n->cont_.size();
-            int recsize = sizeof(bbox_type) + 3 * sizeof(int) + shape_count * sizeof(value_type);
-            std::unique_ptr<char[]> node_record(new char[recsize]);
-            std::memset(node_record.get(), 0, recsize);
-            std::memcpy(node_record.get(), &offset, 4);
-            std::memcpy(node_record.get() + 4, &n->extent_, sizeof(bbox_type));
-            std::memcpy(node_record.get() + 4 + sizeof(bbox_type), &shape_count, 4);
-            for (int i = 0; i < shape_count; ++i)
-            {
-                memcpy(node_record.get() + 8 + sizeof(bbox_type) + i * sizeof(value_type),
-                       &(n->cont_[i]),
-                       sizeof(value_type));
-            }
-            int num_subnodes = 0;
-            for (int i = 0; i < 4; ++i)
-            {
-                if (n->children_[i])
-                {
-                    ++num_subnodes;
-                }
-            }
-            std::memcpy(node_record.get() + 8 + sizeof(bbox_type) + shape_count * sizeof(value_type), &num_subnodes, 4);
-            out.write(node_record.get(), recsize);
+            write_record(out, subnode_offset(n), n->extent_, n->cont_.data(), n->cont_.size(), n->num_subnodes());
             for (int i = 0; i < 4; ++i)
             {
                 write_node(out, n->children_[i]);
@@ -309,11 +597,31 @@ class quad_tree : util::noncopyable
         }
     }
 
+    template<typename OutputStream>
+    void write_packed_node(OutputStream& out, std::uint32_t index) const
+    {
+        packed_node const& n = packed_nodes_[index];
+        write_record(out,
+                     packed_subnode_offset(index),
+                     n.extent_,
+                     packed_items_.data() + n.first_item_,
+                     n.num_items_,
+                     n.num_children_);
+        for (std::uint32_t i = n.first_child_; i < n.first_child_ + n.num_children_; ++i)
+        {
+            write_packed_node(out, i);
+        }
+    }
+
     const unsigned int max_depth_;
     const double ratio_;
     result_type query_result_;
     nodes_type nodes_;
     node* root_;
+    std::unique_ptr<char[]> packed_storage_;
+    packed_node* packed_nodes_;
+    std::size_t num_packed_nodes_;
+    std::vector<value_type> packed_items_;
 };
 } // namespace mapnik
 
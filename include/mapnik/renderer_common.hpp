@@ -35,6 +35,7 @@ namespace mapnik {
 class label_collision_detector4;
 class Map;
 class request;
+class simplified_geometry_cache;
 //  class attributes;
 } // namespace mapnik
 
@@ -80,6 +81,10 @@ struct renderer_common : private util::noncopyable
     box2d<double> query_extent_;
     view_transform t_;
     detector_ptr detector_;
+    // pre-simplified geometries of the datasource of the layer being rendered,
+    // simplify_source_ is 0 when that datasource isn't cached
+    std::shared_ptr<simplified_geometry_cache> simplify_cache_;
+    std::size_t simplify_source_;
 
   protected:
     // it's desirable to keep this class implicitly noncopyable to prevent
@@ -0,0 +1,94 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_RENDERER_COMMON_LABEL_BATCH_HPP
+#define MAPNIK_RENDERER_COMMON_LABEL_BATCH_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/renderer_common.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/symbolizer_base.hpp>
+#include <mapnik/text/symbolizer_helpers.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_trans_affine.h"
+MAPNIK_DISABLE_WARNING_POP
+
+// stl
+#include <memory>
+#include <vector>
+
+namespace mapnik {
+
+class proj_transform;
+class label_worker_pool;
+
+// Two-phase placement of the text and shield symbolizers of one style.
+// generate() lays out the labels and computes their first placement
+// candidates, optionally on the threads of a label_worker_pool, without
+// touching the collision detector. The caller then calls get() on each helper
+// in insertion order, which resolves the candidates against the detector
+// exactly as serial processing would.
+class MAPNIK_DECL label_batch : private util::noncopyable
+{
+  public:
+    struct item
+    {
+        feature_ptr feature;
+        symbolizer const* sym;
+        agg::trans_affine tr;
+        std::unique_ptr<text_symbolizer_helper> helper;
+        label_placement_cache::key_type placement_key;
+    };
+
+    label_batch(renderer_common& common, proj_transform const& prj_trans);
+    ~label_batch();
+
+    // Queue a text or shield symbolizer, returns false for any other type.
+    bool add(feature_ptr const& feature, symbolizer const& sym);
+    // Helpers look up and store their placements in cache, under the
+    // placement_key of their item.
+    void set_placement_cache(label_placement_cache* cache) { placement_cache_ = cache; }
+    // Lays out the labels on up to `threads` threads of `workers`.
+    void generate(label_worker_pool& workers, unsigned threads);
+    std::vector<item>& items() { return items_; }
+
+  private:
+    void prepare(item& it, face_manager& font_manager, bool candidates);
+
+    renderer_common& common_;
+    proj_transform const& prj_trans_;
+    box2d<double> const clip_box_;
+    label_placement_cache* placement_cache_;
+    std::vector<item> items_;
+    // per-worker face managers, referenced by the helpers until they are destroyed
+    std::vector<std::unique_ptr<face_manager>> font_managers_;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_RENDERER_COMMON_LABEL_BATCH_HPP
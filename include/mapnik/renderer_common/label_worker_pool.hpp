@@ -0,0 +1,83 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RENDERER_COMMON_LABEL_WORKER_POOL_HPP
+#define MAPNIK_RENDERER_COMMON_LABEL_WORKER_POOL_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mapnik {
+
+class font_library;
+
+// Persistent threads used by label_batch::generate(). Workers live as long as
+// the pool, so the faces they open stay in their thread local face caches
+// from one style (and, through agg_renderer_pool, one render) to the next.
+//
+// Faces opened by a worker are used by the renderer thread once run()
+// returns, so a pool must only serve one renderer at a time.
+class MAPNIK_DECL label_worker_pool : private util::noncopyable
+{
+  public:
+    using task_type = std::function<void(unsigned slot)>;
+
+    label_worker_pool();
+    ~label_worker_pool();
+
+    // Calls task(0) on the calling thread and task(1) .. task(threads - 1) on
+    // workers, returns when all are done. Rethrows the first exception.
+    void run(unsigned threads, task_type const& task);
+    // FreeType library of a worker slot, slot 0 is the calling thread
+    font_library& library(unsigned slot);
+    std::size_t size() const { return workers_.size(); }
+
+  private:
+    void work(unsigned slot, std::size_t seen);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    task_type const* task_;
+    unsigned active_;
+    unsigned pending_;
+    std::size_t generation_;
+    bool stop_;
+    std::exception_ptr error_;
+    std::vector<std::unique_ptr<font_library>> libraries_;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_RENDERER_COMMON_LABEL_WORKER_POOL_HPP
@@ -30,6 +30,7 @@
 
 #include <mapnik/feature.hpp>
 #include <mapnik/renderer_common/apply_vertex_converter.hpp>
+#include <mapnik/renderer_common/simplified_geometry.hpp>
 
 namespace mapnik {
 
@@ -52,6 +53,8 @@ void render_polygon_symbolizer(polygon_symbolizer const& sym,
     value_double smooth = get<value_double, keys::smooth>(sym, feature, common.vars_);
     value_double opacity = get<value_double, keys::fill_opacity>(sym, feature, common.vars_);
 
+    simplified_geometry_cache::path_ptr simplified = find_simplified_geometry(sym, feature, prj_trans, common);
+
     vertex_converter_type
       converter(clip_box, sym, common.t_, prj_trans, tr, feature, common.vars_, common.scale_factor_);
 
@@ -59,7 +62,7 @@ void render_polygon_symbolizer(polygon_symbolizer const& sym,
         converter.template set<clip_poly_tag>();
     converter.template set<transform_tag>(); // always transform
     converter.template set<affine_transform_tag>();
-    if (simplify_tolerance > 0.0)
+    if (simplify_tolerance > 0.0 && !simplified)
         converter.template set<simplify_tag>(); // optional simplify converter
     if (smooth > 0.0)
         converter.template set<smooth_tag>(); // optional smooth converter
@@ -67,7 +70,10 @@ void render_polygon_symbolizer(polygon_symbolizer const& sym,
     using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer_type>;
     using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
     apply_vertex_converter_type apply(converter, ras);
-    mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
+    if (simplified)
+        apply(geometry::simplified_path_adapter(*simplified));
+    else
+        mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
 
     color const& fill = get<mapnik::color, keys::fill>(sym, feature, common.vars_);
     fill_func(fill, opacity);
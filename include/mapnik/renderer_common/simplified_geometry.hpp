@@ -0,0 +1,161 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RENDERER_COMMON_SIMPLIFIED_GEOMETRY_HPP
+#define MAPNIK_RENDERER_COMMON_SIMPLIFIED_GEOMETRY_HPP
+
+// mapnik
+#include <mapnik/renderer_common.hpp>
+#include <mapnik/simplified_geometry_cache.hpp>
+#include <mapnik/simplify_converter.hpp>
+#include <mapnik/transform_path_adapter.hpp>
+#include <mapnik/vertex_processor.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/geometry/geometry_type.hpp>
+
+// stl
+#include <cmath>
+
+namespace mapnik {
+
+namespace detail {
+
+struct count_vertices
+{
+    template<typename T>
+    std::size_t operator()(geometry::line_string<T> const& line) const
+    {
+        return line.size();
+    }
+
+    template<typename T>
+    std::size_t operator()(geometry::polygon<T> const& poly) const
+    {
+        std::size_t count = 0;
+        for (auto const& ring : poly)
+            count += ring.size();
+        return count;
+    }
+
+    template<typename T>
+    std::size_t operator()(geometry::multi_line_string<T> const& multi) const
+    {
+        std::size_t count = 0;
+        for (auto const& line : multi)
+            count += (*this)(line);
+        return count;
+    }
+
+    template<typename T>
+    std::size_t operator()(geometry::multi_polygon<T> const& multi) const
+    {
+        std::size_t count = 0;
+        for (auto const& poly : multi)
+            count += (*this)(poly);
+        return count;
+    }
+
+    template<typename Geometry>
+    std::size_t operator()(Geometry const&) const
+    {
+        return 0;
+    }
+};
+
+// runs the transform + simplify part of the converter pipeline and stores
+// the result back in map coordinates
+struct append_simplified
+{
+    template<typename Adapter>
+    void operator()(Adapter const& va) const
+    {
+        using path_type = transform_path_adapter<view_transform, Adapter const>;
+        path_type path(t, va, prj_trans);
+        simplify_converter<path_type> simplified(path);
+        simplified.set_simplify_algorithm(algorithm);
+        simplified.set_simplify_tolerance(tolerance);
+        simplified.rewind(0);
+        double x, y;
+        unsigned cmd;
+        while ((cmd = simplified.vertex(&x, &y)) != SEG_END)
+        {
+            t.backward(&x, &y);
+            out.vertices.push_back({x, y, cmd});
+        }
+    }
+
+    view_transform const& t;
+    proj_transform const& prj_trans;
+    simplify_algorithm_e algorithm;
+    double tolerance;
+    simplified_path& out;
+};
+
+} // namespace detail
+
+// The simplified geometry of feature for sym from the cache attached to the
+// layer being rendered, building it on first use. Null if the cache doesn't
+// apply, in which case the geometry is simplified by the converter pipeline.
+// Only plain simplification is cached: no geometry-transform, no offset, no
+// reprojection and a view transform with square pixels. The cached path is
+// simplified right after the view transform, so anything the pipeline runs
+// in between would see different vertices.
+template<typename Symbolizer>
+simplified_geometry_cache::path_ptr find_simplified_geometry(Symbolizer const& sym,
+                                                             feature_impl const& feature,
+                                                             proj_transform const& prj_trans,
+                                                             renderer_common const& common)
+{
+    if (!common.simplify_cache_ || common.simplify_source_ == 0 || !prj_trans.equal())
+        return nullptr;
+    value_double tolerance = get<value_double, keys::simplify_tolerance>(sym, feature, common.vars_);
+    if (tolerance <= 0.0 || get_optional<transform_type>(sym, keys::geometry_transform))
+        return nullptr;
+    if (get<value_double, keys::offset>(sym, feature, common.vars_) != 0.0)
+        return nullptr;
+    view_transform const& t = common.t_;
+    if (std::fabs(t.scale_x() - t.scale_y()) > 1e-9 * t.scale_x())
+        return nullptr;
+    geometry::geometry<double> const& geom = feature.get_geometry();
+    if (util::apply_visitor(detail::count_vertices(), geom) < common.simplify_cache_->min_vertices())
+        return nullptr;
+
+    simplified_geometry_cache::key_type key{feature.id(),
+                                            simplified_geometry_cache::scale_bucket(t.scale_x()),
+                                            tolerance,
+                                            get<simplify_algorithm_e, keys::simplify_algorithm>(sym, feature, common.vars_)};
+    simplified_geometry_cache::path_ptr path = common.simplify_cache_->find(common.simplify_source_, key);
+    if (path)
+        return path;
+
+    simplified_path simplified;
+    simplified.type = geometry::geometry_type(geom);
+    detail::append_simplified append{t, prj_trans, key.algorithm, tolerance, simplified};
+    util::apply_visitor(geometry::vertex_processor<detail::append_simplified>(append), geom);
+    return common.simplify_cache_->insert(common.simplify_source_, key, std::move(simplified));
+}
+
+} // namespace mapnik
+
+#endif // MAPNIK_RENDERER_COMMON_SIMPLIFIED_GEOMETRY_HPP
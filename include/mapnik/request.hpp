@@ -27,6 +27,10 @@
 #include <mapnik/config.hpp>
 #include <mapnik/geometry/box2d.hpp>
 
+// stl
+#include <cstddef>
+#include <vector>
+
 namespace mapnik {
 
 class MAPNIK_DECL request
@@ -41,6 +45,10 @@ class MAPNIK_DECL request
     void set_extent(box2d<double> const& box);
     box2d<double> get_buffered_extent() const;
     double scale() const;
+    // per-request visibility of the Map's top-level layers, by index;
+    // all layers are enabled by default
+    void set_layer_enabled(std::size_t index, bool enabled);
+    bool layer_enabled(std::size_t index) const;
     ~request();
 
   private:
@@ -48,6 +56,7 @@ class MAPNIK_DECL request
     unsigned height_;
     box2d<double> extent_;
     int buffer_size_;
+    std::vector<bool> disabled_layers_;
 };
 
 } // namespace mapnik
@@ -0,0 +1,214 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_SIMPLIFIED_GEOMETRY_CACHE_HPP
+#define MAPNIK_SIMPLIFIED_GEOMETRY_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/simplify.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/geometry/geometry_types.hpp>
+#include <mapnik/value/types.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik {
+
+class datasource;
+
+// Vertices of a simplified feature geometry in map coordinates. The parts of
+// multi geometries are simplified separately and stored one after the other.
+struct simplified_path
+{
+    struct vertex
+    {
+        double x;
+        double y;
+        unsigned cmd;
+    };
+
+    geometry::geometry_types type = geometry::geometry_types::Unknown;
+    std::vector<vertex> vertices;
+};
+
+namespace geometry {
+
+struct simplified_path_adapter
+{
+    using coordinate_type = double;
+
+    explicit simplified_path_adapter(simplified_path const& path)
+        : path_(path)
+        , pos_(0)
+    {}
+
+    void rewind(unsigned) const { pos_ = 0; }
+
+    unsigned vertex(coordinate_type* x, coordinate_type* y) const
+    {
+        if (pos_ >= path_.vertices.size())
+            return SEG_END;
+        simplified_path::vertex const& v = path_.vertices[pos_++];
+        *x = v.x;
+        *y = v.y;
+        return v.cmd;
+    }
+
+    geometry_types type() const { return path_.type; }
+
+  private:
+    simplified_path const& path_;
+    mutable std::size_t pos_;
+};
+
+} // namespace geometry
+
+// Thread-safe store of simplified geometries of static datasources, shared
+// between renders of the same scale. A large coastline or boundary polygon is
+// simplified once per zoom level instead of once per tile; renders clip and
+// transform the stored geometry as usual. Geometries are looked up by feature
+// id, so only datasources whose ids are stable and unique are cached.
+class MAPNIK_DECL simplified_geometry_cache : private util::noncopyable
+{
+  public:
+    // identifies an attached datasource, 0 for one that isn't cached
+    using source_id = std::size_t;
+
+    struct key_type
+    {
+        value_integer feature_id;
+        // see scale_bucket()
+        int scale;
+        // simplify-tolerance in pixels
+        double tolerance;
+        simplify_algorithm_e algorithm;
+
+        bool operator==(key_type const& other) const
+        {
+            return feature_id == other.feature_id && scale == other.scale && tolerance == other.tolerance &&
+                   algorithm == other.algorithm;
+        }
+    };
+
+    using path_ptr = std::shared_ptr<simplified_path const>;
+
+    struct statistics
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t vertices = 0;
+    };
+
+    // max_vertices == 0 keeps every geometry until clear() is called,
+    // otherwise the oldest geometries of a shard are dropped first once it
+    // holds more than its share of max_vertices. Geometries with fewer than
+    // min_vertices vertices are cheap to simplify and not cached.
+    explicit simplified_geometry_cache(std::size_t max_vertices = 0, std::size_t min_vertices = 256);
+
+    // datasource types (the "type" parameter) that number their features
+    // the same way on every query. "shape" by default; "geojson" is cached
+    // only when its features are held in memory.
+    void add_static_type(std::string const& type);
+    // the id under which features of ds are cached, 0 if they may not be;
+    // forgets the geometries of datasources that were destroyed meanwhile
+    source_id attach(std::shared_ptr<datasource> const& ds);
+
+    // bucket of a view transform scale (pixels per map unit), 1/16 octave wide
+    static int scale_bucket(double scale);
+    std::size_t min_vertices() const { return min_vertices_; }
+
+    path_ptr find(source_id source, key_type const& key) const;
+    // the first geometry stored for a key wins, later ones are ignored
+    path_ptr insert(source_id source, key_type const& key, simplified_path&& path);
+    void clear();
+    statistics stats() const;
+
+  private:
+    struct entry_key
+    {
+        source_id source;
+        key_type key;
+
+        bool operator==(entry_key const& other) const { return source == other.source && key == other.key; }
+    };
+
+    struct key_hash
+    {
+        std::size_t operator()(entry_key const& key) const;
+    };
+
+    // Entries are spread over shards by key so that renders of different
+    // tiles rarely wait for each other; each shard evicts on its own.
+    struct shard
+    {
+#ifdef MAPNIK_THREADSAFE
+        mutable std::mutex mutex;
+#endif
+        std::unordered_map<entry_key, path_ptr, key_hash> entries;
+        std::deque<entry_key> order; // insertion order, oldest first
+        std::size_t vertices = 0;
+        std::size_t evictions = 0;
+    };
+
+    struct source
+    {
+        std::weak_ptr<datasource> owner;
+        source_id id;
+    };
+
+    bool stable_ids(datasource const& ds) const;
+    shard& shard_for(entry_key const& key) const;
+    void evict(shard& s);
+    void drop(source_id id);
+
+    std::size_t max_vertices_;
+    std::size_t min_vertices_;
+    mutable std::array<shard, 16> shards_;
+    mutable std::atomic<std::size_t> hits_;
+    mutable std::atomic<std::size_t> misses_;
+    // attached datasources, only touched by attach() once per layer and render
+    std::set<std::string> static_types_;
+    std::unordered_map<datasource const*, source> sources_;
+    source_id next_source_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex sources_mutex_;
+#endif
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_SIMPLIFIED_GEOMETRY_CACHE_HPP
@@ -0,0 +1,133 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_SVG_FLATTENED_PATH_HPP
+#define MAPNIK_SVG_FLATTENED_PATH_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/marker.hpp>
+#include <mapnik/svg/svg_path_attributes.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/vertex.hpp>
+
+// stl
+#include <cstddef>
+#include <vector>
+
+namespace mapnik {
+namespace svg {
+
+// Paths of an svg_storage with their curves flattened (and strokes
+// outlined) once for a scale bucket, in marker coordinates: the path
+// attribute transforms are already applied, so a placement only needs
+// the marker transform on top. Buckets are quarter octaves rounded up,
+// flattening for a bucket is at least as fine as for any scale in it.
+class MAPNIK_DECL svg_flattened_path : private util::noncopyable
+{
+  public:
+    struct vertex
+    {
+        double x;
+        double y;
+        unsigned cmd;
+    };
+
+    // Vertex source over the fill or stroke outline of one attribute,
+    // rewind takes the position of the attribute in the storage.
+    class source
+    {
+      public:
+        source(svg_flattened_path const& path, bool stroke)
+            : path_(path)
+            , stroke_(stroke)
+            , pos_(0)
+            , end_(0)
+        {}
+
+        void rewind(unsigned path_id)
+        {
+            pos_ = end_ = 0;
+            if (path_id < path_.entries_.size())
+            {
+                entry const& e = path_.entries_[path_id];
+                pos_ = stroke_ ? e.stroke_begin : e.fill_begin;
+                end_ = stroke_ ? e.stroke_end : e.fill_end;
+            }
+        }
+
+        unsigned vertex(double* x, double* y)
+        {
+            if (pos_ >= end_)
+                return SEG_END;
+            svg_flattened_path::vertex const& v = path_.vertices_[pos_++];
+            *x = v.x;
+            *y = v.y;
+            return v.cmd;
+        }
+
+      private:
+        svg_flattened_path const& path_;
+        bool stroke_;
+        std::size_t pos_;
+        std::size_t end_;
+    };
+
+    svg_flattened_path(svg_storage_type& storage, int bucket);
+
+    // Quarter octave bucket of a marker transform scale
+    static int bucket(double scale);
+    static double bucket_scale(int bucket);
+
+    int bucket() const { return bucket_; }
+
+    // True if `attr`, the attribute at `path_id` as it is about to be
+    // rendered (possibly with symbolizer overrides), can be drawn from the
+    // flattened paths: no gradients, same geometry and stroke parameters.
+    bool covers(unsigned path_id, path_attributes const& attr) const;
+
+    std::size_t size() const { return vertices_.size(); }
+
+  private:
+    struct entry
+    {
+        path_attributes attr;
+        std::size_t fill_begin;
+        std::size_t fill_end;
+        std::size_t stroke_begin;
+        std::size_t stroke_end;
+        bool has_stroke;
+    };
+
+    template<typename VertexSource>
+    void append(VertexSource& src, unsigned path_id, std::size_t& begin, std::size_t& end);
+
+    int bucket_;
+    std::vector<entry> entries_;
+    std::vector<vertex> vertices_;
+};
+
+} // namespace svg
+} // namespace mapnik
+
+#endif // MAPNIK_SVG_FLATTENED_PATH_HPP
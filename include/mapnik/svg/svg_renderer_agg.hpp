@@ -25,6 +25,7 @@
 
 // mapnik
 #include <mapnik/svg/svg_path_attributes.hpp>
+#include <mapnik/svg/svg_flattened_path.hpp>
 #include <mapnik/gradient.hpp>
 #include <mapnik/geometry/box2d.hpp>
 #include <mapnik/value/types.hpp>
@@ -62,6 +63,9 @@ MAPNIK_DISABLE_WARNING_PUSH
 #include "agg_span_interpolator_linear.h"
 MAPNIK_DISABLE_WARNING_POP
 
+// stl
+#include <memory>
+
 namespace mapnik {
 namespace svg {
 
@@ -131,8 +135,14 @@ class renderer_agg : util::noncopyable
         , curved_stroked_(curved_)
         , curved_dashed_stroked_(curved_dashed_)
         , attributes_(attributes)
+        , flattened_()
     {}
 
+    // Draw the attributes it covers from pre-flattened paths (see
+    // marker_cache::find_flattened) instead of flattening and stroking
+    // the curves for every call to render.
+    void set_flattened(std::shared_ptr<svg_flattened_path const> const& flattened) { flattened_ = flattened; }
+
     template<typename Rasterizer, typename Scanline, typename Renderer>
     void render_gradient(Rasterizer& ras,
                          Scanline& sl,
@@ -265,6 +275,12 @@ class renderer_agg : util::noncopyable
             if (!attr.visibility_flag)
                 continue;
 
+            if (flattened_ && flattened_->covers(i, attr))
+            {
+                render_flattened(ras, sl, ren, i, attr, mtx, opacity);
+                continue;
+            }
+
             transform = attr.transform;
 
             transform *= mtx;
@@ -503,12 +519,55 @@ class renderer_agg : util::noncopyable
 
   private:
 
+    template<typename Rasterizer, typename Scanline, typename Renderer>
+    void render_flattened(Rasterizer& ras,
+                          Scanline& sl,
+                          Renderer& ren,
+                          unsigned path_id,
+                          mapnik::svg::path_attributes const& attr,
+                          agg::trans_affine const& mtx,
+                          double opacity)
+    {
+        using source_type = svg_flattened_path::source;
+        agg::trans_affine transform = mtx;
+        typename PixelFormat::color_type color;
+        if (attr.fill_flag)
+        {
+            source_type fill(*flattened_, false);
+            agg::conv_transform<source_type> fill_trans(fill, transform);
+            ras.reset();
+            ras.add_path(fill_trans, path_id);
+            ras.filling_rule(attr.even_odd_flag ? agg::fill_even_odd : agg::fill_non_zero);
+            color = attr.fill_color;
+            color.opacity(color.opacity() * attr.fill_opacity * attr.opacity * opacity);
+            ScanlineRenderer ren_s(ren);
+            color.premultiply();
+            ren_s.color(color);
+            agg::render_scanlines(ras, sl, ren_s);
+        }
+        if (attr.stroke_flag)
+        {
+            source_type stroke(*flattened_, true);
+            agg::conv_transform<source_type> stroke_trans(stroke, transform);
+            ras.reset();
+            ras.add_path(stroke_trans, path_id);
+            ras.filling_rule(agg::fill_non_zero);
+            color = attr.stroke_color;
+            color.opacity(color.opacity() * attr.stroke_opacity * attr.opacity * opacity);
+            ScanlineRenderer ren_s(ren);
+            color.premultiply();
+            ren_s.color(color);
+            agg::render_scanlines(ras, sl, ren_s);
+        }
+    }
+
     VertexSource& source_;
     curved_type curved_;
     curved_dashed_type curved_dashed_;
     curved_stroked_type curved_stroked_;
     curved_dashed_stroked_type curved_dashed_stroked_;
     AttributeSource const& attributes_;
+    std::shared_ptr<svg_flattened_path const> flattened_;
 };
 
 } // namespace svg
@@ -42,6 +42,7 @@ MAPNIK_DISABLE_WARNING_POP
 // stl
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace mapnik {
@@ -69,8 +70,20 @@ class MAPNIK_DECL font_face : util::noncopyable
   private:
     bool init_color_font();
 
+    struct glyph_metrics
+    {
+        double ymin;
+        double ymax;
+        double advance;
+        double line_height;
+    };
+
     FT_Face face_;
     const bool color_font_;
+    // unscaled metrics only depend on the glyph once set_unscaled_character_sizes()
+    // succeeded, so they are remembered for the lifetime of the face
+    bool unscaled_;
+    mutable std::unordered_map<unsigned, glyph_metrics> glyph_metrics_;
 };
 using face_ptr = std::shared_ptr<font_face>;
 
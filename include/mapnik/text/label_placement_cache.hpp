@@ -0,0 +1,176 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_LABEL_PLACEMENT_CACHE_HPP
+#define MAPNIK_LABEL_PLACEMENT_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/pixel_position.hpp>
+#include <mapnik/text/rotation.hpp>
+#include <mapnik/value/types.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore.hpp>
+#include <unicode/unistr.h>
+MAPNIK_DISABLE_WARNING_POP
+
+// stl
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik {
+
+// A label accepted by an earlier render, stored independent of the extent it
+// was rendered at. Replaying it at the same zoom only needs a fresh layout of
+// the label text, not a new placement search.
+struct cached_label
+{
+    struct glyph
+    {
+        // position of the glyph in the layout, counting all lines of all layouts
+        unsigned index;
+        // relative to the base point, in pixels
+        pixel_position pos;
+        rotation rot;
+    };
+
+    // placement alternative the label was found with, see placement_finder::next_position()
+    unsigned position = 0;
+    // map coordinates of the glyph_positions base point
+    pixel_position anchor;
+    std::vector<glyph> glyphs;
+    bool has_marker = false;
+    // relative to the base point, in pixels
+    pixel_position marker_pos;
+    // map coordinates of the boxes added to the collision detector
+    std::vector<box2d<double>> boxes;
+    value_unicode_string text;
+};
+
+using cached_labels = std::vector<cached_label>;
+
+// Thread-safe store of label placements shared between renders of the same
+// zoom level, e.g. the tiles of neighbouring metatiles while seeding. Renders
+// look up the placements of a feature here before searching for one, and seed
+// their collision detector with the labels already placed around them so that
+// labels crossing tile edges agree on both sides.
+class MAPNIK_DECL label_placement_cache : private util::noncopyable
+{
+  public:
+    struct key_type
+    {
+        std::string layer;
+        int zoom;
+        value_integer feature_id;
+        // position of the style in the layer and of the label symbolizer among
+        // those applied to the feature by that style
+        unsigned style;
+        unsigned symbolizer;
+
+        bool operator==(key_type const& other) const
+        {
+            return feature_id == other.feature_id && symbolizer == other.symbolizer && style == other.style &&
+                   zoom == other.zoom && layer == other.layer;
+        }
+    };
+
+    using labels_ptr = std::shared_ptr<cached_labels const>;
+
+    struct statistics
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t features = 0;
+    };
+
+    // max_features == 0 keeps every placement until clear() is called,
+    // otherwise the oldest features are dropped first
+    explicit label_placement_cache(std::size_t max_features = 0);
+    // Sets the cell size of the lookup grid of a layer and zoom, typically
+    // a fraction of the rendered extent in map units. Without it, the cell
+    // size is guessed from the first label stored. Only has an effect before
+    // the first label of that layer and zoom is stored.
+    void set_cell_size(std::string const& layer, int zoom, double cell_size);
+
+    labels_ptr find(key_type const& key);
+    // the first placement stored for a key wins, later ones are ignored
+    void insert(key_type const& key, cached_labels labels);
+    // labels of layer and zoom whose boxes intersect extent (map coordinates)
+    std::vector<labels_ptr> query(std::string const& layer, int zoom, box2d<double> const& extent) const;
+    void clear();
+    statistics stats() const;
+
+  private:
+    struct key_hash
+    {
+        std::size_t operator()(key_type const& key) const;
+    };
+
+    struct entry
+    {
+        labels_ptr labels;
+        box2d<double> bounds;
+        std::vector<std::uint64_t> cells;
+    };
+
+    // uniform grid over the label bounds of one layer and zoom, bounds covering
+    // more than max_cells cells are kept in a list checked by every query
+    struct grid
+    {
+        double cell_size = 0.0;
+        std::unordered_map<std::uint64_t, std::vector<key_type const*>> cells;
+        std::vector<key_type const*> large;
+    };
+
+    static constexpr double max_cells = 64.0;
+
+    void evict();
+    // number of cells box covers, without enumerating them
+    static double cell_count(grid const& g, box2d<double> const& box);
+    static std::vector<std::uint64_t> cells(grid const& g, box2d<double> const& box);
+
+    std::size_t max_features_;
+    std::unordered_map<key_type, entry, key_hash> entries_;
+    std::unordered_map<std::string, grid> grids_; // "<zoom>/<layer>"
+    std::deque<key_type> order_;                  // insertion order, oldest first
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+    mutable statistics stats_;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_LABEL_PLACEMENT_CACHE_HPP
@@ -28,8 +28,18 @@
 #include <mapnik/text/text_layout.hpp>
 #include <mapnik/text/glyph_positions.hpp>
 #include <mapnik/text/rotation.hpp>
+#include <mapnik/text/label_placement_cache.hpp>
 #include <mapnik/util/noncopyable.hpp>
 
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore.hpp>
+#include <boost/optional.hpp>
+MAPNIK_DISABLE_WARNING_POP
+
+// stl
+#include <vector>
+
 namespace mapnik {
 
 class label_collision_detector4;
@@ -37,9 +47,37 @@ using DetectorType = label_collision_detector4;
 
 class feature_impl;
 class vertex_cache;
+class view_transform;
 class text_placement_info;
 struct glyph_info;
 
+// A label position found without consulting the collision detector, so that
+// candidates for many features can be generated concurrently and placed later,
+// in order, by placement_finder::place().
+struct label_candidate
+{
+    glyph_positions_ptr glyphs;
+    // boxes that must not collide with labels placed before
+    std::vector<box2d<double>> checks;
+    // boxes added to the detector when the candidate is placed
+    std::vector<box2d<double>> bboxes;
+    boost::optional<box2d<double>> marker_box;
+    value_unicode_string repeat_key;
+    double margin = 0.0;
+    double repeat_distance = 0.0;
+    bool allow_overlap = false;
+};
+
+// Candidates for a single point or geometry. Of each group the first candidate
+// that fits is placed, the same way positions along a line are tried one offset
+// after the other until one fits.
+struct label_candidates
+{
+    std::vector<std::vector<label_candidate>> groups;
+    // the geometry counts as placed without a label, e.g. it has no text to place
+    bool placed = false;
+};
+
 class placement_finder : util::noncopyable
 {
   public:
@@ -61,10 +99,32 @@ class placement_finder : util::noncopyable
 
     placements_list const& placements() const { return placements_; }
 
+    // While set, find_point_placement() and find_line_placements() record every
+    // candidate position they find into candidates and return false, leaving the
+    // detector untouched.
+    void record_candidates(label_candidates* candidates) { candidates_ = candidates; }
+    // Places recorded candidates, returns true if any of them was placed.
+    bool place(label_candidates& candidates);
+
+    // While set, every label added to the detector is also appended to labels,
+    // with t mapping its pixel positions to map coordinates.
+    void record_placements(cached_labels* labels, view_transform const* t)
+    {
+        recorded_ = labels;
+        record_transform_ = t;
+    }
+    // Re-creates labels recorded by an earlier render of the same zoom level
+    // without consulting the detector. Returns false if none of them could be
+    // replayed, e.g. they do not match the layout of this feature; the next
+    // next_position() call then starts from the first alternative again.
+    bool replay(cached_labels const& labels, view_transform const& t);
+
     void
       set_marker(marker_info_ptr m, box2d<double> box, bool marker_unlocked, pixel_position const& marker_displacement);
 
   private:
+    // Goes back to the state before the first next_position() call.
+    void rewind();
     bool single_line_placement(vertex_cache& pp, text_upright_e orientation);
     // Moves dx pixels but makes sure not to fall of the end.
     void path_move_dx(vertex_cache& pp, double dx);
@@ -72,6 +132,23 @@ class placement_finder : util::noncopyable
     double get_spacing(double path_length, double layout_width) const;
     // Checks for collision.
     bool collision(box2d<double> const& box, const value_unicode_string& repeat_key, bool line_placement) const;
+    double margin(bool line_placement) const;
+    double repeat_distance(bool line_placement) const;
+    // Adds the label boxes to the detector and the glyphs to placements_ unless off the canvas.
+    void commit(glyph_positions_ptr& glyphs,
+                std::vector<box2d<double>> const& bboxes,
+                value_unicode_string const& repeat_key);
+    void record(glyph_positions_ptr glyphs,
+                std::vector<box2d<double>> checks,
+                std::vector<box2d<double>> bboxes,
+                boost::optional<box2d<double>> const& marker_box,
+                bool line_placement);
+    bool place(label_candidate& candidate);
+    void record_placement(glyph_positions const& glyphs, std::vector<box2d<double>> const& bboxes);
+    // All glyphs of the current layouts, in the order placements visit them.
+    std::vector<glyph_info const*> layout_glyphs() const;
+    // Tries the opposite orientation once the glyphs in bboxes are known to fit.
+    bool retry_placement(vertex_cache& pp, text_upright_e orientation, std::vector<box2d<double>> const& bboxes);
     // Adds marker to glyph_positions and to collision detector. Returns false if there is a collision.
     bool add_marker(glyph_positions_ptr& glyphs, pixel_position const& pos, std::vector<box2d<double>>& bboxes) const;
     // Maps upright==auto, left-only and right-only to left,right to simplify processing.
@@ -98,6 +175,13 @@ class placement_finder : util::noncopyable
     pixel_position marker_displacement_;
     double move_dx_;
     horizontal_alignment_e horizontal_alignment_;
+    label_candidates* candidates_;
+    // boxes of a first attempt that a recorded retry also has to check
+    std::vector<box2d<double>> pending_checks_;
+    // number of placement alternatives tried so far
+    unsigned position_;
+    cached_labels* recorded_;
+    view_transform const* record_transform_;
 };
 
 } // namespace mapnik
@@ -36,7 +36,11 @@ template<typename T>
 bool placement_finder::find_line_placements(T& path, bool points)
 {
     if (!layouts_.line_count())
+    {
+        if (candidates_)
+            candidates_->placed = true;
         return true; // TODO
+    }
     vertex_cache pp(path);
 
     bool success = false;
@@ -46,6 +50,8 @@ bool placement_finder::find_line_placements(T& path, bool points)
         {
             if (pp.length() <= 0.001)
             {
+                if (candidates_)
+                    candidates_->groups.emplace_back();
                 success = find_point_placement(pp.current_position()) || success;
                 continue;
             }
@@ -83,6 +89,8 @@ bool placement_finder::find_line_placements(T& path, bool points)
 
         do
         {
+            if (candidates_)
+                candidates_->groups.emplace_back();
             tolerance_iterator tolerance_offset(text_props_->label_position_tolerance * scale_factor_,
                                                 spacing); // TODO: Handle halign
             while (tolerance_offset.next())
@@ -52,6 +52,10 @@ class MAPNIK_DECL text_placement_info : util::noncopyable
     // considered invalid!
 
     virtual bool next() const = 0;
+    // Rewinds to the state before the first next() call.
+    // The default restores the parent's default properties, classes that
+    // keep more state have to reset it as well.
+    virtual void reset() const;
     virtual ~text_placement_info() {}
 
     // Properties actually used by placement finder and renderer. Values in
@@ -60,6 +64,9 @@ class MAPNIK_DECL text_placement_info : util::noncopyable
 
     // Scale factor used by the renderer.
     double scale_factor;
+
+  protected:
+    text_placements const* placements_;
 };
 
 using text_placement_info_ptr = std::shared_ptr<text_placement_info>;
@@ -50,6 +50,7 @@ class MAPNIK_DECL text_placement_info_dummy : public text_placement_info
         , state(0)
     {}
     bool next() const;
+    void reset() const { state = 0; }
 
   private:
     mutable unsigned state;
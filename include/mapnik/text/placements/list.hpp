@@ -39,6 +39,7 @@ class MAPNIK_DECL text_placements_list : public text_placements
     virtual void add_expressions(expression_set& output) const;
     text_symbolizer_properties& add();
     text_symbolizer_properties& get(unsigned i);
+    text_symbolizer_properties const& get(unsigned i) const;
     std::size_t size() const;
     static text_placements_ptr from_xml(xml_node const& xml, fontset_map const& fontsets, bool is_shield);
 
@@ -58,6 +59,7 @@ class MAPNIK_DECL text_placement_info_list : public text_placement_info
         , parent_(parent)
     {}
     bool next() const;
+    void reset() const;
 
   private:
     mutable unsigned state;
@@ -43,6 +43,7 @@ class MAPNIK_DECL text_placements_simple : public text_placements
     text_placement_info_ptr
       get_placement_info(double _scale_factor, feature_impl const& feature, attributes const& vars) const;
     std::string get_positions() const;
+    symbolizer_base::value_type const& positions() const { return positions_; }
     static text_placements_ptr from_xml(xml_node const& xml, fontset_map const& fontsets, bool is_shield);
     std::vector<directions_e> direction_;
     std::vector<int> text_sizes_;
@@ -61,6 +62,7 @@ class MAPNIK_DECL text_placement_info_simple : public text_placement_info
                                std::string const& evaluated_positions,
                                double _scale_factor);
     bool next() const;
+    void reset() const;
 
   protected:
     bool next_position_only() const;
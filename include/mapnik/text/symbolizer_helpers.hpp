@@ -159,6 +159,16 @@ class text_symbolizer_helper : public base_symbolizer_helper
     // Return all placements.
     placements_list const& get() const;
 
+    // Generate the first set of placement candidates without touching the
+    // collision detector. Safe to run concurrently for helpers that do not
+    // share a font manager; a later get() resolves the candidates in order.
+    void generate_candidates() const;
+
+    // Reuse the placements an earlier render stored in cache under key, and
+    // store them there otherwise. The detector is expected to hold the cached
+    // labels already, see agg_renderer::set_label_placement_cache().
+    void set_placement_cache(label_placement_cache& cache, label_placement_cache::key_type const& key) const;
+
   protected:
     void init_converters();
     void initialize_points() const;
@@ -166,8 +176,15 @@ class text_symbolizer_helper : public base_symbolizer_helper
     void initialize_grid_points() const;
     bool next_point_placement() const;
     bool next_line_placement() const;
+    void place_candidates() const;
+    bool replay_placements() const;
 
     mutable placement_finder finder_;
+    // One entry per point or geometry, filled by generate_candidates().
+    mutable std::vector<label_candidates> candidates_;
+    mutable label_placement_cache* placement_cache_ = nullptr;
+    mutable label_placement_cache::key_type placement_key_;
+    mutable cached_labels cached_labels_;
 
     placement_finder_adapter<placement_finder> adapter_;
     mutable vertex_converter_type converter_;
@@ -0,0 +1,163 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_TIFF_TILE_CACHE_HPP
+#define MAPNIK_TIFF_TILE_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace mapnik {
+
+// Bounded LRU of decoded TIFF tiles shared by all tiff readers. It is disabled
+// until set_max_size() is given a non zero size in bytes; while enabled, file
+// based tiff readers look up the tiles they need here and decode the missing
+// ones. Decoding happens on the reading thread unless set_decode_threads() is
+// raised, in which case readers are helped by a pool of decode_threads() - 1
+// threads shared by the whole process.
+class MAPNIK_DECL tiff_tile_cache : public singleton<tiff_tile_cache, CreateStatic>,
+                                    private util::noncopyable
+{
+    friend class CreateStatic<tiff_tile_cache>;
+
+  public:
+    struct key_type
+    {
+        std::string file;
+        std::uint32_t directory;
+        std::uint32_t tile;
+        // identifies how the tile was decoded, e.g. expanded to RGBA or raw samples
+        std::uint32_t layout;
+
+        bool operator==(key_type const& other) const
+        {
+            return tile == other.tile && directory == other.directory && layout == other.layout &&
+                   file == other.file;
+        }
+    };
+
+    using tile_ptr = std::shared_ptr<std::vector<std::uint8_t> const>;
+
+    struct statistics
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t tiles = 0;
+        std::size_t size = 0;
+
+        double hit_rate() const
+        {
+            std::size_t total = hits + misses;
+            return total > 0 ? static_cast<double>(hits) / total : 0.0;
+        }
+    };
+
+    void set_max_size(std::size_t bytes);
+    std::size_t max_size() const;
+    void set_decode_threads(unsigned threads);
+    unsigned decode_threads() const;
+    bool enabled() const;
+
+    /**
+     * @brief calls job on the calling thread and helper on up to helpers pool threads
+     *
+     * Returns once every started call has returned. Helper calls still queued
+     * when job returns are withdrawn, so both are expected to share their work
+     * through the state they capture. Exceptions thrown by helper are logged
+     * and dropped, those thrown by job are rethrown.
+     *
+     * @param helpers number of pool threads wanted, bounded by decode_threads() - 1
+     * @param helper work to run on pool threads
+     * @param job work to run on the calling thread
+     */
+    void run_decode(unsigned helpers, std::function<void()> const& helper, std::function<void()> const& job);
+
+    tile_ptr find(key_type const& key);
+    void insert(key_type const& key, tile_ptr tile);
+    /**
+     * @brief removes all tiles decoded from file
+     *
+     * @param file path the tiles were read from
+     * @return true if any tile was removed
+     */
+    bool remove(std::string const& file);
+    void clear();
+    statistics stats() const;
+    void reset_stats();
+
+  private:
+    tiff_tile_cache();
+    ~tiff_tile_cache();
+
+    struct key_hash
+    {
+        std::size_t operator()(key_type const& key) const;
+    };
+
+    using entry_type = std::pair<key_type, tile_ptr>;
+    using list_type = std::list<entry_type>;
+
+    void evict(std::size_t max_size);
+#ifdef MAPNIK_THREADSAFE
+    struct decode_batch;
+    void decode_worker(unsigned index);
+#endif
+
+    list_type tiles_; // most recently used first
+    std::unordered_map<key_type, list_type::iterator, key_hash> index_;
+    std::size_t max_size_;
+    statistics stats_;
+#ifdef MAPNIK_THREADSAFE
+    // decode pool, guarded by pool_mutex_
+    mutable std::mutex pool_mutex_;
+    std::condition_variable pool_wake_;
+    std::condition_variable pool_done_;
+    std::list<decode_batch*> queue_;
+    std::vector<std::thread> workers_;
+    bool stop_;
+#endif
+    unsigned decode_threads_;
+};
+
+extern template class MAPNIK_DECL singleton<tiff_tile_cache, CreateStatic>;
+
+} // namespace mapnik
+
+#endif // MAPNIK_TIFF_TILE_CACHE_HPP
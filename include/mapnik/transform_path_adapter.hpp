@@ -27,6 +27,9 @@
 #include <mapnik/vertex.hpp>
 #include <mapnik/config.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
 
 namespace mapnik {
@@ -56,59 +59,119 @@ struct transform_path_adapter
     using size_type = std::size_t;
     using value_type = typename select_value_type<Geometry, void>::type;
 
+    // number of vertices reprojected with a single proj_transform call
+    static constexpr std::size_t batch_size = 128;
+
     transform_path_adapter(Transform const& _t, Geometry& _geom, proj_transform const& prj_trans)
         : t_(&_t)
         , geom_(_geom)
         , prj_trans_(&prj_trans)
+        , pos_(0)
+        , size_(0)
     {}
 
     explicit transform_path_adapter(Geometry& _geom)
         : t_(0)
         , geom_(_geom)
         , prj_trans_(0)
+        , pos_(0)
+        , size_(0)
     {}
 
     void set_proj_trans(proj_transform const& prj_trans) { prj_trans_ = &prj_trans; }
 
     void set_trans(Transform const& t) { t_ = &t; }
 
+    // Vertices are pulled from the geometry and reprojected in runs of up to
+    // batch_size, so PROJ is called once per run instead of once per vertex.
+    // Vertices that fail to reproject are skipped, and the next line segment
+    // becomes a move as before.
     unsigned vertex(double* x, double* y) const
     {
-        unsigned command;
-        bool ok = false;
         bool skipped_points = false;
-        while (!ok)
+        while (true)
         {
-            command = geom_.vertex(x, y);
+            if (pos_ == size_)
+            {
+                fill();
+            }
+            std::size_t i = pos_++;
+            unsigned command = commands_[i];
+            *x = xs_[i];
+            *y = ys_[i];
             if (command == SEG_END || command == SEG_CLOSE)
             {
                 return command;
             }
-            double z = 0;
-            ok = prj_trans_->backward(*x, *y, z);
-            if (!ok)
+            if (!ok_[i])
             {
                 skipped_points = true;
+                continue;
             }
+            if (skipped_points && (command == SEG_LINETO))
+            {
+                command = SEG_MOVETO;
+            }
+            t_->forward(x, y);
+            return command;
         }
-        if (skipped_points && (command == SEG_LINETO))
-        {
-            command = SEG_MOVETO;
-        }
-        t_->forward(x, y);
-        return command;
     }
 
-    void rewind(unsigned pos) const { geom_.rewind(pos); }
+    void rewind(unsigned pos) const
+    {
+        pos_ = size_ = 0;
+        geom_.rewind(pos);
+    }
 
     unsigned type() const { return static_cast<unsigned>(geom_.type()); }
 
     Geometry const& geom() const { return geom_; }
 
   private:
+    // Reads vertices up to and including the next SEG_END or SEG_CLOSE, which
+    // are passed through untouched, and reprojects the ones before it.
+    void fill() const
+    {
+        pos_ = size_ = 0;
+        std::size_t count = 0;
+        while (size_ < batch_size)
+        {
+            xs_[size_] = ys_[size_] = 0.0;
+            unsigned command = geom_.vertex(&xs_[size_], &ys_[size_]);
+            commands_[size_++] = command;
+            if (command == SEG_END || command == SEG_CLOSE)
+            {
+                break;
+            }
+            ++count;
+        }
+        if (count == 0)
+        {
+            return;
+        }
+        if (prj_trans_->backward(xs_.data(), ys_.data(), nullptr, count))
+        {
+            std::fill(ok_.begin(), ok_.begin() + count, true);
+        }
+        else
+        {
+            // failed vertices are set to HUGE_VAL
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                ok_[i] = xs_[i] != HUGE_VAL && ys_[i] != HUGE_VAL;
+            }
+        }
+    }
+
     Transform const* t_;
     Geometry& geom_;
     proj_transform const* prj_trans_;
+    mutable std::size_t pos_;
+    mutable std::size_t size_;
+    mutable std::array<double, batch_size> xs_;
+    mutable std::array<double, batch_size> ys_;
+    mutable std::array<unsigned, batch_size> commands_;
+    mutable std::array<bool, batch_size> ok_;
 };
 
 } // namespace mapnik
@@ -27,6 +27,7 @@
 #include <mapnik/config.hpp>
 
 // stl
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,13 @@ MAPNIK_DECL bool exists(std::string const& value);
 MAPNIK_DECL bool is_directory(std::string const& value);
 MAPNIK_DECL bool is_regular_file(std::string const& value);
 MAPNIK_DECL bool remove(std::string const& value);
+// replaces an existing destination, atomically where the platform allows it
+MAPNIK_DECL bool rename(std::string const& from, std::string const& to);
+// size in bytes, or 0 if the file cannot be inspected
+MAPNIK_DECL std::uintmax_t file_size(std::string const& value);
+// opaque modification stamp, only meaningful when compared with another stamp
+// of the same file; 0 if the file cannot be inspected
+MAPNIK_DECL std::int64_t last_write_time(std::string const& value);
 MAPNIK_DECL bool is_relative(std::string const& value);
 MAPNIK_DECL std::string make_relative(std::string const& filepath, std::string const& base);
 MAPNIK_DECL std::string make_absolute(std::string const& filepath, std::string const& base);
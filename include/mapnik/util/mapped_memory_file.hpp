@@ -25,11 +25,11 @@
 
 #include <mapnik/config.hpp>
 #include <mapnik/util/noncopyable.hpp>
+#include <mapnik/mapped_memory_cache.hpp>
 
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
-#include <mapnik/mapped_memory_cache.hpp>
 #else
 #include <fstream>
 #endif
@@ -55,7 +55,7 @@ class MAPNIK_DECL mapped_memory_file : public noncopyable
 
   public:
     mapped_memory_file();
-    explicit mapped_memory_file(std::string const& file_name);
+    explicit mapped_memory_file(std::string const& file_name, mapped_access access = mapped_access::normal);
     virtual ~mapped_memory_file();
 
     file_source_type& file();
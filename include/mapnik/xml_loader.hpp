@@ -28,11 +28,15 @@
 
 // stl
 #include <string>
+#include <vector>
 
 namespace mapnik {
 class MAPNIK_DECL xml_node;
 MAPNIK_DECL void read_xml(std::string const& filename, xml_node& node);
 MAPNIK_DECL void read_xml_string(std::string const& str, xml_node& node, std::string const& base_path = "");
+// Like read_xml(), and also lists every file read while parsing: `filename`
+// itself, XIncludes and external entities.
+MAPNIK_DECL void read_xml(std::string const& filename, xml_node& node, std::vector<std::string>& dependencies);
 } // namespace mapnik
 
 #endif // MAPNIK_LIBXML2_LOADER_HPP
@@ -61,6 +61,9 @@ MAPNIK_DISABLE_WARNING_POP
 #include <vector>
 #include <string>
 #include <algorithm>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#endif
 
 using mapnik::datasource;
 using mapnik::parameters;
@@ -79,6 +82,12 @@ csv_datasource::csv_datasource(parameters const& params)
     row_limit_ = *params.get<mapnik::value_integer>("row_limit", 0);
     manual_headers_ = mapnik::util::trim_copy(*params.get<std::string>("headers", ""));
     strict_ = *params.get<mapnik::boolean_type>("strict", false);
+#ifdef MAPNIK_THREADSAFE
+    // large files are split into chunks parsed on this many threads
+    mapnik::value_integer threads =
+      *params.get<mapnik::value_integer>("threads", std::thread::hardware_concurrency());
+    num_threads_ = static_cast<std::size_t>(std::max<mapnik::value_integer>(1, threads));
+#endif
 
     auto quote_param = params.get<std::string>("quote");
     if (quote_param)
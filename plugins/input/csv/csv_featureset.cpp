@@ -59,7 +59,8 @@ csv_featureset::csv_featureset(std::string const& filename,
     , tr_("utf8")
 {
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
-    boost::optional<mapnik::mapped_region_ptr> memory = mapnik::mapped_memory_cache::instance().find(filename, true);
+    boost::optional<mapnik::mapped_region_ptr> memory =
+      mapnik::mapped_memory_cache::instance().find(filename, true, mapnik::mapped_access::random);
     if (memory)
     {
         mapped_region_ = *memory;
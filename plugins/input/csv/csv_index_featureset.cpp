@@ -57,7 +57,8 @@ csv_index_featureset::csv_index_featureset(std::string const& filename,
 
 {
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
-    boost::optional<mapnik::mapped_region_ptr> memory = mapnik::mapped_memory_cache::instance().find(filename, true);
+    boost::optional<mapnik::mapped_region_ptr> memory =
+      mapnik::mapped_memory_cache::instance().find(filename, true, mapnik::mapped_access::random);
     if (memory)
     {
         mapped_region_ = *memory;
@@ -36,12 +36,21 @@
 #include "csv_utils.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <cstdio>
 #include <algorithm>
+#include <iterator>
+#include <exception>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#endif
 
 // boost string algo
 #include <boost/algorithm/string/trim.hpp>
+#ifdef MAPNIK_MEMORY_MAPPED_FILE
+#include <boost/interprocess/streams/bufferstream.hpp>
+#endif
 
 namespace csv_utils {
 namespace detail {
@@ -187,6 +196,95 @@ void locate_geometry_column(std::string const& header, std::size_t index, geomet
     }
 }
 
+// chunks smaller than this are not worth a thread of their own
+static constexpr std::size_t min_chunk_size = 1 << 20;
+
+// Parses a single record into `values` and its geometry envelope into `box`.
+// Returns false if the record has no usable geometry; the error is logged, or
+// thrown as mapnik::datasource_exception when `strict` is set.
+bool parse_record(char const* start,
+                  char const* end,
+                  int line_number,
+                  std::size_t num_headers,
+                  geometry_column_locator const& locator,
+                  char separator,
+                  char quote,
+                  bool strict,
+                  mapnik::csv_line& values,
+                  mapnik::box2d<double>& box)
+{
+    try
+    {
+        values = csv_utils::parse_line(start, end, separator, quote, num_headers);
+        unsigned num_fields = values.size();
+        if (num_fields != num_headers)
+        {
+            std::ostringstream s;
+            s << "CSV Plugin: # of columns(" << num_fields << ")";
+            if (num_fields > num_headers)
+            {
+                s << " > ";
+            }
+            else
+            {
+                s << " < ";
+            }
+            s << "# of headers(" << num_headers << ") parsed";
+            throw mapnik::datasource_exception(s.str());
+        }
+
+        auto geom = extract_geometry(values, locator);
+        if (!geom.is<mapnik::geometry::geometry_empty>())
+        {
+            box = mapnik::geometry::envelope(geom);
+            return true;
+        }
+        else
+        {
+            std::ostringstream s;
+            s << "CSV Plugin: expected geometry column: could not parse row " << line_number << " "
+              << values.at(locator.index) << "'";
+            throw mapnik::datasource_exception(s.str());
+        }
+    }
+    catch (mapnik::datasource_exception const& ex)
+    {
+        if (strict)
+            throw ex;
+        else
+        {
+            MAPNIK_LOG_ERROR(csv) << ex.what() << " at line: " << line_number;
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::ostringstream s;
+        s << "CSV Plugin: unexpected error parsing line: " << line_number << " - found " << num_headers
+          << " with values like: " << std::string(start, end) << "\n"
+          << " and got error like: " << ex.what();
+        if (strict)
+        {
+            throw mapnik::datasource_exception(s.str());
+        }
+        else
+        {
+            MAPNIK_LOG_ERROR(csv) << s.str();
+        }
+    }
+    return false;
+}
+
+bool is_blank_record(char const* start, char const* end)
+{
+    if (end - start <= 10)
+    {
+        std::string trimmed(start, end);
+        boost::trim_if(trimmed, boost::algorithm::is_any_of("\",'\r\n "));
+        return trimmed.empty();
+    }
+    return false;
+}
+
 bool valid(geometry_column_locator const& locator, std::size_t max_size)
 {
     if (locator.type == geometry_column_locator::UNKNOWN)
@@ -367,6 +465,37 @@ void csv_file_parser::parse_csv_and_boxes(std::istream& csv_file, T& boxes)
         }
     }
 
+#ifdef MAPNIK_THREADSAFE
+    if (has_newline && num_threads_ > 1 && row_limit_ == 0 && !has_disk_index_)
+    {
+        std::uint64_t offset = pos;
+        std::size_t size = file_length - offset;
+        std::size_t num_chunks = std::min(num_threads_, size / detail::min_chunk_size);
+        if (num_chunks > 1)
+        {
+#ifdef MAPNIK_MEMORY_MAPPED_FILE
+            auto* mapped = dynamic_cast<boost::interprocess::ibufferstream*>(&csv_file);
+            if (mapped)
+            {
+                char const* data = mapped->buffer().first + offset;
+                parse_chunks(data, data + size, offset, newline, line_number, num_chunks, boxes);
+                return;
+            }
+#endif
+            std::vector<char> buffer(size);
+            csv_file.read(buffer.data(), size);
+            if (static_cast<std::size_t>(csv_file.gcount()) == size)
+            {
+                parse_chunks(buffer.data(), buffer.data() + size, offset, newline, line_number, num_chunks, boxes);
+                return;
+            }
+            // short read, rewind and take the serial path
+            csv_file.clear();
+            csv_file.seekg(pos);
+        }
+    }
+#endif
+
     while (is_first_row || csv_utils::getline_csv(csv_file, csv_line, newline, quote_))
     {
         ++line_number;
@@ -381,90 +510,194 @@ void csv_file_parser::parse_csv_and_boxes(std::istream& csv_file, T& boxes)
         is_first_row = false;
 
         // skip blank lines
-        if (record_size <= 10)
+        if (detail::is_blank_record(csv_line.data(), csv_line.data() + record_size))
         {
-            std::string trimmed = csv_line;
-            boost::trim_if(trimmed, boost::algorithm::is_any_of("\",'\r\n "));
-            if (trimmed.empty())
+            MAPNIK_LOG_DEBUG(csv) << "csv_datasource: empty row encountered at line: " << line_number;
+            continue;
+        }
+
+        mapnik::csv_line values;
+        mapnik::box2d<double> box;
+        auto const* line_start = csv_line.data();
+        auto const* line_end = line_start + csv_line.size();
+        if (detail::parse_record(line_start, line_end, line_number, num_headers, locator_, separator_, quote_, strict_,
+                                 values, box))
+        {
+            if (!extent_initialized_)
             {
-                MAPNIK_LOG_DEBUG(csv) << "csv_datasource: empty row encountered at line: " << line_number;
-                continue;
+                if (extent_.valid())
+                    extent_.expand_to_include(box);
+                else
+                    extent_ = box;
             }
+            boxes.emplace_back(box_type(box), make_pair(record_offset, record_size));
+            add_feature(++feature_count, values);
         }
+        // return early if *.index is present
+        if (has_disk_index_)
+            return;
+    }
+}
 
+#ifdef MAPNIK_THREADSAFE
+template<typename T>
+void csv_file_parser::parse_chunks(char const* begin,
+                                   char const* end,
+                                   std::uint64_t offset,
+                                   char newline,
+                                   int line_number,
+                                   std::size_t num_chunks,
+                                   T& boxes)
+{
+    using boxes_type = T;
+    using box_type = typename boxes_type::value_type::first_type;
+
+    struct chunk
+    {
+        char const* begin;
+        char const* end;
+        int line_number; // of the record preceding the chunk
+        boxes_type boxes;
+        mapnik::box2d<double> extent;
+        mapnik::csv_line first_values;
+        bool has_first = false;
+        std::exception_ptr error;
+    };
+
+    // split at record boundaries, a newline inside a quoted value does not end a record
+    std::vector<chunk> chunks(num_chunks);
+    std::size_t target_size = (end - begin) / num_chunks;
+    std::size_t count = 0;
+    chunks[0].begin = begin;
+    chunks[0].line_number = line_number;
+    char const* split = begin + target_size;
+    bool quoted = false;
+    for (char const* itr = begin; itr != end; ++itr)
+    {
+        char c = *itr;
+        if (c == quote_)
+        {
+            quoted = !quoted;
+        }
+        else if (c == newline && !quoted)
+        {
+            ++line_number;
+            if (itr + 1 >= split && count + 1 < num_chunks && itr + 1 != end)
+            {
+                chunks[count].end = itr + 1;
+                chunk& next = chunks[++count];
+                next.begin = itr + 1;
+                next.line_number = line_number;
+                split = next.begin + target_size;
+            }
+        }
+    }
+    chunks[count].end = end;
+    chunks.resize(count + 1);
+
+    std::size_t num_headers = headers_.size();
+    auto parse = [&](chunk& ch) {
         try
         {
-            auto const* line_start = csv_line.data();
-            auto const* line_end = line_start + csv_line.size();
-            auto values = csv_utils::parse_line(line_start, line_end, separator_, quote_, num_headers);
-            unsigned num_fields = values.size();
-            if (num_fields != num_headers)
+            int line = ch.line_number;
+            char const* pos = ch.begin;
+            while (pos != ch.end)
             {
-                std::ostringstream s;
-                s << "CSV Plugin: # of columns(" << num_fields << ")";
-                if (num_fields > num_headers)
+                char const* record_end = pos;
+                bool in_quote = false;
+                while (record_end != ch.end && (*record_end != newline || in_quote))
                 {
-                    s << " > ";
+                    if (*record_end == quote_)
+                        in_quote = !in_quote;
+                    ++record_end;
                 }
-                else
+                ++line;
+                if (detail::is_blank_record(pos, record_end))
                 {
-                    s << " < ";
+                    MAPNIK_LOG_DEBUG(csv) << "csv_datasource: empty row encountered at line: " << line;
                 }
-                s << "# of headers(" << num_headers << ") parsed";
-                throw mapnik::datasource_exception(s.str());
-            }
-
-            auto geom = extract_geometry(values, locator_);
-            if (!geom.is<mapnik::geometry::geometry_empty>())
-            {
-                auto box = mapnik::geometry::envelope(geom);
-                if (!extent_initialized_)
+                else
                 {
-                    if (extent_.valid())
-                        extent_.expand_to_include(box);
-                    else
-                        extent_ = box;
+                    mapnik::csv_line values;
+                    mapnik::box2d<double> box;
+                    if (detail::parse_record(pos,
+                                             record_end,
+                                             line,
+                                             num_headers,
+                                             locator_,
+                                             separator_,
+                                             quote_,
+                                             strict_,
+                                             values,
+                                             box))
+                    {
+                        if (ch.extent.valid())
+                            ch.extent.expand_to_include(box);
+                        else
+                            ch.extent = box;
+                        std::uint64_t record_offset = offset + (pos - begin);
+                        std::uint64_t record_size = record_end - pos;
+                        ch.boxes.emplace_back(box_type(box), std::make_pair(record_offset, record_size));
+                        if (!ch.has_first)
+                        {
+                            ch.first_values = std::move(values);
+                            ch.has_first = true;
+                        }
+                    }
                 }
-                boxes.emplace_back(box_type(box), make_pair(record_offset, record_size));
-                add_feature(++feature_count, values);
-            }
-            else
-            {
-                std::ostringstream s;
-                s << "CSV Plugin: expected geometry column: could not parse row " << line_number << " "
-                  << values.at(locator_.index) << "'";
-                throw mapnik::datasource_exception(s.str());
+                pos = (record_end == ch.end) ? record_end : record_end + 1;
             }
         }
-        catch (mapnik::datasource_exception const& ex)
+        catch (...)
         {
-            if (strict_)
-                throw ex;
-            else
-            {
-                MAPNIK_LOG_ERROR(csv) << ex.what() << " at line: " << line_number;
-            }
+            ch.error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunks.size() - 1);
+    for (std::size_t i = 1; i < chunks.size(); ++i)
+    {
+        workers.emplace_back(parse, std::ref(chunks[i]));
+    }
+    parse(chunks[0]);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    MAPNIK_LOG_DEBUG(csv) << "csv_datasource: parsed " << chunks.size() << " chunks in parallel";
+
+    // merge in file order so the result matches the serial path
+    std::size_t total = 0;
+    for (auto const& ch : chunks)
+    {
+        if (ch.error)
+            std::rethrow_exception(ch.error);
+        total += ch.boxes.size();
+    }
+    boxes.reserve(boxes.size() + total);
+    bool has_first = false;
+    for (auto& ch : chunks)
+    {
+        if (!ch.has_first)
+            continue;
+        if (!has_first)
+        {
+            add_feature(1, ch.first_values);
+            has_first = true;
         }
-        catch (std::exception const& ex)
+        if (!extent_initialized_)
         {
-            std::ostringstream s;
-            s << "CSV Plugin: unexpected error parsing line: " << line_number << " - found " << headers_.size()
-              << " with values like: " << csv_line << "\n"
-              << " and got error like: " << ex.what();
-            if (strict_)
-            {
-                throw mapnik::datasource_exception(s.str());
-            }
+            if (extent_.valid())
+                extent_.expand_to_include(ch.extent);
             else
-            {
-                MAPNIK_LOG_ERROR(csv) << s.str();
-            }
+                extent_ = ch.extent;
         }
-        // return early if *.index is present
-        if (has_disk_index_)
-            return;
+        std::move(ch.boxes.begin(), ch.boxes.end(), std::back_inserter(boxes));
     }
 }
+#endif
 
 mapnik::geometry::geometry<double> extract_geometry(std::vector<std::string> const& row,
                                                     geometry_column_locator const& locator)
@@ -32,6 +32,7 @@
 #include <mapnik/csv/csv_types.hpp>
 
 // std
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 #include <vector>
@@ -138,6 +139,17 @@ struct csv_file_parser
     template<typename T>
     void parse_csv_and_boxes(std::istream& csv_file, T& boxes);
 
+    // parses the records in [begin, end) split into `num_chunks` chunks on
+    // separate threads, `offset` is the file position of `begin`
+    template<typename T>
+    void parse_chunks(char const* begin,
+                      char const* end,
+                      std::uint64_t offset,
+                      char newline,
+                      int line_number,
+                      std::size_t num_chunks,
+                      T& boxes);
+
     virtual void add_feature(mapnik::value_integer index, mapnik::csv_line const& values);
 
     std::vector<std::string> headers_;
@@ -145,6 +157,7 @@ struct csv_file_parser
     geometry_column_locator locator_;
     mapnik::box2d<double> extent_;
     mapnik::value_integer row_limit_ = 0;
+    std::size_t num_threads_ = 1;
     char separator_ = '\0';
     char quote_ = '\0';
     bool strict_ = false;
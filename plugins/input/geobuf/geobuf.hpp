@@ -31,6 +31,8 @@
 #include <mapnik/util/noncopyable.hpp>
 #include <cmath>
 #include <cassert>
+#include <set>
+#include <string>
 #include <vector>
 
 #include <boost/optional.hpp>
@@ -76,110 +78,99 @@ struct value_visitor
 };
 } // namespace detail
 
-template<typename FeatureCallback>
-struct geobuf : util::noncopyable
+// Decodes Feature and Geometry messages. It holds what a file declares ahead of
+// its features (keys, dimensions and precision), so a single message can be
+// decoded on its own once the file header has been read.
+struct geobuf_decoder
 {
     using value_type = util::variant<bool, int, double, std::string>;
+    using values_type = std::vector<value_type>;
     unsigned dim = 2;
     double precision = std::pow(10, 6);
-    bool is_topo = false;
     bool transformed = false;
-    std::size_t lengths = 0;
-    std::vector<std::string> keys_;
-    std::vector<value_type> values_;
-    protozero::pbf_reader reader_;
-    FeatureCallback& callback_;
-    context_ptr ctx_;
-    const std::unique_ptr<transcoder> tr_;
+    std::vector<std::string> keys;
 
-  public:
-    // ctor
-    geobuf(char const* buf, std::size_t size, FeatureCallback& callback)
-        : reader_(buf, size)
-        , callback_(callback)
-        , ctx_(std::make_shared<context_type>())
-        , tr_(new transcoder("utf8"))
-    {}
-
-    void read()
+    // Only properties named in `attribute_names` are kept, all of them if it is null
+    template<typename T>
+    feature_ptr read_feature(T& reader,
+                             context_ptr const& ctx,
+                             transcoder const& tr,
+                             std::set<std::string> const* attribute_names = nullptr) const
     {
-        while (reader_.next())
+        auto feature = feature_factory::create(ctx, 1);
+        values_type values;
+        while (reader.next())
         {
-            switch (reader_.tag())
+            switch (reader.tag())
             {
-                case 1: // keys
-                {
-                    keys_.push_back(reader_.get_string());
+                case 1: {
+                    auto message = reader.get_message();
+                    auto geom = read_geometry(message);
+                    feature->set_geometry(std::move(geom));
                     break;
                 }
-                case 2: {
-                    dim = reader_.get_uint32();
+                case 11: {
+                    auto feature_id = reader.get_string();
                     break;
                 }
-                case 3: {
-                    precision = std::pow(10, reader_.get_uint32());
+                case 12: {
+                    feature->set_id(reader.get_sint64());
                     break;
                 }
-                case 4: {
-                    auto feature_collection = reader_.get_message();
-                    read_feature_collection(feature_collection);
+                case 13: {
+                    auto message = reader.get_message();
+                    read_value(message, values);
                     break;
                 }
-                case 5: {
-                    // standalone Feature
-                    auto message = reader_.get_message();
-                    read_feature(message);
+                case 14: {
+                    // feature props
+                    read_props(reader, *feature, tr, values, attribute_names);
                     break;
                 }
-                case 6: {
-                    // standalone Geometry
-                    auto feature = feature_factory::create(ctx_, 1);
-                    auto message = reader_.get_message();
-                    feature->set_geometry(std::move(read_geometry(message)));
-                    callback_(feature);
+                case 15: {
+                    // generic props
+                    read_props(reader, *feature, tr, values, attribute_names);
                     break;
                 }
                 default:
-                    MAPNIK_LOG_DEBUG(geobuf) << "Unsupported tag=" << reader_.tag();
-                    reader_.skip();
+                    MAPNIK_LOG_DEBUG(geobuf) << "Unsupported tag=" << reader.tag();
                     break;
             }
         }
+        return feature;
     }
 
-  private:
-
-    double transform(std::int64_t input) { return (transformed) ? (static_cast<double>(input)) : (input / precision); }
+    double transform(std::int64_t input) const { return (transformed) ? (static_cast<double>(input)) : (input / precision); }
 
     template<typename T>
-    void read_value(T& reader)
+    void read_value(T& reader, values_type& values) const
     {
         while (reader.next())
         {
             switch (reader.tag())
             {
                 case 1: {
-                    values_.emplace_back(reader.get_string());
+                    values.emplace_back(reader.get_string());
                     break;
                 }
                 case 2: {
-                    values_.emplace_back(reader.get_double());
+                    values.emplace_back(reader.get_double());
                     break;
                 }
                 case 3: {
-                    values_.emplace_back(static_cast<int>(reader.get_uint32()));
+                    values.emplace_back(static_cast<int>(reader.get_uint32()));
                     break;
                 }
                 case 4: {
-                    values_.emplace_back(-static_cast<int>(reader.get_uint32()));
+                    values.emplace_back(-static_cast<int>(reader.get_uint32()));
                     break;
                 }
                 case 5: {
-                    values_.emplace_back(reader.get_bool());
+                    values.emplace_back(reader.get_bool());
                     break;
                 }
                 case 6: {
-                    values_.emplace_back(reader.get_string()); // JSON value
+                    values.emplace_back(reader.get_string()); // JSON value
                     break;
                 }
                 default:
@@ -189,93 +180,29 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T, typename Feature>
-    void read_props(T& reader, Feature& feature)
+    void read_props(T& reader,
+                    Feature& feature,
+                    transcoder const& tr,
+                    values_type& values,
+                    std::set<std::string> const* attribute_names) const
     {
         auto pi = reader.get_packed_uint32();
         for (auto it = pi.first; it != pi.second; ++it)
         {
             auto key_index = *it++;
             auto value_index = *it;
-            assert(key_index < keys_.size());
-            assert(value_index < values_.size());
-            std::string const& name = keys_[key_index];
-            util::apply_visitor(detail::value_visitor(feature, *tr_, name), values_[value_index]);
-        }
-        values_.clear();
-    }
-
-    template<typename T>
-    void read_feature(T& reader)
-    {
-        auto feature = feature_factory::create(ctx_, 1);
-        while (reader.next())
-        {
-            switch (reader.tag())
-            {
-                case 1: {
-                    auto message = reader.get_message();
-                    auto geom = read_geometry(message);
-                    feature->set_geometry(std::move(geom));
-                    break;
-                }
-                case 11: {
-                    auto feature_id = reader.get_string();
-                    break;
-                }
-                case 12: {
-                    feature->set_id(reader.get_sint64());
-                    break;
-                }
-                case 13: {
-                    auto message = reader.get_message();
-                    read_value(message);
-                    break;
-                }
-                case 14: {
-                    // feature props
-                    read_props(reader, *feature);
-                    break;
-                }
-                case 15: {
-                    // generic props
-                    read_props(reader, *feature);
-                    break;
-                }
-                default:
-                    MAPNIK_LOG_DEBUG(geobuf) << "Unsupported tag=" << reader.tag();
-                    break;
-            }
+            assert(key_index < keys.size());
+            assert(value_index < values.size());
+            std::string const& name = keys[key_index];
+            if (attribute_names && attribute_names->find(name) == attribute_names->end())
+                continue;
+            util::apply_visitor(detail::value_visitor(feature, tr, name), values[value_index]);
         }
-        callback_(feature);
+        values.clear();
     }
 
     template<typename T>
-    void read_feature_collection(T& reader)
-    {
-        while (reader.next())
-        {
-            switch (reader.tag())
-            {
-                case 1: {
-                    auto message = reader.get_message();
-                    read_feature(message);
-                    break;
-                }
-                case 13: {
-                    auto message = reader.get_message();
-                    read_value(message);
-                    break;
-                }
-                default: {
-                    reader.skip();
-                    break;
-                }
-            }
-        }
-    }
-
-    template<typename T>
-    geometry::point<double> read_point(T& reader)
+    geometry::point<double> read_point(T& reader) const
     {
         double x = 0.0;
         double y = 0.0;
@@ -293,7 +220,7 @@ struct geobuf : util::noncopyable
 
     template<typename T>
     geometry::geometry<double>
-      read_coords(T& reader, geometry_type_e type, boost::optional<std::vector<std::uint32_t>> const& lengths)
+      read_coords(T& reader, geometry_type_e type, boost::optional<std::vector<std::uint32_t>> const& lengths) const
     {
         geometry::geometry<double> geom = geometry::geometry_empty();
         switch (type)
@@ -331,7 +258,7 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T>
-    std::vector<std::uint32_t> read_lengths(T& reader)
+    std::vector<std::uint32_t> read_lengths(T& reader) const
     {
         std::vector<std::uint32_t> lengths;
         auto pi = reader.get_packed_uint32();
@@ -343,7 +270,7 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T, typename Iterator, typename Ring>
-    void read_linear_ring(T& reader, Iterator begin, Iterator end, Ring& ring, bool close = false)
+    void read_linear_ring(T& reader, Iterator begin, Iterator end, Ring& ring, bool close = false) const
     {
         double x = 0.0;
         double y = 0.0;
@@ -369,7 +296,7 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T>
-    geometry::multi_point<double> read_multi_point(T& reader)
+    geometry::multi_point<double> read_multi_point(T& reader) const
     {
         geometry::multi_point<double> multi_point;
         double x = 0.0;
@@ -394,7 +321,7 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T>
-    geometry::line_string<double> read_line_string(T& reader)
+    geometry::line_string<double> read_line_string(T& reader) const
     {
         geometry::line_string<double> line;
         auto pi = reader.get_packed_sint64();
@@ -405,7 +332,7 @@ struct geobuf : util::noncopyable
 
     template<typename T>
     geometry::multi_line_string<double>
-      read_multi_linestring(T& reader, boost::optional<std::vector<std::uint32_t>> const& lengths)
+      read_multi_linestring(T& reader, boost::optional<std::vector<std::uint32_t>> const& lengths) const
     {
         geometry::multi_line_string<double> multi_line;
         multi_line.reserve(!lengths ? 1 : lengths->size());
@@ -432,7 +359,7 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T>
-    geometry::polygon<double> read_polygon(T& reader, boost::optional<std::vector<std::uint32_t>> const& lengths)
+    geometry::polygon<double> read_polygon(T& reader, boost::optional<std::vector<std::uint32_t>> const& lengths) const
     {
         geometry::polygon<double> poly;
         poly.reserve(!lengths ? 1 : lengths->size());
@@ -460,7 +387,7 @@ struct geobuf : util::noncopyable
 
     template<typename T>
     geometry::multi_polygon<double> read_multi_polygon(T& reader,
-                                                       boost::optional<std::vector<std::uint32_t>> const& lengths)
+                                                       boost::optional<std::vector<std::uint32_t>> const& lengths) const
     {
         geometry::multi_polygon<double> multi_poly;
         if (!lengths)
@@ -492,7 +419,7 @@ struct geobuf : util::noncopyable
     }
 
     template<typename T>
-    geometry::geometry<double> read_geometry(T& reader)
+    geometry::geometry<double> read_geometry(T& reader) const
     {
         geometry::geometry<double> geom = geometry::geometry_empty();
         geometry_type_e type = Unknown;
@@ -524,9 +451,110 @@ struct geobuf : util::noncopyable
                     collection.push_back(std::move(read_geometry(message)));
                     break;
                 }
-                case 13: {
-                    auto value = reader.get_message();
-                    read_value(value);
+                default: {
+                    reader.skip();
+                    break;
+                }
+            }
+        }
+        return geom;
+    }
+};
+
+// Reads a whole geobuf file. Every feature is passed to FeatureCallback together
+// with the bytes of its message, which can be handed to geobuf_decoder later on.
+template<typename FeatureCallback>
+struct geobuf : util::noncopyable
+{
+    geobuf_decoder decoder_;
+    protozero::pbf_reader reader_;
+    FeatureCallback& callback_;
+    context_ptr ctx_;
+    std::set<std::string> const* attribute_names_;
+    bool standalone_geometry_ = false;
+    const std::unique_ptr<transcoder> tr_;
+
+  public:
+    // ctor
+    geobuf(char const* buf,
+           std::size_t size,
+           FeatureCallback& callback,
+           std::set<std::string> const* attribute_names = nullptr)
+        : reader_(buf, size)
+        , callback_(callback)
+        , ctx_(std::make_shared<context_type>())
+        , attribute_names_(attribute_names)
+        , tr_(new transcoder("utf8"))
+    {}
+
+    geobuf_decoder const& decoder() const { return decoder_; }
+
+    // true when the file holds a single Geometry rather than Features
+    bool standalone_geometry() const { return standalone_geometry_; }
+
+    void read()
+    {
+        while (reader_.next())
+        {
+            switch (reader_.tag())
+            {
+                case 1: // keys
+                {
+                    decoder_.keys.push_back(reader_.get_string());
+                    break;
+                }
+                case 2: {
+                    decoder_.dim = reader_.get_uint32();
+                    break;
+                }
+                case 3: {
+                    decoder_.precision = std::pow(10, reader_.get_uint32());
+                    break;
+                }
+                case 4: {
+                    auto feature_collection = reader_.get_message();
+                    read_feature_collection(feature_collection);
+                    break;
+                }
+                case 5: {
+                    // standalone Feature
+                    read_feature(reader_.get_view());
+                    break;
+                }
+                case 6: {
+                    // standalone Geometry
+                    standalone_geometry_ = true;
+                    auto feature = feature_factory::create(ctx_, 1);
+                    auto view = reader_.get_view();
+                    protozero::pbf_reader message(view);
+                    feature->set_geometry(std::move(decoder_.read_geometry(message)));
+                    callback_(feature, view);
+                    break;
+                }
+                default:
+                    MAPNIK_LOG_DEBUG(geobuf) << "Unsupported tag=" << reader_.tag();
+                    reader_.skip();
+                    break;
+            }
+        }
+    }
+
+  private:
+    void read_feature(protozero::data_view const& view)
+    {
+        protozero::pbf_reader message(view);
+        callback_(decoder_.read_feature(message, ctx_, *tr_, attribute_names_), view);
+    }
+
+    template<typename T>
+    void read_feature_collection(T& reader)
+    {
+        while (reader.next())
+        {
+            switch (reader.tag())
+            {
+                case 1: {
+                    read_feature(reader.get_view());
                     break;
                 }
                 default: {
@@ -535,7 +563,6 @@ struct geobuf : util::noncopyable
                 }
             }
         }
-        return geom;
     }
 };
 
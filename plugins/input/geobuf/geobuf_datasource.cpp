@@ -22,17 +22,20 @@
 
 #include "geobuf_datasource.hpp"
 #include "geobuf_featureset.hpp"
+#include "geobuf_memory_index_featureset.hpp"
 #include "geobuf.hpp"
 
 #include <fstream>
 #include <algorithm>
 #include <functional>
+#include <set>
 
 // boost
 
 #include <boost/algorithm/string.hpp>
 
 // mapnik
+#include <mapnik/boolean.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_kv_iterator.hpp>
@@ -45,6 +48,14 @@
 #include <mapnik/util/file_io.hpp>
 #include <mapnik/geometry/boost_adapters.hpp>
 
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+MAPNIK_DISABLE_WARNING_POP
+#endif
+
 using mapnik::datasource;
 using mapnik::parameters;
 
@@ -89,15 +100,45 @@ geobuf_datasource::geobuf_datasource(parameters const& params)
     else
         filename_ = *file;
 
-    mapnik::util::file in(filename_);
-    if (!in.is_open())
+    cache_features_ = *params.get<mapnik::boolean_type>("cache_features", true);
+    if (cache_features_)
     {
-        throw mapnik::datasource_exception("Geobuf Plugin: could not open: '" + filename_ + "'");
+        mapnik::util::file in(filename_);
+        if (!in.is_open())
+        {
+            throw mapnik::datasource_exception("Geobuf Plugin: could not open: '" + filename_ + "'");
+        }
+        std::vector<char> geobuf;
+        geobuf.resize(in.size());
+        std::fread(geobuf.data(), in.size(), 1, in.get());
+        parse_geobuf(geobuf.data(), geobuf.size());
+    }
+    else
+    {
+        // the buffer is kept for the lifetime of the datasource
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+        boost::optional<mapnik::mapped_region_ptr> mapped_region =
+          mapnik::mapped_memory_cache::instance().find(filename_, false);
+        if (!mapped_region)
+        {
+            throw mapnik::datasource_exception("Geobuf Plugin: could not get file mapping for '" + filename_ + "'");
+        }
+        mapped_region_ = *mapped_region;
+        data_ = reinterpret_cast<char const*>(mapped_region_->get_address());
+        std::size_t size = mapped_region_->get_size();
+#else
+        mapnik::util::file in(filename_);
+        if (!in.is_open())
+        {
+            throw mapnik::datasource_exception("Geobuf Plugin: could not open: '" + filename_ + "'");
+        }
+        buffer_.resize(in.size());
+        std::fread(buffer_.data(), in.size(), 1, in.get());
+        data_ = buffer_.data();
+        std::size_t size = buffer_.size();
+#endif
+        initialise_index(data_, size);
     }
-    std::vector<char> geobuf;
-    geobuf.resize(in.size());
-    std::fread(geobuf.data(), in.size(), 1, in.get());
-    parse_geobuf(geobuf.data(), geobuf.size());
 }
 
 namespace {
@@ -109,9 +150,37 @@ struct push_feature
         : features_(features)
     {}
 
-    void operator()(mapnik::feature_ptr const& feature) { features_.push_back(feature); }
+    void operator()(mapnik::feature_ptr const& feature, protozero::data_view const&) { features_.push_back(feature); }
     features_container& features_;
 };
+
+template<typename T>
+struct index_feature
+{
+    using values_container = T;
+    index_feature(char const* data, values_container& values, std::vector<mapnik::feature_ptr>& samples)
+        : data_(data)
+        , values_(values)
+        , samples_(samples)
+    {}
+
+    void operator()(mapnik::feature_ptr const& feature, protozero::data_view const& message)
+    {
+        mapnik::box2d<double> box = feature->envelope();
+        if (box.valid())
+        {
+            values_.emplace_back(box,
+                                 std::make_pair(static_cast<std::size_t>(message.data() - data_), message.size()));
+        }
+        if (samples_.size() < 5)
+        {
+            samples_.push_back(feature);
+        }
+    }
+    char const* data_;
+    values_container& values_;
+    std::vector<mapnik::feature_ptr>& samples_;
+};
 } // namespace
 
 void geobuf_datasource::parse_geobuf(char const* data, std::size_t size)
@@ -152,6 +221,45 @@ void geobuf_datasource::parse_geobuf(char const* data, std::size_t size)
     tree_ = std::make_unique<spatial_index_type>(values);
 }
 
+void geobuf_datasource::initialise_index(char const* data, std::size_t size)
+{
+    using values_container = std::vector<std::pair<box_type, std::pair<std::size_t, std::size_t>>>;
+    using index_feature_callback = index_feature<values_container>;
+    values_container values;
+    index_feature_callback callback(data, values, features_);
+    // geometries are decoded to find their bounding boxes, properties are skipped
+    std::set<std::string> const no_attributes;
+    mapnik::util::geobuf<index_feature_callback> buf(data, size, callback, &no_attributes);
+    buf.read();
+    decoder_ = std::make_unique<mapnik::util::geobuf_decoder>(buf.decoder());
+    standalone_geometry_ = buf.standalone_geometry();
+
+    if (!values.empty())
+    {
+        extent_ = values.front().first;
+        for (auto const& item : values)
+        {
+            extent_.expand_to_include(item.first);
+        }
+        if (!standalone_geometry_)
+        {
+            // describe the first feature with a valid bounding box, as parse_geobuf() does
+            mapnik::transcoder tr("utf8");
+            protozero::pbf_reader message(data + values.front().second.first, values.front().second.second);
+            mapnik::feature_ptr feature =
+              decoder_->read_feature(message, std::make_shared<mapnik::context_type>(), tr);
+            for (auto const& kv : *feature)
+            {
+                desc_.add_descriptor(mapnik::attribute_descriptor(
+                  std::get<0>(kv),
+                  mapnik::util::apply_visitor(attr_value_converter(), std::get<1>(kv))));
+            }
+        }
+    }
+    // packing algorithm
+    tree_ = std::make_unique<spatial_index_type>(values);
+}
+
 geobuf_datasource::~geobuf_datasource() {}
 
 const char* geobuf_datasource::name()
@@ -206,7 +314,19 @@ mapnik::featureset_ptr geobuf_datasource::features(mapnik::query const& q) const
         if (tree_)
         {
             tree_->query(boost::geometry::index::intersects(box), std::back_inserter(index_array));
-            return std::make_shared<geobuf_featureset>(features_, std::move(index_array));
+            if (cache_features_)
+            {
+                return std::make_shared<geobuf_featureset>(features_, std::move(index_array));
+            }
+            // decode in file order, which also reads the buffer front to back
+            std::sort(index_array.begin(), index_array.end(), [](item_type const& item0, item_type const& item1) {
+                return item0.second.first < item1.second.first;
+            });
+            return std::make_shared<geobuf_memory_index_featureset>(*decoder_,
+                                                                    data_,
+                                                                    standalone_geometry_,
+                                                                    q.property_names(),
+                                                                    std::move(index_array));
         }
     }
     return mapnik::featureset_ptr();
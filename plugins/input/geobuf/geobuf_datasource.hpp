@@ -33,6 +33,9 @@
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/datasource_plugin.hpp>
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+#include <mapnik/mapped_memory_cache.hpp>
+#endif
 // boost
 #include <boost/optional.hpp>
 #include <mapnik/warning.hpp>
@@ -53,6 +56,12 @@ MAPNIK_DISABLE_WARNING_POP
 
 using mapnik::datasource;
 
+namespace mapnik {
+namespace util {
+struct geobuf_decoder;
+}
+} // namespace mapnik
+
 template<std::size_t Max, std::size_t Min>
 struct geobuf_linear : boost::geometry::index::linear<Max, Min>
 {};
@@ -104,14 +113,28 @@ class geobuf_datasource : public mapnik::datasource
     mapnik::layer_descriptor get_descriptor() const;
     boost::optional<mapnik::datasource_geometry_t> get_geometry_type() const;
     void parse_geobuf(char const* buffer, std::size_t size);
+    void initialise_index(char const* buffer, std::size_t size);
 
   private:
     mapnik::datasource::datasource_t type_;
     mapnik::layer_descriptor desc_;
     std::string filename_;
     mapnik::box2d<double> extent_;
+    // with cache_features=false only the first few features are kept (without
+    // properties) to answer get_geometry_type()
     std::vector<mapnik::feature_ptr> features_;
     std::unique_ptr<spatial_index_type> tree_;
+    bool cache_features_ = true;
+    // cache_features=false: the index holds the byte range of every feature
+    // message, which is decoded from the file buffer on demand
+    std::unique_ptr<mapnik::util::geobuf_decoder> decoder_;
+    bool standalone_geometry_ = false;
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+    mapnik::mapped_region_ptr mapped_region_;
+#else
+    std::vector<char> buffer_;
+#endif
+    char const* data_ = nullptr;
 };
 
 #endif // GEOBUF_DATASOURCE_HPP
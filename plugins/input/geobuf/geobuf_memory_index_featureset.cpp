@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/debug.hpp>
+// stl
+#include <string>
+#include <vector>
+#include <deque>
+
+#include "geobuf_memory_index_featureset.hpp"
+#include "geobuf.hpp"
+
+geobuf_memory_index_featureset::geobuf_memory_index_featureset(mapnik::util::geobuf_decoder const& decoder,
+                                                               char const* data,
+                                                               bool standalone_geometry,
+                                                               std::set<std::string> const& attribute_names,
+                                                               array_type&& index_array)
+    : decoder_(decoder)
+    , data_(data)
+    , standalone_geometry_(standalone_geometry)
+    , attribute_names_(attribute_names)
+    , tr_("utf8")
+    , index_array_(std::move(index_array))
+    , index_itr_(index_array_.begin())
+    , index_end_(index_array_.end())
+    , ctx_(std::make_shared<mapnik::context_type>())
+{}
+
+geobuf_memory_index_featureset::~geobuf_memory_index_featureset() {}
+
+mapnik::feature_ptr geobuf_memory_index_featureset::next()
+{
+    while (index_itr_ != index_end_)
+    {
+        geobuf_datasource::item_type const& item = *index_itr_++;
+        protozero::pbf_reader message(data_ + item.second.first, item.second.second);
+        try
+        {
+            if (standalone_geometry_)
+            {
+                mapnik::feature_ptr feature = mapnik::feature_factory::create(ctx_, 1);
+                feature->set_geometry(decoder_.read_geometry(message));
+                return feature;
+            }
+            return decoder_.read_feature(message, ctx_, tr_, &attribute_names_);
+        }
+        catch (protozero::exception const& ex)
+        {
+            MAPNIK_LOG_ERROR(geobuf) << "geobuf_memory_index_featureset: " << ex.what();
+        }
+    }
+    return mapnik::feature_ptr();
+}
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GEOBUF_MEMORY_INDEX_FEATURESET_HPP
+#define GEOBUF_MEMORY_INDEX_FEATURESET_HPP
+
+#include <mapnik/feature.hpp>
+#include <mapnik/unicode.hpp>
+#include "geobuf_datasource.hpp"
+
+#include <deque>
+#include <set>
+#include <string>
+
+// Decodes features straight from the geobuf buffer, using the byte ranges
+// recorded in the datasource's index, keeping only the requested properties.
+class geobuf_memory_index_featureset : public mapnik::Featureset
+{
+  public:
+    using array_type = std::deque<geobuf_datasource::item_type>;
+
+    geobuf_memory_index_featureset(mapnik::util::geobuf_decoder const& decoder,
+                                   char const* data,
+                                   bool standalone_geometry,
+                                   std::set<std::string> const& attribute_names,
+                                   array_type&& index_array);
+    virtual ~geobuf_memory_index_featureset();
+    mapnik::feature_ptr next();
+
+  private:
+    mapnik::util::geobuf_decoder const& decoder_;
+    char const* data_;
+    bool standalone_geometry_;
+    std::set<std::string> attribute_names_;
+    mapnik::transcoder tr_;
+    const array_type index_array_;
+    array_type::const_iterator index_itr_;
+    array_type::const_iterator index_end_;
+    mapnik::context_ptr ctx_;
+};
+
+#endif // GEOBUF_MEMORY_INDEX_FEATURESET_HPP
@@ -26,6 +26,9 @@
 #include "geojson_memory_index_featureset.hpp"
 #include <fstream>
 #include <algorithm>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#endif
 
 #include <mapnik/warning.hpp>
 MAPNIK_DISABLE_WARNING_PUSH
@@ -101,6 +104,12 @@ geojson_datasource::geojson_datasource(parameters const& params)
     , num_features_to_query_(
         std::max(mapnik::value_integer(1), *params.get<mapnik::value_integer>("num_features_to_query", 5)))
 {
+#ifdef MAPNIK_THREADSAFE
+    // bounding boxes of large FeatureCollections are extracted on this many threads
+    mapnik::value_integer threads =
+      *params.get<mapnik::value_integer>("threads", std::thread::hardware_concurrency());
+    num_threads_ = static_cast<std::size_t>(std::max(mapnik::value_integer(1), threads));
+#endif
     boost::optional<std::string> inline_string = params.get<std::string>("inline");
     if (!inline_string)
     {
@@ -257,7 +266,7 @@ void geojson_datasource::initialise_index(Iterator start, Iterator end)
     Iterator itr = start;
     try
     {
-        mapnik::json::extract_bounding_boxes(itr, end, boxes);
+        mapnik::json::extract_bounding_boxes(itr, end, boxes, num_threads_);
         if (itr != end || boxes.empty())
             throw std::exception();
         // bulk insert initialise r-tree
@@ -354,7 +363,7 @@ void geojson_datasource::parse_geojson(Iterator start, Iterator end)
     try
     {
         boxes_type boxes;
-        mapnik::json::extract_bounding_boxes(itr, end, boxes);
+        mapnik::json::extract_bounding_boxes(itr, end, boxes, num_threads_);
         if (itr != end || boxes.empty())
             throw std::exception(); // ensure we've consumed all input and we extracted at least one bbox;
         for (auto const& item : boxes)
@@ -118,6 +118,7 @@ class geojson_datasource : public mapnik::datasource
     std::unique_ptr<spatial_index_type> tree_;
     bool cache_features_ = true;
     bool has_disk_index_ = false;
+    std::size_t num_threads_ = 1;
     const std::size_t num_features_to_query_;
 };
 
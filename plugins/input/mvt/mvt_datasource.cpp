@@ -0,0 +1,362 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "mvt_datasource.hpp"
+#include "mvt_featureset.hpp"
+#include "mvt_mbtiles.hpp"
+
+// boost
+#include <boost/algorithm/string.hpp>
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/feature_kv_iterator.hpp>
+#include <mapnik/util/file_io.hpp>
+#include <mapnik/util/variant.hpp>
+#include <mapnik/value/types.hpp>
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/mvt/mvt.hpp>
+
+// protozero
+#include <protozero/pbf_reader.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+using mapnik::datasource;
+using mapnik::parameters;
+
+DATASOURCE_PLUGIN_IMPL(mvt_datasource_plugin, mvt_datasource);
+DATASOURCE_PLUGIN_EXPORT(mvt_datasource_plugin);
+DATASOURCE_PLUGIN_EMPTY_AFTER_LOAD(mvt_datasource_plugin);
+DATASOURCE_PLUGIN_EMPTY_BEFORE_UNLOAD(mvt_datasource_plugin);
+
+namespace {
+
+struct attr_value_converter
+{
+    mapnik::eAttributeType operator()(mapnik::value_integer) const { return mapnik::Integer; }
+
+    mapnik::eAttributeType operator()(double) const { return mapnik::Double; }
+
+    mapnik::eAttributeType operator()(bool) const { return mapnik::Boolean; }
+
+    mapnik::eAttributeType operator()(mapnik::value_unicode_string const&) const { return mapnik::String; }
+
+    mapnik::eAttributeType operator()(mapnik::value_null const&) const { return mapnik::String; }
+};
+
+bool is_mbtiles(std::string const& filename, std::string const& data)
+{
+    static const std::string sqlite_magic("SQLite format 3", 16);
+    return boost::algorithm::iends_with(filename, ".mbtiles") || data.compare(0, sqlite_magic.size(), sqlite_magic) == 0;
+}
+
+} // namespace
+
+mvt_datasource::mvt_datasource(parameters const& params)
+    : datasource(params),
+      type_(datasource::Vector),
+      desc_(mvt_datasource::name(), *params.get<std::string>("encoding", "utf-8")),
+      filename_(),
+      layer_name_(*params.get<std::string>("layer", "")),
+      encoding_(*params.get<std::string>("encoding", "utf-8")),
+      extent_(),
+      geometry_type_(),
+      tile_(),
+      archive_(),
+      minzoom_(0),
+      maxzoom_(0),
+      zoom_(),
+      tile_size_(*params.get<mapnik::value_double>("tile_size", 256.0))
+{
+    boost::optional<std::string> file = params.get<std::string>("file");
+    if (!file)
+        throw mapnik::datasource_exception("MVT Plugin: missing <file> parameter");
+
+    boost::optional<std::string> base = params.get<std::string>("base");
+    if (base)
+        filename_ = *base + "/" + *file;
+    else
+        filename_ = *file;
+
+    if (tile_size_ <= 0)
+        throw mapnik::datasource_exception("MVT Plugin: <tile_size> must be positive");
+
+    mapnik::util::file in(filename_);
+    if (!in.is_open())
+    {
+        throw mapnik::datasource_exception("MVT Plugin: could not open: '" + filename_ + "'");
+    }
+    std::string header(16, '\0');
+    header.resize(std::fread(&header[0], 1, header.size(), in.get()));
+    if (is_mbtiles(filename_, header))
+    {
+        boost::optional<mapnik::value_integer> zoom = params.get<mapnik::value_integer>("zoom");
+        if (zoom)
+        {
+            if (*zoom < 0 || *zoom > 30)
+                throw mapnik::datasource_exception("MVT Plugin: <zoom> must be between 0 and 30");
+            zoom_ = static_cast<std::uint32_t>(*zoom);
+        }
+        init_mbtiles();
+    }
+    else
+    {
+        std::string data;
+        data.resize(in.size());
+        std::rewind(in.get());
+        if (data.size() > 0 && std::fread(&data[0], data.size(), 1, in.get()) != 1)
+        {
+            throw mapnik::datasource_exception("MVT Plugin: could not read: '" + filename_ + "'");
+        }
+        tile_.data = std::make_shared<std::string const>(std::move(data));
+        init_tile_file(params);
+    }
+}
+
+void mvt_datasource::init_tile_file(parameters const& params)
+{
+    boost::optional<mapnik::value_integer> z = params.get<mapnik::value_integer>("z");
+    boost::optional<mapnik::value_integer> x = params.get<mapnik::value_integer>("x");
+    boost::optional<mapnik::value_integer> y = params.get<mapnik::value_integer>("y");
+    if (!z || !x || !y)
+    {
+        throw mapnik::datasource_exception("MVT Plugin: <z>, <x> and <y> parameters are required for tile files");
+    }
+    if (*z < 0 || *z > 30 || *x < 0 || *y < 0 || *x >= (mapnik::value_integer(1) << *z) ||
+        *y >= (mapnik::value_integer(1) << *z))
+    {
+        throw mapnik::datasource_exception("MVT Plugin: invalid tile coordinates");
+    }
+    tile_.z = static_cast<std::uint32_t>(*z);
+    tile_.x = static_cast<std::uint32_t>(*x);
+    tile_.y = static_cast<std::uint32_t>(*y);
+    extent_ = mvt_tile_utils::tile_bounds(tile_.z, tile_.x, tile_.y);
+    minzoom_ = maxzoom_ = tile_.z;
+    describe(tile_);
+}
+
+void mvt_datasource::init_mbtiles()
+{
+    archive_ = std::make_shared<mbtiles_archive>(filename_);
+    if (!archive_->zoom_range(minzoom_, maxzoom_))
+    {
+        throw mapnik::datasource_exception("MVT Plugin: no tiles in '" + filename_ + "'");
+    }
+    extent_.init(-mapnik::MERC_MAX_EXTENT,
+                 -mapnik::MERC_MAX_EXTENT,
+                 mapnik::MERC_MAX_EXTENT,
+                 mapnik::MERC_MAX_EXTENT);
+    boost::optional<std::string> bounds = archive_->metadata("bounds");
+    if (bounds)
+    {
+        // west,south,east,north in degrees
+        mapnik::box2d<double> box;
+        if (box.from_string(*bounds))
+        {
+            double minx = box.minx(), miny = std::max(box.miny(), -85.0511287798);
+            double maxx = box.maxx(), maxy = std::min(box.maxy(), 85.0511287798);
+            if (mapnik::lonlat2merc(minx, miny) && mapnik::lonlat2merc(maxx, maxy))
+            {
+                extent_.init(minx, miny, maxx, maxy);
+            }
+        }
+    }
+    mvt_tile sample;
+    if (archive_->sample_tile(zoom_ ? *zoom_ : maxzoom_, sample))
+    {
+        describe(sample);
+    }
+}
+
+void mvt_datasource::describe(mvt_tile const& tile)
+{
+    std::string buffer;
+    protozero::data_view layer;
+    if (!tile.data ||
+        !mvt_tile_utils::find_layer(mvt_tile_utils::decompress(*tile.data, buffer), layer_name_, layer))
+    {
+        MAPNIK_LOG_WARN(mvt) << "mvt_datasource: layer '" << layer_name_ << "' not found in tile " << tile.z << "/"
+                             << tile.x << "/" << tile.y;
+        return;
+    }
+    std::vector<std::string> keys;
+    std::vector<protozero::data_view> values;
+    std::vector<protozero::data_view> features;
+    protozero::pbf_reader reader(layer);
+    while (reader.next())
+    {
+        switch (reader.tag())
+        {
+            case mapnik::mvt::LAYER_NAME:
+                if (layer_name_.empty())
+                    layer_name_ = reader.get_string();
+                else
+                    reader.skip();
+                break;
+            case mapnik::mvt::LAYER_KEYS:
+                keys.push_back(reader.get_string());
+                break;
+            case mapnik::mvt::LAYER_VALUES:
+                values.push_back(reader.get_view());
+                break;
+            case mapnik::mvt::LAYER_FEATURES:
+                features.push_back(reader.get_view());
+                break;
+            default:
+                reader.skip();
+        }
+    }
+
+    // attribute types come from the first non-null value of every key
+    mapnik::transcoder tr(encoding_);
+    std::vector<boost::optional<mapnik::eAttributeType>> types(keys.size());
+    std::size_t untyped = keys.size();
+    int geometry_type = mapnik::mvt::GEOM_UNKNOWN;
+    for (auto const& message : features)
+    {
+        protozero::pbf_reader feature(message);
+        while (feature.next())
+        {
+            if (feature.tag() == mapnik::mvt::FEATURE_TYPE)
+            {
+                int type = feature.get_enum();
+                if (geometry_type == mapnik::mvt::GEOM_UNKNOWN)
+                {
+                    geometry_type = type;
+                    geometry_type_ = static_cast<mapnik::datasource_geometry_t>(type);
+                }
+                else if (type != geometry_type)
+                {
+                    geometry_type_ = mapnik::datasource_geometry_t::Collection;
+                }
+            }
+            else if (feature.tag() == mapnik::mvt::FEATURE_TAGS && untyped > 0)
+            {
+                auto tags = feature.get_packed_uint32();
+                for (auto itr = tags.begin(); itr != tags.end(); ++itr)
+                {
+                    std::uint32_t key = *itr;
+                    if (++itr == tags.end())
+                        break;
+                    std::uint32_t val = *itr;
+                    if (key < keys.size() && !types[key] && val < values.size())
+                    {
+                        mapnik::value v = mvt_tile_utils::decode_value(values[val], tr);
+                        if (!v.is_null())
+                        {
+                            types[key] = mapnik::util::apply_visitor(attr_value_converter(), v);
+                            --untyped;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                feature.skip();
+            }
+        }
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        desc_.add_descriptor(mapnik::attribute_descriptor(keys[i], types[i] ? *types[i] : mapnik::String));
+    }
+}
+
+mvt_datasource::~mvt_datasource() {}
+
+const char* mvt_datasource::name()
+{
+    return "mvt";
+}
+
+boost::optional<mapnik::datasource_geometry_t> mvt_datasource::get_geometry_type() const
+{
+    return geometry_type_;
+}
+
+mapnik::datasource::datasource_t mvt_datasource::type() const
+{
+    return type_;
+}
+
+mapnik::box2d<double> mvt_datasource::envelope() const
+{
+    return extent_;
+}
+
+mapnik::layer_descriptor mvt_datasource::get_descriptor() const
+{
+    return desc_;
+}
+
+std::uint32_t mvt_datasource::query_zoom(mapnik::query const& q) const
+{
+    if (zoom_)
+        return *zoom_;
+    // the zoom level at which one tile covers tile_size pixels
+    double resolution = std::get<0>(q.resolution());
+    double zoom = std::log2(resolution * 2.0 * mapnik::MERC_MAX_EXTENT / tile_size_);
+    if (!std::isfinite(zoom))
+        return maxzoom_;
+    long z = std::lround(zoom);
+    return static_cast<std::uint32_t>(std::min<long>(std::max<long>(z, minzoom_), maxzoom_));
+}
+
+mapnik::featureset_ptr mvt_datasource::features(mapnik::query const& q) const
+{
+    mapnik::box2d<double> const& box = q.get_bbox();
+    if (!extent_.intersects(box))
+        return mapnik::make_invalid_featureset();
+    std::vector<mvt_tile> tiles;
+    if (archive_)
+    {
+        std::uint32_t z = query_zoom(q);
+        std::uint32_t minx, miny, maxx, maxy;
+        if (!mvt_tile_utils::tile_range(z, box, minx, miny, maxx, maxy))
+            return mapnik::make_invalid_featureset();
+        tiles = archive_->tiles(z, minx, miny, maxx, maxy);
+        MAPNIK_LOG_DEBUG(mvt) << "mvt_datasource: zoom=" << z << " tiles=" << tiles.size();
+    }
+    else
+    {
+        tiles.push_back(tile_);
+    }
+    return std::make_shared<mvt_featureset>(std::move(tiles), layer_name_, box, q.property_names(), encoding_);
+}
+
+mapnik::featureset_ptr mvt_datasource::features_at_point(mapnik::coord2d const& pt, double tol) const
+{
+    mapnik::box2d<double> query_bbox(pt, pt);
+    query_bbox.pad(tol);
+    mapnik::query q(query_bbox);
+    for (auto const& attr : desc_.get_descriptors())
+    {
+        q.add_property_name(attr.get_name());
+    }
+    return features(q);
+}
@@ -0,0 +1,90 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MVT_DATASOURCE_HPP
+#define MVT_DATASOURCE_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/coord.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/datasource_plugin.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "mvt_tile.hpp"
+
+class mbtiles_archive;
+
+DATASOURCE_PLUGIN_DEF(mvt_datasource_plugin, mvt);
+
+// Reads one layer of Mapbox Vector Tiles, either from a single tile file
+// (georeferenced by the `z`, `x` and `y` parameters) or from an MBTiles
+// archive, in which case the zoom level is picked from the query resolution
+// unless fixed with `zoom`. Features are always in spherical mercator.
+class mvt_datasource : public mapnik::datasource
+{
+  public:
+    mvt_datasource(mapnik::parameters const& params);
+    virtual ~mvt_datasource();
+    mapnik::datasource::datasource_t type() const;
+    static const char* name();
+    mapnik::featureset_ptr features(mapnik::query const& q) const;
+    mapnik::featureset_ptr features_at_point(mapnik::coord2d const& pt, double tol = 0) const;
+    mapnik::box2d<double> envelope() const;
+    mapnik::layer_descriptor get_descriptor() const;
+    boost::optional<mapnik::datasource_geometry_t> get_geometry_type() const;
+
+  private:
+    void init_tile_file(mapnik::parameters const& params);
+    void init_mbtiles();
+    void describe(mvt_tile const& tile);
+    std::uint32_t query_zoom(mapnik::query const& q) const;
+
+    mapnik::datasource::datasource_t type_;
+    mapnik::layer_descriptor desc_;
+    std::string filename_;
+    std::string layer_name_;
+    std::string encoding_;
+    mapnik::box2d<double> extent_;
+    boost::optional<mapnik::datasource_geometry_t> geometry_type_;
+    // single tile file
+    mvt_tile tile_;
+    // MBTiles archive
+    std::shared_ptr<mbtiles_archive> archive_;
+    std::uint32_t minzoom_;
+    std::uint32_t maxzoom_;
+    boost::optional<std::uint32_t> zoom_;
+    double tile_size_;
+};
+
+#endif // MVT_DATASOURCE_HPP
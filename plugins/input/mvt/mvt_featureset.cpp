@@ -0,0 +1,398 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/mvt/mvt.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// protozero
+#include <protozero/pbf_reader.hpp>
+#include <protozero/varint.hpp>
+
+// stl
+#include <limits>
+
+#include "mvt_featureset.hpp"
+
+namespace {
+
+// walks the MoveTo/LineTo/ClosePath commands of a feature geometry,
+// returns false on a malformed command stream
+template<typename Visitor>
+bool walk_commands(protozero::data_view const& commands, Visitor& visitor)
+{
+    char const* itr = commands.data();
+    char const* end = itr + commands.size();
+    std::int64_t x = 0;
+    std::int64_t y = 0;
+    while (itr != end)
+    {
+        std::uint32_t cmd = static_cast<std::uint32_t>(protozero::decode_varint(&itr, end));
+        std::uint32_t id = mapnik::mvt::command_id(cmd);
+        std::uint32_t count = mapnik::mvt::command_count(cmd);
+        if (id == mapnik::mvt::CMD_MOVE_TO || id == mapnik::mvt::CMD_LINE_TO)
+        {
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                if (itr == end)
+                    return false;
+                x += mapnik::mvt::zigzag_decode(static_cast<std::uint32_t>(protozero::decode_varint(&itr, end)));
+                if (itr == end)
+                    return false;
+                y += mapnik::mvt::zigzag_decode(static_cast<std::uint32_t>(protozero::decode_varint(&itr, end)));
+                visitor.vertex(id == mapnik::mvt::CMD_MOVE_TO, x, y);
+            }
+        }
+        else if (id == mapnik::mvt::CMD_CLOSE_PATH)
+        {
+            visitor.close();
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct bounds_visitor
+{
+    void vertex(bool, std::int64_t x, std::int64_t y)
+    {
+        minx = std::min(minx, x);
+        miny = std::min(miny, y);
+        maxx = std::max(maxx, x);
+        maxy = std::max(maxy, y);
+    }
+    void close() {}
+
+    std::int64_t minx = std::numeric_limits<std::int64_t>::max();
+    std::int64_t miny = std::numeric_limits<std::int64_t>::max();
+    std::int64_t maxx = std::numeric_limits<std::int64_t>::min();
+    std::int64_t maxy = std::numeric_limits<std::int64_t>::min();
+};
+
+struct path_part
+{
+    std::vector<mapnik::geometry::point<double>> points;
+    // twice the signed area in tile coordinates, see mapnik::mvt
+    std::int64_t area = 0;
+    std::int64_t first_x = 0;
+    std::int64_t first_y = 0;
+    std::int64_t last_x = 0;
+    std::int64_t last_y = 0;
+};
+
+struct parts_visitor
+{
+    parts_visitor(double minx, double maxy, double scale)
+        : minx_(minx),
+          maxy_(maxy),
+          scale_(scale)
+    {}
+
+    void vertex(bool move_to, std::int64_t x, std::int64_t y)
+    {
+        if (move_to || parts.empty())
+        {
+            parts.emplace_back();
+            parts.back().first_x = x;
+            parts.back().first_y = y;
+        }
+        else
+        {
+            path_part& part = parts.back();
+            part.area += part.last_x * y - x * part.last_y;
+        }
+        path_part& part = parts.back();
+        part.last_x = x;
+        part.last_y = y;
+        part.points.emplace_back(minx_ + x * scale_, maxy_ - y * scale_);
+    }
+
+    void close()
+    {
+        if (parts.empty() || parts.back().points.empty())
+            return;
+        path_part& part = parts.back();
+        part.area += part.last_x * part.first_y - part.first_x * part.last_y;
+        part.points.push_back(part.points.front());
+    }
+
+    double minx_;
+    double maxy_;
+    double scale_;
+    std::vector<path_part> parts;
+};
+
+mapnik::geometry::geometry<double> make_geometry(std::int32_t type, std::vector<path_part>& parts)
+{
+    using namespace mapnik::geometry;
+    switch (type)
+    {
+        case mapnik::mvt::GEOM_POINT: {
+            multi_point<double> points;
+            for (auto& part : parts)
+            {
+                points.insert(points.end(), part.points.begin(), part.points.end());
+            }
+            if (points.size() == 1)
+                return points.front();
+            if (!points.empty())
+                return points;
+            break;
+        }
+        case mapnik::mvt::GEOM_LINESTRING: {
+            multi_line_string<double> lines;
+            for (auto& part : parts)
+            {
+                if (part.points.size() > 1)
+                {
+                    lines.emplace_back();
+                    lines.back().swap(part.points);
+                }
+            }
+            if (lines.size() == 1)
+                return std::move(lines.front());
+            if (!lines.empty())
+                return lines;
+            break;
+        }
+        case mapnik::mvt::GEOM_POLYGON: {
+            // a ring with positive area starts a new polygon, negative ones are its holes
+            multi_polygon<double> polygons;
+            bool has_exterior = false;
+            for (auto& part : parts)
+            {
+                if (part.points.size() < 4 || part.area == 0)
+                    continue;
+                if (part.area > 0)
+                {
+                    polygons.emplace_back();
+                    has_exterior = true;
+                }
+                else if (!has_exterior)
+                {
+                    continue;
+                }
+                polygons.back().emplace_back();
+                polygons.back().back().swap(part.points);
+            }
+            if (polygons.size() == 1)
+                return std::move(polygons.front());
+            if (!polygons.empty())
+                return polygons;
+            break;
+        }
+        default:
+            break;
+    }
+    return geometry_empty();
+}
+
+} // namespace
+
+mvt_featureset::mvt_featureset(std::vector<mvt_tile>&& tiles,
+                               std::string const& layer_name,
+                               mapnik::box2d<double> const& bbox,
+                               std::set<std::string> const& attribute_names,
+                               std::string const& encoding)
+    : tiles_(std::move(tiles)),
+      tile_index_(0),
+      layer_name_(layer_name),
+      bbox_(bbox),
+      attribute_names_(attribute_names),
+      tr_(encoding),
+      ctx_(std::make_shared<mapnik::context_type>()),
+      feature_id_(0),
+      buffer_(),
+      features_(),
+      feature_index_(0),
+      minx_(0),
+      maxy_(0),
+      scale_(1)
+{
+    for (auto const& name : attribute_names_)
+    {
+        ctx_->push(name);
+    }
+}
+
+mvt_featureset::~mvt_featureset() {}
+
+bool mvt_featureset::next_tile()
+{
+    while (tile_index_ < tiles_.size())
+    {
+        mvt_tile const& tile = tiles_[tile_index_++];
+        features_.clear();
+        feature_index_ = 0;
+        keys_.clear();
+        wanted_keys_.clear();
+        values_.clear();
+        if (!tile.data)
+            continue;
+        try
+        {
+            protozero::data_view layer;
+            if (!mvt_tile_utils::find_layer(mvt_tile_utils::decompress(*tile.data, buffer_), layer_name_, layer))
+                continue;
+            std::uint32_t extent = mapnik::mvt::default_extent;
+            protozero::pbf_reader reader(layer);
+            while (reader.next())
+            {
+                switch (reader.tag())
+                {
+                    case mapnik::mvt::LAYER_FEATURES:
+                        features_.push_back(reader.get_view());
+                        break;
+                    case mapnik::mvt::LAYER_KEYS:
+                        keys_.push_back(reader.get_string());
+                        wanted_keys_.push_back(attribute_names_.count(keys_.back()) > 0);
+                        break;
+                    case mapnik::mvt::LAYER_VALUES:
+                        values_.push_back(reader.get_view());
+                        break;
+                    case mapnik::mvt::LAYER_EXTENT:
+                        extent = reader.get_uint32();
+                        break;
+                    default:
+                        reader.skip();
+                }
+            }
+            if (extent == 0)
+                throw std::runtime_error("invalid layer extent");
+            mapnik::box2d<double> bounds = mvt_tile_utils::tile_bounds(tile.z, tile.x, tile.y);
+            minx_ = bounds.minx();
+            maxy_ = bounds.maxy();
+            scale_ = bounds.width() / extent;
+        }
+        catch (std::exception const& ex)
+        {
+            MAPNIK_LOG_ERROR(mvt) << "mvt_featureset: skipping tile " << tile.z << "/" << tile.x << "/" << tile.y
+                                  << ": " << ex.what();
+            features_.clear();
+            continue;
+        }
+        decoded_values_.assign(values_.size(), mapnik::value());
+        value_decoded_.assign(values_.size(), false);
+        if (!features_.empty())
+            return true;
+    }
+    return false;
+}
+
+mapnik::value const& mvt_featureset::get_value(std::uint32_t index)
+{
+    if (!value_decoded_[index])
+    {
+        decoded_values_[index] = mvt_tile_utils::decode_value(values_[index], tr_);
+        value_decoded_[index] = true;
+    }
+    return decoded_values_[index];
+}
+
+mapnik::feature_ptr mvt_featureset::decode_feature(protozero::data_view const& message)
+{
+    boost::optional<std::uint64_t> id;
+    protozero::data_view tags;
+    protozero::data_view commands;
+    std::int32_t type = mapnik::mvt::GEOM_UNKNOWN;
+    protozero::pbf_reader reader(message);
+    while (reader.next())
+    {
+        switch (reader.tag())
+        {
+            case mapnik::mvt::FEATURE_ID:
+                id = reader.get_uint64();
+                break;
+            case mapnik::mvt::FEATURE_TAGS:
+                tags = reader.get_view();
+                break;
+            case mapnik::mvt::FEATURE_TYPE:
+                type = reader.get_enum();
+                break;
+            case mapnik::mvt::FEATURE_GEOMETRY:
+                commands = reader.get_view();
+                break;
+            default:
+                reader.skip();
+        }
+    }
+
+    bounds_visitor bounds;
+    if (!walk_commands(commands, bounds) || bounds.minx > bounds.maxx)
+        return mapnik::feature_ptr();
+    mapnik::box2d<double> box(minx_ + bounds.minx * scale_,
+                              maxy_ - bounds.maxy * scale_,
+                              minx_ + bounds.maxx * scale_,
+                              maxy_ - bounds.miny * scale_);
+    if (!bbox_.intersects(box))
+        return mapnik::feature_ptr();
+
+    parts_visitor parts(minx_, maxy_, scale_);
+    walk_commands(commands, parts);
+    mapnik::geometry::geometry<double> geom = make_geometry(type, parts.parts);
+    if (geom.is<mapnik::geometry::geometry_empty>())
+        return mapnik::feature_ptr();
+
+    mapnik::value_integer feature_id = id ? static_cast<mapnik::value_integer>(*id) : ++feature_id_;
+    mapnik::feature_ptr feature = mapnik::feature_factory::create(ctx_, feature_id);
+    char const* itr = tags.data();
+    char const* end = itr + tags.size();
+    while (itr != end)
+    {
+        std::uint32_t key = static_cast<std::uint32_t>(protozero::decode_varint(&itr, end));
+        if (itr == end)
+            break;
+        std::uint32_t val = static_cast<std::uint32_t>(protozero::decode_varint(&itr, end));
+        if (key < keys_.size() && wanted_keys_[key] && val < values_.size())
+        {
+            feature->put(keys_[key], get_value(val));
+        }
+    }
+    feature->set_geometry(std::move(geom));
+    return feature;
+}
+
+mapnik::feature_ptr mvt_featureset::next()
+{
+    while (feature_index_ < features_.size() || next_tile())
+    {
+        protozero::data_view const& message = features_[feature_index_++];
+        try
+        {
+            mapnik::feature_ptr feature = decode_feature(message);
+            if (feature)
+                return feature;
+        }
+        catch (std::exception const& ex)
+        {
+            MAPNIK_LOG_ERROR(mvt) << "mvt_featureset: skipping malformed feature: " << ex.what();
+        }
+    }
+    return mapnik::feature_ptr();
+}
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MVT_FEATURESET_HPP
+#define MVT_FEATURESET_HPP
+
+#include "mvt_tile.hpp"
+
+// mapnik
+#include <mapnik/feature.hpp>
+#include <mapnik/featureset.hpp>
+#include <mapnik/unicode.hpp>
+
+// protozero
+#include <protozero/data_view.hpp>
+
+// stl
+#include <set>
+#include <string>
+#include <vector>
+
+// Iterates the features of one layer across a set of tiles. Tiles are
+// decompressed one at a time when the previous one is exhausted; feature
+// geometries are only decoded once their bounds, computed straight from the
+// command stream, intersect the query box, and only attributes named in the
+// query are materialised.
+class mvt_featureset : public mapnik::Featureset
+{
+  public:
+    mvt_featureset(std::vector<mvt_tile>&& tiles,
+                   std::string const& layer_name,
+                   mapnik::box2d<double> const& bbox,
+                   std::set<std::string> const& attribute_names,
+                   std::string const& encoding);
+    virtual ~mvt_featureset();
+    mapnik::feature_ptr next();
+
+  private:
+    bool next_tile();
+    mapnik::feature_ptr decode_feature(protozero::data_view const& message);
+    mapnik::value const& get_value(std::uint32_t index);
+
+    std::vector<mvt_tile> tiles_;
+    std::size_t tile_index_;
+    std::string layer_name_;
+    mapnik::box2d<double> bbox_;
+    std::set<std::string> attribute_names_;
+    mapnik::transcoder tr_;
+    mapnik::context_ptr ctx_;
+    mapnik::value_integer feature_id_;
+
+    // state of the current tile
+    std::string buffer_;
+    std::vector<protozero::data_view> features_;
+    std::size_t feature_index_;
+    std::vector<std::string> keys_;
+    std::vector<bool> wanted_keys_;
+    std::vector<protozero::data_view> values_;
+    std::vector<mapnik::value> decoded_values_;
+    std::vector<bool> value_decoded_;
+    double minx_;
+    double maxy_;
+    double scale_;
+};
+
+#endif // MVT_FEATURESET_HPP
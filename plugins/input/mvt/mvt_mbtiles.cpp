@@ -0,0 +1,157 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "mvt_mbtiles.hpp"
+
+// mapnik
+#include <mapnik/datasource.hpp>
+
+// sqlite
+#include <sqlite3.h>
+
+namespace {
+
+class statement : private mapnik::util::noncopyable
+{
+  public:
+    statement(sqlite3* db, char const* sql)
+        : stmt_(nullptr)
+    {
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt_, nullptr) != SQLITE_OK)
+        {
+            throw mapnik::datasource_exception(std::string("MVT Plugin: ") + sqlite3_errmsg(db));
+        }
+    }
+
+    ~statement() { sqlite3_finalize(stmt_); }
+
+    void bind(int index, std::int64_t val) { sqlite3_bind_int64(stmt_, index, val); }
+    void bind(int index, std::string const& val)
+    {
+        sqlite3_bind_text(stmt_, index, val.data(), static_cast<int>(val.size()), SQLITE_TRANSIENT);
+    }
+    bool step() { return sqlite3_step(stmt_) == SQLITE_ROW; }
+    bool is_null(int col) const { return sqlite3_column_type(stmt_, col) == SQLITE_NULL; }
+    std::int64_t column_int(int col) const { return sqlite3_column_int64(stmt_, col); }
+    std::string column_blob(int col) const
+    {
+        char const* data = static_cast<char const*>(sqlite3_column_blob(stmt_, col));
+        int size = sqlite3_column_bytes(stmt_, col);
+        return data ? std::string(data, static_cast<std::size_t>(size)) : std::string();
+    }
+
+  private:
+    sqlite3_stmt* stmt_;
+};
+
+inline std::uint32_t flip_row(std::uint32_t z, std::uint32_t y)
+{
+    // MBTiles rows follow the TMS scheme (origin bottom-left)
+    return static_cast<std::uint32_t>((std::uint64_t(1) << z) - 1 - y);
+}
+
+} // namespace
+
+mbtiles_archive::mbtiles_archive(std::string const& filename)
+    : db_(nullptr)
+{
+    int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX;
+    if (sqlite3_open_v2(filename.c_str(), &db_, flags, nullptr) != SQLITE_OK)
+    {
+        std::string error = db_ ? sqlite3_errmsg(db_) : "out of memory";
+        sqlite3_close(db_);
+        throw mapnik::datasource_exception("MVT Plugin: could not open '" + filename + "': " + error);
+    }
+}
+
+mbtiles_archive::~mbtiles_archive()
+{
+    sqlite3_close(db_);
+}
+
+boost::optional<std::string> mbtiles_archive::metadata(std::string const& name) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    boost::optional<std::string> result;
+    statement stmt(db_, "SELECT value FROM metadata WHERE name = ?");
+    stmt.bind(1, name);
+    if (stmt.step() && !stmt.is_null(0))
+    {
+        result = stmt.column_blob(0);
+    }
+    return result;
+}
+
+bool mbtiles_archive::zoom_range(std::uint32_t& minzoom, std::uint32_t& maxzoom) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    statement stmt(db_, "SELECT MIN(zoom_level), MAX(zoom_level) FROM tiles");
+    if (stmt.step() && !stmt.is_null(0))
+    {
+        minzoom = static_cast<std::uint32_t>(stmt.column_int(0));
+        maxzoom = static_cast<std::uint32_t>(stmt.column_int(1));
+        return true;
+    }
+    return false;
+}
+
+std::vector<mvt_tile> mbtiles_archive::tiles(std::uint32_t z,
+                                             std::uint32_t minx,
+                                             std::uint32_t miny,
+                                             std::uint32_t maxx,
+                                             std::uint32_t maxy) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<mvt_tile> result;
+    statement stmt(db_,
+                   "SELECT tile_column, tile_row, tile_data FROM tiles WHERE zoom_level = ? "
+                   "AND tile_column BETWEEN ? AND ? AND tile_row BETWEEN ? AND ?");
+    stmt.bind(1, z);
+    stmt.bind(2, minx);
+    stmt.bind(3, maxx);
+    stmt.bind(4, flip_row(z, maxy));
+    stmt.bind(5, flip_row(z, miny));
+    while (stmt.step())
+    {
+        mvt_tile tile;
+        tile.z = z;
+        tile.x = static_cast<std::uint32_t>(stmt.column_int(0));
+        tile.y = flip_row(z, static_cast<std::uint32_t>(stmt.column_int(1)));
+        tile.data = std::make_shared<std::string const>(stmt.column_blob(2));
+        result.push_back(std::move(tile));
+    }
+    return result;
+}
+
+bool mbtiles_archive::sample_tile(std::uint32_t z, mvt_tile& tile) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    statement stmt(db_, "SELECT tile_column, tile_row, tile_data FROM tiles WHERE zoom_level = ? LIMIT 1");
+    stmt.bind(1, z);
+    if (!stmt.step())
+        return false;
+    tile.z = z;
+    tile.x = static_cast<std::uint32_t>(stmt.column_int(0));
+    tile.y = flip_row(z, static_cast<std::uint32_t>(stmt.column_int(1)));
+    tile.data = std::make_shared<std::string const>(stmt.column_blob(2));
+    return true;
+}
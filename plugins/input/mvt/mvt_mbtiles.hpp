@@ -0,0 +1,65 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MVT_MBTILES_HPP
+#define MVT_MBTILES_HPP
+
+#include "mvt_tile.hpp"
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+// Read-only access to an MBTiles archive (an SQLite database with `tiles`
+// and `metadata` tables). The connection is shared by all featuresets of a
+// datasource, so every statement runs under a lock and tile blobs are copied
+// out before it is released.
+class mbtiles_archive : private mapnik::util::noncopyable
+{
+  public:
+    explicit mbtiles_archive(std::string const& filename);
+    ~mbtiles_archive();
+    boost::optional<std::string> metadata(std::string const& name) const;
+    // lowest and highest zoom levels stored in the tiles table
+    bool zoom_range(std::uint32_t& minzoom, std::uint32_t& maxzoom) const;
+    // tiles of zoom level z inside the (XYZ) tile range
+    std::vector<mvt_tile>
+      tiles(std::uint32_t z, std::uint32_t minx, std::uint32_t miny, std::uint32_t maxx, std::uint32_t maxy) const;
+    // any one tile of zoom level z, used to describe the layers
+    bool sample_tile(std::uint32_t z, mvt_tile& tile) const;
+
+  private:
+    sqlite3* db_;
+    mutable std::mutex mutex_;
+};
+
+#endif // MVT_MBTILES_HPP
@@ -0,0 +1,170 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "mvt_tile.hpp"
+
+// mapnik
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/mvt/mvt.hpp>
+
+// protozero
+#include <protozero/pbf_reader.hpp>
+
+// zlib
+#include <zlib.h>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace mvt_tile_utils {
+
+mapnik::box2d<double> tile_bounds(std::uint32_t z, std::uint32_t x, std::uint32_t y)
+{
+    double tile_size = 2.0 * mapnik::MERC_MAX_EXTENT / static_cast<double>(std::uint64_t(1) << z);
+    double minx = -mapnik::MERC_MAX_EXTENT + x * tile_size;
+    double maxy = mapnik::MERC_MAX_EXTENT - y * tile_size;
+    return mapnik::box2d<double>(minx, maxy - tile_size, minx + tile_size, maxy);
+}
+
+bool tile_range(std::uint32_t z,
+                mapnik::box2d<double> const& box,
+                std::uint32_t& minx,
+                std::uint32_t& miny,
+                std::uint32_t& maxx,
+                std::uint32_t& maxy)
+{
+    mapnik::box2d<double> world(-mapnik::MERC_MAX_EXTENT,
+                                -mapnik::MERC_MAX_EXTENT,
+                                mapnik::MERC_MAX_EXTENT,
+                                mapnik::MERC_MAX_EXTENT);
+    if (!box.valid() || !world.intersects(box))
+        return false;
+    double num_tiles = static_cast<double>(std::uint64_t(1) << z);
+    double tile_size = 2.0 * mapnik::MERC_MAX_EXTENT / num_tiles;
+    auto clamp = [num_tiles](double val) {
+        return static_cast<std::uint32_t>(std::min(std::max(val, 0.0), num_tiles - 1));
+    };
+    minx = clamp(std::floor((box.minx() + mapnik::MERC_MAX_EXTENT) / tile_size));
+    maxx = clamp(std::floor((box.maxx() + mapnik::MERC_MAX_EXTENT) / tile_size));
+    miny = clamp(std::floor((mapnik::MERC_MAX_EXTENT - box.maxy()) / tile_size));
+    maxy = clamp(std::floor((mapnik::MERC_MAX_EXTENT - box.miny()) / tile_size));
+    return true;
+}
+
+protozero::data_view decompress(std::string const& data, std::string& out)
+{
+    bool gzip = data.size() > 2 && static_cast<unsigned char>(data[0]) == 0x1f &&
+                static_cast<unsigned char>(data[1]) == 0x8b;
+    bool zlib = data.size() > 2 && static_cast<unsigned char>(data[0]) == 0x78 &&
+                ((static_cast<unsigned char>(data[0]) << 8) | static_cast<unsigned char>(data[1])) % 31 == 0;
+    if (!gzip && !zlib)
+    {
+        return protozero::data_view(data.data(), data.size());
+    }
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 32 enables automatic gzip/zlib header detection
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+    {
+        throw std::runtime_error("MVT Plugin: failed to initialise zlib");
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    out.clear();
+    std::size_t chunk = std::max<std::size_t>(data.size() * 4, 16384);
+    int result = Z_OK;
+    while (result == Z_OK)
+    {
+        std::size_t offset = out.size();
+        out.resize(offset + chunk);
+        stream.next_out = reinterpret_cast<Bytef*>(&out[offset]);
+        stream.avail_out = static_cast<uInt>(chunk);
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.resize(offset + chunk - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END)
+    {
+        throw std::runtime_error("MVT Plugin: could not decompress tile data");
+    }
+    return protozero::data_view(out.data(), out.size());
+}
+
+mapnik::value decode_value(protozero::data_view const& message, mapnik::transcoder const& tr)
+{
+    protozero::pbf_reader reader(message);
+    while (reader.next())
+    {
+        switch (reader.tag())
+        {
+            case mapnik::mvt::VALUE_STRING: {
+                protozero::data_view str = reader.get_view();
+                return tr.transcode(str.data(), static_cast<std::int32_t>(str.size()));
+            }
+            case mapnik::mvt::VALUE_FLOAT:
+                return static_cast<mapnik::value_double>(reader.get_float());
+            case mapnik::mvt::VALUE_DOUBLE:
+                return reader.get_double();
+            case mapnik::mvt::VALUE_INT:
+                return static_cast<mapnik::value_integer>(reader.get_int64());
+            case mapnik::mvt::VALUE_UINT:
+                return static_cast<mapnik::value_integer>(reader.get_uint64());
+            case mapnik::mvt::VALUE_SINT:
+                return static_cast<mapnik::value_integer>(reader.get_sint64());
+            case mapnik::mvt::VALUE_BOOL:
+                return reader.get_bool();
+            default:
+                reader.skip();
+        }
+    }
+    return mapnik::value_null();
+}
+
+bool find_layer(protozero::data_view const& tile, std::string const& name, protozero::data_view& layer)
+{
+    protozero::pbf_reader tile_reader(tile);
+    while (tile_reader.next(mapnik::mvt::TILE_LAYERS))
+    {
+        protozero::data_view view = tile_reader.get_view();
+        if (name.empty())
+        {
+            layer = view;
+            return true;
+        }
+        protozero::pbf_reader layer_reader(view);
+        if (layer_reader.next(mapnik::mvt::LAYER_NAME))
+        {
+            protozero::data_view layer_name = layer_reader.get_view();
+            if (layer_name.size() == name.size() && std::equal(name.begin(), name.end(), layer_name.data()))
+            {
+                layer = view;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace mvt_tile_utils
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MVT_TILE_HPP
+#define MVT_TILE_HPP
+
+// mapnik
+#include <mapnik/geometry.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/unicode.hpp>
+
+// protozero
+#include <protozero/data_view.hpp>
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// a raw tile as stored on disk or in an MBTiles archive, possibly compressed;
+// rows follow the XYZ scheme (origin top-left)
+struct mvt_tile
+{
+    std::uint32_t z = 0;
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+    std::shared_ptr<std::string const> data;
+};
+
+namespace mvt_tile_utils {
+
+// spherical mercator bounds of a tile
+mapnik::box2d<double> tile_bounds(std::uint32_t z, std::uint32_t x, std::uint32_t y);
+
+// tile range at zoom z covering `box`; returns false when `box` is outside of the world
+bool tile_range(std::uint32_t z,
+                mapnik::box2d<double> const& box,
+                std::uint32_t& minx,
+                std::uint32_t& miny,
+                std::uint32_t& maxx,
+                std::uint32_t& maxy);
+
+// inflates gzip or zlib compressed tile data into `out`; returns the
+// uncompressed input unchanged
+protozero::data_view decompress(std::string const& data, std::string& out);
+
+// decodes a Layer.values message
+mapnik::value decode_value(protozero::data_view const& message, mapnik::transcoder const& tr);
+
+// locates the layer named `name` (or the first one when empty)
+bool find_layer(protozero::data_view const& tile, std::string const& name, protozero::data_view& layer);
+
+} // namespace mvt_tile_utils
+
+#endif // MVT_TILE_HPP
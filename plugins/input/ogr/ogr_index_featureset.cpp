@@ -72,7 +72,8 @@ ogr_index_featureset<filterT>::ogr_index_featureset(mapnik::context_ptr const& c
     , feature_envelope_()
 {
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
-    boost::optional<mapnik::mapped_region_ptr> memory = mapnik::mapped_memory_cache::instance().find(index_file, true);
+    boost::optional<mapnik::mapped_region_ptr> memory =
+      mapnik::mapped_memory_cache::instance().find(index_file, true, mapnik::mapped_access::willneed);
     if (memory)
     {
         boost::interprocess::ibufferstream file(static_cast<char*>((*memory)->get_address()), (*memory)->get_size());
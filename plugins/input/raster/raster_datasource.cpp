@@ -66,6 +66,7 @@ raster_datasource::raster_datasource(parameters const& params)
         filename_ = *file;
 
     multi_tiles_ = *params.get<mapnik::boolean_type>("multi", false);
+    reduced_resolution_ = *params.get<mapnik::boolean_type>("reduced_resolution", false);
     tile_size_ = *params.get<mapnik::value_integer>("tile_size", 1024);
     tile_stride_ = *params.get<mapnik::value_integer>("tile_stride", 1);
 
@@ -202,7 +203,7 @@ featureset_ptr raster_datasource::features(query const& q) const
         tiled_multi_file_policy
           policy(filename_, format_, tile_size_, extent_, q.get_bbox(), width_, height_, tile_stride_);
 
-        return std::make_shared<raster_featureset<tiled_multi_file_policy>>(policy, extent_, q);
+        return std::make_shared<raster_featureset<tiled_multi_file_policy>>(policy, extent_, q, reduced_resolution_);
     }
     else if (width * height > static_cast<int>(tile_size_ * tile_size_ << 2))
     {
@@ -210,7 +211,7 @@ featureset_ptr raster_datasource::features(query const& q) const
 
         tiled_file_policy policy(filename_, format_, tile_size_, extent_, q.get_bbox(), width_, height_);
 
-        return std::make_shared<raster_featureset<tiled_file_policy>>(policy, extent_, q);
+        return std::make_shared<raster_featureset<tiled_file_policy>>(policy, extent_, q, reduced_resolution_);
     }
     else
     {
@@ -219,7 +220,7 @@ featureset_ptr raster_datasource::features(query const& q) const
         raster_info info(filename_, format_, extent_, width_, height_);
         single_file_policy policy(info);
 
-        return std::make_shared<raster_featureset<single_file_policy>>(policy, extent_, q);
+        return std::make_shared<raster_featureset<single_file_policy>>(policy, extent_, q, reduced_resolution_);
     }
 }
 
@@ -64,6 +64,7 @@ class raster_datasource : public mapnik::datasource
     mapnik::box2d<double> extent_;
     bool extent_initialized_;
     bool multi_tiles_;
+    bool reduced_resolution_;
     unsigned tile_size_;
     unsigned tile_stride_;
     unsigned width_;
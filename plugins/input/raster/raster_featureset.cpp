@@ -37,6 +37,10 @@ MAPNIK_DISABLE_WARNING_PUSH
 #include <boost/format.hpp>
 MAPNIK_DISABLE_WARNING_POP
 
+// stl
+#include <algorithm>
+#include <tuple>
+
 #include "raster_featureset.hpp"
 
 using mapnik::feature_factory;
@@ -49,7 +53,8 @@ using mapnik::raster;
 template<typename LookupPolicy>
 raster_featureset<LookupPolicy>::raster_featureset(LookupPolicy const& policy,
                                                    box2d<double> const& extent,
-                                                   query const& q)
+                                                   query const& q,
+                                                   bool reduced_resolution)
     : policy_(policy)
     , feature_id_(1)
     , ctx_(std::make_shared<mapnik::context_type>())
@@ -58,6 +63,8 @@ raster_featureset<LookupPolicy>::raster_featureset(LookupPolicy const& policy,
     , curIter_(policy_.begin())
     , endIter_(policy_.end())
     , filter_factor_(q.get_filter_factor())
+    , resolution_(std::get<0>(q.resolution()))
+    , reduced_resolution_(reduced_resolution)
 {}
 
 template<typename LookupPolicy>
@@ -109,6 +116,24 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                     if (end_y > image_height)
                         end_y = image_height;
 
+                    // when the output is at least twice as coarse as the source, read a
+                    // reduced resolution window aligned to the reduction factor
+                    unsigned reduction = 1;
+                    if (reduced_resolution_ && resolution_ > 0 && extent_.width() > 0)
+                    {
+                        double ratio = image_width / (extent_.width() * resolution_);
+                        while (reduction < 8 && ratio >= 2.0 * reduction)
+                            reduction *= 2;
+                    }
+                    if (reduction > 1)
+                    {
+                        int r = static_cast<int>(reduction);
+                        x_off -= x_off % r;
+                        y_off -= y_off % r;
+                        end_x = std::min(((end_x + r - 1) / r) * r, image_width);
+                        end_y = std::min(((end_y + r - 1) / r) * r, image_height);
+                    }
+
                     int width = end_x - x_off;
                     int height = end_y - y_off;
                     if (width < 1)
@@ -122,7 +147,9 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                                                         rem.maxx() + x_off + width,
                                                         rem.maxy() + y_off + height);
                     feature_raster_extent = t.backward(feature_raster_extent);
-                    mapnik::image_any data = reader->read(x_off, y_off, width, height);
+                    mapnik::image_any data = reduction > 1
+                                               ? reader->read_reduced(x_off, y_off, width, height, reduction)
+                                               : reader->read(x_off, y_off, width, height);
                     mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(feature_raster_extent,
                                                                                  intersect,
                                                                                  std::move(data),
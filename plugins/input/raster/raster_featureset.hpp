@@ -258,7 +258,10 @@ class raster_featureset : public mapnik::Featureset
     using iterator_type = typename LookupPolicy::const_iterator;
 
   public:
-    raster_featureset(LookupPolicy const& policy, box2d<double> const& exttent, mapnik::query const& q);
+    raster_featureset(LookupPolicy const& policy,
+                      box2d<double> const& exttent,
+                      mapnik::query const& q,
+                      bool reduced_resolution = false);
     virtual ~raster_featureset();
     mapnik::feature_ptr next();
 
@@ -271,6 +274,8 @@ class raster_featureset : public mapnik::Featureset
     iterator_type curIter_;
     iterator_type endIter_;
     double filter_factor_;
+    double resolution_;
+    bool reduced_resolution_;
 };
 
 #endif // RASTER_FEATURESET_HPP
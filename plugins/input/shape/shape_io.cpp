@@ -52,7 +52,8 @@ shape_io::shape_io(std::string const& shape_name, bool open_index)
     {
         try
         {
-            index_ = std::make_unique<shape_file>(shape_name + INDEX);
+            // the quadtree is walked for every query, start reading it in up front
+            index_ = std::make_unique<shape_file>(shape_name + INDEX, mapnik::mapped_access::willneed);
         }
         catch (...)
         {
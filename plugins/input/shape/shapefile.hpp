@@ -125,8 +125,8 @@ class shape_file : public mapnik::util::mapped_memory_file
 
     shape_file() {}
 
-    shape_file(std::string const& file_name)
-        : mapped_memory_file(file_name)
+    shape_file(std::string const& file_name, mapnik::mapped_access access = mapnik::mapped_access::normal)
+        : mapped_memory_file(file_name, access)
     {}
 
     ~shape_file() {}
@@ -26,6 +26,7 @@
 // stl
 #include <string.h>
 #include <memory>
+#include <unordered_map>
 
 // mapnik
 #include <mapnik/datasource.hpp>
@@ -101,12 +102,18 @@ class sqlite_connection
 
     virtual ~sqlite_connection()
     {
+        for (auto const& stmt : statements_)
+        {
+            sqlite3_finalize(stmt.second);
+        }
         if (db_)
         {
             sqlite3_close(db_);
         }
     }
 
+    bool isOK() const { return db_ != 0; }
+
     void throw_sqlite_error(std::string const& sql)
     {
         std::ostringstream s;
@@ -121,6 +128,42 @@ class sqlite_connection
         throw mapnik::datasource_exception(s.str());
     }
 
+    // Returns a statement for `sql`, reusing one handed back through
+    // release_statement() when available. A statement is owned by the
+    // caller until it is released.
+    sqlite3_stmt* prepare_cached(std::string const& sql)
+    {
+        auto itr = statements_.find(sql);
+        if (itr != statements_.end())
+        {
+            sqlite3_stmt* stmt = itr->second;
+            statements_.erase(itr);
+            return stmt;
+        }
+#ifdef MAPNIK_STATS
+        mapnik::progress_timer __stats__(std::clog, std::string("sqlite_connection::prepare_cached ") + sql);
+#endif
+        sqlite3_stmt* stmt = 0;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, 0) != SQLITE_OK)
+        {
+            throw_sqlite_error(sql);
+        }
+        return stmt;
+    }
+
+    void release_statement(sqlite3_stmt* stmt)
+    {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        char const* sql = sqlite3_sql(stmt);
+        if (sql && statements_.size() < max_cached_statements &&
+            statements_.emplace(sql, stmt).second)
+        {
+            return;
+        }
+        sqlite3_finalize(stmt);
+    }
+
     std::shared_ptr<sqlite_resultset> execute_query(std::string const& sql)
     {
 #ifdef MAPNIK_STATS
@@ -174,8 +217,11 @@ class sqlite_connection
 
   private:
 
+    static constexpr std::size_t max_cached_statements = 32;
+
     sqlite3* db_;
     std::string file_;
+    std::unordered_map<std::string, sqlite3_stmt*> statements_;
 };
 
 #endif // MAPNIK_SQLITE_CONNECTION_HPP
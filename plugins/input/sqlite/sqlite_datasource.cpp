@@ -286,7 +286,8 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
         bool index_db_attached = false;
         if (mapnik::util::exists(index_db))
         {
-            dataset_->execute("attach database '" + index_db + "' as " + index_table_);
+            init_statements_.push_back("attach database '" + index_db + "' as " + index_table_);
+            dataset_->execute(init_statements_.back());
             index_db_attached = true;
         }
         has_spatial_index_ = sqlite_utils::has_rtree(index_table_, dataset_);
@@ -309,7 +310,8 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
                     has_spatial_index_ = true;
                     if (!index_db_attached && mapnik::util::exists(index_db))
                     {
-                        dataset_->execute("attach database '" + index_db + "' as " + index_table_);
+                        init_statements_.push_back("attach database '" + index_db + "' as " + index_table_);
+                        dataset_->execute(init_statements_.back());
                     }
                 }
             }
@@ -353,6 +355,83 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
             throw datasource_exception(s.str());
         }
     }
+
+    filtered_table_ = table_;
+    spatial_filter_ = false;
+    if (!key_field_.empty() && has_spatial_index_)
+    {
+        spatial_filter_ = sqlite_utils::apply_spatial_filter(filtered_table_,
+                                                             table_,
+                                                             key_field_,
+                                                             index_table_,
+                                                             geometry_table_,
+                                                             intersects_token_);
+        if (!spatial_filter_)
+        {
+            MAPNIK_LOG_WARN(sqlite) << "sqlite_datasource: could not apply the spatial index '" << index_table_
+                                    << "' to table '" << table_ << "', queries will scan the whole table";
+        }
+    }
+
+    // Queries run on a pool of read-only connections so render threads don't
+    // contend for dataset_, and each connection keeps its prepared statements.
+    // An in-memory database only exists on the connection that created it.
+    if (dataset_name_.compare(":memory:") != 0)
+    {
+        mapnik::value_integer initial_size = *params.get<mapnik::value_integer>("initial_size", 1);
+        mapnik::value_integer max_size = *params.get<mapnik::value_integer>("max_size", 10);
+        mapnik::value_integer mmap_size = *params.get<mapnik::value_integer>("mmap_size", 268435456);
+        creator_ = std::make_unique<sqlite_connection_creator<sqlite_connection>>(dataset_name_,
+                                                                                   init_statements_,
+                                                                                   mmap_size);
+        try
+        {
+            pool_ = std::make_unique<sqlite_pool>(*creator_, initial_size, max_size);
+        }
+        catch (datasource_exception const& ex)
+        {
+            MAPNIK_LOG_WARN(sqlite) << "sqlite_datasource: falling back to a single connection: " << ex.what();
+            pool_.reset();
+        }
+    }
+}
+
+std::shared_ptr<sqlite_connection> sqlite_datasource::borrow_connection() const
+{
+    if (pool_)
+    {
+        std::shared_ptr<sqlite_connection> conn = pool_->borrowObject();
+        if (conn)
+        {
+            return conn;
+        }
+        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: all " << pool_->max_size()
+                                 << " pooled connections are busy, opening another one";
+        return std::shared_ptr<sqlite_connection>((*creator_)());
+    }
+    return dataset_;
+}
+
+std::shared_ptr<sqlite_resultset> sqlite_datasource::execute_query(std::string const& sql,
+                                                                   mapnik::box2d<double> const& bbox) const
+{
+    std::shared_ptr<sqlite_resultset> rs;
+    std::shared_ptr<sqlite_connection> conn = borrow_connection();
+    if (pool_)
+    {
+        // the result set keeps the connection borrowed and hands the statement back when done
+        rs = std::make_shared<sqlite_resultset>(conn->prepare_cached(sql),
+                                                [conn](sqlite3_stmt* stmt) { conn->release_statement(stmt); });
+    }
+    else
+    {
+        rs = conn->execute_query(sql);
+    }
+    if (spatial_filter_)
+    {
+        sqlite_utils::bind_spatial_filter(rs->get_statement(), bbox);
+    }
+    return rs;
 }
 
 std::string sqlite_datasource::populate_tokens(std::string const& sql, double pixel_width, double pixel_height) const
@@ -433,7 +512,7 @@ boost::optional<mapnik::datasource_geometry_t> sqlite_datasource::get_geometry_t
 #endif
 
     boost::optional<mapnik::datasource_geometry_t> result;
-    if (dataset_)
+    if (std::shared_ptr<sqlite_connection> conn = borrow_connection())
     {
         // get geometry type by querying first features
         std::ostringstream s;
@@ -446,7 +525,7 @@ boost::optional<mapnik::datasource_geometry_t> sqlite_datasource::get_geometry_t
         {
             s << " LIMIT 5";
         }
-        std::shared_ptr<sqlite_resultset> rs = dataset_->execute_query(s.str());
+        std::shared_ptr<sqlite_resultset> rs = conn->execute_query(s.str());
         int multi_type = 0;
         while (rs->is_valid() && rs->step_next())
         {
@@ -523,21 +602,7 @@ featureset_ptr sqlite_datasource::features(query const& q) const
         }
         s << " FROM ";
 
-        std::string query(table_);
-
-        if (!key_field_.empty() && has_spatial_index_)
-        {
-            // TODO - debug warn if fails
-            sqlite_utils::apply_spatial_filter(query,
-                                               e,
-                                               table_,
-                                               key_field_,
-                                               index_table_,
-                                               geometry_table_,
-                                               intersects_token_);
-        }
-
-        query = populate_tokens(query, px_gw, px_gh);
+        std::string query = populate_tokens(filtered_table_, px_gw, px_gh);
 
         s << query;
 
@@ -553,7 +618,7 @@ featureset_ptr sqlite_datasource::features(query const& q) const
 
         MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        std::shared_ptr<sqlite_resultset> rs(execute_query(s.str(), e));
 
         return std::make_shared<sqlite_featureset>(rs,
                                                    ctx,
@@ -602,21 +667,7 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
 
         s << " FROM ";
 
-        std::string query(table_);
-
-        if (!key_field_.empty() && has_spatial_index_)
-        {
-            // TODO - debug warn if fails
-            sqlite_utils::apply_spatial_filter(query,
-                                               e,
-                                               table_,
-                                               key_field_,
-                                               index_table_,
-                                               geometry_table_,
-                                               intersects_token_);
-        }
-
-        query = populate_tokens(query, 0, 0);
+        std::string query = populate_tokens(filtered_table_, 0, 0);
 
         s << query;
 
@@ -632,7 +683,7 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
 
         MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        std::shared_ptr<sqlite_resultset> rs(execute_query(s.str(), e));
 
         return std::make_shared<sqlite_featureset>(rs,
                                                    ctx,
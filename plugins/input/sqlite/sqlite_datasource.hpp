@@ -45,6 +45,8 @@
 
 // sqlite
 #include "sqlite_connection.hpp"
+#include "sqlite_pool.hpp"
+#include "sqlite_resultset.hpp"
 
 DATASOURCE_PLUGIN_DEF(sqlite_datasource_plugin, sqlite);
 
@@ -66,12 +68,16 @@ class sqlite_datasource : public mapnik::datasource
     // needed to attach auxillary databases
     void parse_attachdb(std::string const& attachdb) const;
     std::string populate_tokens(std::string const& sql, double pixel_width, double pixel_height) const;
+    std::shared_ptr<sqlite_connection> borrow_connection() const;
+    std::shared_ptr<sqlite_resultset> execute_query(std::string const& sql, mapnik::box2d<double> const& bbox) const;
 
     mapnik::box2d<double> extent_;
     bool extent_initialized_;
     mapnik::datasource::datasource_t type_;
     std::string dataset_name_;
     std::shared_ptr<sqlite_connection> dataset_;
+    std::unique_ptr<sqlite_connection_creator<sqlite_connection>> creator_;
+    std::unique_ptr<sqlite_pool> pool_;
     std::string table_;
     std::string fields_;
     std::string metadata_;
@@ -91,6 +97,9 @@ class sqlite_datasource : public mapnik::datasource
     bool use_spatial_index_;
     bool has_spatial_index_;
     bool using_subquery_;
+    // table_ with the rtree filter applied, see sqlite_utils::apply_spatial_filter
+    std::string filtered_table_;
+    bool spatial_filter_;
     mutable std::vector<std::string> init_statements_;
 };
 
@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_SQLITE_POOL_HPP
+#define MAPNIK_SQLITE_POOL_HPP
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/pool.hpp>
+#include <mapnik/value/types.hpp>
+
+// stl
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sqlite_connection.hpp"
+
+// Opens the read-only connections handed out to render threads. Every
+// connection replays the datasource's init statements (attached databases,
+// `initdb` and the attached spatial index) and enables memory mapped I/O.
+template<typename T>
+class sqlite_connection_creator
+{
+  public:
+    sqlite_connection_creator(std::string const& file,
+                              std::vector<std::string> const& init_statements,
+                              mapnik::value_integer mmap_size)
+        : file_(file)
+        , init_statements_(init_statements)
+        , mmap_size_(mmap_size)
+    {}
+
+    T* operator()() const
+    {
+        int mode = SQLITE_OPEN_READONLY;
+#if SQLITE_VERSION_NUMBER >= 3006018
+        // Don't use shared cache in SQLite prior to 3.7.15.
+        // https://github.com/mapnik/mapnik/issues/2483
+        if (sqlite3_libversion_number() >= 3007015)
+        {
+            mode |= SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_SHAREDCACHE;
+        }
+#endif
+        std::unique_ptr<T> conn(new T(file_, mode));
+        sqlite3_busy_timeout(*(*conn), 5000);
+#if SQLITE_VERSION_NUMBER >= 3007017
+        if (mmap_size_ > 0)
+        {
+            std::ostringstream s;
+            s << "PRAGMA mmap_size=" << mmap_size_;
+            conn->execute(s.str());
+        }
+#endif
+        for (auto const& sql : init_statements_)
+        {
+            MAPNIK_LOG_DEBUG(sqlite) << "sqlite_connection_creator: Execute init sql=" << sql;
+            conn->execute(sql);
+        }
+        return conn.release();
+    }
+
+  private:
+    std::string file_;
+    std::vector<std::string> init_statements_;
+    mapnik::value_integer mmap_size_;
+};
+
+using sqlite_pool = mapnik::Pool<sqlite_connection, sqlite_connection_creator>;
+
+#endif // MAPNIK_SQLITE_POOL_HPP
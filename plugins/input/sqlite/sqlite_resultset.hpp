@@ -30,6 +30,7 @@
 
 // stl
 #include <string.h>
+#include <functional>
 
 // sqlite
 extern "C" {
@@ -42,15 +43,27 @@ class sqlite_resultset
 {
   public:
 
+    using release_type = std::function<void(sqlite3_stmt*)>;
+
     sqlite_resultset(sqlite3_stmt* stmt)
         : stmt_(stmt)
+        , release_()
+    {}
+
+    // `release` takes the statement back instead of finalizing it
+    sqlite_resultset(sqlite3_stmt* stmt, release_type release)
+        : stmt_(stmt)
+        , release_(std::move(release))
     {}
 
     ~sqlite_resultset()
     {
         if (stmt_)
         {
-            sqlite3_finalize(stmt_);
+            if (release_)
+                release_(stmt_);
+            else
+                sqlite3_finalize(stmt_);
         }
     }
 
@@ -107,6 +120,7 @@ class sqlite_resultset
   private:
 
     sqlite3_stmt* stmt_;
+    release_type release_;
 };
 
 #endif // MAPNIK_SQLITE_RESULTSET_HPP
@@ -106,8 +106,10 @@ class sqlite_utils
         //}
     }
 
+    // Adds an rtree filter to `query`. The bounding box is left as the
+    // ?1 (minx), ?2 (maxx), ?3 (miny) and ?4 (maxy) parameters so the
+    // statement can be prepared once and bound with bind_spatial_filter().
     static bool apply_spatial_filter(std::string& query,
-                                     mapnik::box2d<double> const& e,
                                      std::string const& table,
                                      std::string const& key_field,
                                      std::string const& index_table,
@@ -115,10 +117,8 @@ class sqlite_utils
                                      std::string const& intersects_token)
     {
         std::ostringstream spatial_sql;
-        spatial_sql << std::setprecision(16);
         spatial_sql << key_field << " IN (SELECT pkid FROM " << index_table;
-        spatial_sql << " WHERE xmax>=" << e.minx() << " AND xmin<=" << e.maxx();
-        spatial_sql << " AND ymax>=" << e.miny() << " AND ymin<=" << e.maxy() << ")";
+        spatial_sql << " WHERE xmax>=?1 AND xmin<=?2 AND ymax>=?3 AND ymin<=?4)";
         if (boost::algorithm::ifind_first(query, intersects_token))
         {
             boost::algorithm::ireplace_all(query, intersects_token, spatial_sql.str());
@@ -141,6 +141,17 @@ class sqlite_utils
         return false;
     }
 
+    static void bind_spatial_filter(sqlite3_stmt* stmt, mapnik::box2d<double> const& e)
+    {
+        if ((sqlite3_bind_double(stmt, 1, e.minx()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt, 2, e.maxx()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt, 3, e.miny()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt, 4, e.maxy()) != SQLITE_OK))
+        {
+            throw mapnik::datasource_exception("SQLite Plugin: invalid value for extent of spatial filter");
+        }
+    }
+
     static void get_tables(std::shared_ptr<sqlite_connection> ds, std::vector<std::string>& tables)
     {
         std::ostringstream sql;
@@ -42,6 +42,8 @@
 #include <mapnik/image_compositing.hpp>
 #include <mapnik/image_filter.hpp>
 #include <mapnik/image_any.hpp>
+#include <mapnik/renderer_common/label_batch.hpp>
+#include <mapnik/renderer_common/label_worker_pool.hpp>
 
 #include <mapnik/warning.hpp>
 MAPNIK_DISABLE_WARNING_PUSH
@@ -64,18 +66,46 @@ MAPNIK_DISABLE_WARNING_POP
 
 // stl
 #include <cmath>
+#include <stdexcept>
 
 namespace mapnik {
 
+template<typename T>
+agg_renderer_scratch<T>::agg_renderer_scratch(std::size_t width, std::size_t height)
+    : internal_buffers(width, height)
+    , inflated_buffer()
+    , ras_ptr(std::make_unique<rasterizer>())
+{}
+
+template<typename T>
+agg_renderer_scratch<T>::~agg_renderer_scratch()
+{}
+
+template<typename T>
+void agg_renderer_scratch<T>::reset()
+{
+    internal_buffers.reset();
+    // agg_renderer assumes a fresh rasterizer with linear gamma and the
+    // non-zero filling rule, symbolizers may have changed either
+    ras_ptr->reset();
+    ras_ptr->gamma(agg::gamma_power());
+    ras_ptr->filling_rule(agg::fill_non_zero);
+}
+
 template<typename T0, typename T1>
 agg_renderer<T0, T1>::agg_renderer(Map const& m, T0& pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor)
     , buffers_()
-    , internal_buffers_(m.width(), m.height())
-    , inflated_buffer_()
-    , ras_ptr(std::make_unique<rasterizer>())
+    , scratch_(std::make_shared<scratch_type>(m.width(), m.height()))
+    , internal_buffers_(scratch_->internal_buffers)
+    , inflated_buffer_(scratch_->inflated_buffer)
+    , ras_ptr(scratch_->ras_ptr)
     , gamma_method_(gamma_method_enum::GAMMA_POWER)
     , gamma_(1.0)
+    , label_threads_(1)
+    , placement_cache_()
+    , placement_key_()
+    , placement_feature_(nullptr)
     , common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor)
 {
     setup(m, pixmap);
@@ -91,16 +121,51 @@ agg_renderer<T0, T1>::agg_renderer(Map const& m,
                                    unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor)
     , buffers_()
-    , internal_buffers_(req.width(), req.height())
-    , inflated_buffer_()
-    , ras_ptr(std::make_unique<rasterizer>())
+    , scratch_(std::make_shared<scratch_type>(req.width(), req.height()))
+    , internal_buffers_(scratch_->internal_buffers)
+    , inflated_buffer_(scratch_->inflated_buffer)
+    , ras_ptr(scratch_->ras_ptr)
     , gamma_method_(gamma_method_enum::GAMMA_POWER)
     , gamma_(1.0)
+    , label_threads_(1)
+    , placement_cache_()
+    , placement_key_()
+    , placement_feature_(nullptr)
     , common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
 {
     setup(m, pixmap);
 }
 
+template<typename T0, typename T1>
+agg_renderer<T0, T1>::agg_renderer(Map const& m,
+                                   request const& req,
+                                   attributes const& vars,
+                                   T0& pixmap,
+                                   scratch_ptr scratch,
+                                   double scale_factor,
+                                   unsigned offset_x,
+                                   unsigned offset_y)
+    : feature_style_processor<agg_renderer>(m, scale_factor)
+    , buffers_()
+    , scratch_(scratch ? std::move(scratch) : std::make_shared<scratch_type>(req.width(), req.height()))
+    , internal_buffers_(scratch_->internal_buffers)
+    , inflated_buffer_(scratch_->inflated_buffer)
+    , ras_ptr(scratch_->ras_ptr)
+    , gamma_method_(gamma_method_enum::GAMMA_POWER)
+    , gamma_(1.0)
+    , label_threads_(1)
+    , placement_cache_()
+    , placement_key_()
+    , placement_feature_(nullptr)
+    , common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
+{
+    if (scratch_->width() != req.width() || scratch_->height() != req.height())
+    {
+        throw std::runtime_error("agg_renderer: scratch buffers do not match request dimensions");
+    }
+    setup(m, pixmap);
+}
+
 template<typename T0, typename T1>
 agg_renderer<T0, T1>::agg_renderer(Map const& m,
                                    T0& pixmap,
@@ -110,11 +175,16 @@ agg_renderer<T0, T1>::agg_renderer(Map const& m,
                                    unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor)
     , buffers_()
-    , internal_buffers_(m.width(), m.height())
-    , inflated_buffer_()
-    , ras_ptr(std::make_unique<rasterizer>())
+    , scratch_(std::make_shared<scratch_type>(m.width(), m.height()))
+    , internal_buffers_(scratch_->internal_buffers)
+    , inflated_buffer_(scratch_->inflated_buffer)
+    , ras_ptr(scratch_->ras_ptr)
     , gamma_method_(gamma_method_enum::GAMMA_POWER)
     , gamma_(1.0)
+    , label_threads_(1)
+    , placement_cache_()
+    , placement_key_()
+    , placement_feature_(nullptr)
     , common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor, detector)
 {
     setup(m, pixmap);
@@ -235,6 +305,31 @@ void agg_renderer<T0, T1>::start_layer_processing(layer const& lay, box2d<double
         common_.query_extent_.clip(*maximum_extent);
     }
 
+    common_.simplify_source_ = common_.simplify_cache_ ? common_.simplify_cache_->attach(lay.datasource()) : 0;
+
+    if (placement_cache_)
+    {
+        placement_key_.layer = lay.name();
+        placement_key_.style = 0;
+        // labels placed by other renders around this one, including those of
+        // features replayed below, which therefore do not add them again
+        box2d<double> extent = common_.t_.backward(common_.detector_->extent());
+        // a query then covers a few cells whatever the size of the first label
+        placement_cache_->set_cell_size(placement_key_.layer,
+                                        placement_key_.zoom,
+                                        std::max(extent.width(), extent.height()) / 4.0);
+        for (auto const& labels : placement_cache_->query(placement_key_.layer, placement_key_.zoom, extent))
+        {
+            for (cached_label const& label : *labels)
+            {
+                for (box2d<double> const& box : label.boxes)
+                {
+                    common_.detector_->insert(common_.t_.forward(box), label.text);
+                }
+            }
+        }
+    }
+
     if (lay.comp_op() || lay.get_opacity() < 1.0)
     {
         buffers_.emplace(internal_buffers_.push());
@@ -268,6 +363,7 @@ void agg_renderer<T0, T1>::start_style_processing(feature_type_style const& st)
 {
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: Start processing style";
 
+    placement_feature_ = nullptr;
     if (st.comp_op() || st.image_filters().size() > 0 || st.get_opacity() < 1)
     {
         if (st.image_filters_inflate())
@@ -317,6 +413,7 @@ void agg_renderer<T0, T1>::start_style_processing(feature_type_style const& st)
 template<typename T0, typename T1>
 void agg_renderer<T0, T1>::end_style_processing(feature_type_style const& st)
 {
+    ++placement_key_.style;
     buffer_type& current_buffer = buffers_.top().get();
     buffers_.pop();
     buffer_type& previous_buffer = buffers_.top().get();
@@ -438,6 +535,7 @@ struct agg_render_marker_visitor
         // https://github.com/mapnik/mapnik/issues/1866
         mtx.tx = std::floor(mtx.tx + .5);
         mtx.ty = std::floor(mtx.ty + .5);
+        svg_renderer.set_flattened(marker_cache::instance().find_flattened(marker.get_data(), mtx.scale()));
         svg_renderer.render(*ras_ptr_, sl, renb, mtx, opacity_, bbox);
     }
 
@@ -558,6 +656,86 @@ void agg_renderer<T0, T1>::render_marker(pixel_position const& pos,
     util::apply_visitor(visitor, marker);
 }
 
+template<typename T0, typename T1>
+void agg_renderer<T0, T1>::set_label_placement_cache(std::shared_ptr<label_placement_cache> cache, int zoom)
+{
+    placement_cache_ = std::move(cache);
+    placement_key_.zoom = zoom;
+}
+
+template<typename T0, typename T1>
+void agg_renderer<T0, T1>::set_simplified_geometry_cache(std::shared_ptr<simplified_geometry_cache> cache)
+{
+    common_.simplify_cache_ = std::move(cache);
+}
+
+template<typename T0, typename T1>
+label_placement_cache::key_type const& agg_renderer<T0, T1>::next_placement_key(feature_impl const& feature)
+{
+    // label symbolizers applied to the same feature by one style are numbered
+    // in the order they are processed, which is the same for every render
+    if (&feature != placement_feature_ || feature.id() != placement_key_.feature_id)
+    {
+        placement_feature_ = &feature;
+        placement_key_.feature_id = feature.id();
+        placement_key_.symbolizer = 0;
+    }
+    else
+    {
+        ++placement_key_.symbolizer;
+    }
+    return placement_key_;
+}
+
+template<typename T0, typename T1>
+bool agg_renderer<T0, T1>::batch_labels(feature_type_style const& st) const
+{
+    if (label_threads_ <= 1)
+        return false;
+    for (rule const& r : st.get_rules())
+    {
+        for (symbolizer const& sym : r.get_symbolizers())
+        {
+            if (!sym.is<text_symbolizer>() && !sym.is<shield_symbolizer>())
+                return false;
+        }
+    }
+    return true;
+}
+
+template<typename T0, typename T1>
+void agg_renderer<T0, T1>::process_labels(label_list const& labels, proj_transform const& prj_trans)
+{
+    label_batch batch(common_, prj_trans);
+    batch.set_placement_cache(placement_cache_.get());
+    for (auto const& label : labels)
+    {
+        for (symbolizer const& sym : label.second->get_symbolizers())
+        {
+            if (batch.add(label.first, sym) && placement_cache_)
+            {
+                batch.items().back().placement_key = next_placement_key(*label.first);
+            }
+        }
+    }
+    if (!scratch_->label_workers)
+    {
+        scratch_->label_workers = std::make_unique<label_worker_pool>();
+    }
+    batch.generate(*scratch_->label_workers, label_threads_);
+    for (auto& item : batch.items())
+    {
+        if (item.sym->is<text_symbolizer>())
+        {
+            render_labels(util::get<text_symbolizer>(*item.sym), *item.feature, *item.helper);
+        }
+        else
+        {
+            render_labels(util::get<shield_symbolizer>(*item.sym), *item.feature, *item.helper);
+        }
+    }
+}
+
 template<typename T0, typename T1>
 bool agg_renderer<T0, T1>::painted()
 {
@@ -640,6 +818,7 @@ void agg_renderer<T0, T1>::draw_geo_extent(box2d<double> const& extent, mapnik::
     }
 }
 
+template class agg_renderer_scratch<image_rgba8>;
 template class agg_renderer<image_rgba8>;
 template void agg_renderer<image_rgba8>::debug_draw_box<agg::rendering_buffer>(agg::rendering_buffer& buf,
                                                                                box2d<double> const& box,
@@ -26,6 +26,7 @@
 #include <mapnik/agg_rasterizer.hpp>
 #include <mapnik/agg_render_marker.hpp>
 #include <mapnik/image.hpp>
+#include <mapnik/marker_cache.hpp>
 #include <mapnik/text/renderer.hpp>
 #include <mapnik/text/glyph_positions.hpp>
 #include <mapnik/renderer_common/clipping_extent.hpp>
@@ -96,6 +97,7 @@ struct thunk_renderer<image_rgba8> : render_thunk_list_dispatch
 
         agg::trans_affine offset_tr = thunk.tr_;
         offset_tr.translate(offset_.x, offset_.y);
+        svg_renderer.set_flattened(marker_cache::instance().find_flattened(thunk.src_, offset_tr.scale()));
         render_vector_marker(svg_renderer,
                              *ras_ptr_,
                              renb,
@@ -31,6 +31,7 @@
 #include <mapnik/vertex_processor.hpp>
 #include <mapnik/renderer_common/clipping_extent.hpp>
 #include <mapnik/renderer_common/apply_vertex_converter.hpp>
+#include <mapnik/renderer_common/simplified_geometry.hpp>
 #include <mapnik/geometry/geometry_type.hpp>
 
 #include <mapnik/warning.hpp>
@@ -150,6 +151,8 @@ void agg_renderer<T0, T1>::process(line_symbolizer const& sym,
         clip_box.pad(padding);
     }
 
+    simplified_geometry_cache::path_ptr simplified = find_simplified_geometry(sym, feature, prj_trans, common_);
+
     if (rasterizer_e == line_rasterizer_enum::RASTERIZER_FAST)
     {
         using renderer_type = agg::renderer_outline_aa<renderer_base>;
@@ -181,7 +184,7 @@ void agg_renderer<T0, T1>::process(line_symbolizer const& sym,
         if (std::fabs(offset) > 0.0)
             converter.set<offset_transform_tag>(); // parallel offset
         converter.set<affine_transform_tag>();     // optional affine transform
-        if (simplify_tolerance > 0.0)
+        if (simplify_tolerance > 0.0 && !simplified)
             converter.set<simplify_tag>(); // optional simplify converter
         if (smooth > 0.0)
             converter.set<smooth_tag>(); // optional smooth converter
@@ -189,7 +192,10 @@ void agg_renderer<T0, T1>::process(line_symbolizer const& sym,
         using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer_type>;
         using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
         apply_vertex_converter_type apply(converter, ras);
-        mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
+        if (simplified)
+            apply(geometry::simplified_path_adapter(*simplified));
+        else
+            mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
     }
     else
     {
@@ -216,7 +222,7 @@ void agg_renderer<T0, T1>::process(line_symbolizer const& sym,
         if (std::fabs(offset) > 0.0)
             converter.set<offset_transform_tag>(); // parallel offset
         converter.set<affine_transform_tag>();     // optional affine transform
-        if (simplify_tolerance > 0.0)
+        if (simplify_tolerance > 0.0 && !simplified)
             converter.set<simplify_tag>(); // optional simplify converter
         if (smooth > 0.0)
             converter.set<smooth_tag>(); // optional smooth converter
@@ -227,7 +233,10 @@ void agg_renderer<T0, T1>::process(line_symbolizer const& sym,
         using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, rasterizer>;
         using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
         apply_vertex_converter_type apply(converter, *ras_ptr);
-        mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
+        if (simplified)
+            apply(geometry::simplified_path_adapter(*simplified));
+        else
+            mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
 
         using renderer_type = agg::renderer_scanline_aa_solid<renderer_base>;
         renderer_type ren(renb);
@@ -25,7 +25,9 @@
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
 #include <mapnik/agg_render_marker.hpp>
+#include <mapnik/marker_cache.hpp>
 #include <mapnik/svg/svg_renderer_agg.hpp>
+#include <mapnik/svg/svg_flattened_path.hpp>
 #include <mapnik/svg/svg_storage.hpp>
 #include <mapnik/svg/svg_path_adapter.hpp>
 #include <mapnik/svg/svg_path_attributes.hpp>
@@ -68,6 +70,9 @@ struct agg_markers_renderer_context : markers_renderer_context
         , pixf_(buf_)
         , renb_(pixf_)
         , ras_(ras)
+        , flattened_src_()
+        , flattened_bucket_(0)
+        , flattened_()
     {
         auto comp_op = get<composite_mode_e, keys::comp_op>(sym, feature, vars);
         pixf_.comp_op(static_cast<agg::comp_op_e>(comp_op));
@@ -80,6 +85,15 @@ struct agg_markers_renderer_context : markers_renderer_context
                                agg::trans_affine const& marker_tr)
     {
         SvgRenderer svg_renderer(path, attrs);
+        // placements of one feature share the marker and, mostly, its scale
+        int bucket = svg::svg_flattened_path::bucket(marker_tr.scale());
+        if (src != flattened_src_ || bucket != flattened_bucket_)
+        {
+            flattened_ = marker_cache::instance().find_flattened(src, marker_tr.scale());
+            flattened_src_ = src;
+            flattened_bucket_ = bucket;
+        }
+        svg_renderer.set_flattened(flattened_);
         render_vector_marker(svg_renderer,
                              ras_,
                              renb_,
@@ -102,6 +116,9 @@ struct agg_markers_renderer_context : markers_renderer_context
     pixfmt_type pixf_;
     renderer_base renb_;
     RasterizerType& ras_;
+    svg_path_ptr flattened_src_;
+    int flattened_bucket_;
+    std::shared_ptr<svg::svg_flattened_path const> flattened_;
 };
 
 } // namespace detail
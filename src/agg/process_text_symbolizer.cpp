@@ -54,7 +54,19 @@ void agg_renderer<T0, T1>::process(text_symbolizer const& sym,
                                         *common_.detector_,
                                         clip_box,
                                         tr);
+    if (placement_cache_)
+    {
+        helper.set_placement_cache(*placement_cache_, next_placement_key(feature));
+    }
+
+    render_labels(sym, feature, helper);
+}
 
+template<typename T0, typename T1>
+void agg_renderer<T0, T1>::render_labels(text_symbolizer const& sym,
+                                         mapnik::feature_impl& feature,
+                                         text_symbolizer_helper const& helper)
+{
     const halo_rasterizer_enum halo_rasterizer = get<halo_rasterizer_enum>(sym,
                                                                            keys::halo_rasterizer,
                                                                            feature,
@@ -86,5 +98,8 @@ void agg_renderer<T0, T1>::process(text_symbolizer const& sym,
 }
 
 template void agg_renderer<image_rgba8>::process(text_symbolizer const&, mapnik::feature_impl&, proj_transform const&);
+template void agg_renderer<image_rgba8>::render_labels(text_symbolizer const&,
+                                                       mapnik::feature_impl&,
+                                                       text_symbolizer_helper const&);
 
 } // namespace mapnik
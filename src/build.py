@@ -188,6 +188,7 @@ source = Split(
     expression.cpp
     transform_expression.cpp
     transform_expression_grammar_x3.cpp
+    feature_arena.cpp
     feature_kv_iterator.cpp
     feature_style_processor.cpp
     feature_type_style.cpp
@@ -212,6 +213,7 @@ source = Split(
     image_util_webp.cpp
     layer.cpp
     map.cpp
+    map_cache.cpp
     load_map.cpp
     palette.cpp
     marker_helpers.cpp
@@ -224,6 +226,7 @@ source = Split(
     proj_transform.cpp
     proj_transform_cache.cpp
     scale_denominator.cpp
+    simplified_geometry_cache.cpp
     simplify.cpp
     parse_transform.cpp
     memory_datasource.cpp
@@ -233,9 +236,11 @@ source = Split(
     unicode.cpp
     raster_colorizer.cpp
     mapped_memory_cache.cpp
+    tiff_tile_cache.cpp
     marker_cache.cpp
     css/css_color_grammar_x3.cpp
     css/css_grammar_x3.cpp
+    svg/svg_flattened_path.cpp
     svg/svg_parser.cpp
     svg/svg_path_parser.cpp
     svg/svg_points_parser.cpp
@@ -248,6 +253,7 @@ source = Split(
     text/text_layout.cpp
     text/text_line.cpp
     text/itemizer.cpp
+    text/label_placement_cache.cpp
     text/scrptrun.cpp
     text/face.cpp
     text/glyph_positions.cpp
@@ -275,7 +281,11 @@ source = Split(
     xml_tree.cpp
     config_error.cpp
     color_factory.cpp
+    mvt/mvt_encoder.cpp
+    mvt/mvt_renderer.cpp
     renderer_common.cpp
+    renderer_common/label_batch.cpp
+    renderer_common/label_worker_pool.cpp
     renderer_common/render_group_symbolizer.cpp
     renderer_common/render_markers_symbolizer.cpp
     renderer_common/render_pattern.cpp
@@ -392,6 +402,8 @@ if env['GRID_RENDERER']:
     source += Split(
         """
         grid/grid.cpp
+        grid/grid_encoder.cpp
+        grid/grid_hit_index.cpp
         grid/grid_renderer.cpp
         grid/process_building_symbolizer.cpp
         grid/process_line_pattern_symbolizer.cpp
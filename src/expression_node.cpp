@@ -114,6 +114,17 @@ std::string regex_match_node::to_string() const
     return str_;
 }
 
+std::string regex_match_node::pattern() const
+{
+    std::string str;
+#if defined(BOOST_REGEX_HAS_ICU)
+    fromUTF32toUTF8(impl_.get()->pattern_.str(), str);
+#else
+    str = impl_.get()->pattern_.str();
+#endif
+    return str;
+}
+
 regex_replace_node::regex_replace_node(transcoder const& tr,
                                        expr_node const& a,
                                        std::string const& ustr,
@@ -163,4 +174,26 @@ std::string regex_replace_node::to_string() const
     return str_;
 }
 
+std::string regex_replace_node::pattern() const
+{
+    std::string str;
+#if defined(BOOST_REGEX_HAS_ICU)
+    fromUTF32toUTF8(impl_.get()->pattern_.str(), str);
+#else
+    str = impl_.get()->pattern_.str();
+#endif
+    return str;
+}
+
+std::string regex_replace_node::format() const
+{
+    std::string str;
+#if defined(BOOST_REGEX_HAS_ICU)
+    impl_.get()->format_.toUTF8String(str);
+#else
+    str = impl_.get()->format_;
+#endif
+    return str;
+}
+
 } // namespace mapnik
@@ -0,0 +1,119 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include <mapnik/feature_arena.hpp>
+
+// stl
+#include <algorithm>
+#include <cstdint>
+
+namespace mapnik {
+
+namespace detail {
+
+arena_resource::arena_resource(std::size_t block_size)
+    : block_size_(block_size)
+    , blocks_()
+    , current_(nullptr)
+    , remaining_(0)
+    , bytes_allocated_(0)
+    , bytes_reserved_(0)
+{}
+
+void* arena_resource::allocate(std::size_t size, std::size_t alignment)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    std::size_t padding = 0;
+    if (current_ != nullptr)
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(current_);
+        padding = (alignment - (address % alignment)) % alignment;
+    }
+    if (current_ == nullptr || padding + size > remaining_)
+    {
+        // oversized requests get a dedicated block
+        std::size_t capacity = std::max(block_size_, size + alignment);
+        blocks_.emplace_back(new char[capacity]);
+        current_ = blocks_.back().get();
+        remaining_ = capacity;
+        bytes_reserved_ += capacity;
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(current_);
+        padding = (alignment - (address % alignment)) % alignment;
+    }
+    char* ptr = current_ + padding;
+    current_ += padding + size;
+    remaining_ -= padding + size;
+    bytes_allocated_ += size;
+    return ptr;
+}
+
+std::size_t arena_resource::bytes_allocated() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return bytes_allocated_;
+}
+
+std::size_t arena_resource::bytes_reserved() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return bytes_reserved_;
+}
+
+} // namespace detail
+
+namespace {
+thread_local static feature_arena* current_arena_ = nullptr;
+}
+
+feature_arena::scope::scope(feature_arena& arena)
+    : previous_(current_arena_)
+{
+    current_arena_ = &arena;
+}
+
+feature_arena::scope::~scope()
+{
+    current_arena_ = previous_;
+}
+
+feature_arena::feature_arena(std::size_t block_size)
+    : block_size_(block_size)
+    , resource_(std::make_shared<detail::arena_resource>(block_size))
+{}
+
+void feature_arena::release()
+{
+    resource_ = std::make_shared<detail::arena_resource>(block_size_);
+}
+
+feature_arena* feature_arena::current()
+{
+    return current_arena_;
+}
+
+} // namespace mapnik
@@ -27,6 +27,7 @@
 #include <mapnik/text/face.hpp>
 #include <mapnik/util/fs.hpp>
 #include <mapnik/util/file_io.hpp>
+#include <mapnik/util/utf_conv_win.hpp>
 
 #include <mapnik/warning.hpp>
 MAPNIK_DISABLE_WARNING_PUSH
@@ -45,6 +46,10 @@ MAPNIK_DISABLE_WARNING_POP
 
 // stl
 #include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 
 namespace mapnik {
@@ -85,14 +90,15 @@ bool freetype_engine::register_font_impl(std::string const& file_name)
     std::lock_guard<std::mutex> lock(mutex_);
 #endif
     font_library library;
-    return register_font_impl(file_name, library, global_font_file_mapping_);
+    bool success = register_font_impl(file_name, library, global_font_file_mapping_);
+    save_registry_cache();
+    return success;
 }
 
-bool freetype_engine::register_font_impl(std::string const& file_name,
-                                         font_library& library,
-                                         freetype_engine::font_file_mapping_type& font_file_mapping)
+bool freetype_engine::read_face_names(std::string const& file_name,
+                                      font_library& library,
+                                      std::vector<std::pair<int, std::string>>& faces)
 {
-    MAPNIK_LOG_DEBUG(font_engine_freetype) << "registering: " << file_name;
     mapnik::util::file file(file_name);
     if (!file)
         return false;
@@ -111,7 +117,6 @@ bool freetype_engine::register_font_impl(std::string const& file_name,
     args.flags = FT_OPEN_STREAM;
     args.stream = &streamRec;
     int num_faces = 0;
-    bool success = false;
     // some font files have multiple fonts in a file
     // the count is in the 'root' face library[0]
     // see the FT_FaceRec in freetype.h
@@ -132,18 +137,7 @@ bool freetype_engine::register_font_impl(std::string const& file_name,
             // skip fonts with leading . in the name
             if (!boost::algorithm::starts_with(name, "."))
             {
-                // http://stackoverflow.com/a/24795559/2333354
-                auto range = font_file_mapping.equal_range(name);
-                if (range.first == range.second) // the key was previously absent; insert a pair
-                {
-                    font_file_mapping.emplace_hint(range.first, name, std::make_pair(i, file_name));
-                }
-                else // the key was present, replace the associated value
-                {    /* some action with value range.first->second about to be overwritten here */
-                    MAPNIK_LOG_WARN(font_engine_freetype) << "registering new " << name << " at '" << file_name << "'";
-                    range.first->second = std::make_pair(i, file_name); // replace value
-                }
-                success = true;
+                faces.emplace_back(i, std::move(name));
             }
         }
         else
@@ -161,6 +155,68 @@ bool freetype_engine::register_font_impl(std::string const& file_name,
         if (face)
             FT_Done_Face(face);
     }
+    return true;
+}
+
+bool freetype_engine::register_font_impl(std::string const& file_name,
+                                         font_library& library,
+                                         freetype_engine::font_file_mapping_type& font_file_mapping)
+{
+    MAPNIK_LOG_DEBUG(font_engine_freetype) << "registering: " << file_name;
+    std::vector<std::pair<int, std::string>> faces;
+    std::uintmax_t size = 0;
+    std::int64_t mtime = 0;
+    bool cached = false;
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+#endif
+        if (!registry_cache_file_.empty())
+        {
+            size = mapnik::util::file_size(file_name);
+            mtime = mapnik::util::last_write_time(file_name);
+            auto itr = registry_cache_.find(file_name);
+            if (itr != registry_cache_.end() && mtime != 0 && itr->second.size == size && itr->second.mtime == mtime)
+            {
+                faces = itr->second.faces;
+                cached = true;
+            }
+        }
+    }
+    if (!cached)
+    {
+        if (!read_face_names(file_name, library, faces))
+            return false;
+        if (mtime != 0)
+        {
+#ifdef MAPNIK_THREADSAFE
+            std::lock_guard<std::mutex> lock(registry_mutex_);
+#endif
+            if (!registry_cache_file_.empty())
+            {
+                registry_cache_[file_name] = registry_entry{size, mtime, faces};
+                registry_cache_dirty_ = true;
+            }
+        }
+    }
+
+    bool success = false;
+    for (auto const& face : faces)
+    {
+        std::string const& name = face.second;
+        // http://stackoverflow.com/a/24795559/2333354
+        auto range = font_file_mapping.equal_range(name);
+        if (range.first == range.second) // the key was previously absent; insert a pair
+        {
+            font_file_mapping.emplace_hint(range.first, name, std::make_pair(face.first, file_name));
+        }
+        else // the key was present, replace the associated value
+        {    /* some action with value range.first->second about to be overwritten here */
+            MAPNIK_LOG_WARN(font_engine_freetype) << "registering new " << name << " at '" << file_name << "'";
+            range.first->second = std::make_pair(face.first, file_name); // replace value
+        }
+        success = true;
+    }
     return success;
 }
 
@@ -175,7 +231,9 @@ bool freetype_engine::register_fonts_impl(std::string const& dir, bool recurse)
     std::lock_guard<std::mutex> lock(mutex_);
 #endif
     font_library library;
-    return register_fonts_impl(dir, library, global_font_file_mapping_, recurse);
+    bool success = register_fonts_impl(dir, library, global_font_file_mapping_, recurse);
+    save_registry_cache();
+    return success;
 }
 
 bool freetype_engine::register_fonts_impl(std::string const& dir,
@@ -224,6 +282,176 @@ bool freetype_engine::register_fonts_impl(std::string const& dir,
     return success;
 }
 
+namespace {
+constexpr char const* registry_cache_header = "mapnik-font-registry 1";
+constexpr char const* registry_cache_trailer = "end";
+
+std::ifstream open_registry_input(std::string const& filename)
+{
+#ifdef _WIN32
+    return std::ifstream(mapnik::utf8_to_utf16(filename), std::ios::binary);
+#else
+    return std::ifstream(filename, std::ios::binary);
+#endif
+}
+
+std::ofstream open_registry_output(std::string const& filename)
+{
+#ifdef _WIN32
+    return std::ofstream(mapnik::utf8_to_utf16(filename), std::ios::binary | std::ios::trunc);
+#else
+    return std::ofstream(filename, std::ios::binary | std::ios::trunc);
+#endif
+}
+} // namespace
+
+void freetype_engine::set_registry_cache(std::string const& cache_file)
+{
+    instance().set_registry_cache_impl(cache_file);
+}
+
+// The cache is a text file: a header line, then for every font file a line
+//   <size> TAB <mtime> TAB <number of faces> TAB <path>
+// followed by one line per face
+//   <face index> TAB <family> <style>
+// and a last line
+//   end TAB <number of font files> TAB <size in bytes of the lines above it>
+// A file without a matching last line was not written completely and is ignored.
+void freetype_engine::set_registry_cache_impl(std::string const& cache_file)
+{
+    save_registry_cache();
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+#endif
+    registry_cache_file_ = cache_file;
+    registry_cache_.clear();
+    registry_cache_dirty_ = false;
+    if (cache_file.empty() || !mapnik::util::exists(cache_file))
+        return;
+
+    std::string content;
+    {
+        std::ifstream in = open_registry_input(cache_file);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        content = ss.str();
+    }
+    // the trailer is the last line, check it before trusting anything above it
+    std::size_t body_size = 0;
+    std::size_t expected_files = 0;
+    if (content.size() > 1 && content.back() == '\n')
+    {
+        std::size_t const pos = content.rfind('\n', content.size() - 2);
+        std::istringstream trailer(content.substr(pos + 1));
+        std::string tag;
+        std::size_t expected_size = 0;
+        if (pos != std::string::npos && (trailer >> tag >> expected_files >> expected_size) &&
+            tag == registry_cache_trailer && expected_size == pos + 1)
+        {
+            body_size = expected_size;
+        }
+    }
+    if (body_size == 0)
+    {
+        MAPNIK_LOG_WARN(font_engine_freetype) << "ignoring '" << cache_file << "': file is incomplete";
+        return;
+    }
+    std::istringstream file(content.substr(0, body_size));
+    std::string line;
+    if (!std::getline(file, line) || line != registry_cache_header)
+    {
+        MAPNIK_LOG_WARN(font_engine_freetype) << "ignoring '" << cache_file << "': not a font registry cache";
+        return;
+    }
+    registry_cache_type entries;
+    while (std::getline(file, line))
+    {
+        std::istringstream header(line);
+        registry_entry entry;
+        std::size_t count = 0;
+        std::string path;
+        if (!(header >> entry.size >> entry.mtime >> count) || header.get() != '\t' || !std::getline(header, path))
+        {
+            MAPNIK_LOG_WARN(font_engine_freetype) << "ignoring '" << cache_file << "': file is damaged";
+            return;
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::string face_line;
+            std::size_t tab;
+            if (!std::getline(file, face_line) || (tab = face_line.find('\t')) == std::string::npos)
+            {
+                MAPNIK_LOG_WARN(font_engine_freetype) << "ignoring '" << cache_file << "': file is damaged";
+                return;
+            }
+            entry.faces.emplace_back(std::atoi(face_line.c_str()), face_line.substr(tab + 1));
+        }
+        entries[path] = std::move(entry);
+    }
+    if (entries.size() != expected_files)
+    {
+        MAPNIK_LOG_WARN(font_engine_freetype) << "ignoring '" << cache_file << "': file is damaged";
+        return;
+    }
+    registry_cache_ = std::move(entries);
+}
+
+void freetype_engine::save_registry_cache()
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+#endif
+    if (registry_cache_file_.empty() || !registry_cache_dirty_)
+        return;
+    std::ostringstream content;
+    content << registry_cache_header << '\n';
+    std::size_t files = 0;
+    for (auto const& kv : registry_cache_)
+    {
+        // the format is line based
+        if (kv.first.find('\n') != std::string::npos)
+            continue;
+        registry_entry const& entry = kv.second;
+        content << entry.size << '\t' << entry.mtime << '\t' << entry.faces.size() << '\t' << kv.first << '\n';
+        for (auto const& face : entry.faces)
+        {
+            std::string name = face.second;
+            std::replace(name.begin(), name.end(), '\n', ' ');
+            content << face.first << '\t' << name << '\n';
+        }
+        ++files;
+    }
+    std::string const body = content.str();
+
+    // other processes may share the cache: write a private file next to it and
+    // rename it over the cache, so that readers see either the old or the new file
+    std::ostringstream tmp_name;
+    tmp_name << registry_cache_file_ << '.' << std::hex << std::random_device{}() << ".tmp";
+    std::string const tmp_file = tmp_name.str();
+    {
+        std::ofstream file = open_registry_output(tmp_file);
+        if (file)
+        {
+            file << body << registry_cache_trailer << '\t' << files << '\t' << body.size() << '\n';
+            file.close();
+        }
+        if (!file)
+        {
+            MAPNIK_LOG_ERROR(font_engine_freetype) << "could not write font registry cache '" << tmp_file << "'";
+            mapnik::util::remove(tmp_file);
+            return;
+        }
+    }
+    if (!mapnik::util::rename(tmp_file, registry_cache_file_))
+    {
+        MAPNIK_LOG_ERROR(font_engine_freetype) << "could not replace font registry cache '" << registry_cache_file_
+                                               << "'";
+        mapnik::util::remove(tmp_file);
+        return;
+    }
+    registry_cache_dirty_ = false;
+}
+
 std::vector<std::string> freetype_engine::face_names()
 {
     return instance().face_names_impl();
@@ -410,10 +638,30 @@ face_ptr freetype_engine::create_face(std::string const& family_name,
                                        global_memory_fonts);
 }
 
+namespace {
+
+struct thread_face_cache
+{
+    // faces keep this library alive (see face_manager::get_face) so it may
+    // outlive the thread when a face is still referenced elsewhere
+    std::shared_ptr<font_library> library = std::make_shared<font_library>();
+    // (file name, face index) -> face
+    std::map<std::pair<std::string, int>, face_ptr> faces;
+};
+
+thread_face_cache& local_face_cache()
+{
+    thread_local static thread_face_cache cache;
+    return cache;
+}
+
+} // namespace
+
 face_manager::face_manager(font_library& library,
                            freetype_engine::font_file_mapping_type const& font_file_mapping,
                            freetype_engine::font_memory_cache_type const& font_cache)
     : face_cache_(new face_cache())
+    , face_cache_owner_(nullptr)
     , library_(library)
     , font_file_mapping_(font_file_mapping)
     , font_memory_cache_(font_cache)
@@ -426,27 +674,78 @@ face_manager::face_manager(font_library& library,
     }
 }
 
+face_manager::face_manager(font_library& library, face_manager const& other)
+    : face_manager(library, other.font_file_mapping_, other.font_memory_cache_)
+{}
+
 face_ptr face_manager::get_face(std::string const& name)
 {
+    thread_face_cache& local = local_face_cache();
+    if (face_cache_owner_ != &local)
+    {
+        // faces looked up on another thread must not be used on this one
+        face_cache_->clear();
+        face_cache_owner_ = &local;
+    }
     auto itr = face_cache_->find(name);
     if (itr != face_cache_->end())
     {
         return itr->second;
     }
+
+    auto const& global_mapping = freetype_engine::instance().get_mapping();
+    auto mapping_itr = font_file_mapping_.find(name);
+    bool map_font = mapping_itr != font_file_mapping_.end();
+    if (!map_font)
+    {
+        mapping_itr = global_mapping.find(name);
+        if (mapping_itr == global_mapping.end())
+            return face_ptr();
+    }
+
+    face_ptr face;
+    std::string const& file_name = mapping_itr->second.second;
+    if (map_font && font_memory_cache_.find(file_name) != font_memory_cache_.end())
+    {
+        // backed by the map's memory cache, so it can not outlive the map
+        face = freetype_engine::create_face(name,
+                                            library_,
+                                            font_file_mapping_,
+                                            font_memory_cache_,
+                                            global_mapping,
+                                            freetype_engine::instance().get_cache());
+    }
     else
     {
-        face_ptr face = freetype_engine::create_face(name,
-                                                     library_,
-                                                     font_file_mapping_,
-                                                     font_memory_cache_,
-                                                     freetype_engine::instance().get_mapping(),
-                                                     freetype_engine::instance().get_cache());
-        if (face)
+        auto key = std::make_pair(file_name, mapping_itr->second.first);
+        auto shared_itr = local.faces.find(key);
+        if (shared_itr != local.faces.end())
         {
-            face_cache_->emplace(name, face);
+            face = shared_itr->second;
         }
-        return face;
+        else
+        {
+            face_ptr created = freetype_engine::create_face(name,
+                                                            *local.library,
+                                                            font_file_mapping_,
+                                                            font_memory_cache_,
+                                                            global_mapping,
+                                                            freetype_engine::instance().get_cache());
+            if (created)
+            {
+                // the face must be released before the library that created it
+                auto owner = std::make_shared<std::pair<std::shared_ptr<font_library>, face_ptr>>(local.library,
+                                                                                                   created);
+                face = face_ptr(owner, owner->second.get());
+                local.faces.emplace(std::move(key), face);
+            }
+        }
+    }
+    if (face)
+    {
+        face_cache_->emplace(name, face);
     }
+    return face;
 }
 
 face_set_ptr face_manager::get_face_set(std::string const& name)
@@ -68,6 +68,45 @@ bool remove(std::string const& filepath)
 #endif
 }
 
+bool rename(std::string const& from, std::string const& to)
+{
+    error_code ec;
+#ifdef _WIN32
+    fs::rename(mapnik::utf8_to_utf16(from), mapnik::utf8_to_utf16(to), ec);
+#else
+    fs::rename(from, to, ec);
+#endif
+    return !ec;
+}
+
+std::uintmax_t file_size(std::string const& filepath)
+{
+    error_code ec;
+#ifdef _WIN32
+    std::uintmax_t size = fs::file_size(mapnik::utf8_to_utf16(filepath), ec);
+#else
+    std::uintmax_t size = fs::file_size(filepath, ec);
+#endif
+    return ec ? 0 : size;
+}
+
+std::int64_t last_write_time(std::string const& filepath)
+{
+    error_code ec;
+#ifdef _WIN32
+    auto stamp = fs::last_write_time(mapnik::utf8_to_utf16(filepath), ec);
+#else
+    auto stamp = fs::last_write_time(filepath, ec);
+#endif
+    if (ec)
+        return 0;
+#ifdef USE_BOOST_FILESYSTEM
+    return static_cast<std::int64_t>(stamp);
+#else
+    return static_cast<std::int64_t>(stamp.time_since_epoch().count());
+#endif
+}
+
 bool is_relative(std::string const& filepath)
 {
 #ifdef _WIN32
@@ -36,6 +36,8 @@ char const* unary_function_name(unary_function_impl const& fun)
         return "atan";
     else if (fun.target<exp_impl>())
         return "exp";
+    else if (fun.target<log_impl>())
+        return "log";
     else if (fun.target<abs_impl>())
         return "abs";
     else if (fun.target<length_impl>())
@@ -0,0 +1,281 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#if defined(GRID_RENDERER)
+
+// mapnik
+#include <mapnik/grid/grid_encoder.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/conversions.hpp>
+
+// stl
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mapnik {
+
+namespace {
+
+void append_utf8(std::string& out, std::uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+void append_json_string(std::string& out, std::string const& str)
+{
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xf];
+                    out += hex[c & 0xf];
+                }
+                else
+                {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+struct json_value_writer
+{
+    explicit json_value_writer(std::string& out)
+        : out_(out)
+    {}
+
+    void operator()(value_null) const { out_ += "null"; }
+
+    void operator()(value_bool val) const { out_ += val ? "true" : "false"; }
+
+    void operator()(value_integer val) const { util::to_string(out_, val); }
+
+    void operator()(value_double val) const
+    {
+        if (std::isfinite(val))
+            util::to_string(out_, val);
+        else
+            out_ += "null";
+    }
+
+    void operator()(value_unicode_string const& val) const
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        append_json_string(out_, utf8);
+    }
+
+    std::string& out_;
+};
+
+// skip the codepoints that can't be written into a JSON string as-is
+// ('"', '\') and the surrogate range which has no UTF-8 encoding
+inline std::uint32_t next_codepoint(std::uint32_t cp)
+{
+    while (cp == 34 || cp == 92 || (cp >= 0xd800 && cp <= 0xdfff))
+        ++cp;
+    return cp;
+}
+
+} // namespace
+
+template<typename T>
+void encode_utfgrid(T const& grid, std::string& output, unsigned resolution, bool add_features)
+{
+    using value_type = typename T::value_type;
+    static const std::string empty_key;
+
+    if (resolution == 0)
+        resolution = 1;
+    std::size_t const width = grid.width();
+    std::size_t const height = grid.height();
+    std::size_t const cols = (width + resolution - 1) / resolution;
+    std::size_t const rows = (height + resolution - 1) / resolution;
+    auto const& feature_keys = grid.get_feature_keys();
+
+    // Every distinct pixel id resolves its string key once, after that
+    // runs of equal ids reuse the last codepoint and other ids hit the
+    // id -> codepoint table without touching any strings.
+    std::unordered_map<value_type, std::uint32_t> codepoints;
+    std::unordered_map<std::string, std::uint32_t> keys;
+    std::vector<std::string const*> key_order;
+    std::uint32_t codepoint = 32;
+
+    output.reserve(output.size() + rows * (cols + 3) + 64);
+    output += "{\"grid\":[";
+    for (std::size_t y = 0; y < height; y += resolution)
+    {
+        if (y > 0)
+            output += ',';
+        output += '"';
+        value_type const* row = grid.get_row(y);
+        bool has_last = false;
+        value_type last_id = 0;
+        std::uint32_t last_cp = 0;
+        for (std::size_t x = 0; x < width; x += resolution)
+        {
+            value_type const id = row[x];
+            if (!has_last || id != last_id)
+            {
+                auto itr = codepoints.find(id);
+                if (itr == codepoints.end())
+                {
+                    // ids without a lookup key are encoded as background
+                    std::string const* key = &empty_key;
+                    if (id != T::base_mask)
+                    {
+                        auto pos = feature_keys.find(id);
+                        if (pos != feature_keys.end())
+                            key = &pos->second;
+                    }
+                    auto key_itr = keys.find(*key);
+                    if (key_itr == keys.end())
+                    {
+                        codepoint = next_codepoint(codepoint);
+                        key_itr = keys.emplace(*key, codepoint++).first;
+                        key_order.push_back(key);
+                    }
+                    itr = codepoints.emplace(id, key_itr->second).first;
+                }
+                has_last = true;
+                last_id = id;
+                last_cp = itr->second;
+            }
+            append_utf8(output, last_cp);
+        }
+        output += '"';
+    }
+
+    output += "],\"keys\":[";
+    bool first = true;
+    for (std::string const* key : key_order)
+    {
+        if (!first)
+            output += ',';
+        first = false;
+        append_json_string(output, *key);
+    }
+
+    output += "],\"data\":{";
+    if (add_features)
+    {
+        auto const& features = grid.get_grid_features();
+        auto const& fields = grid.get_fields();
+        std::string const& id_name = grid.key_name();
+        json_value_writer writer(output);
+        first = true;
+        for (std::string const* key : key_order)
+        {
+            auto feat_itr = features.find(*key);
+            if (key->empty() || feat_itr == features.end())
+                continue;
+            feature_impl const& feature = *feat_itr->second;
+            if (!first)
+                output += ',';
+            first = false;
+            append_json_string(output, *key);
+            output += ":{";
+            bool first_attr = true;
+            for (std::string const& attr : fields)
+            {
+                bool const is_id = (attr == id_name);
+                if (!is_id && !feature.has_key(attr))
+                    continue;
+                if (!first_attr)
+                    output += ',';
+                first_attr = false;
+                append_json_string(output, attr);
+                output += ':';
+                if (is_id)
+                    util::to_string(output, feature.id());
+                else
+                    util::apply_visitor(writer, feature.get(attr));
+            }
+            output += '}';
+        }
+    }
+    output += "}}";
+}
+
+template<typename T>
+std::string encode_utfgrid(T const& grid, unsigned resolution, bool add_features)
+{
+    std::string output;
+    encode_utfgrid(grid, output, resolution, add_features);
+    return output;
+}
+
+template MAPNIK_DECL void encode_utfgrid(grid const&, std::string&, unsigned, bool);
+template MAPNIK_DECL std::string encode_utfgrid(grid const&, unsigned, bool);
+
+} // namespace mapnik
+
+#endif
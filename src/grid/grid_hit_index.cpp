@@ -0,0 +1,389 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#if defined(GRID_RENDERER)
+
+// mapnik
+#include <mapnik/grid/grid_hit_index.hpp>
+
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_trans_affine.h"
+MAPNIK_DISABLE_WARNING_POP
+
+// stl
+#include <algorithm>
+#include <cmath>
+
+namespace mapnik {
+
+namespace {
+
+inline double distance_squared(double px, double py, double x0, double y0, double x1, double y1)
+{
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double len2 = dx * dx + dy * dy;
+    double t = 0.0;
+    if (len2 > 0.0)
+    {
+        t = ((px - x0) * dx + (py - y0) * dy) / len2;
+        t = std::max(0.0, std::min(1.0, t));
+    }
+    double ex = x0 + t * dx - px;
+    double ey = y0 + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+struct crossing
+{
+    double x;
+    int dir;
+};
+
+// first and last sample index i (sample at i * res + 0.5) with lo <= sample <= hi
+inline bool sample_range(double lo, double hi, double res, std::size_t count, std::size_t& first, std::size_t& last)
+{
+    double const f = std::ceil((lo - 0.5) / res);
+    double const l = std::floor((hi - 0.5) / res);
+    if (count == 0 || l < 0.0 || f > count - 1.0 || f > l)
+        return false;
+    first = static_cast<std::size_t>(std::max(0.0, f));
+    last = static_cast<std::size_t>(std::min(count - 1.0, l));
+    return true;
+}
+
+} // namespace
+
+grid_hit_index::grid_hit_index(std::size_t width, std::size_t height, unsigned resolution)
+    : width_(width)
+    , height_(height)
+    , resolution_(std::max(1u, resolution))
+    , shapes_()
+    , vertices_()
+    , ring_start_(0)
+{}
+
+void grid_hit_index::start_polygon(value_type id, fill_rule_e rule)
+{
+    shapes_.push_back(shape{id, polygon_shape, rule, 0.0, vertices_.size(), vertices_.size(), box2d<double>()});
+}
+
+void grid_hit_index::start_line(value_type id, double half_width)
+{
+    shapes_.push_back(
+      shape{id, line_shape, fill_non_zero, std::max(0.5, half_width), vertices_.size(), vertices_.size(), box2d<double>()});
+}
+
+void grid_hit_index::add_box(value_type id, box2d<double> const& box, agg::trans_affine const& tr)
+{
+    double x[4] = {box.minx(), box.maxx(), box.maxx(), box.minx()};
+    double y[4] = {box.miny(), box.miny(), box.maxy(), box.maxy()};
+    start_polygon(id, fill_non_zero);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        tr.transform(&x[i], &y[i]);
+        if (i == 0)
+            move_to(x[i], y[i]);
+        else
+            line_to(x[i], y[i]);
+    }
+}
+
+void grid_hit_index::add_box(value_type id, box2d<double> const& box)
+{
+    add_box(id, box, agg::trans_affine());
+}
+
+void grid_hit_index::move_to(double x, double y)
+{
+    if (shapes_.empty())
+        return;
+    ring_start_ = vertices_.size();
+    vertices_.push_back(vertex{x, y, true});
+    shape& s = shapes_.back();
+    s.last = vertices_.size();
+    if (s.bbox.valid())
+        s.bbox.expand_to_include(x, y);
+    else
+        s.bbox.init(x, y, x, y);
+}
+
+void grid_hit_index::line_to(double x, double y)
+{
+    if (shapes_.empty())
+        return;
+    shape& s = shapes_.back();
+    if (s.last == s.first)
+    {
+        move_to(x, y);
+        return;
+    }
+    vertices_.push_back(vertex{x, y, false});
+    s.last = vertices_.size();
+    s.bbox.expand_to_include(x, y);
+}
+
+void grid_hit_index::close_path()
+{
+    // polygon rings are implicitly closed, lines need the closing segment
+    if (shapes_.empty() || shapes_.back().type != line_shape || ring_start_ >= vertices_.size())
+        return;
+    vertex const start = vertices_[ring_start_];
+    line_to(start.x, start.y);
+}
+
+bool grid_hit_index::contains(shape const& s, double x, double y) const
+{
+    if (s.first == s.last)
+        return false;
+    if (s.type == line_shape)
+    {
+        double const hw2 = s.half_width * s.half_width;
+        for (std::size_t i = s.first; i < s.last; ++i)
+        {
+            vertex const& v = vertices_[i];
+            bool const single = v.move && (i + 1 == s.last || vertices_[i + 1].move);
+            if (single)
+            {
+                if (distance_squared(x, y, v.x, v.y, v.x, v.y) <= hw2)
+                    return true;
+            }
+            else if (!v.move && distance_squared(x, y, vertices_[i - 1].x, vertices_[i - 1].y, v.x, v.y) <= hw2)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    // polygons: crossing number (even-odd) or winding number (non-zero),
+    // closing every ring back to its first vertex
+    int crossings = 0;
+    int winding = 0;
+    std::size_t ring = s.first;
+    for (std::size_t i = s.first; i < s.last; ++i)
+    {
+        vertex const& v0 = vertices_[i];
+        if (v0.move)
+            ring = i;
+        bool const last_in_ring = (i + 1 == s.last || vertices_[i + 1].move);
+        vertex const& v1 = last_in_ring ? vertices_[ring] : vertices_[i + 1];
+        if ((v0.y <= y) != (v1.y <= y))
+        {
+            double const xi = v0.x + (y - v0.y) * (v1.x - v0.x) / (v1.y - v0.y);
+            if (x < xi)
+            {
+                ++crossings;
+                winding += (v1.y > v0.y) ? 1 : -1;
+            }
+        }
+    }
+    return (s.rule == fill_even_odd) ? (crossings & 1) != 0 : winding != 0;
+}
+
+bool grid_hit_index::cell_range(shape const& s,
+                                std::size_t cols,
+                                std::size_t rows,
+                                std::size_t& x0,
+                                std::size_t& y0,
+                                std::size_t& x1,
+                                std::size_t& y1) const
+{
+    if (!s.bbox.valid() || cols == 0 || rows == 0)
+        return false;
+    // cells whose sample point (c * resolution + 0.5) falls inside the padded bbox
+    double const pad = (s.type == line_shape) ? s.half_width : 0.0;
+    double const res = resolution_;
+    double const minx = std::ceil((s.bbox.minx() - pad - 0.5) / res);
+    double const miny = std::ceil((s.bbox.miny() - pad - 0.5) / res);
+    double const maxx = std::floor((s.bbox.maxx() + pad - 0.5) / res);
+    double const maxy = std::floor((s.bbox.maxy() + pad - 0.5) / res);
+    if (maxx < 0.0 || maxy < 0.0 || minx > cols - 1.0 || miny > rows - 1.0 || minx > maxx || miny > maxy)
+        return false;
+    x0 = static_cast<std::size_t>(std::max(0.0, minx));
+    y0 = static_cast<std::size_t>(std::max(0.0, miny));
+    x1 = static_cast<std::size_t>(std::min(cols - 1.0, maxx));
+    y1 = static_cast<std::size_t>(std::min(rows - 1.0, maxy));
+    return true;
+}
+
+bool grid_hit_index::fill_polygon(shape const& s,
+                                  grid& g,
+                                  std::vector<bool>& done,
+                                  std::size_t cols,
+                                  std::size_t x0,
+                                  std::size_t y0,
+                                  std::size_t x1,
+                                  std::size_t y1) const
+{
+    // scanline: every edge records where it crosses the sample line of the
+    // rows it spans, each row is then swept once from left to right
+    double const res = resolution_;
+    std::vector<std::vector<crossing>> rows(y1 - y0 + 1);
+    std::size_t ring = s.first;
+    for (std::size_t i = s.first; i < s.last; ++i)
+    {
+        vertex const& v0 = vertices_[i];
+        if (v0.move)
+            ring = i;
+        bool const last_in_ring = (i + 1 == s.last || vertices_[i + 1].move);
+        vertex const& v1 = last_in_ring ? vertices_[ring] : vertices_[i + 1];
+        std::size_t first;
+        std::size_t last;
+        if (v0.y == v1.y || !sample_range(std::min(v0.y, v1.y), std::max(v0.y, v1.y), res, y1 + 1, first, last))
+            continue;
+        for (std::size_t y = std::max(first, y0); y <= last; ++y)
+        {
+            double const py = y * res + 0.5;
+            // same half open test as contains()
+            if ((v0.y <= py) == (v1.y <= py))
+                continue;
+            double const xi = v0.x + (py - v0.y) * (v1.x - v0.x) / (v1.y - v0.y);
+            rows[y - y0].push_back(crossing{xi, (v1.y > v0.y) ? 1 : -1});
+        }
+    }
+    bool painted = false;
+    for (std::size_t y = y0; y <= y1; ++y)
+    {
+        std::vector<crossing>& row = rows[y - y0];
+        if (row.empty())
+            continue;
+        std::sort(row.begin(), row.end(), [](crossing const& a, crossing const& b) { return a.x < b.x; });
+        // crossings and winding of the crossings right of the sample point
+        int crossings = static_cast<int>(row.size());
+        int winding = 0;
+        for (auto const& c : row)
+            winding += c.dir;
+        auto next = row.begin();
+        for (std::size_t x = x0; x <= x1; ++x)
+        {
+            double const px = x * res + 0.5;
+            for (; next != row.end() && !(px < next->x); ++next)
+            {
+                --crossings;
+                winding -= next->dir;
+            }
+            if (next == row.end())
+                break;
+            std::size_t const idx = y * cols + x;
+            bool const inside = (s.rule == fill_even_odd) ? (crossings & 1) != 0 : winding != 0;
+            if (inside && !done[idx])
+            {
+                g.setPixel(x, y, s.id);
+                done[idx] = true;
+                painted = true;
+            }
+        }
+    }
+    return painted;
+}
+
+bool grid_hit_index::fill_line(shape const& s,
+                               grid& g,
+                               std::vector<bool>& done,
+                               std::size_t cols,
+                               std::size_t x0,
+                               std::size_t y0,
+                               std::size_t x1,
+                               std::size_t y1) const
+{
+    // every segment only tests the cells of its own padded bounding box
+    double const res = resolution_;
+    double const hw = s.half_width;
+    double const hw2 = hw * hw;
+    bool painted = false;
+    for (std::size_t i = s.first; i < s.last; ++i)
+    {
+        vertex const& v = vertices_[i];
+        bool const single = v.move && (i + 1 == s.last || vertices_[i + 1].move);
+        if (v.move && !single)
+            continue;
+        vertex const& p = single ? v : vertices_[i - 1];
+        std::size_t cx0, cy0, cx1, cy1;
+        if (!sample_range(std::min(p.x, v.x) - hw, std::max(p.x, v.x) + hw, res, x1 + 1, cx0, cx1) ||
+            !sample_range(std::min(p.y, v.y) - hw, std::max(p.y, v.y) + hw, res, y1 + 1, cy0, cy1))
+            continue;
+        for (std::size_t y = std::max(cy0, y0); y <= cy1; ++y)
+        {
+            double const py = y * res + 0.5;
+            for (std::size_t x = std::max(cx0, x0); x <= cx1; ++x)
+            {
+                std::size_t const idx = y * cols + x;
+                if (done[idx] || distance_squared(x * res + 0.5, py, p.x, p.y, v.x, v.y) > hw2)
+                    continue;
+                g.setPixel(x, y, s.id);
+                done[idx] = true;
+                painted = true;
+            }
+        }
+    }
+    return painted;
+}
+
+bool grid_hit_index::fill(grid& g) const
+{
+    std::size_t const cols = std::min(g.width(), (width_ + resolution_ - 1) / resolution_);
+    std::size_t const rows = std::min(g.height(), (height_ + resolution_ - 1) / resolution_);
+    std::vector<bool> done(cols * rows, false);
+    bool painted = false;
+    // topmost shape first, so that cells hit once are not painted again
+    for (auto itr = shapes_.rbegin(); itr != shapes_.rend(); ++itr)
+    {
+        std::size_t x0, y0, x1, y1;
+        if (itr->first == itr->last || !cell_range(*itr, cols, rows, x0, y0, x1, y1))
+            continue;
+        if (itr->type == line_shape)
+            painted |= fill_line(*itr, g, done, cols, x0, y0, x1, y1);
+        else
+            painted |= fill_polygon(*itr, g, done, cols, x0, y0, x1, y1);
+    }
+    return painted;
+}
+
+grid_hit_index::value_type grid_hit_index::hit(std::size_t x, std::size_t y) const
+{
+    double const px = x * resolution_ + 0.5;
+    double const py = y * resolution_ + 0.5;
+    for (auto itr = shapes_.rbegin(); itr != shapes_.rend(); ++itr)
+    {
+        double const pad = (itr->type == line_shape) ? itr->half_width : 0.0;
+        if (!itr->bbox.valid() || px < itr->bbox.minx() - pad || px > itr->bbox.maxx() + pad ||
+            py < itr->bbox.miny() - pad || py > itr->bbox.maxy() + pad)
+            continue;
+        if (contains(*itr, px, py))
+            return itr->id;
+    }
+    return grid::base_mask;
+}
+
+void grid_hit_index::clear()
+{
+    shapes_.clear();
+    vertices_.clear();
+    ring_start_ = 0;
+}
+
+} // namespace mapnik
+
+#endif
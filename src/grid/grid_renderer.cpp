@@ -27,6 +27,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 
 #include <mapnik/image_scaling.hpp>
 #include <mapnik/rule.hpp>
@@ -45,6 +46,8 @@
 #include <mapnik/svg/svg_renderer_agg.hpp>
 #include <mapnik/svg/svg_path_adapter.hpp>
 #include <mapnik/pixel_position.hpp>
+#include <mapnik/text/glyph_positions.hpp>
+#include <mapnik/text/text_properties.hpp>
 
 #include <mapnik/warning.hpp>
 MAPNIK_DISABLE_WARNING_PUSH
@@ -58,6 +61,9 @@ MAPNIK_DISABLE_WARNING_PUSH
 #include "agg_trans_affine.h"
 MAPNIK_DISABLE_WARNING_POP
 
+// stl
+#include <stdexcept>
+
 namespace mapnik {
 
 template<typename T>
@@ -65,6 +71,8 @@ grid_renderer<T>::grid_renderer(Map const& m, T& pixmap, double scale_factor, un
     : feature_style_processor<grid_renderer>(m, scale_factor)
     , pixmap_(pixmap)
     , ras_ptr(new grid_rasterizer)
+    , hit_resolution_(0)
+    , hit_index_()
     , common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor)
 {
     setup(m);
@@ -81,6 +89,8 @@ grid_renderer<T>::grid_renderer(Map const& m,
     : feature_style_processor<grid_renderer>(m, scale_factor)
     , pixmap_(pixmap)
     , ras_ptr(new grid_rasterizer)
+    , hit_resolution_(0)
+    , hit_index_()
     , common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
 {
     setup(m);
@@ -97,17 +107,67 @@ template<typename T>
 grid_renderer<T>::~grid_renderer()
 {}
 
+template<typename T>
+void grid_renderer<T>::set_hit_resolution(unsigned resolution)
+{
+    hit_resolution_ = resolution;
+    if (resolution == 0)
+    {
+        hit_index_.reset();
+        return;
+    }
+    std::size_t width = (common_.width_ + resolution - 1) / resolution;
+    std::size_t height = (common_.height_ + resolution - 1) / resolution;
+    if (pixmap_.width() != width || pixmap_.height() != height)
+    {
+        throw std::runtime_error("grid_renderer: hit resolution " + std::to_string(resolution) +
+                                 " requires a grid of " + std::to_string(width) + "x" + std::to_string(height));
+    }
+    hit_index_ = std::make_unique<grid_hit_index>(common_.width_, common_.height_, resolution);
+}
+
+template<typename T>
+void grid_renderer<T>::record_glyphs(glyph_positions const& glyphs, value_integer feature_id)
+{
+    if (!hit_index_)
+        return;
+    pixel_position const& base_point = glyphs.get_base_point();
+    for (auto const& glyph_pos : glyphs)
+    {
+        glyph_info const& glyph = glyph_pos.glyph;
+        pixel_position pos = glyph_pos.pos + glyph.offset.rotate(glyph_pos.rot);
+        double halo = glyph.format->halo_radius * common_.scale_factor_;
+        box2d<double> box(-halo, glyph.ymin() - halo, glyph.advance() + halo, glyph.ymax() + halo);
+        // glyph space is y-up and rotated around the pen position
+        agg::trans_affine tr(glyph_pos.rot.cos,
+                             -glyph_pos.rot.sin,
+                             -glyph_pos.rot.sin,
+                             -glyph_pos.rot.cos,
+                             base_point.x + pos.x,
+                             base_point.y - pos.y);
+        hit_index_->add_box(feature_id, box, tr);
+    }
+}
+
 template<typename T>
 void grid_renderer<T>::start_map_processing(Map const& m)
 {
     MAPNIK_LOG_DEBUG(grid_renderer) << "grid_renderer: Start map processing bbox=" << m.get_current_extent();
 
     ras_ptr->clip_box(0, 0, common_.width_, common_.height_);
+    if (hit_index_)
+        hit_index_->clear();
 }
 
 template<typename T>
 void grid_renderer<T>::end_map_processing(Map const& /*m*/)
 {
+    if (hit_index_)
+    {
+        MAPNIK_LOG_DEBUG(grid_renderer) << "grid_renderer: Hit testing " << hit_index_->size() << " shapes";
+        hit_index_->fill(pixmap_);
+        hit_index_->clear();
+    }
     MAPNIK_LOG_DEBUG(grid_renderer) << "grid_renderer: End map processing";
 }
 
@@ -243,6 +303,28 @@ void grid_renderer<T>::render_marker(mapnik::feature_impl const& feature,
                                      double opacity,
                                      composite_mode_e /*comp_op*/)
 {
+    if (hit_index_)
+    {
+        if (marker.is<marker_svg>())
+        {
+            // same placement as grid_render_marker_visitor
+            box2d<double> const& bbox = util::get<marker_svg>(marker).get_data()->bounding_box();
+            coord<double, 2> c = bbox.center();
+            agg::trans_affine mtx = agg::trans_affine_translation(-c.x, -c.y);
+            mtx *= tr;
+            mtx *= agg::trans_affine_scaling(common_.scale_factor_);
+            mtx.translate(pos.x, pos.y);
+            hit_index_->add_box(feature.id(), bbox, mtx);
+        }
+        else if (marker.is<marker_rgba8>())
+        {
+            double cx = 0.5 * marker.width();
+            double cy = 0.5 * marker.height();
+            hit_index_->add_box(feature.id(), box2d<double>(pos.x - cx, pos.y - cy, pos.x + cx, pos.y + cy));
+        }
+        pixmap_.add_feature(feature);
+        return;
+    }
     grid_render_marker_visitor<buffer_type> visitor(pixmap_, ras_ptr, common_, feature, pos, tr, opacity);
     util::apply_visitor(visitor, marker);
     pixmap_.add_feature(feature);
@@ -28,6 +28,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 #include <mapnik/expression_evaluator.hpp>
 #include <mapnik/expression.hpp>
 #include <mapnik/symbolizer.hpp>
@@ -68,6 +69,32 @@ void grid_renderer<T>::process(building_symbolizer const& sym,
 
     double height = get<value_double>(sym, keys::height, feature, common_.vars_, 0.0);
 
+    if (hit_index_)
+    {
+        value_integer feature_id = feature.id();
+        render_building_symbolizer::apply(
+          feature,
+          prj_trans,
+          common_.t_,
+          height,
+          [&](path_type const& faces) {
+              vertex_adapter va(faces);
+              hit_index_->start_polygon(feature_id, grid_hit_index::fill_non_zero);
+              hit_index_->add_path(va);
+          },
+          [&](path_type const& frame) {
+              vertex_adapter va(frame);
+              hit_index_->start_line(feature_id, 0.5);
+              hit_index_->add_path(va);
+          },
+          [&](render_building_symbolizer::roof_type& roof) {
+              hit_index_->start_polygon(feature_id, grid_hit_index::fill_non_zero);
+              hit_index_->add_path(roof);
+          });
+        pixmap_.add_feature(feature);
+        return;
+    }
+
     render_building_symbolizer::apply(
       feature,
       prj_trans,
@@ -28,6 +28,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 #include <mapnik/grid/grid_render_marker.hpp>
 #include <mapnik/text/renderer.hpp>
 #include <mapnik/text/glyph_positions.hpp>
@@ -73,6 +74,14 @@ struct thunk_renderer : render_thunk_list_dispatch
 
     virtual void operator()(vector_marker_render_thunk const& thunk)
     {
+        if (grid_hit_index* index = ren_.hit_index())
+        {
+            agg::trans_affine offset_tr = thunk.tr_;
+            offset_tr.translate(offset_.x, offset_.y);
+            index->add_box(feature_.id(), thunk.src_->bounding_box(), offset_tr);
+            pixmap_.add_feature(feature_);
+            return;
+        }
         using buf_type = grid_rendering_buffer;
         using pixfmt_type = typename grid_renderer_base_type::pixfmt_type;
         using renderer_type = agg::renderer_scanline_bin_solid<grid_renderer_base_type>;
@@ -94,6 +103,14 @@ struct thunk_renderer : render_thunk_list_dispatch
 
     virtual void operator()(raster_marker_render_thunk const& thunk)
     {
+        if (grid_hit_index* index = ren_.hit_index())
+        {
+            agg::trans_affine offset_tr = thunk.tr_;
+            offset_tr.translate(offset_.x, offset_.y);
+            index->add_box(feature_.id(), box2d<double>(0, 0, thunk.src_.width(), thunk.src_.height()), offset_tr);
+            pixmap_.add_feature(feature_);
+            return;
+        }
         using buf_type = grid_rendering_buffer;
         using pixfmt_type = typename grid_renderer_base_type::pixfmt_type;
         using renderer_type = agg::renderer_scanline_bin_solid<grid_renderer_base_type>;
@@ -127,7 +144,10 @@ struct thunk_renderer : render_thunk_list_dispatch
                                    thunk.opacity_,
                                    thunk.comp_op_);
             }
-            tex_.render(*glyphs, feature_id);
+            if (ren_.hit_index())
+                ren_.record_glyphs(*glyphs, feature_id);
+            else
+                tex_.render(*glyphs, feature_id);
         }
 
         pixmap_.add_feature(feature_);
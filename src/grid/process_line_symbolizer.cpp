@@ -28,6 +28,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 #include <mapnik/vertex_converters.hpp>
 #include <mapnik/vertex_processor.hpp>
 #include <mapnik/renderer_common/apply_vertex_converter.hpp>
@@ -120,6 +121,17 @@ void grid_renderer<T>::process(line_symbolizer const& sym,
         converter.set<simplify_tag>(); // optional simplify converter
     if (smooth > 0.0)
         converter.set<smooth_tag>(); // optional smooth converter
+    if (hit_index_)
+    {
+        // hit test the centre line against the stroke width, the gaps of a
+        // dashed stroke are hit as well
+        hit_index_->start_line(feature.id(), 0.5 * width * common_.scale_factor_);
+        using apply_hit_index_type = detail::apply_vertex_converter<vertex_converter_type, grid_hit_index>;
+        apply_hit_index_type apply(converter, *hit_index_);
+        mapnik::util::apply_visitor(geometry::vertex_processor<apply_hit_index_type>(apply), feature.get_geometry());
+        pixmap_.add_feature(feature);
+        return;
+    }
     if (has_dash)
         converter.set<dash_tag>();
     converter.set<stroke_tag>(); // always stroke
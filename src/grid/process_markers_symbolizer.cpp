@@ -49,6 +49,7 @@ porting notes -->
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid_render_marker.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 #include <mapnik/svg/svg_renderer_agg.hpp>
 #include <mapnik/svg/svg_storage.hpp>
 #include <mapnik/svg/svg_path_adapter.hpp>
@@ -129,6 +130,49 @@ struct grid_markers_renderer_context : markers_renderer_context
     bool placed_;
 };
 
+template<typename PixMapType>
+struct grid_hit_markers_renderer_context : markers_renderer_context
+{
+    grid_hit_markers_renderer_context(feature_impl const& feature, grid_hit_index& index, PixMapType& pixmap)
+        : feature_(feature)
+        , index_(index)
+        , pixmap_(pixmap)
+        , placed_(false)
+    {}
+
+    virtual void render_marker(svg_path_ptr const& src,
+                               svg_path_adapter&,
+                               svg_attribute_type const&,
+                               markers_dispatch_params const&,
+                               agg::trans_affine const& marker_tr)
+    {
+        index_.add_box(feature_.id(), src->bounding_box(), marker_tr);
+        place_feature();
+    }
+
+    virtual void
+      render_marker(image_rgba8 const& src, markers_dispatch_params const&, agg::trans_affine const& marker_tr)
+    {
+        index_.add_box(feature_.id(), box2d<double>(0, 0, src.width(), src.height()), marker_tr);
+        place_feature();
+    }
+
+    void place_feature()
+    {
+        if (!placed_)
+        {
+            pixmap_.add_feature(feature_);
+            placed_ = true;
+        }
+    }
+
+  private:
+    feature_impl const& feature_;
+    grid_hit_index& index_;
+    PixMapType& pixmap_;
+    bool placed_;
+};
+
 } // namespace detail
 
 template<typename T>
@@ -141,9 +185,17 @@ void grid_renderer<T>::process(markers_symbolizer const& sym,
     using renderer_type = agg::renderer_scanline_bin_solid<grid_renderer_base_type>;
     using svg_renderer_type = svg::renderer_agg<svg_path_adapter, svg_attribute_type, renderer_type, pixfmt_type>;
 
+    box2d<double> clip_box = common_.query_extent_;
+
+    if (hit_index_)
+    {
+        detail::grid_hit_markers_renderer_context<buffer_type> hit_context(feature, *hit_index_, pixmap_);
+        render_markers_symbolizer(sym, feature, prj_trans, common_, clip_box, hit_context);
+        return;
+    }
+
     buf_type render_buf(pixmap_.raw_data(), common_.width_, common_.height_, common_.width_);
     ras_ptr->reset();
-    box2d<double> clip_box = common_.query_extent_;
 
     using renderer_context_type =
       detail::grid_markers_renderer_context<svg_renderer_type, renderer_type, buf_type, grid_rasterizer, buffer_type>;
@@ -29,6 +29,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 #include <mapnik/vertex_converters.hpp>
 #include <mapnik/vertex_processor.hpp>
 #include <mapnik/marker.hpp>
@@ -97,6 +98,16 @@ void grid_renderer<T>::process(polygon_pattern_symbolizer const& sym,
     if (smooth > 0.0)
         converter.set<smooth_tag>(); // optional smooth converter
 
+    if (hit_index_)
+    {
+        hit_index_->start_polygon(feature.id());
+        using apply_hit_index_type = detail::apply_vertex_converter<vertex_converter_type, grid_hit_index>;
+        apply_hit_index_type apply(converter, *hit_index_);
+        mapnik::util::apply_visitor(geometry::vertex_processor<apply_hit_index_type>(apply), feature.get_geometry());
+        pixmap_.add_feature(feature);
+        return;
+    }
+
     using apply_vertex_converter_type = detail::apply_vertex_converter<vertex_converter_type, grid_rasterizer>;
     using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
     apply_vertex_converter_type apply(converter, *ras_ptr);
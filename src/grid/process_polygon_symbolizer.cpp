@@ -30,6 +30,7 @@
 #include <mapnik/grid/grid_renderer.hpp>
 #include <mapnik/grid/grid_renderer_base.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
 #include <mapnik/vertex_converters.hpp>
 #include <mapnik/renderer_common/process_polygon_symbolizer.hpp>
 
@@ -58,6 +59,19 @@ void grid_renderer<T>::process(polygon_symbolizer const& sym,
     using vertex_converter_type =
       vertex_converter<clip_poly_tag, transform_tag, affine_transform_tag, simplify_tag, smooth_tag>;
 
+    if (hit_index_)
+    {
+        hit_index_->start_polygon(feature.id());
+        render_polygon_symbolizer<vertex_converter_type>(sym,
+                                                         feature,
+                                                         prj_trans,
+                                                         common_,
+                                                         common_.query_extent_,
+                                                         *hit_index_,
+                                                         [&](color const&, double) { pixmap_.add_feature(feature); });
+        return;
+    }
+
     ras_ptr->reset();
 
     grid_rendering_buffer buf(pixmap_.raw_data(), common_.width_, common_.height_, common_.width_);
@@ -81,7 +81,10 @@ void grid_renderer<T>::process(shield_symbolizer const& sym,
         {
             render_marker(feature, glyphs->marker_pos(), *mark->marker_, mark->transform_, opacity, comp_op);
         }
-        ren.render(*glyphs, feature_id);
+        if (hit_index_)
+            record_glyphs(*glyphs, feature_id);
+        else
+            ren.render(*glyphs, feature_id);
         placement_found = true;
     }
     if (placement_found)
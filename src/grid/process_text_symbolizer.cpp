@@ -74,7 +74,10 @@ void grid_renderer<T>::process(text_symbolizer const& sym,
 
     for (auto const& glyphs : placements)
     {
-        ren.render(*glyphs, feature_id);
+        if (hit_index_)
+            record_glyphs(*glyphs, feature_id);
+        else
+            ren.render(*glyphs, feature_id);
         placement_found = true;
     }
     if (placement_found)
@@ -79,9 +79,11 @@ class jpeg_reader : public image_reader
     inline bool has_alpha() const final { return false; }
     void read(unsigned x, unsigned y, image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    image_any read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned reduction) final;
 
   private:
     void init();
+    void read_scaled(unsigned x, unsigned y, image_rgba8& image, unsigned reduction);
     static void on_error(j_common_ptr cinfo);
     static void on_error_message(j_common_ptr cinfo);
     static void init_source(j_decompress_ptr cinfo);
@@ -267,6 +269,14 @@ boost::optional<box2d<double>> jpeg_reader<T>::bounding_box() const
 
 template<typename T>
 void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
+{
+    read_scaled(x0, y0, image, 1);
+}
+
+// x0 and y0 are in scaled coordinates, libjpeg decodes at 1/reduction
+// of full resolution by scaling the DCT
+template<typename T>
+void jpeg_reader<T>::read_scaled(unsigned x0, unsigned y0, image_rgba8& image, unsigned reduction)
 {
     stream_.clear();
     stream_.seekg(0, std::ios_base::beg);
@@ -282,6 +292,8 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
     int ret = jpeg_read_header(&cinfo, TRUE);
     if (ret != JPEG_HEADER_OK)
         throw image_reader_exception("JPEG Reader read(): failed to read header");
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = reduction;
     jpeg_start_decompress(&cinfo);
     JSAMPARRAY buffer;
     int row_stride;
@@ -289,13 +301,19 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
     row_stride = cinfo.output_width * cinfo.output_components;
     buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, row_stride, 1);
 
-    unsigned w = std::min(unsigned(image.width()), width_ - x0);
-    unsigned h = std::min(unsigned(image.height()), height_ - y0);
+    unsigned w = std::min(unsigned(image.width()), cinfo.output_width - x0);
+    unsigned h = std::min(unsigned(image.height()), cinfo.output_height - y0);
 
     const std::unique_ptr<unsigned int[]> out_row(new unsigned int[w]);
     unsigned row = 0;
     while (cinfo.output_scanline < cinfo.output_height)
     {
+        if (row >= y0 + h)
+        {
+            // rows below the window are never decoded
+            jpeg_abort_decompress(&cinfo);
+            return;
+        }
         jpeg_read_scanlines(&cinfo, buffer, 1);
         if (row >= y0 && row < y0 + h)
         {
@@ -331,4 +349,16 @@ image_any jpeg_reader<T>::read(unsigned x, unsigned y, unsigned width, unsigned
     return image_any(std::move(data));
 }
 
+template<typename T>
+image_any jpeg_reader<T>::read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned reduction)
+{
+    if (reduction != 2 && reduction != 4 && reduction != 8)
+    {
+        return read(x, y, width, height);
+    }
+    image_rgba8 data((width + reduction - 1) / reduction, (height + reduction - 1) / reduction, true, true);
+    read_scaled(x / reduction, y / reduction, data, reduction);
+    return image_any(std::move(data));
+}
+
 } // namespace mapnik
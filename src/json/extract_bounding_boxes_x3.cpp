@@ -28,6 +28,16 @@
 #include <mapnik/json/unicode_string_grammar_x3.hpp>
 #include <mapnik/json/positions_grammar_x3.hpp>
 
+// stl
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#endif
+
 namespace mapnik {
 namespace json {
 
@@ -139,6 +149,7 @@ x3::rule<struct bounding_box_rule_tag,
          std::tuple<boost::iterator_range<base_iterator_type>, mapnik::box2d<double>>> const bounding_box =
   "Bounding Box";
 x3::rule<struct feature_collection_tag> const feature_collection = "Feature Collection";
+x3::rule<struct feature_list_tag> const feature_list = "Feature List";
 
 auto const coordinates_rule_def = lit("\"coordinates\"") >> lit(':') >> positions_rule[extract_bounding_box];
 
@@ -157,7 +168,10 @@ auto const type = lit("\"type\"") > lit(':') > lit("\"FeatureCollection\"");
 
 auto const feature_collection_def = lit('{') > ((type | features | key_value_) % lit(',')) > lit('}');
 
-BOOST_SPIRIT_DEFINE(coordinates_rule, bounding_box, feature_collection);
+// a run of comma separated features, one slice of the "features" array
+auto const feature_list_def = omit[feature] % lit(',');
+
+BOOST_SPIRIT_DEFINE(coordinates_rule, bounding_box, feature_collection, feature_list);
 } // namespace grammar
 
 template<typename Iterator, typename Boxes>
@@ -184,11 +198,297 @@ void extract_bounding_boxes(Iterator& start, Iterator const& end, Boxes& boxes)
         throw std::runtime_error("Can't extract bounding boxes");
     }
 }
+
+namespace {
+
+// documents smaller than this are not worth splitting
+constexpr std::size_t min_parallel_size = 4 << 20;
+
+template<typename Iterator>
+Iterator skip_space(Iterator itr, Iterator const& end)
+{
+    while (itr != end && (*itr == ' ' || *itr == '\t' || *itr == '\n' || *itr == '\r'))
+        ++itr;
+    return itr;
+}
+
+// returns the position after the string starting at `itr`, or `end` if it is unterminated
+template<typename Iterator>
+Iterator skip_string(Iterator itr, Iterator const& end)
+{
+    for (++itr; itr != end; ++itr)
+    {
+        if (*itr == '\\')
+        {
+            if (++itr == end)
+                break;
+        }
+        else if (*itr == '"')
+            return ++itr;
+    }
+    return end;
+}
+
+// returns the position after the JSON value starting at `itr`, or `end` if it is malformed;
+// this only tracks strings and nesting, the grammar does the actual validation
+template<typename Iterator>
+Iterator skip_value(Iterator itr, Iterator const& end)
+{
+    std::size_t depth = 0;
+    while (itr != end)
+    {
+        char c = *itr;
+        if (c == '"')
+        {
+            itr = skip_string(itr, end);
+            if (depth == 0)
+                return itr;
+            continue;
+        }
+        else if (c == '{' || c == '[')
+        {
+            ++depth;
+        }
+        else if (c == '}' || c == ']')
+        {
+            if (depth == 0)
+                return itr; // end of an enclosing scalar's container
+            if (--depth == 0)
+                return ++itr;
+        }
+        else if (depth == 0 && (c == ',' || c == ' ' || c == '\t' || c == '\n' || c == '\r'))
+        {
+            return itr;
+        }
+        ++itr;
+    }
+    return depth == 0 ? itr : end;
+}
+
+template<typename Iterator>
+struct feature_collection_layout
+{
+    // [begin, end) of every element of the "features" array
+    std::vector<std::pair<Iterator, Iterator>> features;
+    // [begin, end) of the values of all other members
+    std::vector<std::pair<Iterator, Iterator>> members;
+    bool valid = false;
+};
+
+// Splits a FeatureCollection into its members without parsing them. Any
+// document this cannot make sense of is left to the sequential grammar.
+template<typename Iterator>
+feature_collection_layout<Iterator> scan_feature_collection(Iterator itr, Iterator const& end)
+{
+    feature_collection_layout<Iterator> layout;
+    bool has_features = false;
+    itr = skip_space(itr, end);
+    if (itr == end || *itr != '{')
+        return layout;
+    itr = skip_space(++itr, end);
+    while (itr != end && *itr == '"')
+    {
+        Iterator key_begin = itr;
+        itr = skip_string(itr, end);
+        if (itr == end)
+            return layout;
+        std::size_t key_size = std::distance(key_begin, itr);
+        bool is_features = (key_size == 10 && std::strncmp(key_begin, "\"features\"", 10) == 0);
+        bool is_type = (key_size == 6 && std::strncmp(key_begin, "\"type\"", 6) == 0);
+        itr = skip_space(itr, end);
+        if (itr == end || *itr != ':')
+            return layout;
+        itr = skip_space(++itr, end);
+        if (is_features)
+        {
+            if (has_features || itr == end || *itr != '[')
+                return layout;
+            has_features = true;
+            itr = skip_space(++itr, end);
+            while (itr != end && *itr != ']')
+            {
+                Iterator value_end = skip_value(itr, end);
+                if (value_end == end || value_end == itr)
+                    return layout;
+                layout.features.emplace_back(itr, value_end);
+                itr = skip_space(value_end, end);
+                if (itr != end && *itr == ',')
+                    itr = skip_space(++itr, end);
+                else if (itr == end || *itr != ']')
+                    return layout;
+            }
+            if (itr == end)
+                return layout;
+            ++itr;
+        }
+        else
+        {
+            Iterator value_end = skip_value(itr, end);
+            if (value_end == end || value_end == itr)
+                return layout;
+            if (is_type && !(std::distance(itr, value_end) == 19 && std::strncmp(itr, "\"FeatureCollection\"", 19) == 0))
+                return layout;
+            if (!is_type)
+                layout.members.emplace_back(itr, value_end);
+            itr = value_end;
+        }
+        itr = skip_space(itr, end);
+        if (itr != end && *itr == ',')
+            itr = skip_space(++itr, end);
+        else
+            break;
+    }
+    if (itr == end || *itr != '}')
+        return layout;
+    layout.valid = has_features && skip_space(++itr, end) == end;
+    return layout;
+}
+
+template<typename Iterator, typename Boxes>
+void extract_feature_list(Iterator const& base, Iterator begin, Iterator const& end, Boxes& boxes)
+{
+    using namespace boost::spirit;
+    using space_type = mapnik::json::grammar::space_type;
+
+    extract_positions<Iterator, Boxes> callback(base, boxes);
+    auto keys = mapnik::json::get_keys();
+    std::size_t bracket_counter = 0;
+#if BOOST_VERSION >= 106700
+    auto feature_list_impl = x3::with<mapnik::json::grammar::bracket_tag>(
+      bracket_counter)[x3::with<mapnik::json::grammar::feature_callback_tag>(
+      callback)[x3::with<mapnik::json::grammar::keys_tag>(keys)[mapnik::json::grammar::feature_list]]];
+#else
+    auto feature_list_impl = x3::with<mapnik::json::grammar::bracket_tag>(
+      std::ref(bracket_counter))[x3::with<mapnik::json::grammar::feature_callback_tag>(std::ref(
+      callback))[x3::with<mapnik::json::grammar::keys_tag>(std::ref(keys))[mapnik::json::grammar::feature_list]]];
+#endif
+    if (!x3::phrase_parse(begin, end, feature_list_impl, space_type()) || begin != end)
+    {
+        throw std::runtime_error("Can't extract bounding boxes");
+    }
+}
+
+template<typename Iterator>
+bool valid_json_value(Iterator begin, Iterator const& end)
+{
+    using namespace boost::spirit;
+    using space_type = mapnik::json::grammar::space_type;
+    auto keys = mapnik::json::get_keys();
+#if BOOST_VERSION >= 106700
+    auto value_grammar = x3::with<mapnik::json::grammar::keys_tag>(keys)[mapnik::json::grammar::geojson_value];
+#else
+    auto value_grammar =
+      x3::with<mapnik::json::grammar::keys_tag>(std::ref(keys))[mapnik::json::grammar::geojson_value];
+#endif
+    mapnik::json::geojson_value value;
+    try
+    {
+        return x3::phrase_parse(begin, end, value_grammar, space_type(), value) && begin == end;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+} // namespace
+
+template<typename Iterator, typename Boxes>
+void extract_bounding_boxes(Iterator& start, Iterator const& end, Boxes& boxes, std::size_t num_threads)
+{
+#ifdef MAPNIK_THREADSAFE
+    if (num_threads > 1 && static_cast<std::size_t>(std::distance(start, end)) >= min_parallel_size)
+    {
+        auto layout = scan_feature_collection(start, end);
+        bool valid = layout.valid && layout.features.size() >= 2 * num_threads;
+        for (auto const& member : layout.members)
+        {
+            if (!valid)
+                break;
+            valid = valid_json_value(member.first, member.second);
+        }
+        if (valid)
+        {
+            // contiguous runs of features of roughly equal byte size
+            std::size_t num_features = layout.features.size();
+            std::size_t target_size = std::distance(layout.features.front().first, layout.features.back().second) /
+                                      num_threads;
+            std::vector<std::pair<std::size_t, std::size_t>> slices;
+            std::size_t first = 0;
+            for (std::size_t i = 0; i < num_features; ++i)
+            {
+                bool last = (i + 1 == num_features);
+                if (last || (slices.size() + 1 < num_threads &&
+                             static_cast<std::size_t>(std::distance(layout.features[first].first,
+                                                                    layout.features[i].second)) >= target_size))
+                {
+                    slices.emplace_back(first, i);
+                    first = i + 1;
+                }
+            }
+            std::vector<Boxes> slice_boxes(slices.size());
+            std::vector<std::exception_ptr> errors(slices.size());
+            auto parse = [&](std::size_t index) {
+                try
+                {
+                    auto const& slice = slices[index];
+                    extract_feature_list(start,
+                                         layout.features[slice.first].first,
+                                         layout.features[slice.second].second,
+                                         slice_boxes[index]);
+                }
+                catch (...)
+                {
+                    errors[index] = std::current_exception();
+                }
+            };
+            std::vector<std::thread> workers;
+            workers.reserve(slices.size() - 1);
+            for (std::size_t i = 1; i < slices.size(); ++i)
+            {
+                workers.emplace_back(parse, i);
+            }
+            parse(0);
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+            for (auto const& error : errors)
+            {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+            std::size_t total = 0;
+            for (auto const& b : slice_boxes)
+            {
+                total += b.size();
+            }
+            boxes.reserve(boxes.size() + total);
+            for (auto& b : slice_boxes)
+            {
+                std::move(b.begin(), b.end(), std::back_inserter(boxes));
+            }
+            start = end;
+            return;
+        }
+    }
+#endif
+    extract_bounding_boxes(start, end, boxes);
+}
+
 using base_iterator_type = char const*;
 template void
   extract_bounding_boxes<base_iterator_type, boxes_type>(base_iterator_type&, base_iterator_type const&, boxes_type&);
 template void extract_bounding_boxes<base_iterator_type, boxes_type_f>(base_iterator_type&,
                                                                        base_iterator_type const&,
                                                                        boxes_type_f&);
+template void extract_bounding_boxes<base_iterator_type, boxes_type>(base_iterator_type&,
+                                                                     base_iterator_type const&,
+                                                                     boxes_type&,
+                                                                     std::size_t);
+template void extract_bounding_boxes<base_iterator_type, boxes_type_f>(base_iterator_type&,
+                                                                       base_iterator_type const&,
+                                                                       boxes_type_f&,
+                                                                       std::size_t);
 } // namespace json
 } // namespace mapnik
@@ -35,9 +35,13 @@
 #include <libxml/tree.h>
 #include <libxml/parserInternals.h>
 #include <libxml/xinclude.h>
+#include <libxml/uri.h>
 
 // stl
+#include <algorithm>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 
 #if LIBXML_VERSION >= 20900
 #define DEFAULT_OPTIONS                                                                                                \
@@ -52,6 +56,54 @@
 #endif
 
 namespace mapnik {
+
+namespace {
+
+// libxml2 only offers a process wide hook for loading external resources, so
+// the files read by one particular parse are collected in a thread local list
+// that is set for the duration of that parse
+thread_local std::vector<std::string>* recorded_dependencies = nullptr;
+xmlExternalEntityLoader next_entity_loader = nullptr;
+std::once_flag entity_loader_flag;
+
+void record_dependency(std::string path)
+{
+    if (path.compare(0, 7, "file://") == 0)
+    {
+        path.erase(0, 7);
+    }
+    if (std::find(recorded_dependencies->begin(), recorded_dependencies->end(), path) == recorded_dependencies->end())
+    {
+        recorded_dependencies->push_back(std::move(path));
+    }
+}
+
+xmlParserInputPtr recording_entity_loader(const char* url, const char* id, xmlParserCtxtPtr ctxt)
+{
+    if (recorded_dependencies && url)
+    {
+        record_dependency(url);
+    }
+    return next_entity_loader(url, id, ctxt);
+}
+
+class dependency_recorder : util::noncopyable
+{
+  public:
+    explicit dependency_recorder(std::vector<std::string>& dependencies)
+    {
+        std::call_once(entity_loader_flag, [] {
+            next_entity_loader = xmlGetExternalEntityLoader();
+            xmlSetExternalEntityLoader(recording_entity_loader);
+        });
+        recorded_dependencies = &dependencies;
+    }
+
+    ~dependency_recorder() { recorded_dependencies = nullptr; }
+};
+
+} // namespace
+
 class libxml2_loader : util::noncopyable
 {
   public:
@@ -193,12 +245,38 @@ class libxml2_loader : util::noncopyable
                 break;
                 case XML_COMMENT_NODE:
                     break;
+                case XML_XINCLUDE_START:
+                    // text includes do not go through the entity loader
+                    if (recorded_dependencies)
+                    {
+                        record_xinclude(cur_node);
+                    }
+                    break;
                 default:
                     break;
             }
         }
     }
 
+    void record_xinclude(xmlNode* include_node)
+    {
+        xmlChar* href = xmlGetProp(include_node, reinterpret_cast<const xmlChar*>("href"));
+        if (!href)
+            return;
+        xmlChar* base = xmlNodeGetBase(include_node->doc, include_node);
+        xmlChar* uri = xmlBuildURI(href, base);
+        if (uri)
+        {
+            record_dependency(reinterpret_cast<const char*>(uri));
+            xmlFree(uri);
+        }
+        if (base)
+        {
+            xmlFree(base);
+        }
+        xmlFree(href);
+    }
+
     xmlParserCtxtPtr ctx_;
     const char* encoding_;
     int options_;
@@ -210,6 +288,13 @@ void read_xml(std::string const& filename, xml_node& node)
     libxml2_loader loader;
     loader.load(filename, node);
 }
+void read_xml(std::string const& filename, xml_node& node, std::vector<std::string>& dependencies)
+{
+    dependencies.push_back(filename);
+    dependency_recorder recorder(dependencies);
+    libxml2_loader loader;
+    loader.load(filename, node);
+}
 void read_xml_string(std::string const& str, xml_node& node, std::string const& base_path)
 {
     libxml2_loader loader;
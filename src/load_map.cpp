@@ -23,6 +23,7 @@
 // mapnik
 #include <mapnik/debug.hpp>
 #include <mapnik/load_map.hpp>
+#include <mapnik/map_cache.hpp>
 #include <mapnik/xml_tree.hpp>
 #include <mapnik/version.hpp>
 #include <mapnik/image_compositing.hpp>
@@ -221,8 +222,24 @@ void map_apply_overlap_optimization(Map& map)
     }
 }
 
-void load_map(Map& map, std::string const& filename, bool strict, std::string base_path)
+void load_map(Map& map,
+              std::string const& filename,
+              bool strict,
+              std::string base_path,
+              std::string const& cache_filename)
 {
+    if (!cache_filename.empty())
+    {
+        map_cache_source source;
+        source.filename = filename;
+        source.base_path = base_path;
+        source.strict = strict;
+        if (read_map_cache(map, source, cache_filename))
+        {
+            map_apply_overlap_optimization(map);
+            return;
+        }
+    }
     xml_tree tree;
     tree.set_filename(filename);
     read_xml(filename, tree.root());
@@ -231,6 +248,41 @@ void load_map(Map& map, std::string const& filename, bool strict, std::string ba
     map_apply_overlap_optimization(map);
 }
 
+void compile_map(std::string const& filename,
+                 std::string const& cache_filename,
+                 bool strict,
+                 std::string const& base_path)
+{
+    map_cache_source source;
+    source.filename = filename;
+    source.base_path = base_path;
+    source.strict = strict;
+    xml_tree tree;
+    tree.set_filename(filename);
+    read_xml(filename, tree.root(), source.dependencies);
+    // the cache stores the map as parsed; load_map() applies the overlap
+    // optimization after reading it
+    Map map;
+    map_parser parser(map, strict, filename);
+    parser.parse_map(map, tree.root(), base_path);
+    xml_node const& map_node = tree.root().get_child("Map");
+    for (char const* name : {"background-color",
+                             "background-image",
+                             "background-image-comp-op",
+                             "background-image-opacity",
+                             "srs",
+                             "buffer-size",
+                             "maximum-extent",
+                             "font-directory"})
+    {
+        if (map_node.has_attribute(name))
+        {
+            source.map_attributes.insert(name);
+        }
+    }
+    write_map_cache(map, source, cache_filename);
+}
+
 void load_map_string(Map& map, std::string const& str, bool strict, std::string base_path)
 {
     xml_tree tree;
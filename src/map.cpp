@@ -283,7 +283,9 @@ std::map<std::string, font_set>& Map::fontsets()
 bool Map::register_fonts(std::string const& dir, bool recurse)
 {
     font_library library;
-    return freetype_engine::instance().register_fonts_impl(dir, library, font_file_mapping_, recurse);
+    bool success = freetype_engine::instance().register_fonts_impl(dir, library, font_file_mapping_, recurse);
+    freetype_engine::instance().save_registry_cache();
+    return success;
 }
 
 bool Map::load_fonts()
@@ -0,0 +1,1875 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/map_cache.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/function_call.hpp>
+#include <mapnik/path_expression.hpp>
+#include <mapnik/transform/transform_expression.hpp>
+#include <mapnik/raster_colorizer.hpp>
+#include <mapnik/image_filter_types.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <mapnik/group/group_layout.hpp>
+#include <mapnik/group/group_rule.hpp>
+#include <mapnik/group/group_symbolizer_properties.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/text/placements/simple.hpp>
+#include <mapnik/text/placements/list.hpp>
+#include <mapnik/text/formatting/text.hpp>
+#include <mapnik/text/formatting/format.hpp>
+#include <mapnik/text/formatting/layout.hpp>
+#include <mapnik/text/formatting/list.hpp>
+#include <mapnik/text/font_feature_settings.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/font_set.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/config_error.hpp>
+#include <mapnik/debug.hpp>
+#include <mapnik/version.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/util/utf_conv_win.hpp>
+
+// stl
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mapnik {
+
+namespace {
+
+// bump when the layout below changes
+constexpr std::uint32_t map_cache_format = 1;
+constexpr char map_cache_magic[8] = {'M', 'A', 'P', 'N', 'I', 'K', 'M', 'C'};
+
+// a cache that does not decode is treated like a missing one
+struct cache_error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+class cache_writer
+{
+  public:
+    explicit cache_writer(std::string& out)
+        : out_(out)
+    {}
+
+    void write_u8(std::uint8_t value) { out_.push_back(static_cast<char>(value)); }
+
+    void write_bool(bool value) { write_u8(value ? 1 : 0); }
+
+    void write_u32(std::uint32_t value)
+    {
+        for (unsigned i = 0; i < 4; ++i)
+            out_.push_back(static_cast<char>(value >> (i * 8)));
+    }
+
+    void write_u64(std::uint64_t value)
+    {
+        write_u32(static_cast<std::uint32_t>(value));
+        write_u32(static_cast<std::uint32_t>(value >> 32));
+    }
+
+    void write_i64(std::int64_t value) { write_u64(static_cast<std::uint64_t>(value)); }
+
+    void write_double(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write_u64(bits);
+    }
+
+    void write_size(std::size_t size) { write_u32(static_cast<std::uint32_t>(size)); }
+
+    void write_string(std::string const& str)
+    {
+        write_size(str.size());
+        out_.append(str);
+    }
+
+  private:
+    std::string& out_;
+};
+
+class cache_reader
+{
+  public:
+    cache_reader(char const* begin, char const* end)
+        : pos_(begin)
+        , end_(end)
+    {}
+
+    std::uint8_t read_u8()
+    {
+        require(1);
+        return static_cast<std::uint8_t>(*pos_++);
+    }
+
+    bool read_bool() { return read_u8() != 0; }
+
+    std::uint32_t read_u32()
+    {
+        require(4);
+        std::uint32_t value = 0;
+        for (unsigned i = 0; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(*pos_++)) << (i * 8);
+        return value;
+    }
+
+    std::uint64_t read_u64()
+    {
+        std::uint64_t low = read_u32();
+        std::uint64_t high = read_u32();
+        return low | (high << 32);
+    }
+
+    std::int64_t read_i64() { return static_cast<std::int64_t>(read_u64()); }
+
+    double read_double()
+    {
+        std::uint64_t bits = read_u64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // element count; every element takes at least one byte, which keeps a
+    // damaged count from turning into a huge allocation
+    std::size_t read_size()
+    {
+        std::size_t size = read_u32();
+        if (size > static_cast<std::size_t>(end_ - pos_))
+        {
+            throw cache_error("element count exceeds file size");
+        }
+        return size;
+    }
+
+    std::string read_string()
+    {
+        std::size_t size = read_size();
+        std::string str(pos_, size);
+        pos_ += size;
+        return str;
+    }
+
+    bool at_end() const { return pos_ == end_; }
+
+  private:
+    void require(std::size_t bytes)
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < bytes)
+        {
+            throw cache_error("unexpected end of file");
+        }
+    }
+
+    char const* pos_;
+    char const* end_;
+};
+
+// Map level settings are only applied when the stylesheet sets them, the same
+// as when the XML is parsed into an existing Map
+struct compiled_map
+{
+    std::string base_path;
+    boost::optional<color> background;
+    boost::optional<std::string> background_image;
+    boost::optional<composite_mode_e> background_image_comp_op;
+    boost::optional<float> background_image_opacity;
+    boost::optional<std::string> srs;
+    boost::optional<int> buffer_size;
+    boost::optional<box2d<double>> maximum_extent;
+    boost::optional<std::string> font_directory;
+    parameters extra_parameters;
+    std::vector<font_set> fontsets;
+    std::vector<std::pair<std::string, feature_type_style>> styles;
+    std::vector<layer> layers;
+};
+
+class map_serializer;
+
+template<typename Writer>
+struct write_alternative
+{
+    Writer& writer;
+
+    template<typename T>
+    void operator()(T const& val) const
+    {
+        writer.write(val);
+    }
+};
+
+// Variants are written as their index followed by the held value; the reader
+// maps indices back to types in declaration order.
+class map_serializer
+{
+  public:
+    explicit map_serializer(std::string& out)
+        : out_(out)
+    {}
+
+    void write_map(Map const& map, map_cache_source const& source)
+    {
+        auto has = [&source](char const* name) { return source.map_attributes.count(name) > 0; };
+        out_.write_string(map.base_path());
+        write_optional(has("background-color") ? map.background() : boost::optional<color>());
+        write_optional(has("background-image") ? map.background_image() : boost::optional<std::string>());
+        out_.write_bool(has("background-image-comp-op"));
+        if (has("background-image-comp-op"))
+            out_.write_u32(static_cast<std::uint32_t>(map.background_image_comp_op()));
+        out_.write_bool(has("background-image-opacity"));
+        if (has("background-image-opacity"))
+            out_.write_double(map.background_image_opacity());
+        write_optional(has("srs") ? boost::optional<std::string>(map.srs()) : boost::optional<std::string>());
+        out_.write_bool(has("buffer-size"));
+        if (has("buffer-size"))
+            out_.write_i64(map.buffer_size());
+        write_optional(has("maximum-extent") ? map.maximum_extent() : boost::optional<box2d<double>>());
+        write_optional(has("font-directory") ? map.font_directory() : boost::optional<std::string>());
+        write(map.get_extra_parameters());
+
+        out_.write_size(map.fontsets().size());
+        for (auto const& fontset : map.fontsets())
+        {
+            write(fontset.second);
+        }
+        out_.write_size(map.styles().size());
+        for (auto const& style : map.styles())
+        {
+            out_.write_string(style.first);
+            write(style.second);
+        }
+        out_.write_size(map.layers().size());
+        for (auto const& lyr : map.layers())
+        {
+            write(lyr);
+        }
+    }
+
+    void write(layer const& lyr)
+    {
+        out_.write_string(lyr.name());
+        out_.write_string(lyr.srs());
+        out_.write_double(lyr.minimum_scale_denominator());
+        out_.write_double(lyr.maximum_scale_denominator());
+        out_.write_bool(lyr.active());
+        out_.write_bool(lyr.queryable());
+        out_.write_bool(lyr.clear_label_cache());
+        out_.write_bool(lyr.cache_features());
+        out_.write_string(lyr.group_by());
+        out_.write_size(lyr.styles().size());
+        for (auto const& name : lyr.styles())
+        {
+            out_.write_string(name);
+        }
+        out_.write_bool(bool(lyr.buffer_size()));
+        if (lyr.buffer_size())
+            out_.write_i64(*lyr.buffer_size());
+        write_optional(lyr.maximum_extent());
+        write_comp_op(lyr.comp_op());
+        out_.write_double(lyr.get_opacity());
+        // datasources are recreated from their parameters on load
+        datasource_ptr ds = lyr.datasource();
+        out_.write_bool(bool(ds));
+        if (ds)
+            write(ds->params());
+        out_.write_size(lyr.layers().size());
+        for (auto const& sublayer : lyr.layers())
+        {
+            write(sublayer);
+        }
+    }
+
+    void write(feature_type_style const& style)
+    {
+        out_.write_u8(static_cast<std::uint8_t>(filter_mode_enum(style.get_filter_mode())));
+        write_comp_op(style.comp_op());
+        out_.write_double(style.get_opacity());
+        out_.write_bool(style.image_filters_inflate());
+        write(style.image_filters());
+        write(style.direct_image_filters());
+        out_.write_size(style.get_rules().size());
+        for (auto const& r : style.get_rules())
+        {
+            write(r);
+        }
+    }
+
+    void write(rule const& r)
+    {
+        out_.write_string(r.get_name());
+        out_.write_double(r.get_min_scale());
+        out_.write_double(r.get_max_scale());
+        write(r.get_filter());
+        out_.write_bool(r.has_else_filter());
+        out_.write_bool(r.has_also_filter());
+        write(r.get_symbolizers());
+    }
+
+    void write(std::vector<symbolizer> const& symbolizers)
+    {
+        out_.write_size(symbolizers.size());
+        for (auto const& sym : symbolizers)
+        {
+            out_.write_u8(static_cast<std::uint8_t>(sym.which()));
+            util::apply_visitor(write_alternative<map_serializer>{*this}, sym);
+        }
+    }
+
+    void write(symbolizer_base const& sym)
+    {
+        out_.write_size(sym.properties.size());
+        for (auto const& prop : sym.properties)
+        {
+            out_.write_u32(static_cast<std::uint32_t>(prop.first));
+            write(prop.second);
+        }
+    }
+
+    void write(symbolizer_base::value_type const& val)
+    {
+        out_.write_u8(static_cast<std::uint8_t>(val.which()));
+        util::apply_visitor(write_alternative<map_serializer>{*this}, val);
+    }
+
+    void write(value_bool val) { out_.write_bool(val); }
+    void write(enumeration_wrapper const& val) { out_.write_i64(val.value); }
+    void write(value_integer val) { out_.write_i64(val); }
+    void write(value_double val) { out_.write_double(val); }
+    void write(std::string const& val) { out_.write_string(val); }
+
+    void write(color const& val)
+    {
+        out_.write_u8(val.red());
+        out_.write_u8(val.green());
+        out_.write_u8(val.blue());
+        out_.write_u8(val.alpha());
+        out_.write_bool(val.get_premultiplied());
+    }
+
+    void write(expression_ptr const& expr)
+    {
+        out_.write_bool(bool(expr));
+        if (expr)
+            write(*expr);
+    }
+
+    void write(expr_node const& node)
+    {
+        out_.write_u8(static_cast<std::uint8_t>(node.which()));
+        util::apply_visitor(write_alternative<map_serializer>{*this}, node);
+    }
+
+    void write(value_null const&) {}
+
+    void write(value_unicode_string const& val)
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        out_.write_string(utf8);
+    }
+
+    void write(attribute const& attr) { out_.write_string(attr.name_); }
+    void write(global_attribute const& attr) { out_.write_string(attr.name); }
+    void write(geometry_type_attribute const&) {}
+
+    template<typename Tag>
+    void write(unary_node<Tag> const& node)
+    {
+        write(node.expr);
+    }
+
+    template<typename Tag>
+    void write(binary_node<Tag> const& node)
+    {
+        write(node.left);
+        write(node.right);
+    }
+
+    void write(regex_match_node const& node)
+    {
+        write(node.expr);
+        out_.write_string(node.pattern());
+    }
+
+    void write(regex_replace_node const& node)
+    {
+        write(node.expr);
+        out_.write_string(node.pattern());
+        out_.write_string(node.format());
+    }
+
+    void write(unary_function_call const& call)
+    {
+        write_function_name(unary_function_name(call.fun));
+        write(call.arg);
+    }
+
+    void write(binary_function_call const& call)
+    {
+        write_function_name(binary_function_name(call.fun));
+        write(call.arg1);
+        write(call.arg2);
+    }
+
+    void write(path_expression_ptr const& path)
+    {
+        out_.write_bool(bool(path));
+        if (!path)
+            return;
+        out_.write_size(path->size());
+        for (auto const& component : *path)
+        {
+            out_.write_u8(static_cast<std::uint8_t>(component.which()));
+            util::apply_visitor(write_alternative<map_serializer>{*this}, component);
+        }
+    }
+
+    void write(transform_type const& transform)
+    {
+        out_.write_bool(bool(transform));
+        if (!transform)
+            return;
+        out_.write_size(transform->size());
+        for (auto const& node : *transform)
+        {
+            out_.write_u8(static_cast<std::uint8_t>(node.base_.which()));
+            util::apply_visitor(write_alternative<map_serializer>{*this}, node.base_);
+        }
+    }
+
+    void write(identity_node const&) {}
+
+    void write(matrix_node const& node)
+    {
+        write(node.a_);
+        write(node.b_);
+        write(node.c_);
+        write(node.d_);
+        write(node.e_);
+        write(node.f_);
+    }
+
+    void write(translate_node const& node)
+    {
+        write(node.tx_);
+        write(node.ty_);
+    }
+
+    void write(scale_node const& node)
+    {
+        write(node.sx_);
+        write(node.sy_);
+    }
+
+    void write(rotate_node const& node)
+    {
+        write(node.angle_);
+        write(node.cx_);
+        write(node.cy_);
+    }
+
+    void write(skewX_node const& node) { write(node.angle_); }
+    void write(skewY_node const& node) { write(node.angle_); }
+
+    void write(text_placements_ptr const& placements)
+    {
+        if (!placements)
+        {
+            out_.write_u8(placement_none);
+        }
+        else if (auto const* simple = dynamic_cast<text_placements_simple const*>(placements.get()))
+        {
+            out_.write_u8(placement_simple);
+            write(placements->defaults);
+            write(simple->positions());
+            out_.write_size(simple->direction_.size());
+            for (auto dir : simple->direction_)
+            {
+                out_.write_u8(static_cast<std::uint8_t>(dir));
+            }
+            out_.write_size(simple->text_sizes_.size());
+            for (auto size : simple->text_sizes_)
+            {
+                out_.write_i64(size);
+            }
+        }
+        else if (auto const* list = dynamic_cast<text_placements_list const*>(placements.get()))
+        {
+            out_.write_u8(placement_list);
+            write(placements->defaults);
+            out_.write_size(list->size());
+            for (unsigned i = 0; i < list->size(); ++i)
+            {
+                write(list->get(i));
+            }
+        }
+        else if (dynamic_cast<text_placements_dummy const*>(placements.get()))
+        {
+            out_.write_u8(placement_dummy);
+            write(placements->defaults);
+        }
+        else
+        {
+            throw config_error("text placements of this type cannot be compiled");
+        }
+    }
+
+    void write(text_symbolizer_properties const& props)
+    {
+        text_properties_expressions const& exprs = props.expressions;
+        for (auto const* val : {&exprs.label_placement,
+                                &exprs.label_spacing,
+                                &exprs.label_position_tolerance,
+                                &exprs.avoid_edges,
+                                &exprs.margin,
+                                &exprs.repeat_distance,
+                                &exprs.minimum_distance,
+                                &exprs.minimum_padding,
+                                &exprs.minimum_path_length,
+                                &exprs.max_char_angle_delta,
+                                &exprs.allow_overlap,
+                                &exprs.largest_bbox_only,
+                                &exprs.upright,
+                                &exprs.grid_cell_width,
+                                &exprs.grid_cell_height})
+        {
+            write(*val);
+        }
+        text_layout_properties const& layout = props.layout_defaults;
+        for (auto const* val : {&layout.dx,
+                                &layout.dy,
+                                &layout.orientation,
+                                &layout.text_ratio,
+                                &layout.wrap_width,
+                                &layout.wrap_char,
+                                &layout.wrap_before,
+                                &layout.repeat_wrap_char,
+                                &layout.rotate_displacement,
+                                &layout.halign,
+                                &layout.jalign,
+                                &layout.valign})
+        {
+            write(*val);
+        }
+        out_.write_u8(static_cast<std::uint8_t>(layout.dir));
+        format_properties const& format = props.format_defaults;
+        out_.write_string(format.face_name);
+        write_optional(format.fontset);
+        for (auto const* val : {&format.text_size,
+                                &format.character_spacing,
+                                &format.line_spacing,
+                                &format.text_opacity,
+                                &format.halo_opacity,
+                                &format.fill,
+                                &format.halo_fill,
+                                &format.halo_radius,
+                                &format.text_transform,
+                                &format.ff_settings})
+        {
+            write(*val);
+        }
+        write(props.format_tree());
+    }
+
+    void write(formatting::node_ptr const& node)
+    {
+        if (!node)
+        {
+            out_.write_u8(format_none);
+        }
+        else if (auto const* text = dynamic_cast<formatting::text_node const*>(node.get()))
+        {
+            out_.write_u8(format_text);
+            write(text->get_text());
+        }
+        else if (auto const* format = dynamic_cast<formatting::format_node const*>(node.get()))
+        {
+            out_.write_u8(format_format);
+            write_optional(format->face_name);
+            write_optional(format->fontset);
+            for (auto const* val : {&format->text_size,
+                                    &format->character_spacing,
+                                    &format->line_spacing,
+                                    &format->text_opacity,
+                                    &format->wrap_before,
+                                    &format->repeat_wrap_char,
+                                    &format->text_transform,
+                                    &format->fill,
+                                    &format->halo_fill,
+                                    &format->halo_radius,
+                                    &format->ff_settings})
+            {
+                write_optional(*val);
+            }
+            write(format->get_child());
+        }
+        else if (auto const* layout = dynamic_cast<formatting::layout_node const*>(node.get()))
+        {
+            out_.write_u8(format_layout);
+            for (auto const* val : {&layout->dx,
+                                    &layout->dy,
+                                    &layout->halign,
+                                    &layout->valign,
+                                    &layout->jalign,
+                                    &layout->text_ratio,
+                                    &layout->wrap_width,
+                                    &layout->wrap_char,
+                                    &layout->wrap_before,
+                                    &layout->repeat_wrap_char,
+                                    &layout->rotate_displacement,
+                                    &layout->orientation})
+            {
+                write_optional(*val);
+            }
+            write(layout->get_child());
+        }
+        else if (auto const* list = dynamic_cast<formatting::list_node const*>(node.get()))
+        {
+            out_.write_u8(format_list);
+            out_.write_size(list->get_children().size());
+            for (auto const& child : list->get_children())
+            {
+                write(child);
+            }
+        }
+        else
+        {
+            throw config_error("text formatting nodes of this type cannot be compiled");
+        }
+    }
+
+    void write(dash_array const& dashes)
+    {
+        out_.write_size(dashes.size());
+        for (auto const& dash : dashes)
+        {
+            out_.write_double(dash.first);
+            out_.write_double(dash.second);
+        }
+    }
+
+    void write(raster_colorizer_ptr const& colorizer)
+    {
+        out_.write_bool(bool(colorizer));
+        if (!colorizer)
+            return;
+        out_.write_u8(static_cast<std::uint8_t>(colorizer->get_default_mode_enum()));
+        write(colorizer->get_default_color());
+        out_.write_double(colorizer->get_epsilon());
+        out_.write_size(colorizer->get_stops().size());
+        for (auto const& stop : colorizer->get_stops())
+        {
+            out_.write_double(stop.get_value());
+            out_.write_u8(static_cast<std::uint8_t>(stop.get_mode_enum()));
+            write(stop.get_color());
+            out_.write_string(stop.get_label());
+        }
+    }
+
+    void write(group_symbolizer_properties_ptr const& group)
+    {
+        out_.write_bool(bool(group));
+        if (!group)
+            return;
+        group_layout const& layout = group->get_layout();
+        out_.write_u8(static_cast<std::uint8_t>(layout.which()));
+        if (layout.is<pair_layout>())
+        {
+            pair_layout const& pair = layout.get<pair_layout>();
+            out_.write_double(pair.get_item_margin());
+            out_.write_double(pair.get_max_difference());
+        }
+        else
+        {
+            out_.write_double(layout.get<simple_row_layout>().get_item_margin());
+        }
+        out_.write_size(group->get_rules().size());
+        for (auto const& r : group->get_rules())
+        {
+            write(r->get_filter());
+            write(r->get_repeat_key());
+            write(r->get_symbolizers());
+        }
+    }
+
+    void write(font_feature_settings const& settings)
+    {
+        out_.write_size(settings.count());
+        for (auto const& feature : settings.features())
+        {
+            out_.write_u32(feature.tag);
+            out_.write_u32(feature.value);
+            out_.write_u32(feature.start);
+            out_.write_u32(feature.end);
+        }
+    }
+
+    void write(std::vector<filter::filter_type> const& filters)
+    {
+        out_.write_size(filters.size());
+        for (auto const& f : filters)
+        {
+            out_.write_u8(static_cast<std::uint8_t>(f.which()));
+            util::apply_visitor(write_alternative<map_serializer>{*this}, f);
+        }
+    }
+
+    void write(filter::image_filter_base const&) {}
+
+    void write(filter::agg_stack_blur const& f)
+    {
+        out_.write_u32(f.rx);
+        out_.write_u32(f.ry);
+    }
+
+    void write(filter::scale_hsla const& f)
+    {
+        for (double val : {f.h0, f.h1, f.s0, f.s1, f.l0, f.l1, f.a0, f.a1})
+        {
+            out_.write_double(val);
+        }
+    }
+
+    void write(filter::colorize_alpha const& f)
+    {
+        out_.write_size(f.size());
+        for (auto const& stop : f)
+        {
+            write(stop.color);
+            out_.write_double(stop.offset);
+        }
+    }
+
+    void write(filter::color_to_alpha const& f) { write(f.color); }
+
+    void write(font_set const& fontset)
+    {
+        out_.write_string(fontset.get_name());
+        out_.write_size(fontset.get_face_names().size());
+        for (auto const& face_name : fontset.get_face_names())
+        {
+            out_.write_string(face_name);
+        }
+    }
+
+    void write(parameters const& params)
+    {
+        out_.write_size(params.size());
+        for (auto const& param : params)
+        {
+            out_.write_string(param.first);
+            out_.write_u8(static_cast<std::uint8_t>(param.second.which()));
+            util::apply_visitor(write_alternative<map_serializer>{*this}, param.second);
+        }
+    }
+
+    void write(box2d<double> const& box)
+    {
+        out_.write_double(box.minx());
+        out_.write_double(box.miny());
+        out_.write_double(box.maxx());
+        out_.write_double(box.maxy());
+    }
+
+    template<typename T>
+    void write_optional(boost::optional<T> const& val)
+    {
+        out_.write_bool(bool(val));
+        if (val)
+            write(*val);
+    }
+
+    enum placement_tag : std::uint8_t { placement_none, placement_dummy, placement_simple, placement_list };
+    enum format_tag : std::uint8_t { format_none, format_text, format_format, format_layout, format_list };
+
+  private:
+    void write_comp_op(boost::optional<composite_mode_e> const& comp_op)
+    {
+        out_.write_bool(bool(comp_op));
+        if (comp_op)
+            out_.write_u32(static_cast<std::uint32_t>(*comp_op));
+    }
+
+    void write_function_name(char const* name)
+    {
+        if (std::strcmp(name, "unknown") == 0)
+        {
+            throw config_error("expression functions of this type cannot be compiled");
+        }
+        out_.write_string(name);
+    }
+
+    cache_writer out_;
+};
+
+unary_function_impl unary_function_from_name(std::string const& name)
+{
+    if (name == "sin")
+        return sin_impl();
+    else if (name == "cos")
+        return cos_impl();
+    else if (name == "tan")
+        return tan_impl();
+    else if (name == "atan")
+        return atan_impl();
+    else if (name == "exp")
+        return exp_impl();
+    else if (name == "log")
+        return log_impl();
+    else if (name == "abs")
+        return abs_impl();
+    else if (name == "length")
+        return length_impl();
+    throw cache_error("unknown function '" + name + "'");
+}
+
+binary_function_impl binary_function_from_name(std::string const& name)
+{
+    if (name == "min")
+        return min_impl;
+    else if (name == "max")
+        return max_impl;
+    else if (name == "pow")
+        return pow_impl;
+    throw cache_error("unknown function '" + name + "'");
+}
+
+class map_deserializer
+{
+  public:
+    explicit map_deserializer(cache_reader& in)
+        : in_(in)
+        , tr_("utf8")
+    {}
+
+    void read_map(compiled_map& map)
+    {
+        map.base_path = in_.read_string();
+        if (in_.read_bool())
+            map.background = read_color();
+        if (in_.read_bool())
+            map.background_image = in_.read_string();
+        if (in_.read_bool())
+            map.background_image_comp_op = read_comp_op_value();
+        if (in_.read_bool())
+            map.background_image_opacity = static_cast<float>(in_.read_double());
+        if (in_.read_bool())
+            map.srs = in_.read_string();
+        if (in_.read_bool())
+            map.buffer_size = static_cast<int>(in_.read_i64());
+        if (in_.read_bool())
+            map.maximum_extent = read_box();
+        if (in_.read_bool())
+            map.font_directory = in_.read_string();
+        map.extra_parameters = read_parameters();
+
+        std::size_t fontsets = in_.read_size();
+        for (std::size_t i = 0; i < fontsets; ++i)
+        {
+            map.fontsets.push_back(read_font_set());
+        }
+        std::size_t styles = in_.read_size();
+        for (std::size_t i = 0; i < styles; ++i)
+        {
+            std::string name = in_.read_string();
+            map.styles.emplace_back(std::move(name), read_style());
+        }
+        std::size_t layers = in_.read_size();
+        for (std::size_t i = 0; i < layers; ++i)
+        {
+            map.layers.push_back(read_layer());
+        }
+    }
+
+  private:
+    layer read_layer()
+    {
+        std::string name = in_.read_string();
+        std::string srs = in_.read_string();
+        layer lyr(name, srs);
+        lyr.set_minimum_scale_denominator(in_.read_double());
+        lyr.set_maximum_scale_denominator(in_.read_double());
+        lyr.set_active(in_.read_bool());
+        lyr.set_queryable(in_.read_bool());
+        lyr.set_clear_label_cache(in_.read_bool());
+        lyr.set_cache_features(in_.read_bool());
+        lyr.set_group_by(in_.read_string());
+        std::size_t styles = in_.read_size();
+        for (std::size_t i = 0; i < styles; ++i)
+        {
+            lyr.add_style(in_.read_string());
+        }
+        if (in_.read_bool())
+            lyr.set_buffer_size(static_cast<int>(in_.read_i64()));
+        if (in_.read_bool())
+            lyr.set_maximum_extent(read_box());
+        if (in_.read_bool())
+            lyr.set_comp_op(read_comp_op_value());
+        lyr.set_opacity(in_.read_double());
+        if (in_.read_bool())
+        {
+            parameters params = read_parameters();
+            try
+            {
+                lyr.set_datasource(datasource_cache::instance().create(params));
+            }
+            catch (std::exception const& ex)
+            {
+                throw config_error(std::string(ex.what()) + " encountered during parsing of layer '" + name + "'");
+            }
+        }
+        std::size_t sublayers = in_.read_size();
+        for (std::size_t i = 0; i < sublayers; ++i)
+        {
+            lyr.add_layer(read_layer());
+        }
+        return lyr;
+    }
+
+    feature_type_style read_style()
+    {
+        feature_type_style style;
+        std::uint8_t filter_mode = in_.read_u8();
+        if (filter_mode > static_cast<std::uint8_t>(filter_mode_enum::FILTER_FIRST))
+        {
+            throw cache_error("invalid filter mode");
+        }
+        style.set_filter_mode(static_cast<filter_mode_enum>(filter_mode));
+        if (in_.read_bool())
+            style.set_comp_op(read_comp_op_value());
+        style.set_opacity(static_cast<float>(in_.read_double()));
+        style.set_image_filters_inflate(in_.read_bool());
+        read_filters(style.image_filters());
+        read_filters(style.direct_image_filters());
+        std::size_t rules = in_.read_size();
+        style.reserve(rules);
+        for (std::size_t i = 0; i < rules; ++i)
+        {
+            style.add_rule(read_rule());
+        }
+        return style;
+    }
+
+    rule read_rule()
+    {
+        rule r;
+        r.set_name(in_.read_string());
+        r.set_min_scale(in_.read_double());
+        r.set_max_scale(in_.read_double());
+        r.set_filter(read_expression());
+        r.set_else(in_.read_bool());
+        r.set_also(in_.read_bool());
+        std::size_t symbolizers = in_.read_size();
+        r.reserve(symbolizers);
+        for (std::size_t i = 0; i < symbolizers; ++i)
+        {
+            r.append(read_symbolizer());
+        }
+        return r;
+    }
+
+    symbolizer read_symbolizer()
+    {
+        // order of the symbolizer variant
+        switch (in_.read_u8())
+        {
+            case 0:
+                return read_properties<point_symbolizer>();
+            case 1:
+                return read_properties<line_symbolizer>();
+            case 2:
+                return read_properties<line_pattern_symbolizer>();
+            case 3:
+                return read_properties<polygon_symbolizer>();
+            case 4:
+                return read_properties<polygon_pattern_symbolizer>();
+            case 5:
+                return read_properties<raster_symbolizer>();
+            case 6:
+                return read_properties<shield_symbolizer>();
+            case 7:
+                return read_properties<text_symbolizer>();
+            case 8:
+                return read_properties<building_symbolizer>();
+            case 9:
+                return read_properties<markers_symbolizer>();
+            case 10:
+                return read_properties<group_symbolizer>();
+            case 11:
+                return read_properties<debug_symbolizer>();
+            case 12:
+                return read_properties<dot_symbolizer>();
+        }
+        throw cache_error("invalid symbolizer type");
+    }
+
+    template<typename Symbolizer>
+    Symbolizer read_properties()
+    {
+        Symbolizer sym;
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::uint32_t key = in_.read_u32();
+            if (key >= static_cast<std::uint32_t>(keys::MAX_SYMBOLIZER_KEY))
+            {
+                throw cache_error("invalid symbolizer property");
+            }
+            sym.properties.emplace(static_cast<keys>(key), read_value());
+        }
+        return sym;
+    }
+
+    symbolizer_base::value_type read_value()
+    {
+        // order of detail::value_base_type
+        switch (in_.read_u8())
+        {
+            case 0:
+                return in_.read_bool();
+            case 1:
+                return enumeration_wrapper(static_cast<int>(in_.read_i64()));
+            case 2:
+                return static_cast<value_integer>(in_.read_i64());
+            case 3:
+                return in_.read_double();
+            case 4:
+                return in_.read_string();
+            case 5:
+                return read_color();
+            case 6:
+                return read_expression();
+            case 7:
+                return read_path();
+            case 8:
+                return read_transform();
+            case 9:
+                return read_placements();
+            case 10:
+                return read_dash_array();
+            case 11:
+                return read_colorizer();
+            case 12:
+                return read_group_properties();
+            case 13:
+                return read_font_features();
+        }
+        throw cache_error("invalid property value");
+    }
+
+    boost::optional<symbolizer_base::value_type> read_optional_value()
+    {
+        if (in_.read_bool())
+            return read_value();
+        return boost::none;
+    }
+
+    color read_color()
+    {
+        std::uint8_t red = in_.read_u8();
+        std::uint8_t green = in_.read_u8();
+        std::uint8_t blue = in_.read_u8();
+        std::uint8_t alpha = in_.read_u8();
+        bool premultiplied = in_.read_bool();
+        return color(red, green, blue, alpha, premultiplied);
+    }
+
+    expression_ptr read_expression()
+    {
+        if (!in_.read_bool())
+            return expression_ptr();
+        return std::make_shared<expr_node>(read_expr());
+    }
+
+    template<typename Tag>
+    expr_node read_unary()
+    {
+        expr_node expr = read_expr();
+        return unary_node<Tag>(std::move(expr));
+    }
+
+    template<typename Tag>
+    expr_node read_binary()
+    {
+        expr_node left = read_expr();
+        expr_node right = read_expr();
+        return binary_node<Tag>(std::move(left), std::move(right));
+    }
+
+    expr_node read_expr()
+    {
+        // order of expr_node in expression_node_types.hpp
+        switch (in_.read_u8())
+        {
+            case 0:
+                return value_null();
+            case 1:
+                return value_bool(in_.read_bool());
+            case 2:
+                return static_cast<value_integer>(in_.read_i64());
+            case 3:
+                return in_.read_double();
+            case 4: {
+                std::string utf8 = in_.read_string();
+                return tr_.transcode(utf8.data(), static_cast<std::int32_t>(utf8.size()));
+            }
+            case 5:
+                return attribute(in_.read_string());
+            case 6:
+                return global_attribute(in_.read_string());
+            case 7:
+                return geometry_type_attribute();
+            case 8:
+                return read_unary<tags::negate>();
+            case 9:
+                return read_binary<tags::plus>();
+            case 10:
+                return read_binary<tags::minus>();
+            case 11:
+                return read_binary<tags::mult>();
+            case 12:
+                return read_binary<tags::div>();
+            case 13:
+                return read_binary<tags::mod>();
+            case 14:
+                return read_binary<tags::less>();
+            case 15:
+                return read_binary<tags::less_equal>();
+            case 16:
+                return read_binary<tags::greater>();
+            case 17:
+                return read_binary<tags::greater_equal>();
+            case 18:
+                return read_binary<tags::equal_to>();
+            case 19:
+                return read_binary<tags::not_equal_to>();
+            case 20:
+                return read_unary<tags::logical_not>();
+            case 21:
+                return read_binary<tags::logical_and>();
+            case 22:
+                return read_binary<tags::logical_or>();
+            case 23: {
+                expr_node expr = read_expr();
+                std::string pattern = in_.read_string();
+                return regex_match_node(tr_, expr, pattern);
+            }
+            case 24: {
+                expr_node expr = read_expr();
+                std::string pattern = in_.read_string();
+                std::string format = in_.read_string();
+                return regex_replace_node(tr_, expr, pattern, format);
+            }
+            case 25: {
+                unary_function_impl fun = unary_function_from_name(in_.read_string());
+                expr_node arg = read_expr();
+                return unary_function_call(fun, arg);
+            }
+            case 26: {
+                binary_function_impl fun = binary_function_from_name(in_.read_string());
+                expr_node arg1 = read_expr();
+                expr_node arg2 = read_expr();
+                return binary_function_call(fun, arg1, arg2);
+            }
+        }
+        throw cache_error("invalid expression");
+    }
+
+    path_expression_ptr read_path()
+    {
+        if (!in_.read_bool())
+            return path_expression_ptr();
+        auto path = std::make_shared<path_expression>();
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::uint8_t type = in_.read_u8();
+            std::string str = in_.read_string();
+            if (type == 0)
+                path->emplace_back(std::move(str));
+            else if (type == 1)
+                path->emplace_back(attribute(str));
+            else
+                throw cache_error("invalid path expression");
+        }
+        return path;
+    }
+
+    transform_type read_transform()
+    {
+        if (!in_.read_bool())
+            return transform_type();
+        auto transform = std::make_shared<transform_list>();
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            // order of detail::transform_variant
+            switch (in_.read_u8())
+            {
+                case 0:
+                    transform->emplace_back(identity_node());
+                    break;
+                case 1: {
+                    matrix_node node;
+                    node.a_ = read_expr();
+                    node.b_ = read_expr();
+                    node.c_ = read_expr();
+                    node.d_ = read_expr();
+                    node.e_ = read_expr();
+                    node.f_ = read_expr();
+                    transform->emplace_back(node);
+                    break;
+                }
+                case 2: {
+                    translate_node node;
+                    node.tx_ = read_expr();
+                    node.ty_ = read_expr();
+                    transform->emplace_back(node);
+                    break;
+                }
+                case 3: {
+                    scale_node node;
+                    node.sx_ = read_expr();
+                    node.sy_ = read_expr();
+                    transform->emplace_back(node);
+                    break;
+                }
+                case 4: {
+                    rotate_node node;
+                    node.angle_ = read_expr();
+                    node.cx_ = read_expr();
+                    node.cy_ = read_expr();
+                    transform->emplace_back(node);
+                    break;
+                }
+                case 5:
+                    transform->emplace_back(skewX_node(read_expr()));
+                    break;
+                case 6:
+                    transform->emplace_back(skewY_node(read_expr()));
+                    break;
+                default:
+                    throw cache_error("invalid transform");
+            }
+        }
+        return transform;
+    }
+
+    text_placements_ptr read_placements()
+    {
+        std::uint8_t type = in_.read_u8();
+        if (type == map_serializer::placement_none)
+            return text_placements_ptr();
+        text_symbolizer_properties defaults;
+        read_text_properties(defaults);
+        if (type == map_serializer::placement_dummy)
+        {
+            auto placements = std::make_shared<text_placements_dummy>();
+            placements->defaults = std::move(defaults);
+            return placements;
+        }
+        else if (type == map_serializer::placement_simple)
+        {
+            symbolizer_base::value_type positions = read_value();
+            std::vector<directions_e> directions;
+            std::size_t count = in_.read_size();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::uint8_t dir = in_.read_u8();
+                if (dir > CENTER)
+                    throw cache_error("invalid placement direction");
+                directions.push_back(static_cast<directions_e>(dir));
+            }
+            std::vector<int> text_sizes;
+            count = in_.read_size();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                text_sizes.push_back(static_cast<int>(in_.read_i64()));
+            }
+            auto placements =
+              std::make_shared<text_placements_simple>(positions, std::move(directions), std::move(text_sizes));
+            placements->defaults = std::move(defaults);
+            return placements;
+        }
+        else if (type == map_serializer::placement_list)
+        {
+            auto placements = std::make_shared<text_placements_list>();
+            placements->defaults = std::move(defaults);
+            std::size_t count = in_.read_size();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                read_text_properties(placements->add());
+            }
+            return placements;
+        }
+        throw cache_error("invalid text placements");
+    }
+
+    void read_text_properties(text_symbolizer_properties& props)
+    {
+        text_properties_expressions& exprs = props.expressions;
+        for (auto* val : {&exprs.label_placement,
+                          &exprs.label_spacing,
+                          &exprs.label_position_tolerance,
+                          &exprs.avoid_edges,
+                          &exprs.margin,
+                          &exprs.repeat_distance,
+                          &exprs.minimum_distance,
+                          &exprs.minimum_padding,
+                          &exprs.minimum_path_length,
+                          &exprs.max_char_angle_delta,
+                          &exprs.allow_overlap,
+                          &exprs.largest_bbox_only,
+                          &exprs.upright,
+                          &exprs.grid_cell_width,
+                          &exprs.grid_cell_height})
+        {
+            *val = read_value();
+        }
+        text_layout_properties& layout = props.layout_defaults;
+        for (auto* val : {&layout.dx,
+                          &layout.dy,
+                          &layout.orientation,
+                          &layout.text_ratio,
+                          &layout.wrap_width,
+                          &layout.wrap_char,
+                          &layout.wrap_before,
+                          &layout.repeat_wrap_char,
+                          &layout.rotate_displacement,
+                          &layout.halign,
+                          &layout.jalign,
+                          &layout.valign})
+        {
+            *val = read_value();
+        }
+        std::uint8_t dir = in_.read_u8();
+        if (dir > CENTER)
+            throw cache_error("invalid placement direction");
+        layout.dir = static_cast<directions_e>(dir);
+        format_properties& format = props.format_defaults;
+        format.face_name = in_.read_string();
+        format.fontset = boost::none;
+        if (in_.read_bool())
+            format.fontset = read_font_set();
+        for (auto* val : {&format.text_size,
+                          &format.character_spacing,
+                          &format.line_spacing,
+                          &format.text_opacity,
+                          &format.halo_opacity,
+                          &format.fill,
+                          &format.halo_fill,
+                          &format.halo_radius,
+                          &format.text_transform,
+                          &format.ff_settings})
+        {
+            *val = read_value();
+        }
+        props.set_format_tree(read_format_node());
+    }
+
+    formatting::node_ptr read_format_node()
+    {
+        switch (in_.read_u8())
+        {
+            case map_serializer::format_none:
+                return formatting::node_ptr();
+            case map_serializer::format_text:
+                return std::make_shared<formatting::text_node>(read_expression());
+            case map_serializer::format_format: {
+                auto node = std::make_shared<formatting::format_node>();
+                if (in_.read_bool())
+                    node->face_name = in_.read_string();
+                if (in_.read_bool())
+                    node->fontset = read_font_set();
+                for (auto* val : {&node->text_size,
+                                  &node->character_spacing,
+                                  &node->line_spacing,
+                                  &node->text_opacity,
+                                  &node->wrap_before,
+                                  &node->repeat_wrap_char,
+                                  &node->text_transform,
+                                  &node->fill,
+                                  &node->halo_fill,
+                                  &node->halo_radius,
+                                  &node->ff_settings})
+                {
+                    *val = read_optional_value();
+                }
+                node->set_child(read_format_node());
+                return node;
+            }
+            case map_serializer::format_layout: {
+                auto node = std::make_shared<formatting::layout_node>();
+                for (auto* val : {&node->dx,
+                                  &node->dy,
+                                  &node->halign,
+                                  &node->valign,
+                                  &node->jalign,
+                                  &node->text_ratio,
+                                  &node->wrap_width,
+                                  &node->wrap_char,
+                                  &node->wrap_before,
+                                  &node->repeat_wrap_char,
+                                  &node->rotate_displacement,
+                                  &node->orientation})
+                {
+                    *val = read_optional_value();
+                }
+                node->set_child(read_format_node());
+                return node;
+            }
+            case map_serializer::format_list: {
+                auto node = std::make_shared<formatting::list_node>();
+                std::size_t count = in_.read_size();
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    node->push_back(read_format_node());
+                }
+                return node;
+            }
+        }
+        throw cache_error("invalid text formatting");
+    }
+
+    dash_array read_dash_array()
+    {
+        dash_array dashes;
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            double dash = in_.read_double();
+            double gap = in_.read_double();
+            dashes.emplace_back(dash, gap);
+        }
+        return dashes;
+    }
+
+    raster_colorizer_ptr read_colorizer()
+    {
+        if (!in_.read_bool())
+            return raster_colorizer_ptr();
+        auto colorizer = std::make_shared<raster_colorizer>();
+        colorizer->set_default_mode_enum(read_colorizer_mode());
+        colorizer->set_default_color(read_color());
+        colorizer->set_epsilon(static_cast<float>(in_.read_double()));
+        colorizer_stops stops;
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            float value = static_cast<float>(in_.read_double());
+            colorizer_mode_enum mode = read_colorizer_mode();
+            color c = read_color();
+            std::string label = in_.read_string();
+            stops.emplace_back(value, mode, c, label);
+        }
+        colorizer->set_stops(stops);
+        return colorizer;
+    }
+
+    colorizer_mode_enum read_colorizer_mode()
+    {
+        std::uint8_t mode = in_.read_u8();
+        if (mode >= static_cast<std::uint8_t>(colorizer_mode_enum::colorizer_mode_enum_MAX))
+            throw cache_error("invalid colorizer mode");
+        return static_cast<colorizer_mode_enum>(mode);
+    }
+
+    group_symbolizer_properties_ptr read_group_properties()
+    {
+        if (!in_.read_bool())
+            return group_symbolizer_properties_ptr();
+        auto group = std::make_shared<group_symbolizer_properties>();
+        // order of group_layout
+        std::uint8_t type = in_.read_u8();
+        if (type == 0)
+        {
+            group_layout layout = simple_row_layout(in_.read_double());
+            group->set_layout(std::move(layout));
+        }
+        else if (type == 1)
+        {
+            double item_margin = in_.read_double();
+            double max_difference = in_.read_double();
+            group_layout layout = pair_layout(item_margin, max_difference);
+            group->set_layout(std::move(layout));
+        }
+        else
+        {
+            throw cache_error("invalid group layout");
+        }
+        std::size_t rules = in_.read_size();
+        for (std::size_t i = 0; i < rules; ++i)
+        {
+            expression_ptr filter = read_expression();
+            expression_ptr repeat_key = read_expression();
+            auto r = std::make_shared<group_rule>(filter, repeat_key);
+            std::size_t symbolizers = in_.read_size();
+            for (std::size_t j = 0; j < symbolizers; ++j)
+            {
+                r->append(read_symbolizer());
+            }
+            group->add_rule(r);
+        }
+        return group;
+    }
+
+    font_feature_settings read_font_features()
+    {
+        font_feature_settings settings;
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            font_feature_settings::font_feature feature;
+            feature.tag = in_.read_u32();
+            feature.value = in_.read_u32();
+            feature.start = in_.read_u32();
+            feature.end = in_.read_u32();
+            settings.append(feature);
+        }
+        return settings;
+    }
+
+    void read_filters(std::vector<filter::filter_type>& filters)
+    {
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            // order of filter::filter_type
+            switch (in_.read_u8())
+            {
+                case 0:
+                    filters.emplace_back(filter::blur());
+                    break;
+                case 1:
+                    filters.emplace_back(filter::gray());
+                    break;
+                case 2: {
+                    unsigned rx = in_.read_u32();
+                    unsigned ry = in_.read_u32();
+                    filters.emplace_back(filter::agg_stack_blur(rx, ry));
+                    break;
+                }
+                case 3:
+                    filters.emplace_back(filter::emboss());
+                    break;
+                case 4:
+                    filters.emplace_back(filter::sharpen());
+                    break;
+                case 5:
+                    filters.emplace_back(filter::edge_detect());
+                    break;
+                case 6:
+                    filters.emplace_back(filter::sobel());
+                    break;
+                case 7:
+                    filters.emplace_back(filter::x_gradient());
+                    break;
+                case 8:
+                    filters.emplace_back(filter::y_gradient());
+                    break;
+                case 9:
+                    filters.emplace_back(filter::invert());
+                    break;
+                case 10: {
+                    double v[8];
+                    for (double& val : v)
+                        val = in_.read_double();
+                    filters.emplace_back(filter::scale_hsla(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]));
+                    break;
+                }
+                case 11: {
+                    filter::colorize_alpha stops;
+                    std::size_t size = in_.read_size();
+                    for (std::size_t j = 0; j < size; ++j)
+                    {
+                        color c = read_color();
+                        stops.emplace_back(c, in_.read_double());
+                    }
+                    filters.emplace_back(std::move(stops));
+                    break;
+                }
+                case 12:
+                    filters.emplace_back(filter::color_to_alpha(read_color()));
+                    break;
+                case 13:
+                    filters.emplace_back(filter::color_blind_protanope());
+                    break;
+                case 14:
+                    filters.emplace_back(filter::color_blind_deuteranope());
+                    break;
+                case 15:
+                    filters.emplace_back(filter::color_blind_tritanope());
+                    break;
+                default:
+                    throw cache_error("invalid image filter");
+            }
+        }
+    }
+
+    font_set read_font_set()
+    {
+        font_set fontset(in_.read_string());
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            fontset.add_face_name(in_.read_string());
+        }
+        return fontset;
+    }
+
+    parameters read_parameters()
+    {
+        parameters params;
+        std::size_t count = in_.read_size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::string key = in_.read_string();
+            // order of value_holder_base
+            switch (in_.read_u8())
+            {
+                case 0:
+                    params[key] = value_null();
+                    break;
+                case 1:
+                    params[key] = static_cast<value_integer>(in_.read_i64());
+                    break;
+                case 2:
+                    params[key] = in_.read_double();
+                    break;
+                case 3:
+                    params[key] = in_.read_string();
+                    break;
+                case 4:
+                    params[key] = value_bool(in_.read_bool());
+                    break;
+                default:
+                    throw cache_error("invalid parameter");
+            }
+        }
+        return params;
+    }
+
+    box2d<double> read_box()
+    {
+        double minx = in_.read_double();
+        double miny = in_.read_double();
+        double maxx = in_.read_double();
+        double maxy = in_.read_double();
+        return box2d<double>(minx, miny, maxx, maxy);
+    }
+
+    composite_mode_e read_comp_op_value()
+    {
+        std::uint32_t comp_op = in_.read_u32();
+        if (comp_op > static_cast<std::uint32_t>(divide))
+            throw cache_error("invalid composite mode");
+        return static_cast<composite_mode_e>(comp_op);
+    }
+
+    cache_reader& in_;
+    transcoder tr_;
+};
+
+std::string read_file(std::string const& filename)
+{
+#ifdef _WIN32
+    std::ifstream file(mapnik::utf8_to_utf16(filename), std::ios::binary);
+#else
+    std::ifstream file(filename, std::ios::binary);
+#endif
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void apply_compiled_map(Map& map, compiled_map& compiled, bool strict)
+{
+    map.set_base_path(compiled.base_path);
+    if (compiled.background)
+        map.set_background(*compiled.background);
+    if (compiled.background_image)
+        map.set_background_image(*compiled.background_image);
+    if (compiled.background_image_comp_op)
+        map.set_background_image_comp_op(*compiled.background_image_comp_op);
+    if (compiled.background_image_opacity)
+        map.set_background_image_opacity(*compiled.background_image_opacity);
+    if (compiled.srs)
+        map.set_srs(*compiled.srs);
+    if (compiled.buffer_size)
+        map.set_buffer_size(*compiled.buffer_size);
+    if (compiled.maximum_extent)
+        map.set_maximum_extent(*compiled.maximum_extent);
+    if (compiled.font_directory)
+    {
+        std::string const& font_directory = *compiled.font_directory;
+        map.set_font_directory(font_directory);
+        std::string path = font_directory;
+        if (!compiled.base_path.empty() && util::is_relative(path))
+        {
+            path = util::make_absolute(path, compiled.base_path);
+        }
+        if (!map.register_fonts(path, false) && strict)
+        {
+            throw config_error(std::string("Failed to load fonts from: ") + font_directory);
+        }
+    }
+    parameters& params = map.get_extra_parameters();
+    for (auto& param : compiled.extra_parameters)
+    {
+        params[param.first] = std::move(param.second);
+    }
+    for (auto& fontset : compiled.fontsets)
+    {
+        std::string name = fontset.get_name();
+        map.insert_fontset(name, std::move(fontset));
+    }
+    for (auto& style : compiled.styles)
+    {
+        if (!map.insert_style(style.first, std::move(style.second)))
+        {
+            if (strict)
+            {
+                throw config_error("duplicate style name");
+            }
+            MAPNIK_LOG_ERROR(load_map) << "map_parser: failed to insert style '" << style.first
+                                       << "' to the map since it was already added";
+        }
+    }
+    for (auto& lyr : compiled.layers)
+    {
+        map.add_layer(std::move(lyr));
+    }
+}
+
+} // namespace
+
+void write_map_cache(Map const& map, map_cache_source const& source, std::string const& cache_filename)
+{
+    std::string buffer(map_cache_magic, sizeof(map_cache_magic));
+    cache_writer header(buffer);
+    header.write_u32(map_cache_format);
+    header.write_u32(MAPNIK_VERSION);
+    header.write_u32(static_cast<std::uint32_t>(keys::MAX_SYMBOLIZER_KEY));
+    header.write_string(source.filename);
+    header.write_string(source.base_path);
+    header.write_bool(source.strict);
+    header.write_size(source.dependencies.size());
+    for (auto const& dependency : source.dependencies)
+    {
+        header.write_string(dependency);
+        header.write_u64(util::file_size(dependency));
+        header.write_i64(util::last_write_time(dependency));
+    }
+    map_serializer serializer(buffer);
+    serializer.write_map(map, source);
+#ifdef _WIN32
+    std::ofstream file(mapnik::utf8_to_utf16(cache_filename), std::ios::binary | std::ios::trunc);
+#else
+    std::ofstream file(cache_filename, std::ios::binary | std::ios::trunc);
+#endif
+    if (!file)
+    {
+        throw config_error("Could not write map cache file", 0, cache_filename);
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+bool read_map_cache(Map& map, map_cache_source const& source, std::string const& cache_filename)
+{
+    if (!util::exists(cache_filename))
+    {
+        MAPNIK_LOG_DEBUG(map_cache) << "map_cache: '" << cache_filename << "' does not exist";
+        return false;
+    }
+    std::string const buffer = read_file(cache_filename);
+    if (buffer.size() < sizeof(map_cache_magic) ||
+        buffer.compare(0, sizeof(map_cache_magic), map_cache_magic, sizeof(map_cache_magic)) != 0)
+    {
+        MAPNIK_LOG_WARN(map_cache) << "map_cache: ignoring '" << cache_filename << "': not a map cache file";
+        return false;
+    }
+    cache_reader reader(buffer.data() + sizeof(map_cache_magic), buffer.data() + buffer.size());
+    compiled_map compiled;
+    try
+    {
+        if (reader.read_u32() != map_cache_format || reader.read_u32() != MAPNIK_VERSION ||
+            reader.read_u32() != static_cast<std::uint32_t>(keys::MAX_SYMBOLIZER_KEY))
+        {
+            MAPNIK_LOG_DEBUG(map_cache) << "map_cache: ignoring '" << cache_filename
+                                        << "': written by another mapnik version";
+            return false;
+        }
+        std::string filename = reader.read_string();
+        std::string base_path = reader.read_string();
+        bool strict = reader.read_bool();
+        if (filename != source.filename || base_path != source.base_path || strict != source.strict)
+        {
+            MAPNIK_LOG_DEBUG(map_cache) << "map_cache: ignoring '" << cache_filename << "': compiled from '"
+                                        << filename << "' with other load options";
+            return false;
+        }
+        std::size_t dependencies = reader.read_size();
+        for (std::size_t i = 0; i < dependencies; ++i)
+        {
+            std::string dependency = reader.read_string();
+            std::uint64_t size = reader.read_u64();
+            std::int64_t stamp = reader.read_i64();
+            if (!util::exists(dependency) || util::file_size(dependency) != size ||
+                util::last_write_time(dependency) != stamp)
+            {
+                MAPNIK_LOG_DEBUG(map_cache) << "map_cache: ignoring '" << cache_filename << "': '" << dependency
+                                            << "' has changed";
+                return false;
+            }
+        }
+        map_deserializer deserializer(reader);
+        deserializer.read_map(compiled);
+        if (!reader.at_end())
+        {
+            throw cache_error("trailing data");
+        }
+    }
+    catch (cache_error const& ex)
+    {
+        MAPNIK_LOG_WARN(map_cache) << "map_cache: ignoring '" << cache_filename << "': " << ex.what();
+        return false;
+    }
+    apply_compiled_map(map, compiled, source.strict);
+    return true;
+}
+
+} // namespace mapnik
@@ -35,61 +35,187 @@ MAPNIK_DISABLE_WARNING_PUSH
 #include <boost/interprocess/file_mapping.hpp>
 MAPNIK_DISABLE_WARNING_POP
 
+// stl
+#include <algorithm>
+#include <functional>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace mapnik {
 
 template class singleton<mapped_memory_cache, CreateStatic>;
 
+namespace {
+
+// Per-thread view of the cache entries looked up on this thread. It doesn't
+// own them, so a region is unmapped as soon as the shared cache drops it.
+struct local_region_cache
+{
+    std::size_t generation = 0;
+    std::unordered_map<std::string, std::weak_ptr<detail::mapped_region_entry>> entries;
+};
+
+local_region_cache& local_cache(std::size_t generation)
+{
+    thread_local static local_region_cache cache;
+    if (cache.generation != generation)
+    {
+        cache.entries.clear();
+        cache.generation = generation;
+    }
+    return cache;
+}
+
+mapped_region_ptr map_file(std::string const& uri, mapped_access access)
+{
+    using boost::interprocess::mapped_region;
+    boost::interprocess::file_mapping mapping(uri.c_str(), boost::interprocess::read_only);
+#if defined(MAP_POPULATE)
+    if (access == mapped_access::populate)
+    {
+        return std::make_shared<mapped_region>(mapping, boost::interprocess::read_only, 0, 0, nullptr, MAP_POPULATE);
+    }
+#endif
+    mapped_region_ptr region = std::make_shared<mapped_region>(mapping, boost::interprocess::read_only);
+    switch (access)
+    {
+        case mapped_access::sequential:
+            region->advise(mapped_region::advice_sequential);
+            break;
+        case mapped_access::random:
+            region->advise(mapped_region::advice_random);
+            break;
+        case mapped_access::willneed:
+        case mapped_access::populate:
+            region->advise(mapped_region::advice_willneed);
+            break;
+        case mapped_access::normal:
+            break;
+    }
+    return region;
+}
+
+std::size_t resident_bytes(boost::interprocess::mapped_region const& region)
+{
+#if defined(__linux__)
+    std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t size = region.get_size();
+    std::vector<unsigned char> pages((size + page_size - 1) / page_size);
+    if (pages.empty() || ::mincore(region.get_address(), size, pages.data()) != 0)
+    {
+        return 0;
+    }
+    std::size_t resident = 0;
+    for (unsigned char page : pages)
+    {
+        if (page & 1)
+            resident += page_size;
+    }
+    return std::min(resident, size);
+#else
+    (void)region;
+    return 0;
+#endif
+}
+
+} // namespace
+
+mapped_memory_cache::shard& mapped_memory_cache::shard_for(std::string const& key)
+{
+    return shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
 void mapped_memory_cache::clear()
 {
+    for (auto& s : shards_)
+    {
 #ifdef MAPNIK_THREADSAFE
-    std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(s.mutex);
 #endif
-    return cache_.clear();
+        s.entries.clear();
+    }
+    generation_.fetch_add(1, std::memory_order_acq_rel);
 }
 
 bool mapped_memory_cache::insert(std::string const& uri, mapped_region_ptr mem)
 {
+    shard& s = shard_for(uri);
 #ifdef MAPNIK_THREADSAFE
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(s.mutex);
 #endif
-    return cache_.emplace(uri, mem).second;
+    return s.entries.emplace(uri, std::make_shared<detail::mapped_region_entry>(mem)).second;
 }
 
 bool mapped_memory_cache::remove(std::string const& key)
 {
+    bool removed = false;
+    {
+        shard& s = shard_for(key);
 #ifdef MAPNIK_THREADSAFE
-    std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(s.mutex);
 #endif
-    return cache_.erase(key) > 0;
+        removed = s.entries.erase(key) > 0;
+    }
+    if (removed)
+    {
+        generation_.fetch_add(1, std::memory_order_acq_rel);
+    }
+    return removed;
 }
 
-boost::optional<mapped_region_ptr> mapped_memory_cache::find(std::string const& uri, bool update_cache)
+boost::optional<mapped_region_ptr>
+  mapped_memory_cache::find(std::string const& uri, bool update_cache, mapped_access access)
 {
-#ifdef MAPNIK_THREADSAFE
-    std::lock_guard<std::mutex> lock(mutex_);
-#endif
-
-    using iterator_type = std::unordered_map<std::string, mapped_region_ptr>::const_iterator;
     boost::optional<mapped_region_ptr> result;
-    iterator_type itr = cache_.find(uri);
-    if (itr != cache_.end())
+    local_region_cache& local = local_cache(generation_.load(std::memory_order_acquire));
+    auto local_itr = local.entries.find(uri);
+    if (local_itr != local.entries.end())
+    {
+        if (entry_ptr e = local_itr->second.lock())
+        {
+            e->hits.fetch_add(1, std::memory_order_relaxed);
+            result.reset(e->region);
+            return result;
+        }
+        local.entries.erase(local_itr);
+    }
+
+    shard& s = shard_for(uri);
     {
-        result.reset(itr->second);
-        return result;
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+        auto itr = s.entries.find(uri);
+        if (itr != s.entries.end())
+        {
+            itr->second->hits.fetch_add(1, std::memory_order_relaxed);
+            local.entries[uri] = itr->second;
+            result.reset(itr->second->region);
+            return result;
+        }
     }
 
     if (mapnik::util::exists(uri))
     {
         try
         {
-            boost::interprocess::file_mapping mapping(uri.c_str(), boost::interprocess::read_only);
-            mapped_region_ptr region(
-              std::make_shared<boost::interprocess::mapped_region>(mapping, boost::interprocess::read_only));
-            result.reset(region);
+            // map without holding the shard lock, if another thread cached
+            // the same file meanwhile its mapping wins
+            mapped_region_ptr region = map_file(uri, access);
             if (update_cache)
             {
-                cache_.emplace(uri, *result);
+#ifdef MAPNIK_THREADSAFE
+                std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+                auto emplace_result = s.entries.emplace(uri, std::make_shared<detail::mapped_region_entry>(region));
+                emplace_result.first->second->hits.fetch_add(1, std::memory_order_relaxed);
+                local.entries[uri] = emplace_result.first->second;
+                region = emplace_result.first->second->region;
             }
+            result.reset(region);
             return result;
         }
         catch (std::exception const& ex)
@@ -107,6 +233,26 @@ boost::optional<mapped_region_ptr> mapped_memory_cache::find(std::string const&
     return result;
 }
 
+std::vector<mapped_region_stats> mapped_memory_cache::stats() const
+{
+    std::vector<mapped_region_stats> result;
+    for (auto const& s : shards_)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+        for (auto const& kv : s.entries)
+        {
+            boost::interprocess::mapped_region const& region = *kv.second->region;
+            result.push_back(mapped_region_stats{kv.first,
+                                                 region.get_size(),
+                                                 resident_bytes(region),
+                                                 kv.second->hits.load(std::memory_order_relaxed)});
+        }
+    }
+    return result;
+}
+
 } // namespace mapnik
 
 #endif
@@ -29,6 +29,7 @@
 #include <mapnik/svg/svg_converter.hpp>
 #include <mapnik/svg/svg_path_adapter.hpp>
 #include <mapnik/svg/svg_path_attributes.hpp>
+#include <mapnik/svg/svg_flattened_path.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_reader.hpp>
 #include <mapnik/util/fs.hpp>
@@ -49,8 +50,34 @@ MAPNIK_DISABLE_WARNING_POP
 
 namespace mapnik {
 
+namespace {
+
+// Per-thread copy of the entries a thread has looked up. Once the shared
+// cache is warm every hit is answered here without taking the mutex.
+struct local_marker_cache
+{
+    std::size_t generation = 0;
+    std::unordered_map<std::string, std::shared_ptr<marker const>> markers;
+    std::map<std::pair<svg_storage_type const*, int>, std::shared_ptr<svg::svg_flattened_path const>> flattened;
+};
+
+local_marker_cache& local_cache(std::size_t generation)
+{
+    thread_local static local_marker_cache cache;
+    if (cache.generation != generation)
+    {
+        cache.markers.clear();
+        cache.flattened.clear();
+        cache.generation = generation;
+    }
+    return cache;
+}
+
+} // namespace
+
 marker_cache::marker_cache()
-    : known_svg_prefix_("shape://")
+    : generation_(1)
+    , known_svg_prefix_("shape://")
     , known_image_prefix_("image://")
 {
     insert_svg("ellipse",
@@ -74,11 +101,16 @@ void marker_cache::clear()
 #ifdef MAPNIK_THREADSAFE
     std::lock_guard<std::mutex> lock(mutex_);
 #endif
+    generation_.fetch_add(1, std::memory_order_release);
     auto itr = marker_cache_.begin();
     while (itr != marker_cache_.end())
     {
         if (!is_uri(itr->first))
         {
+            if (itr->second->is<marker_svg>())
+            {
+                flattened_cache_.erase(util::get<marker_svg>(*itr->second).get_data().get());
+            }
             marker_cache_.erase(itr++);
         }
         else
@@ -145,15 +177,50 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
         return std::make_shared<mapnik::marker const>(mapnik::marker_null());
     }
 
+    local_marker_cache& local = local_cache(generation_.load(std::memory_order_acquire));
+    auto local_itr = local.markers.find(uri);
+    if (local_itr != local.markers.end())
+    {
+        return local_itr->second;
+    }
+
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = marker_cache_.find(uri);
+        if (itr != marker_cache_.end())
+        {
+            local.markers.emplace(uri, itr->second);
+            return itr->second;
+        }
+    }
+
+    // parse/decode without holding the lock; if another thread cached the
+    // same uri meanwhile its marker wins
+    std::shared_ptr<mapnik::marker const> mark = load(uri, strict);
+    if (!mark)
+    {
+        return std::make_shared<mapnik::marker const>(mapnik::marker_null());
+    }
+    if (!update_cache)
+    {
+        return mark;
+    }
 #ifdef MAPNIK_THREADSAFE
     std::lock_guard<std::mutex> lock(mutex_);
 #endif
-    auto itr = marker_cache_.find(uri);
-    if (itr != marker_cache_.end())
+    auto emplace_result = marker_cache_.emplace(uri, mark);
+    if (emplace_result.second && mark->is<marker_svg>())
     {
-        return itr->second;
+        flattened_cache_.emplace(util::get<marker_svg>(*mark).get_data().get(), flattened_buckets());
     }
+    local.markers.emplace(uri, emplace_result.first->second);
+    return emplace_result.first->second;
+}
 
+std::shared_ptr<mapnik::marker const> marker_cache::load(std::string const& uri, bool strict)
+{
     try
     {
         // if uri references a built-in marker
@@ -163,7 +230,7 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
             if (mark_itr == svg_cache_.end())
             {
                 MAPNIK_LOG_ERROR(marker_cache) << "Marker does not exist: " << uri;
-                return std::make_shared<mapnik::marker const>(mapnik::marker_null());
+                return nullptr;
             }
             std::string known_svg_string = mark_itr->second;
             using namespace mapnik::svg;
@@ -186,16 +253,7 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
             svg.bounding_rect(&lox, &loy, &hix, &hiy);
             marker_path->set_bounding_box(lox, loy, hix, hiy);
             marker_path->set_dimensions(svg.width(), svg.height());
-            if (update_cache)
-            {
-                auto emplace_result =
-                  marker_cache_.emplace(uri, std::make_shared<mapnik::marker const>(mapnik::marker_svg(marker_path)));
-                return emplace_result.first->second;
-            }
-            else
-            {
-                return std::make_shared<mapnik::marker const>(mapnik::marker_svg(marker_path));
-            }
+            return std::make_shared<mapnik::marker const>(mapnik::marker_svg(marker_path));
         }
         // otherwise assume file-based
         else
@@ -203,7 +261,7 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
             if (!mapnik::util::exists(uri))
             {
                 MAPNIK_LOG_ERROR(marker_cache) << "Marker does not exist: " << uri;
-                return std::make_shared<mapnik::marker const>(mapnik::marker_null());
+                return nullptr;
             }
             if (is_svg(uri))
             {
@@ -227,17 +285,7 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
                 svg.bounding_rect(&lox, &loy, &hix, &hiy);
                 marker_path->set_bounding_box(lox, loy, hix, hiy);
                 marker_path->set_dimensions(svg.width(), svg.height());
-                if (update_cache)
-                {
-                    auto emplace_result =
-                      marker_cache_.emplace(uri,
-                                            std::make_shared<mapnik::marker const>(mapnik::marker_svg(marker_path)));
-                    return emplace_result.first->second;
-                }
-                else
-                {
-                    return std::make_shared<mapnik::marker const>(mapnik::marker_svg(marker_path));
-                }
+                return std::make_shared<mapnik::marker const>(mapnik::marker_svg(marker_path));
             }
             else
             {
@@ -249,24 +297,13 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
                     unsigned height = reader->height();
                     BOOST_ASSERT(width > 0 && height > 0);
                     image_any im = reader->read(0, 0, width, height);
-                    if (update_cache)
-                    {
-                        auto emplace_result =
-                          marker_cache_.emplace(uri,
-                                                std::make_shared<mapnik::marker const>(
-                                                  util::apply_visitor(detail::visitor_create_marker(), im)));
-                        return emplace_result.first->second;
-                    }
-                    else
-                    {
-                        return std::make_shared<mapnik::marker const>(
-                          util::apply_visitor(detail::visitor_create_marker(), im));
-                    }
+                    return std::make_shared<mapnik::marker const>(
+                      util::apply_visitor(detail::visitor_create_marker(), im));
                 }
                 else
                 {
                     MAPNIK_LOG_ERROR(marker_cache) << "could not initialize reader for: '" << uri << "'";
-                    return std::make_shared<mapnik::marker const>(mapnik::marker_null());
+                    return nullptr;
                 }
             }
         }
@@ -275,7 +312,52 @@ std::shared_ptr<mapnik::marker const> marker_cache::find(std::string const& uri,
     {
         MAPNIK_LOG_ERROR(marker_cache) << "Exception caught while loading: '" << uri << "' (" << ex.what() << ")";
     }
-    return std::make_shared<mapnik::marker const>(mapnik::marker_null());
+    return nullptr;
+}
+
+std::shared_ptr<svg::svg_flattened_path const> marker_cache::find_flattened(svg_path_ptr const& path, double scale)
+{
+    if (!path)
+        return nullptr;
+    int bucket = svg::svg_flattened_path::bucket(scale);
+    local_marker_cache& local = local_cache(generation_.load(std::memory_order_acquire));
+    auto key = std::make_pair(static_cast<svg_storage_type const*>(path.get()), bucket);
+    auto local_itr = local.flattened.find(key);
+    if (local_itr != local.flattened.end())
+    {
+        return local_itr->second;
+    }
+
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = flattened_cache_.find(path.get());
+        if (itr == flattened_cache_.end())
+        {
+            return nullptr;
+        }
+        auto bucket_itr = itr->second.find(bucket);
+        if (bucket_itr != itr->second.end())
+        {
+            local.flattened.emplace(key, bucket_itr->second);
+            return bucket_itr->second;
+        }
+    }
+
+    auto flattened = std::make_shared<svg::svg_flattened_path const>(*path, bucket);
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto itr = flattened_cache_.find(path.get());
+    if (itr == flattened_cache_.end())
+    {
+        // evicted by clear() while flattening
+        return flattened;
+    }
+    auto bucket_itr = itr->second.emplace(bucket, flattened).first;
+    local.flattened.emplace(key, bucket_itr->second);
+    return bucket_itr->second;
 }
 
 } // namespace mapnik
@@ -28,9 +28,20 @@
 #include <mapnik/memory_featureset.hpp>
 #include <mapnik/boolean.hpp>
 #include <mapnik/geometry/envelope.hpp>
+#include <mapnik/geometry/boost_adapters.hpp>
+#include <mapnik/raster.hpp>
+
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore.hpp>
+#include <boost/geometry/strategies/cartesian/disjoint_box_box.hpp>
+#include <boost/geometry/index/rtree.hpp>
+MAPNIK_DISABLE_WARNING_POP
 
 // stl
 #include <algorithm>
+#include <iterator>
+#include <vector>
 
 using mapnik::datasource;
 using mapnik::parameters;
@@ -43,6 +54,33 @@ DATASOURCE_PLUGIN_IMPL(memory_datasource_plugin, memory_datasource);
 DATASOURCE_PLUGIN_EMPTY_AFTER_LOAD(memory_datasource_plugin);
 DATASOURCE_PLUGIN_EMPTY_BEFORE_UNLOAD(memory_datasource_plugin);
 
+struct memory_datasource::spatial_index
+{
+    using item_type = std::pair<box2d<double>, std::size_t>;
+    using tree_type = boost::geometry::index::rtree<item_type, boost::geometry::index::rstar<16, 4>>;
+
+    template<typename Range>
+    explicit spatial_index(Range const& items)
+        : tree(items.begin(), items.end()) // packing algorithm
+    {}
+
+    tree_type tree;
+};
+
+namespace {
+
+box2d<double> feature_envelope(feature_ptr const& feature)
+{
+    raster_ptr const& source = feature->get_raster();
+    if (source)
+    {
+        return source->ext_;
+    }
+    return geometry::envelope(feature->get_geometry());
+}
+
+} // namespace
+
 struct accumulate_extent
 {
     accumulate_extent(box2d<double>& ext)
@@ -82,7 +120,7 @@ memory_datasource::memory_datasource(parameters const& _params)
     , type_set_(false)
 {}
 
-memory_datasource::~memory_datasource() {}
+memory_datasource::~memory_datasource() = default;
 
 void memory_datasource::push(feature_ptr feature)
 {
@@ -114,6 +152,15 @@ void memory_datasource::push(feature_ptr feature)
     }
     features_.push_back(feature);
     dirty_extent_ = true;
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (index_)
+    {
+        box2d<double> box = feature_envelope(feature);
+        if (box.valid())
+        {
+            index_->tree.insert(std::make_pair(box, features_.size() - 1));
+        }
+    }
 }
 
 datasource::datasource_t memory_datasource::type() const
@@ -127,7 +174,11 @@ featureset_ptr memory_datasource::features(const query& q) const
     {
         return mapnik::make_invalid_featureset();
     }
-    return std::make_shared<memory_featureset>(q.get_bbox(), *this, bbox_check_);
+    if (!bbox_check_)
+    {
+        return std::make_shared<memory_featureset>(q.get_bbox(), *this, false);
+    }
+    return query_index(q.get_bbox());
 }
 
 featureset_ptr memory_datasource::features_at_point(coord2d const& pt, double tol) const
@@ -139,7 +190,40 @@ featureset_ptr memory_datasource::features_at_point(coord2d const& pt, double to
     box2d<double> box = box2d<double>(pt.x, pt.y, pt.x, pt.y);
     box.pad(tol);
     MAPNIK_LOG_DEBUG(memory_datasource) << "memory_datasource: Box=" << box << ", Point x=" << pt.x << ",y=" << pt.y;
-    return std::make_shared<memory_featureset>(box, *this);
+    return query_index(box);
+}
+
+featureset_ptr memory_datasource::query_index(box2d<double> const& box) const
+{
+    std::vector<spatial_index::item_type> hits;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (!index_)
+        {
+            std::vector<spatial_index::item_type> items;
+            items.reserve(features_.size());
+            for (std::size_t i = 0; i < features_.size(); ++i)
+            {
+                box2d<double> item_box = feature_envelope(features_[i]);
+                // features without an envelope never intersect a query
+                if (item_box.valid())
+                {
+                    items.emplace_back(item_box, i);
+                }
+            }
+            index_ = std::make_unique<spatial_index>(items);
+        }
+        index_->tree.query(boost::geometry::index::intersects(box), std::back_inserter(hits));
+    }
+    // keep features in the order they were pushed
+    std::vector<std::size_t> ids;
+    ids.reserve(hits.size());
+    for (auto const& item : hits)
+    {
+        ids.push_back(item.second);
+    }
+    std::sort(ids.begin(), ids.end());
+    return std::make_shared<memory_index_featureset>(*this, std::move(ids));
 }
 
 void memory_datasource::set_envelope(box2d<double> const& box)
@@ -178,6 +262,9 @@ size_t memory_datasource::size() const
 void memory_datasource::clear()
 {
     features_.clear();
+    dirty_extent_ = true;
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index_.reset();
 }
 
 } // namespace mapnik
@@ -0,0 +1,230 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/mvt/mvt_encoder.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/value.hpp>
+
+// protozero
+#include <protozero/pbf_writer.hpp>
+
+namespace mapnik {
+namespace mvt {
+
+namespace {
+
+struct value_encoder
+{
+    explicit value_encoder(protozero::pbf_writer& writer)
+        : writer_(writer)
+    {}
+
+    bool operator()(value_null const&) const { return false; }
+
+    bool operator()(value_bool val) const
+    {
+        writer_.add_bool(VALUE_BOOL, val);
+        return true;
+    }
+
+    bool operator()(value_integer val) const
+    {
+        if (val >= 0)
+            writer_.add_uint64(VALUE_UINT, static_cast<std::uint64_t>(val));
+        else
+            writer_.add_sint64(VALUE_SINT, val);
+        return true;
+    }
+
+    bool operator()(value_double val) const
+    {
+        writer_.add_double(VALUE_DOUBLE, val);
+        return true;
+    }
+
+    bool operator()(value_unicode_string const& val) const
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        writer_.add_string(VALUE_STRING, utf8);
+        return true;
+    }
+
+    protozero::pbf_writer& writer_;
+};
+
+} // namespace
+
+void geometry_encoder::clear()
+{
+    commands_.clear();
+    x_ = 0;
+    y_ = 0;
+}
+
+void geometry_encoder::add_vertices(tile_path const& path, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (i == 1)
+        {
+            commands_.push_back(command_integer(CMD_LINE_TO, static_cast<std::uint32_t>(count - 1)));
+        }
+        tile_point const& pt = path[i];
+        commands_.push_back(zigzag_encode(pt.x - x_));
+        commands_.push_back(zigzag_encode(pt.y - y_));
+        x_ = pt.x;
+        y_ = pt.y;
+    }
+}
+
+void geometry_encoder::add_points(tile_path const& points)
+{
+    if (points.empty())
+        return;
+    commands_.push_back(command_integer(CMD_MOVE_TO, static_cast<std::uint32_t>(points.size())));
+    for (auto const& pt : points)
+    {
+        commands_.push_back(zigzag_encode(pt.x - x_));
+        commands_.push_back(zigzag_encode(pt.y - y_));
+        x_ = pt.x;
+        y_ = pt.y;
+    }
+}
+
+void geometry_encoder::add_line(tile_path const& line)
+{
+    if (line.size() < 2)
+        return;
+    commands_.push_back(command_integer(CMD_MOVE_TO, 1));
+    add_vertices(line, line.size());
+}
+
+void geometry_encoder::add_ring(tile_path const& ring)
+{
+    if (ring.size() < 3)
+        return;
+    commands_.push_back(command_integer(CMD_MOVE_TO, 1));
+    add_vertices(ring, ring.size());
+    commands_.push_back(command_integer(CMD_CLOSE_PATH, 1));
+}
+
+layer_builder::layer_builder(std::string const& name, std::uint32_t extent)
+    : name_(name),
+      extent_(extent)
+{}
+
+std::uint32_t layer_builder::key_index(std::string const& key)
+{
+    auto itr = key_map_.find(key);
+    if (itr != key_map_.end())
+        return itr->second;
+    std::uint32_t index = static_cast<std::uint32_t>(keys_.size());
+    keys_.push_back(key);
+    key_map_.emplace(key, index);
+    return index;
+}
+
+bool layer_builder::value_index(value const& val, std::uint32_t& index)
+{
+    std::string buffer;
+    {
+        protozero::pbf_writer writer(buffer);
+        if (!util::apply_visitor(value_encoder(writer), val))
+            return false;
+    }
+    auto itr = value_map_.find(buffer);
+    if (itr != value_map_.end())
+    {
+        index = itr->second;
+        return true;
+    }
+    index = static_cast<std::uint32_t>(values_.size());
+    value_map_.emplace(buffer, index);
+    values_.push_back(std::move(buffer));
+    return true;
+}
+
+void layer_builder::add_feature(feature_impl const& feature,
+                                geom_type type,
+                                std::vector<std::uint32_t> const& geometry)
+{
+    if (geometry.empty())
+        return;
+    tags_.clear();
+    for (auto const& kv : feature)
+    {
+        std::uint32_t val_index;
+        if (!value_index(std::get<1>(kv), val_index))
+            continue; // null values are not representable
+        tags_.push_back(key_index(std::get<0>(kv)));
+        tags_.push_back(val_index);
+    }
+
+    std::string buffer;
+    {
+        protozero::pbf_writer writer(buffer);
+        if (feature.id() >= 0)
+        {
+            writer.add_uint64(FEATURE_ID, static_cast<std::uint64_t>(feature.id()));
+        }
+        writer.add_packed_uint32(FEATURE_TAGS, tags_.begin(), tags_.end());
+        writer.add_enum(FEATURE_TYPE, type);
+        writer.add_packed_uint32(FEATURE_GEOMETRY, geometry.begin(), geometry.end());
+    }
+    protozero::pbf_writer layer(features_);
+    layer.add_message(LAYER_FEATURES, buffer);
+    ++count_;
+}
+
+void layer_builder::write(std::string& tile) const
+{
+    if (empty())
+        return;
+    std::string buffer;
+    {
+        protozero::pbf_writer writer(buffer);
+        writer.add_uint32(LAYER_VERSION, layer_version);
+        writer.add_string(LAYER_NAME, name_);
+    }
+    // features are stored pre-encoded as Layer.features fields
+    buffer.append(features_);
+    {
+        protozero::pbf_writer writer(buffer);
+        for (auto const& key : keys_)
+        {
+            writer.add_string(LAYER_KEYS, key);
+        }
+        for (auto const& val : values_)
+        {
+            writer.add_message(LAYER_VALUES, val);
+        }
+        writer.add_uint32(LAYER_EXTENT, extent_);
+    }
+    protozero::pbf_writer tile_writer(tile);
+    tile_writer.add_message(TILE_LAYERS, buffer);
+}
+
+} // namespace mvt
+} // namespace mapnik
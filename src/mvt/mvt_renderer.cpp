@@ -0,0 +1,431 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/mvt/mvt_renderer.hpp>
+#include <mapnik/mvt/mvt_encoder.hpp>
+#include <mapnik/feature_style_processor_impl.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/debug.hpp>
+
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_conv_clip_polygon.h"
+#include "agg_conv_clip_polyline.h"
+MAPNIK_DISABLE_WARNING_POP
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace mapnik {
+
+template class MAPNIK_DECL feature_style_processor<mvt_renderer>;
+
+namespace {
+
+using screen_path = std::vector<geometry::point<double>>;
+
+// vertex source over a path in tile coordinates, as expected by the agg clippers
+struct screen_path_source
+{
+    explicit screen_path_source(screen_path const& path)
+        : path_(path),
+          pos_(0)
+    {}
+
+    void rewind(unsigned) { pos_ = 0; }
+
+    unsigned vertex(double* x, double* y)
+    {
+        if (pos_ >= path_.size())
+            return SEG_END;
+        *x = path_[pos_].x;
+        *y = path_[pos_].y;
+        return (pos_++ == 0) ? SEG_MOVETO : SEG_LINETO;
+    }
+
+    screen_path const& path_;
+    std::size_t pos_;
+};
+
+// twice the signed area, positive for clockwise rings in y-down tile coordinates
+std::int64_t ring_area(mvt::tile_path const& ring)
+{
+    std::int64_t area = 0;
+    std::size_t size = ring.size();
+    for (std::size_t i = 0, j = size - 1; i < size; j = i++)
+    {
+        area += static_cast<std::int64_t>(ring[j].x) * ring[i].y - static_cast<std::int64_t>(ring[i].x) * ring[j].y;
+    }
+    return area;
+}
+
+class geometry_builder
+{
+  public:
+    geometry_builder(view_transform const& t,
+                     proj_transform const& prj_trans,
+                     box2d<double> const& clip_box,
+                     mvt::geometry_encoder& encoder)
+        : t_(t),
+          prj_trans_(prj_trans),
+          clip_box_(clip_box),
+          encoder_(encoder)
+    {}
+
+    mvt::geom_type operator()(geometry::point<double> const& pt)
+    {
+        mvt::tile_path points;
+        add_point(pt, points);
+        encoder_.add_points(points);
+        return points.empty() ? mvt::GEOM_UNKNOWN : mvt::GEOM_POINT;
+    }
+
+    mvt::geom_type operator()(geometry::multi_point<double> const& mpt)
+    {
+        mvt::tile_path points;
+        for (auto const& pt : mpt)
+        {
+            add_point(pt, points);
+        }
+        encoder_.add_points(points);
+        return points.empty() ? mvt::GEOM_UNKNOWN : mvt::GEOM_POINT;
+    }
+
+    mvt::geom_type operator()(geometry::line_string<double> const& line)
+    {
+        return add_line(line) ? mvt::GEOM_LINESTRING : mvt::GEOM_UNKNOWN;
+    }
+
+    mvt::geom_type operator()(geometry::multi_line_string<double> const& mline)
+    {
+        bool found = false;
+        for (auto const& line : mline)
+        {
+            found = add_line(line) || found;
+        }
+        return found ? mvt::GEOM_LINESTRING : mvt::GEOM_UNKNOWN;
+    }
+
+    mvt::geom_type operator()(geometry::polygon<double> const& poly)
+    {
+        return add_polygon(poly) ? mvt::GEOM_POLYGON : mvt::GEOM_UNKNOWN;
+    }
+
+    mvt::geom_type operator()(geometry::multi_polygon<double> const& mpoly)
+    {
+        bool found = false;
+        for (auto const& poly : mpoly)
+        {
+            found = add_polygon(poly) || found;
+        }
+        return found ? mvt::GEOM_POLYGON : mvt::GEOM_UNKNOWN;
+    }
+
+    template<typename T>
+    mvt::geom_type operator()(T const&)
+    {
+        // empty geometries and collections (handled by the caller)
+        return mvt::GEOM_UNKNOWN;
+    }
+
+  private:
+    bool transform(geometry::point<double> const& pt, double& x, double& y) const
+    {
+        x = pt.x;
+        y = pt.y;
+        double z = 0.0;
+        if (!prj_trans_.backward(x, y, z))
+            return false;
+        t_.forward(&x, &y);
+        return true;
+    }
+
+    void transform(std::vector<geometry::point<double>> const& in, screen_path& out) const
+    {
+        out.clear();
+        out.reserve(in.size());
+        for (auto const& pt : in)
+        {
+            double x, y;
+            if (transform(pt, x, y))
+                out.emplace_back(x, y);
+        }
+    }
+
+    static mvt::tile_point quantize(double x, double y)
+    {
+        return mvt::tile_point(static_cast<std::int32_t>(std::lround(x)), static_cast<std::int32_t>(std::lround(y)));
+    }
+
+    static void append(mvt::tile_path& path, mvt::tile_point const& pt)
+    {
+        if (path.empty() || path.back() != pt)
+            path.push_back(pt);
+    }
+
+    void add_point(geometry::point<double> const& pt, mvt::tile_path& points) const
+    {
+        double x, y;
+        if (transform(pt, x, y) && clip_box_.contains(x, y))
+        {
+            points.push_back(quantize(x, y));
+        }
+    }
+
+    bool add_line(geometry::line_string<double> const& line)
+    {
+        transform(line, screen_);
+        if (screen_.size() < 2)
+            return false;
+        screen_path_source source(screen_);
+        agg::conv_clip_polyline<screen_path_source> clipped(source);
+        clipped.clip_box(clip_box_.minx(), clip_box_.miny(), clip_box_.maxx(), clip_box_.maxy());
+        clipped.rewind(0);
+        bool found = false;
+        mvt::tile_path part;
+        double x, y;
+        unsigned cmd;
+        while ((cmd = clipped.vertex(&x, &y)) != SEG_END)
+        {
+            if (cmd == SEG_MOVETO)
+            {
+                found = flush_line(part) || found;
+            }
+            if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
+            {
+                append(part, quantize(x, y));
+            }
+        }
+        return flush_line(part) || found;
+    }
+
+    bool flush_line(mvt::tile_path& part)
+    {
+        bool valid = part.size() > 1;
+        if (valid)
+            encoder_.add_line(part);
+        part.clear();
+        return valid;
+    }
+
+    bool clip_ring(geometry::linear_ring<double> const& ring, mvt::tile_path& out)
+    {
+        out.clear();
+        transform(ring, screen_);
+        if (screen_.size() < 3)
+            return false;
+        screen_path_source source(screen_);
+        agg::conv_clip_polygon<screen_path_source> clipped(source);
+        clipped.clip_box(clip_box_.minx(), clip_box_.miny(), clip_box_.maxx(), clip_box_.maxy());
+        clipped.rewind(0);
+        double x, y;
+        unsigned cmd;
+        while ((cmd = clipped.vertex(&x, &y)) != SEG_END)
+        {
+            if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
+            {
+                append(out, quantize(x, y));
+            }
+        }
+        // closing vertex is implied by ClosePath
+        while (out.size() > 1 && out.back() == out.front())
+        {
+            out.pop_back();
+        }
+        return out.size() > 2;
+    }
+
+    bool add_polygon(geometry::polygon<double> const& poly)
+    {
+        if (poly.empty())
+            return false;
+        bool found = false;
+        bool exterior = true;
+        for (auto const& ring : poly)
+        {
+            if (!clip_ring(ring, ring_))
+            {
+                // holes of a dropped exterior ring are dropped too
+                if (exterior)
+                    return false;
+                continue;
+            }
+            std::int64_t area = ring_area(ring_);
+            if (area == 0)
+            {
+                if (exterior)
+                    return false;
+                continue;
+            }
+            // exterior rings wind clockwise, interior rings counter-clockwise
+            if ((area > 0) != exterior)
+            {
+                std::reverse(ring_.begin(), ring_.end());
+            }
+            encoder_.add_ring(ring_);
+            found = true;
+            exterior = false;
+        }
+        return found;
+    }
+
+    view_transform const& t_;
+    proj_transform const& prj_trans_;
+    box2d<double> const& clip_box_;
+    mvt::geometry_encoder& encoder_;
+    screen_path screen_;
+    mvt::tile_path ring_;
+};
+
+} // namespace
+
+mvt_renderer::mvt_renderer(Map const& m, std::string& output, unsigned tile_extent, double scale_factor)
+    : feature_style_processor<mvt_renderer>(m, scale_factor),
+      output_(output),
+      tile_extent_(tile_extent),
+      scale_factor_(scale_factor),
+      vars_(),
+      t_(tile_extent, tile_extent, m.get_current_extent()),
+      clip_box_(),
+      painted_(false),
+      layer_(),
+      encoded_(),
+      last_feature_(nullptr),
+      style_index_(0)
+{
+    double buffer = m.width() > 0 ? double(m.buffer_size()) * tile_extent / m.width() : 0.0;
+    clip_box_.init(-buffer, -buffer, tile_extent + buffer, tile_extent + buffer);
+}
+
+mvt_renderer::mvt_renderer(Map const& m,
+                           request const& req,
+                           attributes const& vars,
+                           std::string& output,
+                           unsigned tile_extent,
+                           double scale_factor)
+    : feature_style_processor<mvt_renderer>(m, scale_factor),
+      output_(output),
+      tile_extent_(tile_extent),
+      scale_factor_(scale_factor),
+      vars_(vars),
+      t_(tile_extent, tile_extent, req.extent()),
+      clip_box_(),
+      painted_(false),
+      layer_(),
+      encoded_(),
+      last_feature_(nullptr),
+      style_index_(0)
+{
+    double buffer = req.width() > 0 ? double(req.buffer_size()) * tile_extent / req.width() : 0.0;
+    clip_box_.init(-buffer, -buffer, tile_extent + buffer, tile_extent + buffer);
+}
+
+mvt_renderer::~mvt_renderer() {}
+
+void mvt_renderer::start_map_processing(Map const& /*m*/)
+{
+    MAPNIK_LOG_DEBUG(mvt_renderer) << "mvt_renderer: Start map processing clip_box=" << clip_box_;
+}
+
+void mvt_renderer::end_map_processing(Map const& /*m*/)
+{
+    MAPNIK_LOG_DEBUG(mvt_renderer) << "mvt_renderer: End map processing";
+}
+
+void mvt_renderer::start_layer_processing(layer const& lay, box2d<double> const& /*query_extent*/)
+{
+    MAPNIK_LOG_DEBUG(mvt_renderer) << "mvt_renderer: Start processing layer=" << lay.name();
+    layer_ = std::make_unique<mvt::layer_builder>(lay.name(), tile_extent_);
+    encoded_.clear();
+    style_index_ = 0;
+}
+
+void mvt_renderer::end_layer_processing(layer const& lay)
+{
+    MAPNIK_LOG_DEBUG(mvt_renderer) << "mvt_renderer: End processing layer=" << lay.name()
+                                   << " features=" << (layer_ ? layer_->size() : 0);
+    if (layer_)
+    {
+        layer_->write(output_);
+        layer_.reset();
+    }
+}
+
+void mvt_renderer::start_style_processing(feature_type_style const& /*st*/)
+{
+    last_feature_ = nullptr;
+}
+
+void mvt_renderer::end_style_processing(feature_type_style const& /*st*/)
+{
+    ++style_index_;
+}
+
+bool mvt_renderer::process(rule::symbolizers const& /*syms*/,
+                           mapnik::feature_impl& feature,
+                           proj_transform const& prj_trans)
+{
+    // the symbolizers do not matter here, only whether a rule matched
+    if (!layer_ || &feature == last_feature_)
+        return true;
+    last_feature_ = &feature;
+    // ids are only needed to recognise features already encoded by a previous
+    // style, so datasources with non-unique ids still work for single styles
+    if (style_index_ > 0 && encoded_.count(feature.id()) > 0)
+        return true;
+    encoded_.insert(feature.id());
+
+    mvt::geometry_encoder encoder;
+    geometry_builder builder(t_, prj_trans, clip_box_, encoder);
+    auto const& geom = feature.get_geometry();
+    if (geom.is<geometry::geometry_collection<double>>())
+    {
+        // MVT has no collections: every member becomes a feature of its own
+        for (auto const& part : geom.get<geometry::geometry_collection<double>>())
+        {
+            mvt::geom_type type = util::apply_visitor(builder, part);
+            if (type != mvt::GEOM_UNKNOWN)
+                layer_->add_feature(feature, type, encoder.commands());
+            encoder.clear();
+        }
+    }
+    else
+    {
+        mvt::geom_type type = util::apply_visitor(builder, geom);
+        if (type != mvt::GEOM_UNKNOWN)
+            layer_->add_feature(feature, type, encoder.commands());
+    }
+    return true;
+}
+
+} // namespace mapnik
@@ -63,6 +63,7 @@ class png_reader : public image_reader
     int bit_depth_;
     int color_type_;
     bool has_alpha_;
+    bool png_interlaced_;
 
   public:
     explicit png_reader(std::string const& filename);
@@ -74,9 +75,11 @@ class png_reader : public image_reader
     inline bool has_alpha() const final { return has_alpha_; }
     void read(unsigned x, unsigned y, image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    image_any read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned reduction) final;
 
   private:
     void init();
+    void read_scaled(unsigned x, unsigned y, image_rgba8& image, unsigned reduction);
     static void png_read_data(png_structp png_ptr, png_bytep data, png_size_t length);
 };
 
@@ -127,6 +130,7 @@ png_reader<T>::png_reader(std::string const& filename)
     , bit_depth_(0)
     , color_type_(0)
     , has_alpha_(false)
+    , png_interlaced_(false)
 {
     source_.open(filename, std::ios_base::in | std::ios_base::binary);
     if (!source_.is_open())
@@ -143,6 +147,7 @@ png_reader<T>::png_reader(char const* data, std::size_t size)
     , bit_depth_(0)
     , color_type_(0)
     , has_alpha_(false)
+    , png_interlaced_(false)
 {
     if (!stream_)
         throw image_reader_exception("PNG reader: cannot open image stream");
@@ -190,7 +195,9 @@ void png_reader<T>::init()
     png_read_info(png_ptr, info_ptr);
 
     png_uint_32 width, height;
-    png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth_, &color_type_, 0, 0, 0);
+    int interlace_type;
+    png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth_, &color_type_, &interlace_type, 0, 0);
+    png_interlaced_ = interlace_type != PNG_INTERLACE_NONE;
     has_alpha_ = (color_type_ & PNG_COLOR_MASK_ALPHA) || png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS);
     width_ = width;
     height_ = height;
@@ -218,6 +225,14 @@ boost::optional<box2d<double>> png_reader<T>::bounding_box() const
 
 template<typename T>
 void png_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
+{
+    read_scaled(x0, y0, image, 1);
+}
+
+// x0 and y0 are in full resolution pixels, every reduction'th row and column
+// of the window is kept
+template<typename T>
+void png_reader<T>::read_scaled(unsigned x0, unsigned y0, image_rgba8& image, unsigned reduction)
 {
     stream_.clear();
     stream_.seekg(0, std::ios_base::beg);
@@ -259,7 +274,7 @@ void png_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
     if (png_get_gAMA(png_ptr, info_ptr, &gamma))
         png_set_gamma(png_ptr, 2.2, gamma);
 
-    if (x0 == 0 && y0 == 0 && image.width() >= width_ && image.height() >= height_)
+    if (reduction == 1 && x0 == 0 && y0 == 0 && image.width() >= width_ && image.height() >= height_)
     {
         if (png_get_interlace_type(png_ptr, info_ptr) == PNG_INTERLACE_ADAM7)
         {
@@ -278,21 +293,59 @@ void png_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
     }
     else
     {
+        if (png_interlaced_)
+        {
+            // Adam7 rows are only complete after the last pass
+            png_set_interlace_handling(png_ptr);
+        }
         png_read_update_info(png_ptr, info_ptr);
-        unsigned w = std::min(unsigned(image.width()), width_ - x0);
-        unsigned h = std::min(unsigned(image.height()), height_ - y0);
+        unsigned w = std::min(unsigned(image.width()), (width_ - x0 + reduction - 1) / reduction);
+        unsigned h = std::min(unsigned(image.height()), (height_ - y0 + reduction - 1) / reduction);
+        const std::unique_ptr<unsigned[]> out_row(new unsigned[reduction > 1 ? w : 0]);
+        auto set_row = [&](unsigned i, png_byte* row) {
+            if (i >= y0 && (i - y0) % reduction == 0 && (i - y0) / reduction < h)
+            {
+                unsigned const* pixels = reinterpret_cast<unsigned*>(&row[x0 * 4]);
+                if (reduction > 1)
+                {
+                    for (unsigned x = 0; x < w; ++x)
+                    {
+                        out_row[x] = pixels[x * reduction];
+                    }
+                    pixels = out_row.get();
+                }
+                image.set_row((i - y0) / reduction, pixels, w);
+            }
+        };
         unsigned rowbytes = png_get_rowbytes(png_ptr, info_ptr);
-        const std::unique_ptr<png_byte[]> row(new png_byte[rowbytes]);
-        // START read image rows
-        for (unsigned i = 0; i < height_; ++i)
+        if (png_interlaced_)
+        {
+            // every pass revisits the rows, so all of them are decoded
+            const std::unique_ptr<png_byte[]> buffer(new png_byte[std::size_t(rowbytes) * height_]);
+            const std::unique_ptr<png_bytep[]> rows(new png_bytep[height_]);
+            for (unsigned i = 0; i < height_; ++i)
+                rows[i] = &buffer[std::size_t(rowbytes) * i];
+            png_read_image(png_ptr, rows.get());
+            for (unsigned i = 0; i < height_; ++i)
+                set_row(i, rows[i]);
+        }
+        else
         {
-            png_read_row(png_ptr, row.get(), 0);
-            if (i >= y0 && i < (y0 + h))
+            unsigned end_y = std::min(height_, y0 + h * reduction);
+            const std::unique_ptr<png_byte[]> row(new png_byte[rowbytes]);
+            // START read image rows
+            for (unsigned i = 0; i < end_y; ++i)
+            {
+                png_read_row(png_ptr, row.get(), 0);
+                set_row(i, row.get());
+            }
+            // END
+            if (end_y < height_)
             {
-                image.set_row(i - y0, reinterpret_cast<unsigned*>(&row[x0 * 4]), w);
+                // rows below the window are never decoded
+                return;
             }
         }
-        // END
     }
     png_read_end(png_ptr, 0);
 }
@@ -305,4 +358,16 @@ image_any png_reader<T>::read(unsigned x, unsigned y, unsigned width, unsigned h
     return image_any(std::move(data));
 }
 
+template<typename T>
+image_any png_reader<T>::read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned reduction)
+{
+    if (reduction <= 1)
+    {
+        return read(x, y, width, height);
+    }
+    image_rgba8 data((width + reduction - 1) / reduction, (height + reduction - 1) / reduction);
+    read_scaled(x, y, data, reduction);
+    return image_any(std::move(data));
+}
+
 } // namespace mapnik
@@ -161,6 +161,12 @@ void read_xml(std::string const& filename, xml_node& node)
     rapidxml_loader loader;
     loader.load(filename, node);
 }
+void read_xml(std::string const& filename, xml_node& node, std::vector<std::string>& dependencies)
+{
+    // rapidxml resolves neither XIncludes nor external entities
+    read_xml(filename, node);
+    dependencies.push_back(filename);
+}
 void read_xml_string(std::string const& str, xml_node& node, std::string const& base_path)
 {
     rapidxml_loader loader;
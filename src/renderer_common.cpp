@@ -24,6 +24,7 @@
 #include <mapnik/label_collision_detector.hpp>
 #include <mapnik/map.hpp>
 #include <mapnik/request.hpp>
+#include <mapnik/simplified_geometry_cache.hpp>
 #include <mapnik/attribute.hpp>
 #include <mapnik/safe_cast.hpp>
 
@@ -41,6 +42,8 @@ renderer_common::renderer_common(renderer_common const& other)
     , query_extent_(other.query_extent_)
     , t_(other.t_)
     , detector_(other.detector_)
+    , simplify_cache_(other.simplify_cache_)
+    , simplify_source_(other.simplify_source_)
 {}
 
 renderer_common::renderer_common(Map const& map,
@@ -60,6 +63,8 @@ renderer_common::renderer_common(Map const& map,
     , query_extent_()
     , t_(t)
     , detector_(detector)
+    , simplify_cache_()
+    , simplify_source_(0)
 {}
 
 renderer_common::renderer_common(Map const& m,
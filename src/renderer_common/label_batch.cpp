@@ -0,0 +1,161 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/renderer_common/label_batch.hpp>
+#include <mapnik/renderer_common/label_worker_pool.hpp>
+#include <mapnik/renderer_common/clipping_extent.hpp>
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/transform/transform_processor.hpp>
+
+// stl
+#include <algorithm>
+#include <atomic>
+
+namespace mapnik {
+
+label_batch::label_batch(renderer_common& common, proj_transform const& prj_trans)
+    : common_(common)
+    , prj_trans_(prj_trans)
+    , clip_box_(clipping_extent(common))
+    , placement_cache_(nullptr)
+    , items_()
+    , font_managers_()
+{}
+
+label_batch::~label_batch()
+{
+    // helpers reference the per-thread face managers
+    items_.clear();
+}
+
+bool label_batch::add(feature_ptr const& feature, symbolizer const& sym)
+{
+    if (!sym.is<text_symbolizer>() && !sym.is<shield_symbolizer>())
+    {
+        return false;
+    }
+    items_.push_back(item{feature, &sym, agg::trans_affine(), nullptr, label_placement_cache::key_type()});
+    return true;
+}
+
+namespace {
+
+template<typename Symbolizer>
+std::unique_ptr<text_symbolizer_helper> make_helper(Symbolizer const& sym,
+                                                    label_batch::item& it,
+                                                    renderer_common const& common,
+                                                    proj_transform const& prj_trans,
+                                                    face_manager& font_manager,
+                                                    box2d<double> const& clip_box)
+{
+    const auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
+    if (transform)
+        evaluate_transform(it.tr, *it.feature, common.vars_, *transform, common.scale_factor_);
+    return std::make_unique<text_symbolizer_helper>(sym,
+                                                    *it.feature,
+                                                    common.vars_,
+                                                    prj_trans,
+                                                    common.width_,
+                                                    common.height_,
+                                                    common.scale_factor_,
+                                                    common.t_,
+                                                    font_manager,
+                                                    *common.detector_,
+                                                    clip_box,
+                                                    it.tr);
+}
+
+} // namespace
+
+void label_batch::prepare(item& it, face_manager& font_manager, bool candidates)
+{
+    if (it.sym->is<text_symbolizer>())
+    {
+        it.helper =
+          make_helper(util::get<text_symbolizer>(*it.sym), it, common_, prj_trans_, font_manager, clip_box_);
+    }
+    else
+    {
+        it.helper =
+          make_helper(util::get<shield_symbolizer>(*it.sym), it, common_, prj_trans_, font_manager, clip_box_);
+    }
+    if (placement_cache_)
+    {
+        it.helper->set_placement_cache(*placement_cache_, it.placement_key);
+    }
+    if (candidates)
+    {
+        it.helper->generate_candidates();
+    }
+}
+
+void label_batch::generate(label_worker_pool& workers, unsigned threads)
+{
+    // PROJ contexts are not shared between threads, only transforms that do
+    // not need PROJ are safe to run concurrently.
+    if (!prj_trans_.equal() && !prj_trans_.is_known())
+    {
+        threads = 1;
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, items_.size()));
+    if (threads <= 1)
+    {
+        for (auto& it : items_)
+        {
+            prepare(it, common_.font_manager_, false);
+        }
+        return;
+    }
+
+    // FreeType faces may only be used by one thread at a time, so every
+    // worker but the calling thread looks fonts up through its own library.
+    font_managers_.clear();
+    for (unsigned slot = 1; slot < threads; ++slot)
+    {
+        font_managers_.push_back(std::make_unique<face_manager>(workers.library(slot), common_.font_manager_));
+    }
+
+    std::atomic<std::size_t> next(0);
+    workers.run(threads, [&](unsigned slot) {
+        face_manager& font_manager = slot == 0 ? common_.font_manager_ : *font_managers_[slot - 1];
+        try
+        {
+            std::size_t index;
+            while ((index = next++) < items_.size())
+            {
+                prepare(items_[index], font_manager, true);
+            }
+        }
+        catch (...)
+        {
+            // let the other workers stop early
+            next = items_.size();
+            throw;
+        }
+    });
+}
+
+} // namespace mapnik
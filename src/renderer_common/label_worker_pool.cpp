@@ -0,0 +1,142 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/renderer_common/label_worker_pool.hpp>
+#include <mapnik/text/font_library.hpp>
+
+namespace mapnik {
+
+label_worker_pool::label_worker_pool()
+    : mutex_()
+    , wake_()
+    , done_()
+    , task_(nullptr)
+    , active_(0)
+    , pending_(0)
+    , generation_(0)
+    , stop_(false)
+    , error_()
+    , libraries_()
+    , workers_()
+{
+    libraries_.push_back(std::make_unique<font_library>());
+}
+
+label_worker_pool::~label_worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+font_library& label_worker_pool::library(unsigned slot)
+{
+    return *libraries_[slot];
+}
+
+void label_worker_pool::run(unsigned threads, task_type const& task)
+{
+    if (threads == 0)
+    {
+        return;
+    }
+    // workers only ever get added, slots keep their library and thread
+    while (workers_.size() + 1 < threads)
+    {
+        libraries_.push_back(std::make_unique<font_library>());
+        unsigned slot = static_cast<unsigned>(workers_.size() + 1);
+        // the new worker starts with the run about to be published below
+        workers_.emplace_back(&label_worker_pool::work, this, slot, generation_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        active_ = threads;
+        pending_ = threads - 1;
+        error_ = nullptr;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    try
+    {
+        task(0);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+            error_ = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+    if (error_)
+    {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void label_worker_pool::work(unsigned slot, std::size_t seen)
+{
+    for (;;)
+    {
+        task_type const* task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            if (slot >= active_)
+                continue;
+            task = task_;
+        }
+        try
+        {
+            (*task)(slot);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pending_;
+        }
+        done_.notify_one();
+    }
+}
+
+} // namespace mapnik
@@ -30,6 +30,7 @@ request::request(unsigned width, unsigned height, box2d<double> const& extent)
     , height_(height)
     , extent_(extent)
     , buffer_size_(0)
+    , disabled_layers_()
 {}
 
 request::~request() {}
@@ -80,4 +81,20 @@ double request::scale() const
     return extent_.width();
 }
 
+void request::set_layer_enabled(std::size_t index, bool enabled)
+{
+    if (index >= disabled_layers_.size())
+    {
+        if (enabled)
+            return;
+        disabled_layers_.resize(index + 1, false);
+    }
+    disabled_layers_[index] = !enabled;
+}
+
+bool request::layer_enabled(std::size_t index) const
+{
+    return index >= disabled_layers_.size() || !disabled_layers_[index];
+}
+
 } // namespace mapnik
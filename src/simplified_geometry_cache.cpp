@@ -0,0 +1,271 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/simplified_geometry_cache.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/boolean.hpp>
+#include <mapnik/util/fs.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace mapnik {
+
+namespace {
+
+// the GeoJSON plugin numbers features once when it reads them into memory,
+// but per query when it reads them from the file through an index
+bool geojson_in_memory(parameters const& params)
+{
+    if (params.get<std::string>("inline"))
+        return true;
+    if (!*params.get<boolean_type>("cache_features", true))
+        return false;
+    boost::optional<std::string> file = params.get<std::string>("file");
+    if (!file)
+        return false;
+    boost::optional<std::string> base = params.get<std::string>("base");
+    std::string filename = base ? *base + "/" + *file : *file;
+    return !util::exists(filename + ".index");
+}
+
+} // namespace
+
+std::size_t simplified_geometry_cache::key_hash::operator()(entry_key const& key) const
+{
+    std::size_t seed = std::hash<value_integer>()(key.key.feature_id);
+    seed ^= std::hash<source_id>()(key.source) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<int>()(key.key.scale) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<double>()(key.key.tolerance) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<int>()(static_cast<int>(key.key.algorithm)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+simplified_geometry_cache::simplified_geometry_cache(std::size_t max_vertices, std::size_t min_vertices)
+    : max_vertices_(max_vertices)
+    , min_vertices_(min_vertices)
+    , shards_()
+    , hits_(0)
+    , misses_(0)
+    , static_types_{"shape"}
+    , sources_()
+    , next_source_(1)
+{}
+
+void simplified_geometry_cache::add_static_type(std::string const& type)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+#endif
+    static_types_.insert(type);
+    // datasources found uncacheable before are checked again
+    for (auto itr = sources_.begin(); itr != sources_.end();)
+    {
+        if (itr->second.id == 0)
+            itr = sources_.erase(itr);
+        else
+            ++itr;
+    }
+}
+
+bool simplified_geometry_cache::stable_ids(datasource const& ds) const
+{
+    boost::optional<std::string> type = ds.params().get<std::string>("type");
+    if (!type)
+        return false;
+    if (static_types_.find(*type) != static_types_.end())
+        return true;
+    return *type == "geojson" && geojson_in_memory(ds.params());
+}
+
+simplified_geometry_cache::source_id simplified_geometry_cache::attach(std::shared_ptr<datasource> const& ds)
+{
+    if (!ds)
+        return 0;
+    std::vector<source_id> dropped;
+    source_id id = 0;
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(sources_mutex_);
+#endif
+        auto itr = sources_.find(ds.get());
+        if (itr != sources_.end() && itr->second.owner.lock() == ds)
+            return itr->second.id;
+        // a datasource not seen before: forget the geometries of those that
+        // were destroyed meanwhile, including one that lived at this address
+        for (itr = sources_.begin(); itr != sources_.end();)
+        {
+            if (itr->second.owner.expired() || itr->first == ds.get())
+            {
+                if (itr->second.id != 0)
+                    dropped.push_back(itr->second.id);
+                itr = sources_.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+        if (stable_ids(*ds))
+            id = next_source_++;
+        sources_.emplace(ds.get(), source{ds, id});
+    }
+    for (source_id old : dropped)
+    {
+        drop(old);
+    }
+    return id;
+}
+
+int simplified_geometry_cache::scale_bucket(double scale)
+{
+    if (!(scale > 0.0))
+        return 0;
+    return static_cast<int>(std::lround(std::log2(scale) * 16.0));
+}
+
+simplified_geometry_cache::shard& simplified_geometry_cache::shard_for(entry_key const& key) const
+{
+    return shards_[key_hash()(key) % shards_.size()];
+}
+
+simplified_geometry_cache::path_ptr simplified_geometry_cache::find(source_id source, key_type const& key) const
+{
+    if (source != 0)
+    {
+        entry_key k{source, key};
+        shard& s = shard_for(k);
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+        auto itr = s.entries.find(k);
+        if (itr != s.entries.end())
+        {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return itr->second;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return path_ptr();
+}
+
+simplified_geometry_cache::path_ptr
+  simplified_geometry_cache::insert(source_id source, key_type const& key, simplified_path&& path)
+{
+    auto ptr = std::make_shared<simplified_path const>(std::move(path));
+    if (source == 0)
+        return ptr;
+    entry_key k{source, key};
+    shard& s = shard_for(k);
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+    auto result = s.entries.emplace(k, ptr);
+    if (result.second)
+    {
+        s.vertices += ptr->vertices.size();
+        s.order.push_back(k);
+        evict(s);
+    }
+    return result.first->second;
+}
+
+void simplified_geometry_cache::evict(shard& s)
+{
+    if (max_vertices_ == 0)
+        return;
+    std::size_t const budget = (max_vertices_ + shards_.size() - 1) / shards_.size();
+    // the geometry just stored is kept even if it alone exceeds the budget
+    while (s.vertices > budget && s.order.size() > 1)
+    {
+        auto itr = s.entries.find(s.order.front());
+        if (itr != s.entries.end())
+        {
+            s.vertices -= itr->second->vertices.size();
+            s.entries.erase(itr);
+            ++s.evictions;
+        }
+        s.order.pop_front();
+    }
+}
+
+void simplified_geometry_cache::drop(source_id id)
+{
+    for (auto& s : shards_)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+        for (auto itr = s.entries.begin(); itr != s.entries.end();)
+        {
+            if (itr->first.source == id)
+            {
+                s.vertices -= itr->second->vertices.size();
+                itr = s.entries.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+        s.order.erase(std::remove_if(s.order.begin(),
+                                     s.order.end(),
+                                     [id](entry_key const& key) { return key.source == id; }),
+                      s.order.end());
+    }
+}
+
+void simplified_geometry_cache::clear()
+{
+    for (auto& s : shards_)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+        s.entries.clear();
+        s.order.clear();
+        s.vertices = 0;
+    }
+}
+
+simplified_geometry_cache::statistics simplified_geometry_cache::stats() const
+{
+    statistics result;
+    result.hits = hits_.load(std::memory_order_relaxed);
+    result.misses = misses_.load(std::memory_order_relaxed);
+    for (auto const& s : shards_)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(s.mutex);
+#endif
+        result.evictions += s.evictions;
+        result.vertices += s.vertices;
+    }
+    return result;
+}
+
+} // namespace mapnik
@@ -0,0 +1,168 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/svg/svg_flattened_path.hpp>
+#include <mapnik/svg/svg_path_adapter.hpp>
+
+#include <mapnik/warning.hpp>
+MAPNIK_DISABLE_WARNING_PUSH
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_conv_curve.h"
+#include "agg_conv_dash.h"
+#include "agg_conv_stroke.h"
+#include "agg_conv_transform.h"
+MAPNIK_DISABLE_WARNING_POP
+
+// stl
+#include <algorithm>
+#include <cmath>
+
+namespace mapnik {
+namespace svg {
+
+int svg_flattened_path::bucket(double scale)
+{
+    if (!(scale > 0.0))
+        return 0;
+    // exact quarter octaves (e.g. 1.0, 2.0) map onto their own bucket
+    int b = static_cast<int>(std::ceil(4.0 * std::log2(scale) - 1e-9));
+    return std::max(-64, std::min(64, b));
+}
+
+double svg_flattened_path::bucket_scale(int bucket)
+{
+    return std::exp2(bucket / 4.0);
+}
+
+template<typename VertexSource>
+void svg_flattened_path::append(VertexSource& src, unsigned path_id, std::size_t& begin, std::size_t& end)
+{
+    begin = vertices_.size();
+    src.rewind(path_id);
+    double x;
+    double y;
+    unsigned cmd;
+    while (!agg::is_stop(cmd = src.vertex(&x, &y)))
+    {
+        vertices_.push_back(vertex{x, y, cmd});
+    }
+    end = vertices_.size();
+}
+
+svg_flattened_path::svg_flattened_path(svg_storage_type& storage, int bucket)
+    : bucket_(bucket)
+    , entries_()
+    , vertices_()
+{
+    using curved_type = agg::conv_curve<svg_path_adapter>;
+    using curved_dashed_type = agg::conv_dash<curved_type>;
+    using curved_stroked_type = agg::conv_stroke<curved_type>;
+    using curved_dashed_stroked_type = agg::conv_stroke<curved_dashed_type>;
+
+    vertex_stl_adapter<svg_path_storage> stl_storage(storage.source());
+    svg_path_adapter path(stl_storage);
+    curved_type curved(path);
+    curved_dashed_type curved_dashed(curved);
+    curved_stroked_type curved_stroked(curved);
+    curved_dashed_stroked_type curved_dashed_stroked(curved_dashed);
+
+    agg::trans_affine const mtx = agg::trans_affine_scaling(bucket_scale(bucket));
+    svg_attribute_type const& attributes = storage.attributes();
+    entries_.reserve(attributes.size());
+    for (path_attributes const& attr : attributes)
+    {
+        entry e{attr, 0, 0, 0, 0, false};
+        agg::trans_affine attr_transform = attr.transform;
+        // same approximation settings renderer_agg::render uses at this scale
+        agg::trans_affine transform = attr.transform;
+        transform *= mtx;
+        double scl = transform.scale();
+        curved.approximation_scale(scl);
+        curved.angle_tolerance(0.0);
+
+        agg::conv_transform<curved_type> fill(curved, attr_transform);
+        append(fill, attr.index, e.fill_begin, e.fill_end);
+
+        if (attr.stroke_flag)
+        {
+            if (attr.stroke_width * scl > 1.0)
+            {
+                curved.angle_tolerance(0.2);
+            }
+            if (attr.dash.size() > 0)
+            {
+                curved_dashed_stroked.width(attr.stroke_width);
+                curved_dashed_stroked.line_join(attr.line_join);
+                curved_dashed_stroked.line_cap(attr.line_cap);
+                curved_dashed_stroked.miter_limit(attr.miter_limit);
+                curved_dashed_stroked.inner_join(agg::inner_round);
+                curved_dashed_stroked.approximation_scale(scl);
+                curved_dashed.remove_all_dashes();
+                for (auto d : attr.dash)
+                {
+                    curved_dashed.add_dash(std::get<0>(d), std::get<1>(d));
+                }
+                curved_dashed.dash_start(attr.dash_offset);
+                agg::conv_transform<curved_dashed_stroked_type> stroke(curved_dashed_stroked, attr_transform);
+                append(stroke, attr.index, e.stroke_begin, e.stroke_end);
+            }
+            else
+            {
+                curved_stroked.width(attr.stroke_width);
+                curved_stroked.line_join(attr.line_join);
+                curved_stroked.line_cap(attr.line_cap);
+                curved_stroked.miter_limit(attr.miter_limit);
+                curved_stroked.inner_join(agg::inner_round);
+                curved_stroked.approximation_scale(scl);
+                agg::conv_transform<curved_stroked_type> stroke(curved_stroked, attr_transform);
+                append(stroke, attr.index, e.stroke_begin, e.stroke_end);
+            }
+            e.has_stroke = true;
+        }
+        entries_.push_back(std::move(e));
+    }
+}
+
+bool svg_flattened_path::covers(unsigned path_id, path_attributes const& attr) const
+{
+    if (path_id >= entries_.size())
+        return false;
+    entry const& e = entries_[path_id];
+    path_attributes const& cached = e.attr;
+    if (attr.index != cached.index || attr.fill_gradient.get_gradient_type() != NO_GRADIENT ||
+        attr.stroke_gradient.get_gradient_type() != NO_GRADIENT || !attr.transform.is_equal(cached.transform))
+    {
+        return false;
+    }
+    if (attr.stroke_flag)
+    {
+        return e.has_stroke && attr.stroke_width == cached.stroke_width && attr.line_join == cached.line_join &&
+               attr.line_cap == cached.line_cap && attr.miter_limit == cached.miter_limit &&
+               attr.dash == cached.dash && attr.dash_offset == cached.dash_offset;
+    }
+    return true;
+}
+
+} // namespace svg
+} // namespace mapnik
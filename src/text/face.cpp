@@ -39,6 +39,8 @@ namespace mapnik {
 font_face::font_face(FT_Face face)
     : face_(face)
     , color_font_(init_color_font())
+    , unscaled_(false)
+    , glyph_metrics_()
 {}
 
 bool font_face::init_color_font()
@@ -51,17 +53,33 @@ bool font_face::init_color_font()
 
 bool font_face::set_character_sizes(double size)
 {
+    unscaled_ = false;
     return (FT_Set_Char_Size(face_, 0, static_cast<FT_F26Dot6>(size * (1 << 6)), 0, 0) == 0);
 }
 
 bool font_face::set_unscaled_character_sizes()
 {
     FT_F26Dot6 char_height = face_->units_per_EM > 0 ? face_->units_per_EM : 2048.0;
-    return (FT_Set_Char_Size(face_, 0, char_height, 0, 0) == 0);
+    unscaled_ = (FT_Set_Char_Size(face_, 0, char_height, 0, 0) == 0);
+    return unscaled_;
 }
 
 bool font_face::glyph_dimensions(glyph_info& glyph) const
 {
+    // color fonts are always measured at their first strike, see below
+    bool const cacheable = unscaled_ || color_font_;
+    if (cacheable)
+    {
+        auto itr = glyph_metrics_.find(glyph.glyph_index);
+        if (itr != glyph_metrics_.end())
+        {
+            glyph.unscaled_ymin = itr->second.ymin;
+            glyph.unscaled_ymax = itr->second.ymax;
+            glyph.unscaled_advance = itr->second.advance;
+            glyph.unscaled_line_height = itr->second.line_height;
+            return true;
+        }
+    }
     FT_Vector pen;
     pen.x = 0;
     pen.y = 0;
@@ -99,6 +117,12 @@ bool font_face::glyph_dimensions(glyph_info& glyph) const
         glyph.unscaled_advance *= scale_multiplier;
     }
 
+    if (cacheable)
+    {
+        glyph_metrics_.emplace(
+          glyph.glyph_index,
+          glyph_metrics{glyph.unscaled_ymin, glyph.unscaled_ymax, glyph.unscaled_advance, glyph.unscaled_line_height});
+    }
     return true;
 }
 
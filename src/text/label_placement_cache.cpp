@@ -0,0 +1,274 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/text/label_placement_cache.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <unordered_set>
+
+namespace mapnik {
+
+namespace {
+
+std::string grid_name(std::string const& layer, int zoom)
+{
+    return std::to_string(zoom) + "/" + layer;
+}
+
+std::uint64_t cell_id(std::int64_t x, std::int64_t y)
+{
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) |
+           static_cast<std::uint32_t>(y);
+}
+
+} // namespace
+
+std::size_t label_placement_cache::key_hash::operator()(key_type const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.layer);
+    seed ^= std::hash<int>()(key.zoom) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<value_integer>()(key.feature_id) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<unsigned>()(key.style) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<unsigned>()(key.symbolizer) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+label_placement_cache::label_placement_cache(std::size_t max_features)
+    : max_features_(max_features)
+    , entries_()
+    , grids_()
+    , order_()
+#ifdef MAPNIK_THREADSAFE
+    , mutex_()
+#endif
+    , stats_()
+{}
+
+label_placement_cache::labels_ptr label_placement_cache::find(key_type const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto itr = entries_.find(key);
+    if (itr == entries_.end())
+    {
+        ++stats_.misses;
+        return labels_ptr();
+    }
+    ++stats_.hits;
+    return itr->second.labels;
+}
+
+void label_placement_cache::set_cell_size(std::string const& layer, int zoom, double cell_size)
+{
+    if (!(cell_size > 0.0))
+    {
+        return;
+    }
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    grid& g = grids_[grid_name(layer, zoom)];
+    if (g.cell_size <= 0.0)
+    {
+        g.cell_size = cell_size;
+    }
+}
+
+double label_placement_cache::cell_count(grid const& g, box2d<double> const& box)
+{
+    return (std::floor(box.maxx() / g.cell_size) - std::floor(box.minx() / g.cell_size) + 1) *
+           (std::floor(box.maxy() / g.cell_size) - std::floor(box.miny() / g.cell_size) + 1);
+}
+
+std::vector<std::uint64_t> label_placement_cache::cells(grid const& g, box2d<double> const& box)
+{
+    std::vector<std::uint64_t> result;
+    std::int64_t x0 = static_cast<std::int64_t>(std::floor(box.minx() / g.cell_size));
+    std::int64_t y0 = static_cast<std::int64_t>(std::floor(box.miny() / g.cell_size));
+    std::int64_t x1 = static_cast<std::int64_t>(std::floor(box.maxx() / g.cell_size));
+    std::int64_t y1 = static_cast<std::int64_t>(std::floor(box.maxy() / g.cell_size));
+    for (std::int64_t x = x0; x <= x1; ++x)
+    {
+        for (std::int64_t y = y0; y <= y1; ++y)
+        {
+            result.push_back(cell_id(x, y));
+        }
+    }
+    return result;
+}
+
+void label_placement_cache::insert(key_type const& key, cached_labels labels)
+{
+    box2d<double> bounds;
+    for (auto const& label : labels)
+    {
+        for (auto const& box : label.boxes)
+        {
+            if (bounds.valid())
+                bounds.expand_to_include(box);
+            else
+                bounds = box;
+        }
+    }
+
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    if (entries_.find(key) != entries_.end())
+    {
+        return;
+    }
+    auto result =
+      entries_.emplace(key, entry{std::make_shared<cached_labels const>(std::move(labels)), bounds, {}});
+    order_.push_back(key);
+    ++stats_.features;
+    if (bounds.valid())
+    {
+        grid& g = grids_[grid_name(key.layer, key.zoom)];
+        if (g.cell_size <= 0.0)
+        {
+            // no set_cell_size(), sized from the first label so that a cell holds a handful of labels
+            g.cell_size = std::max(std::max(bounds.width(), bounds.height()) * 16.0, 1e-9);
+        }
+        entry& e = result.first->second;
+        if (cell_count(g, bounds) > max_cells)
+        {
+            g.large.push_back(&result.first->first);
+        }
+        else
+        {
+            e.cells = cells(g, bounds);
+            for (auto id : e.cells)
+            {
+                g.cells[id].push_back(&result.first->first);
+            }
+        }
+    }
+    if (max_features_ > 0)
+    {
+        evict();
+    }
+}
+
+void label_placement_cache::evict()
+{
+    while (entries_.size() > max_features_ && !order_.empty())
+    {
+        key_type const& key = order_.front();
+        auto itr = entries_.find(key);
+        if (itr != entries_.end())
+        {
+            auto grid_itr = grids_.find(grid_name(key.layer, key.zoom));
+            if (grid_itr != grids_.end())
+            {
+                auto& large = grid_itr->second.large;
+                large.erase(std::remove(large.begin(), large.end(), &itr->first), large.end());
+                for (auto id : itr->second.cells)
+                {
+                    auto cell_itr = grid_itr->second.cells.find(id);
+                    if (cell_itr == grid_itr->second.cells.end())
+                        continue;
+                    auto& keys = cell_itr->second;
+                    keys.erase(std::remove(keys.begin(), keys.end(), &itr->first), keys.end());
+                    if (keys.empty())
+                        grid_itr->second.cells.erase(cell_itr);
+                }
+            }
+            entries_.erase(itr);
+            ++stats_.evictions;
+            --stats_.features;
+        }
+        order_.pop_front();
+    }
+}
+
+std::vector<label_placement_cache::labels_ptr>
+  label_placement_cache::query(std::string const& layer, int zoom, box2d<double> const& extent) const
+{
+    std::vector<labels_ptr> result;
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto grid_itr = grids_.find(grid_name(layer, zoom));
+    if (grid_itr == grids_.end())
+    {
+        return result;
+    }
+    grid const& g = grid_itr->second;
+    std::unordered_set<key_type const*> seen;
+    auto visit = [&](std::vector<key_type const*> const& keys) {
+        for (key_type const* key : keys)
+        {
+            if (!seen.insert(key).second)
+                continue;
+            entry const& e = entries_.at(*key);
+            if (e.bounds.intersects(extent))
+                result.push_back(e.labels);
+        }
+    };
+    visit(g.large);
+    if (cell_count(g, extent) > static_cast<double>(g.cells.size()))
+    {
+        // cheaper to look at every occupied cell
+        for (auto const& cell : g.cells)
+        {
+            visit(cell.second);
+        }
+    }
+    else
+    {
+        for (auto id : cells(g, extent))
+        {
+            auto cell_itr = g.cells.find(id);
+            if (cell_itr != g.cells.end())
+                visit(cell_itr->second);
+        }
+    }
+    return result;
+}
+
+void label_placement_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    entries_.clear();
+    grids_.clear();
+    order_.clear();
+    stats_.features = 0;
+}
+
+label_placement_cache::statistics label_placement_cache::stats() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return stats_;
+}
+
+} // namespace mapnik
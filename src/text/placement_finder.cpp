@@ -36,6 +36,7 @@
 // stl
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 namespace mapnik {
 
@@ -98,6 +99,11 @@ placement_finder::placement_finder(feature_impl const& feature,
     , marker_displacement_()
     , move_dx_(0.0)
     , horizontal_alignment_(horizontal_alignment_enum::H_LEFT)
+    , candidates_(nullptr)
+    , pending_checks_()
+    , position_(0)
+    , recorded_(nullptr)
+    , record_transform_(nullptr)
 {}
 
 bool placement_finder::next_position()
@@ -128,11 +134,21 @@ bool placement_finder::next_position()
         // cache a few values for use elsewhere in placement finder
         move_dx_ = layout->displacement().x;
         horizontal_alignment_ = layout->horizontal_alignment();
+        ++position_;
         return true;
     }
     return false;
 }
 
+void placement_finder::rewind()
+{
+    info_.reset();
+    text_props_ = evaluate_text_properties(info_.properties, feature_, attr_);
+    if (!layouts_.empty())
+        layouts_.clear();
+    position_ = 0;
+}
+
 text_upright_e placement_finder::simplify_upright(text_upright_e upright, double angle) const
 {
     if (upright == text_upright_enum::UPRIGHT_AUTO)
@@ -161,6 +177,7 @@ bool placement_finder::find_point_placement(pixel_position const& pos)
     glyph_positions_ptr glyphs = std::make_unique<glyph_positions>();
     std::vector<box2d<double>> bboxes;
 
+    std::vector<box2d<double>> checks;
     glyphs->reserve(layouts_.glyphs_count());
     bboxes.reserve(layouts_.size());
 
@@ -185,6 +202,8 @@ bool placement_finder::find_point_placement(pixel_position const& pos)
         /* For point placements it is faster to just check the bounding box. */
         if (collision(bbox, layouts_.text(), false))
             return false;
+        if (candidates_)
+            checks.push_back(bbox);
 
         if (layout.glyphs_count())
             bboxes.push_back(std::move(bbox));
@@ -225,27 +244,18 @@ bool placement_finder::find_point_placement(pixel_position const& pos)
     if (has_marker_ && !add_marker(glyphs, pos, bboxes))
         return false;
 
-    box2d<double> label_box;
-    bool first = true;
-    for (box2d<double> const& box : bboxes)
+    if (candidates_)
     {
-        if (first)
-        {
-            label_box = box;
-            first = false;
-        }
-        else
+        boost::optional<box2d<double>> marker_box;
+        if (has_marker_)
         {
-            label_box.expand_to_include(box);
+            marker_box = bboxes.back();
+            checks.push_back(bboxes.back());
         }
-        detector_.insert(box, layouts_.text());
-    }
-    // do not render text off the canvas
-    if (extent_.intersects(label_box))
-    {
-        placements_.push_back(std::move(glyphs));
+        record(std::move(glyphs), std::move(checks), std::move(bboxes), marker_box, false);
+        return false;
     }
-
+    commit(glyphs, bboxes, layouts_.text());
     return true;
 }
 
@@ -375,10 +385,11 @@ bool placement_finder::single_line_placement(vertex_cache& pp, text_upright_e or
         {
             // Try again with opposite orientation
             begin.restore();
-            return single_line_placement(pp,
-                                         real_orientation == text_upright_enum::UPRIGHT_RIGHT
-                                           ? text_upright_enum::UPRIGHT_LEFT
-                                           : text_upright_enum::UPRIGHT_RIGHT);
+            return retry_placement(pp,
+                                   real_orientation == text_upright_enum::UPRIGHT_RIGHT
+                                     ? text_upright_enum::UPRIGHT_LEFT
+                                     : text_upright_enum::UPRIGHT_RIGHT,
+                                   bboxes);
         }
         // upright==left-only or right-only and more than 50% of characters upside down => no placement
         else if (orientation == text_upright_enum::UPRIGHT_LEFT_ONLY ||
@@ -391,12 +402,44 @@ bool placement_finder::single_line_placement(vertex_cache& pp, text_upright_e or
     {
         // Try again with opposite orientation
         begin.restore();
-        return single_line_placement(pp,
-                                     real_orientation == text_upright_enum::UPRIGHT_RIGHT
-                                       ? text_upright_enum::UPRIGHT_LEFT
-                                       : text_upright_enum::UPRIGHT_RIGHT);
+        return retry_placement(pp,
+                               real_orientation == text_upright_enum::UPRIGHT_RIGHT
+                                 ? text_upright_enum::UPRIGHT_LEFT
+                                 : text_upright_enum::UPRIGHT_RIGHT,
+                               bboxes);
+    }
+
+    if (candidates_)
+    {
+        std::vector<box2d<double>> checks(pending_checks_);
+        checks.insert(checks.end(), bboxes.begin(), bboxes.end());
+        record(std::move(glyphs), std::move(checks), std::move(bboxes), boost::none, true);
+        return false;
     }
+    commit(glyphs, bboxes, layouts_.text());
+    return true;
+}
+
+bool placement_finder::retry_placement(vertex_cache& pp,
+                                       text_upright_e orientation,
+                                       std::vector<box2d<double>> const& bboxes)
+{
+    // Without a detector the first attempt is not known to fit yet, so a recorded
+    // retry has to check its boxes too.
+    std::size_t pending = pending_checks_.size();
+    if (candidates_)
+    {
+        pending_checks_.insert(pending_checks_.end(), bboxes.begin(), bboxes.end());
+    }
+    bool result = single_line_placement(pp, orientation);
+    pending_checks_.resize(pending);
+    return result;
+}
 
+void placement_finder::commit(glyph_positions_ptr& glyphs,
+                              std::vector<box2d<double>> const& bboxes,
+                              value_unicode_string const& repeat_key)
+{
     box2d<double> label_box;
     bool first = true;
     for (box2d<double> const& box : bboxes)
@@ -410,14 +453,196 @@ bool placement_finder::single_line_placement(vertex_cache& pp, text_upright_e or
         {
             label_box.expand_to_include(box);
         }
-        detector_.insert(box, layouts_.text());
+        detector_.insert(box, repeat_key);
+    }
+    if (recorded_)
+    {
+        record_placement(*glyphs, bboxes);
     }
     // do not render text off the canvas
     if (extent_.intersects(label_box))
     {
         placements_.push_back(std::move(glyphs));
     }
+}
+
+std::vector<glyph_info const*> placement_finder::layout_glyphs() const
+{
+    std::vector<glyph_info const*> glyphs;
+    glyphs.reserve(layouts_.glyphs_count());
+    for (auto const& layout_ptr : layouts_)
+    {
+        for (auto const& line : *layout_ptr)
+        {
+            for (auto const& glyph : line)
+            {
+                glyphs.push_back(&glyph);
+            }
+        }
+    }
+    return glyphs;
+}
+
+void placement_finder::record_placement(glyph_positions const& glyphs, std::vector<box2d<double>> const& bboxes)
+{
+    std::unordered_map<glyph_info const*, unsigned> index;
+    for (glyph_info const* glyph : layout_glyphs())
+    {
+        index.emplace(glyph, static_cast<unsigned>(index.size()));
+    }
+    cached_label label;
+    label.position = position_;
+    pixel_position const& base_point = glyphs.get_base_point();
+    label.anchor = base_point;
+    record_transform_->backward(&label.anchor.x, &label.anchor.y);
+    label.glyphs.reserve(glyphs.size());
+    for (auto const& glyph : glyphs)
+    {
+        auto itr = index.find(&glyph.glyph);
+        if (itr == index.end())
+        {
+            // not from the current layouts, can not be replayed
+            return;
+        }
+        label.glyphs.push_back(cached_label::glyph{itr->second, glyph.pos, glyph.rot});
+    }
+    if (glyphs.get_marker())
+    {
+        label.has_marker = true;
+        label.marker_pos = glyphs.marker_pos() - base_point;
+    }
+    label.boxes.reserve(bboxes.size());
+    for (box2d<double> const& box : bboxes)
+    {
+        label.boxes.push_back(record_transform_->backward(box));
+    }
+    label.text = layouts_.text();
+    recorded_->push_back(std::move(label));
+}
 
+bool placement_finder::replay(cached_labels const& labels, view_transform const& t)
+{
+    std::vector<glyph_info const*> glyphs_index;
+    bool replayed = false;
+    // matching a label advances the placement alternatives, a failed replay
+    // leaves the finder as it was for the placement search that follows
+    auto stop = [&] {
+        if (!replayed)
+            rewind();
+        return replayed;
+    };
+    for (cached_label const& label : labels)
+    {
+        while (position_ < label.position)
+        {
+            if (!next_position())
+                return stop();
+            glyphs_index.clear();
+        }
+        if (label.position != position_ || label.text != layouts_.text())
+        {
+            // e.g. a feature id shared by several features
+            return stop();
+        }
+        if (glyphs_index.empty())
+        {
+            glyphs_index = layout_glyphs();
+        }
+        pixel_position base_point = label.anchor;
+        t.forward(&base_point.x, &base_point.y);
+        glyph_positions_ptr glyphs = std::make_unique<glyph_positions>();
+        glyphs->reserve(static_cast<unsigned>(label.glyphs.size()));
+        glyphs->set_base_point(base_point);
+        for (auto const& glyph : label.glyphs)
+        {
+            if (glyph.index >= glyphs_index.size())
+                return stop();
+            glyphs->emplace_back(*glyphs_index[glyph.index], glyph.pos, glyph.rot);
+        }
+        if (label.has_marker && marker_)
+        {
+            glyphs->set_marker(marker_, base_point + label.marker_pos);
+        }
+        // the boxes are in the detector already, see label_placement_cache::query()
+        box2d<double> label_box;
+        bool first = true;
+        for (box2d<double> const& box : label.boxes)
+        {
+            box2d<double> screen_box = t.forward(box);
+            if (first)
+            {
+                label_box = screen_box;
+                first = false;
+            }
+            else
+            {
+                label_box.expand_to_include(screen_box);
+            }
+        }
+        // do not render text off the canvas
+        if (extent_.intersects(label_box))
+        {
+            placements_.push_back(std::move(glyphs));
+        }
+        replayed = true;
+    }
+    return true;
+}
+
+void placement_finder::record(glyph_positions_ptr glyphs,
+                              std::vector<box2d<double>> checks,
+                              std::vector<box2d<double>> bboxes,
+                              boost::optional<box2d<double>> const& marker_box,
+                              bool line_placement)
+{
+    label_candidate candidate;
+    candidate.glyphs = std::move(glyphs);
+    candidate.checks = std::move(checks);
+    candidate.bboxes = std::move(bboxes);
+    candidate.marker_box = marker_box;
+    candidate.repeat_key = layouts_.text();
+    candidate.margin = margin(line_placement);
+    candidate.repeat_distance = repeat_distance(line_placement);
+    candidate.allow_overlap = text_props_->allow_overlap;
+    candidates_->groups.back().push_back(std::move(candidate));
+}
+
+bool placement_finder::place(label_candidates& candidates)
+{
+    bool success = candidates.placed;
+    for (auto& group : candidates.groups)
+    {
+        for (auto& candidate : group)
+        {
+            if (place(candidate))
+            {
+                success = true;
+                break;
+            }
+        }
+    }
+    return success;
+}
+
+bool placement_finder::place(label_candidate& candidate)
+{
+    if (!candidate.allow_overlap)
+    {
+        for (box2d<double> const& box : candidate.checks)
+        {
+            if ((candidate.repeat_key.length() == 0 && !detector_.has_placement(box, candidate.margin)) ||
+                (candidate.repeat_key.length() > 0 &&
+                 !detector_.has_placement(box, candidate.margin, candidate.repeat_key, candidate.repeat_distance)))
+            {
+                return false;
+            }
+        }
+    }
+    if (candidate.marker_box)
+    {
+        detector_.insert(*candidate.marker_box);
+    }
+    commit(candidate.glyphs, candidate.bboxes, candidate.repeat_key);
     return true;
 }
 
@@ -443,29 +668,44 @@ double placement_finder::get_spacing(double path_length, double layout_width) co
     return path_length / num_labels;
 }
 
+double placement_finder::margin(bool line_placement) const
+{
+    if (line_placement)
+    {
+        return text_props_->margin * scale_factor_;
+    }
+    return (text_props_->margin != 0 ? text_props_->margin : text_props_->minimum_distance) * scale_factor_;
+}
+
+double placement_finder::repeat_distance(bool line_placement) const
+{
+    if (line_placement)
+    {
+        return (text_props_->repeat_distance != 0 ? text_props_->repeat_distance : text_props_->minimum_distance) *
+               scale_factor_;
+    }
+    return text_props_->repeat_distance * scale_factor_;
+}
+
 bool placement_finder::collision(const box2d<double>& box,
                                  const value_unicode_string& repeat_key,
                                  bool line_placement) const
 {
-    double margin, repeat_distance;
-    if (line_placement)
+    if ((text_props_->avoid_edges && !extent_.contains(box)) ||
+        (text_props_->minimum_padding > 0 && !extent_.contains(box + (scale_factor_ * text_props_->minimum_padding))))
     {
-        margin = text_props_->margin * scale_factor_;
-        repeat_distance =
-          (text_props_->repeat_distance != 0 ? text_props_->repeat_distance : text_props_->minimum_distance) *
-          scale_factor_;
+        return true;
     }
-    else
+    if (candidates_)
     {
-        margin = (text_props_->margin != 0 ? text_props_->margin : text_props_->minimum_distance) * scale_factor_;
-        repeat_distance = text_props_->repeat_distance * scale_factor_;
+        // checked against the detector when the candidate is placed
+        return false;
     }
-    return (text_props_->avoid_edges && !extent_.contains(box)) ||
-           (text_props_->minimum_padding > 0 &&
-            !extent_.contains(box + (scale_factor_ * text_props_->minimum_padding))) ||
-           (!text_props_->allow_overlap &&
-            ((repeat_key.length() == 0 && !detector_.has_placement(box, margin)) ||
-             (repeat_key.length() > 0 && !detector_.has_placement(box, margin, repeat_key, repeat_distance))));
+    double margin = this->margin(line_placement);
+    double repeat_distance = this->repeat_distance(line_placement);
+    return !text_props_->allow_overlap &&
+           ((repeat_key.length() == 0 && !detector_.has_placement(box, margin)) ||
+            (repeat_key.length() > 0 && !detector_.has_placement(box, margin, repeat_key, repeat_distance)));
 }
 
 void placement_finder::set_marker(marker_info_ptr m,
@@ -489,7 +729,8 @@ bool placement_finder::add_marker(glyph_positions_ptr& glyphs,
     bbox.move(real_pos.x, real_pos.y);
     if (collision(bbox, layouts_.text(), false))
         return false;
-    detector_.insert(bbox);
+    if (!candidates_)
+        detector_.insert(bbox);
     bboxes.push_back(std::move(bbox));
     glyphs->set_marker(marker_, real_pos);
     return true;
@@ -48,6 +48,11 @@ bool text_placement_info_list::next() const
     return true;
 }
 
+void text_placement_info_list::reset() const
+{
+    state = 0;
+}
+
 text_symbolizer_properties& text_placements_list::add()
 {
     if (list_.size())
@@ -67,6 +72,11 @@ text_symbolizer_properties& text_placements_list::get(unsigned i)
     return list_[i];
 }
 
+text_symbolizer_properties const& text_placements_list::get(unsigned i) const
+{
+    return list_[i];
+}
+
 text_placement_info_ptr
   text_placements_list::get_placement_info(double scale_factor, feature_impl const&, attributes const&) const
 {
@@ -126,6 +126,13 @@ bool text_placement_info_simple::next() const
     return true;
 }
 
+void text_placement_info_simple::reset() const
+{
+    text_placement_info::reset();
+    state = 0;
+    position_state = 0;
+}
+
 bool text_placement_info_simple::next_position_only() const
 {
     if (position_state >= direction_.size())
@@ -432,6 +432,15 @@ void text_symbolizer_helper::init_converters()
 
 placements_list const& text_symbolizer_helper::get() const
 {
+    if (placement_cache_ && replay_placements())
+    {
+        candidates_.clear();
+        return finder_.placements();
+    }
+    if (!candidates_.empty())
+    {
+        place_candidates();
+    }
     if (point_placement_)
     {
         while (next_point_placement())
@@ -442,9 +451,42 @@ placements_list const& text_symbolizer_helper::get() const
         while (next_line_placement())
             ;
     }
+    if (placement_cache_)
+    {
+        finder_.record_placements(nullptr, nullptr);
+        if (!cached_labels_.empty())
+        {
+            placement_cache_->insert(placement_key_, std::move(cached_labels_));
+        }
+    }
     return finder_.placements();
 }
 
+void text_symbolizer_helper::set_placement_cache(label_placement_cache& cache,
+                                                 label_placement_cache::key_type const& key) const
+{
+    placement_cache_ = &cache;
+    placement_key_ = key;
+    cached_labels_.clear();
+    finder_.record_placements(&cached_labels_, &t_);
+}
+
+bool text_symbolizer_helper::replay_placements() const
+{
+    if (geometries_to_process_.empty())
+    {
+        return false;
+    }
+    label_placement_cache::labels_ptr labels = placement_cache_->find(placement_key_);
+    if (!labels || !finder_.replay(*labels, t_))
+    {
+        return false;
+    }
+    finder_.record_placements(nullptr, nullptr);
+    placement_cache_ = nullptr;
+    return true;
+}
+
 class apply_line_placement_visitor
 {
   public:
@@ -479,6 +521,70 @@ class apply_line_placement_visitor
     placement_finder_adapter<placement_finder> const& adapter_;
 };
 
+void text_symbolizer_helper::generate_candidates() const
+{
+    candidates_.clear();
+    if (placement_cache_ && placement_cache_->find(placement_key_))
+    {
+        // get() replays the cached placements instead
+        return;
+    }
+    if (point_placement_)
+    {
+        candidates_.reserve(points_.size());
+        for (auto const& point : points_)
+        {
+            candidates_.emplace_back();
+            candidates_.back().groups.emplace_back();
+            finder_.record_candidates(&candidates_.back());
+            finder_.find_point_placement(point);
+        }
+    }
+    else
+    {
+        candidates_.reserve(geometries_to_process_.size());
+        for (auto const& geom : geometries_to_process_)
+        {
+            candidates_.emplace_back();
+            finder_.record_candidates(&candidates_.back());
+            mapnik::util::apply_visitor(apply_line_placement_visitor(converter_, adapter_), geom);
+        }
+    }
+    finder_.record_candidates(nullptr);
+}
+
+void text_symbolizer_helper::place_candidates() const
+{
+    // Same order as the first pass of next_point_placement/next_line_placement,
+    // which candidates_ replaces; remaining points and geometries go on to the
+    // next placement alternative.
+    if (point_placement_)
+    {
+        auto itr = points_.begin();
+        for (auto& candidates : candidates_)
+        {
+            if (finder_.place(candidates))
+                itr = points_.erase(itr);
+            else
+                ++itr;
+        }
+        point_itr_ = points_.end();
+    }
+    else
+    {
+        auto itr = geometries_to_process_.begin();
+        for (auto& candidates : candidates_)
+        {
+            if (finder_.place(candidates))
+                itr = geometries_to_process_.erase(itr);
+            else
+                ++itr;
+        }
+        geo_itr_ = geometries_to_process_.end();
+    }
+    candidates_.clear();
+}
+
 bool text_symbolizer_helper::next_line_placement() const
 {
     while (!geometries_to_process_.empty())
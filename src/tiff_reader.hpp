@@ -3,6 +3,7 @@
 #include <mapnik/debug.hpp>
 #include <mapnik/image_reader.hpp>
 #include <mapnik/util/char_array_buffer.hpp>
+#include <mapnik/tiff_tile_cache.hpp>
 extern "C" {
 #include <tiffio.h>
 }
@@ -22,6 +23,8 @@ MAPNIK_DISABLE_WARNING_POP
 #include <memory>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <vector>
 
 namespace mapnik {
 namespace detail {
@@ -72,6 +75,7 @@ class tiff_reader : public image_reader
     source_type source_;
     input_stream stream_;
     tiff_ptr tif_;
+    std::string filename_; // empty when reading from memory
     int read_method_;
     int rows_per_strip_;
     int tile_width_;
@@ -88,6 +92,15 @@ class tiff_reader : public image_reader
     bool has_alpha_;
     bool is_tiled_;
 
+    // reduced resolution images stored in the directories following the first
+    struct overview
+    {
+        std::uint16_t directory;
+        std::size_t width;
+        std::size_t height;
+    };
+    std::vector<overview> overviews_;
+
   public:
     enum TiffType { generic = 1, stripped, tiled };
     explicit tiff_reader(std::string const& filename);
@@ -102,6 +115,7 @@ class tiff_reader : public image_reader
     }
     void read(unsigned x, unsigned y, image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    image_any read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned reduction) final;
     // methods specific to tiff reader
     unsigned bits_per_sample() const
     {
@@ -144,6 +158,8 @@ class tiff_reader : public image_reader
     tiff_reader(const tiff_reader&);
     tiff_reader& operator=(const tiff_reader&);
     void init();
+    void read_directory(TIFF* tif);
+    void restore_first_directory();
 
     template<typename ImageData>
     void read_generic(std::size_t x, std::size_t y, ImageData& image);
@@ -154,6 +170,17 @@ class tiff_reader : public image_reader
     template<typename ImageData>
     void read_tiled(std::size_t x, std::size_t y, ImageData& image);
 
+    template<typename ImageData>
+    void read_tiled_cached(std::size_t x, std::size_t y, ImageData& image);
+
+    template<typename ImageData, typename Pixel>
+    void copy_tile(std::size_t x0, std::size_t y0, std::size_t x, std::size_t y, Pixel const* tile, ImageData& image);
+
+    template<typename ImageData>
+    tiff_tile_cache::tile_ptr decode_tile(TIFF* tif, std::size_t x, std::size_t y);
+
+    std::unique_ptr<std::streambuf> open_buffer() const;
+
     template<typename ImageData>
     image_any read_any_gray(std::size_t x, std::size_t y, std::size_t width, std::size_t height);
 
@@ -173,6 +200,7 @@ tiff_reader<T>::tiff_reader(std::string const& filename)
 #endif
 
     tif_(nullptr)
+    , filename_(filename)
     , read_method_(generic)
     , rows_per_strip_(0)
     , tile_width_(0)
@@ -213,6 +241,7 @@ tiff_reader<T>::tiff_reader(char const* data, std::size_t size)
     : source_(data, size)
     , stream_(&source_)
     , tif_(nullptr)
+    , filename_()
     , read_method_(generic)
     , rows_per_strip_(0)
     , tile_width_(0)
@@ -245,43 +274,39 @@ void tiff_reader<T>::init()
     if (!tif)
         throw image_reader_exception("Can't open tiff file");
 
-    TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bps_);
-    TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &sample_format_);
-    TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric_);
-    TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &bands_);
-
-    MAPNIK_LOG_DEBUG(tiff_reader) << "bits per sample: " << bps_;
-    MAPNIK_LOG_DEBUG(tiff_reader) << "sample format: " << sample_format_;
-    MAPNIK_LOG_DEBUG(tiff_reader) << "photometric: " << photometric_;
-    MAPNIK_LOG_DEBUG(tiff_reader) << "bands: " << bands_;
-
-    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width_);
-    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height_);
-
-    TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planar_config_);
-    TIFFGetField(tif, TIFFTAG_COMPRESSION, &compression_);
+    read_directory(tif);
 
-    std::uint16_t orientation;
-    if (TIFFGetField(tif, TIFFTAG_ORIENTATION, &orientation) == 0)
+    // look for overviews, e.g. those created by `gdaladdo`
+    std::uint16_t directory = 0;
+    while (TIFFReadDirectory(tif))
     {
-        orientation = 1;
+        ++directory;
+        std::uint32_t subfile_type = 0;
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        std::uint16_t bps = 0;
+        std::uint16_t bands = 1;
+        TIFFGetField(tif, TIFFTAG_SUBFILETYPE, &subfile_type);
+        TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+        TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bps);
+        TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &bands);
+        if ((subfile_type & FILETYPE_REDUCEDIMAGE) && !(subfile_type & FILETYPE_MASK) && width > 0 &&
+            height > 0 && bps == bps_ && bands == bands_)
+        {
+            MAPNIK_LOG_DEBUG(tiff_reader) << "overview " << directory << ": " << width << "x" << height;
+            overviews_.push_back(overview{directory, width, height});
+        }
     }
-    MAPNIK_LOG_DEBUG(tiff_reader) << "orientation: " << orientation;
-    MAPNIK_LOG_DEBUG(tiff_reader) << "planar-config: " << planar_config_;
-    is_tiled_ = TIFFIsTiled(tif);
-
-    if (is_tiled_)
+    if (directory > 0 && !TIFFSetDirectory(tif, 0))
     {
-        TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tile_width_);
-        TIFFGetField(tif, TIFFTAG_TILELENGTH, &tile_height_);
-        MAPNIK_LOG_DEBUG(tiff_reader) << "tiff is tiled";
-        read_method_ = tiled;
+        throw image_reader_exception("TIFF reader: failed to rewind to first directory");
     }
-    else if (TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip_) != 0)
+    if (directory > 0)
     {
-        MAPNIK_LOG_DEBUG(tiff_reader) << "tiff is stripped";
-        read_method_ = stripped;
+        read_directory(tif);
     }
+
     // TIFFTAG_EXTRASAMPLES
     std::uint16_t extrasamples = 0;
     std::uint16_t* sampleinfo = nullptr;
@@ -332,6 +357,62 @@ void tiff_reader<T>::init()
     }
 }
 
+// reads the fields of the current directory that describe how to decode it
+template<typename T>
+void tiff_reader<T>::read_directory(TIFF* tif)
+{
+    bps_ = 0;
+    sample_format_ = SAMPLEFORMAT_UINT;
+    photometric_ = 0;
+    bands_ = 1;
+    width_ = 0;
+    height_ = 0;
+    planar_config_ = PLANARCONFIG_CONTIG;
+    compression_ = COMPRESSION_NONE;
+    read_method_ = generic;
+    rows_per_strip_ = 0;
+    tile_width_ = 0;
+    tile_height_ = 0;
+
+    TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bps_);
+    TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &sample_format_);
+    TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric_);
+    TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &bands_);
+
+    MAPNIK_LOG_DEBUG(tiff_reader) << "bits per sample: " << bps_;
+    MAPNIK_LOG_DEBUG(tiff_reader) << "sample format: " << sample_format_;
+    MAPNIK_LOG_DEBUG(tiff_reader) << "photometric: " << photometric_;
+    MAPNIK_LOG_DEBUG(tiff_reader) << "bands: " << bands_;
+
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width_);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height_);
+
+    TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planar_config_);
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &compression_);
+
+    std::uint16_t orientation;
+    if (TIFFGetField(tif, TIFFTAG_ORIENTATION, &orientation) == 0)
+    {
+        orientation = 1;
+    }
+    MAPNIK_LOG_DEBUG(tiff_reader) << "orientation: " << orientation;
+    MAPNIK_LOG_DEBUG(tiff_reader) << "planar-config: " << planar_config_;
+    is_tiled_ = TIFFIsTiled(tif);
+
+    if (is_tiled_)
+    {
+        TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tile_width_);
+        TIFFGetField(tif, TIFFTAG_TILELENGTH, &tile_height_);
+        MAPNIK_LOG_DEBUG(tiff_reader) << "tiff is tiled";
+        read_method_ = tiled;
+    }
+    else if (TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip_) != 0)
+    {
+        MAPNIK_LOG_DEBUG(tiff_reader) << "tiff is stripped";
+        read_method_ = stripped;
+    }
+}
+
 template<typename T>
 tiff_reader<T>::~tiff_reader()
 {}
@@ -563,6 +644,63 @@ image_any tiff_reader<T>::read(unsigned x, unsigned y, unsigned width, unsigned
     return image_any();
 }
 
+template<typename T>
+image_any tiff_reader<T>::read_reduced(unsigned x, unsigned y, unsigned width, unsigned height, unsigned reduction)
+{
+    if (reduction <= 1)
+    {
+        return read(x, y, width, height);
+    }
+    std::size_t const reduced_width = (width_ + reduction - 1) / reduction;
+    std::size_t const reduced_height = (height_ + reduction - 1) / reduction;
+    auto itr = std::find_if(overviews_.begin(), overviews_.end(), [&](overview const& o) {
+        return (o.width == reduced_width || o.width == width_ / reduction) &&
+               (o.height == reduced_height || o.height == height_ / reduction);
+    });
+    TIFF* tif = open(stream_);
+    if (itr == overviews_.end() || !tif || !TIFFSetDirectory(tif, itr->directory))
+    {
+        return read(x, y, width, height);
+    }
+    // the overview is read with the same code paths by temporarily making its
+    // directory the current one
+    read_directory(tif);
+    image_any image;
+    try
+    {
+        image = read(x / reduction,
+                     y / reduction,
+                     (width + reduction - 1) / reduction,
+                     (height + reduction - 1) / reduction);
+    }
+    catch (...)
+    {
+        restore_first_directory();
+        throw;
+    }
+    restore_first_directory();
+    return image;
+}
+
+// makes the first directory current again after reading an overview, through a
+// new handle if libtiff can't go back to it
+template<typename T>
+void tiff_reader<T>::restore_first_directory()
+{
+    TIFF* tif = tif_.get();
+    if (!tif || !TIFFSetDirectory(tif, 0))
+    {
+        MAPNIK_LOG_DEBUG(tiff_reader) << "tiff_reader: reopening to restore the first directory";
+        tif_.reset();
+        tif = open(stream_);
+        if (!tif)
+        {
+            throw image_reader_exception("TIFF reader: failed to restore the first directory");
+        }
+    }
+    read_directory(tif);
+}
+
 namespace detail {
 
 struct rgb8
@@ -644,6 +782,11 @@ void tiff_reader<T>::read_tiled(std::size_t x0, std::size_t y0, ImageData& image
     TIFF* tif = open(stream_);
     if (tif)
     {
+        if (!filename_.empty() && tiff_tile_cache::instance().enabled())
+        {
+            read_tiled_cached(x0, y0, image);
+            return;
+        }
         std::uint32_t tile_size = TIFFTileSize(tif);
         std::unique_ptr<pixel_type[]> tile(new pixel_type[tile_size]);
         std::size_t width = image.width();
@@ -658,9 +801,6 @@ void tiff_reader<T>::read_tiled(std::size_t x0, std::size_t y0, ImageData& image
           (bands_ > 1) && (tile_size / (tile_width_ * tile_height_ * sizeof(pixel_type)) == bands_);
         for (std::size_t y = start_y; y < end_y; y += tile_height_)
         {
-            std::size_t ty0 = std::max(y0, y) - y;
-            std::size_t ty1 = std::min(height + y0, y + tile_height_) - y;
-
             for (std::size_t x = start_x; x < end_x; x += tile_width_)
             {
                 if (!detail::tiff_reader_traits<ImageData>::read_tile(tif, x, y, tile.get(), tile_width_, tile_height_))
@@ -677,33 +817,200 @@ void tiff_reader<T>::read_tiled(std::size_t x0, std::size_t y0, ImageData& image
                         tile[n] = tile[n * bands_];
                     }
                 }
-                std::size_t tx0 = std::max(x0, x);
-                std::size_t tx1 = std::min(width + x0, x + tile_width_);
-                std::size_t row_index = y + ty0 - y0;
+                copy_tile(x0, y0, x, y, tile.get(), image);
+            }
+        }
+    }
+}
 
-                if (detail::tiff_reader_traits<ImageData>::reverse)
-                {
-                    for (std::size_t ty = ty0; ty < ty1; ++ty, ++row_index)
-                    {
-                        // This is in reverse because the TIFFReadRGBATile reads are inverted
-                        image.set_row(row_index,
-                                      tx0 - x0,
-                                      tx1 - x0,
-                                      &tile[(tile_height_ - ty - 1) * tile_width_ + tx0 - x]);
-                    }
-                }
-                else
-                {
-                    for (std::size_t ty = ty0; ty < ty1; ++ty, ++row_index)
-                    {
-                        image.set_row(row_index, tx0 - x0, tx1 - x0, &tile[ty * tile_width_ + tx0 - x]);
-                    }
-                }
+// Same as read_tiled but goes through tiff_tile_cache: tiles already decoded by
+// any reader of this file are copied from the cache and the missing ones are
+// decoded here, helped by the cache's decode pool when it has threads.
+template<typename T>
+template<typename ImageData>
+void tiff_reader<T>::read_tiled_cached(std::size_t x0, std::size_t y0, ImageData& image)
+{
+    using traits = detail::tiff_reader_traits<ImageData>;
+    using pixel_type = typename traits::pixel_type;
+
+    struct tile_request
+    {
+        std::size_t x;
+        std::size_t y;
+        tiff_tile_cache::key_type key;
+        tiff_tile_cache::tile_ptr data;
+    };
+
+    TIFF* tif = open(stream_);
+    if (!tif)
+        return;
+    tiff_tile_cache& cache = tiff_tile_cache::instance();
+    std::uint32_t const directory = TIFFCurrentDirectory(tif);
+    std::uint32_t const layout = (sizeof(pixel_type) << 1) | (traits::reverse ? 1 : 0);
+    std::size_t start_y = (y0 / tile_height_) * tile_height_;
+    std::size_t end_y = std::min(((y0 + image.height()) / tile_height_ + 1) * tile_height_, height_);
+    std::size_t start_x = (x0 / tile_width_) * tile_width_;
+    std::size_t end_x = std::min(((x0 + image.width()) / tile_width_ + 1) * tile_width_, width_);
+
+    std::vector<tile_request> requests;
+    std::vector<std::size_t> missing;
+    for (std::size_t y = start_y; y < end_y; y += tile_height_)
+    {
+        for (std::size_t x = start_x; x < end_x; x += tile_width_)
+        {
+            tiff_tile_cache::key_type key{filename_, directory, TIFFComputeTile(tif, x, y, 0, 0), layout};
+            tiff_tile_cache::tile_ptr data = cache.find(key);
+            if (!data)
+                missing.push_back(requests.size());
+            requests.push_back(tile_request{x, y, std::move(key), std::move(data)});
+        }
+    }
+
+    std::atomic<std::size_t> next(0);
+    auto decode = [&](TIFF* handle) {
+        for (std::size_t i = next++; i < missing.size(); i = next++)
+        {
+            tile_request& request = requests[missing[i]];
+            request.data = decode_tile<ImageData>(handle, request.x, request.y);
+            cache.insert(request.key, request.data);
+        }
+    };
+    if (missing.size() > 1)
+    {
+        // pool threads each read through their own libtiff handle, whatever
+        // they cannot open a handle for is left to the calling thread
+        auto helper = [&] {
+            std::unique_ptr<std::streambuf> buffer = open_buffer();
+            if (!buffer)
+                return;
+            std::istream input(buffer.get());
+            tiff_ptr handle(TIFFClientOpen("tiff_input_stream",
+                                           "rcm",
+                                           reinterpret_cast<thandle_t>(&input),
+                                           detail::tiff_read_proc,
+                                           detail::tiff_write_proc,
+                                           detail::tiff_seek_proc,
+                                           detail::tiff_close_proc,
+                                           detail::tiff_size_proc,
+                                           detail::tiff_map_proc,
+                                           detail::tiff_unmap_proc),
+                            tiff_closer());
+            if (handle && TIFFSetDirectory(handle.get(), directory))
+            {
+                decode(handle.get());
+            }
+        };
+        auto job = [&] {
+            try
+            {
+                decode(tif);
+            }
+            catch (...)
+            {
+                next = missing.size();
+                throw;
             }
+        };
+        cache.run_decode(static_cast<unsigned>(missing.size() - 1), helper, job);
+    }
+    else
+    {
+        decode(tif);
+    }
+
+    for (auto const& request : requests)
+    {
+        if (!request.data)
+        {
+            MAPNIK_LOG_DEBUG(tiff_reader) << "read_tile(...) failed at " << request.x << "/" << request.y << " for "
+                                          << width_ << "/" << height_ << "\n";
+            continue;
+        }
+        copy_tile(x0, y0, request.x, request.y, reinterpret_cast<pixel_type const*>(request.data->data()), image);
+    }
+}
+
+template<typename T>
+template<typename ImageData, typename Pixel>
+void tiff_reader<T>::copy_tile(std::size_t x0,
+                               std::size_t y0,
+                               std::size_t x,
+                               std::size_t y,
+                               Pixel const* tile,
+                               ImageData& image)
+{
+    std::size_t width = image.width();
+    std::size_t height = image.height();
+    std::size_t ty0 = std::max(y0, y) - y;
+    std::size_t ty1 = std::min(height + y0, y + tile_height_) - y;
+    std::size_t tx0 = std::max(x0, x);
+    std::size_t tx1 = std::min(width + x0, x + tile_width_);
+    std::size_t row_index = y + ty0 - y0;
+
+    if (detail::tiff_reader_traits<ImageData>::reverse)
+    {
+        for (std::size_t ty = ty0; ty < ty1; ++ty, ++row_index)
+        {
+            // This is in reverse because the TIFFReadRGBATile reads are inverted
+            image.set_row(row_index, tx0 - x0, tx1 - x0, &tile[(tile_height_ - ty - 1) * tile_width_ + tx0 - x]);
+        }
+    }
+    else
+    {
+        for (std::size_t ty = ty0; ty < ty1; ++ty, ++row_index)
+        {
+            image.set_row(row_index, tx0 - x0, tx1 - x0, &tile[ty * tile_width_ + tx0 - x]);
         }
     }
 }
 
+// decodes a single tile into a buffer that can be shared through tiff_tile_cache,
+// returns an empty pointer on failure
+template<typename T>
+template<typename ImageData>
+tiff_tile_cache::tile_ptr tiff_reader<T>::decode_tile(TIFF* tif, std::size_t x, std::size_t y)
+{
+    using pixel_type = typename detail::tiff_reader_traits<ImageData>::pixel_type;
+
+    std::uint32_t tile_size = TIFFTileSize(tif);
+    std::unique_ptr<pixel_type[]> tile(new pixel_type[tile_size]);
+    if (!detail::tiff_reader_traits<ImageData>::read_tile(tif, x, y, tile.get(), tile_width_, tile_height_))
+    {
+        return tiff_tile_cache::tile_ptr();
+    }
+    if ((bands_ > 1) && (tile_size / (tile_width_ * tile_height_ * sizeof(pixel_type)) == bands_))
+    {
+        std::uint32_t size = tile_width_ * tile_height_ * sizeof(pixel_type);
+        for (std::uint32_t n = 0; n < size; ++n)
+        {
+            tile[n] = tile[n * bands_];
+        }
+    }
+    std::uint8_t const* begin = reinterpret_cast<std::uint8_t const*>(tile.get());
+    return std::make_shared<std::vector<std::uint8_t> const>(
+      begin,
+      begin + std::size_t(tile_width_) * tile_height_ * sizeof(pixel_type));
+}
+
+template<typename T>
+std::unique_ptr<std::streambuf> tiff_reader<T>::open_buffer() const
+{
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+    if (mapped_region_)
+    {
+        return std::unique_ptr<std::streambuf>(
+          new util::char_array_buffer(static_cast<char const*>(mapped_region_->get_address()),
+                                      mapped_region_->get_size()));
+    }
+#endif
+    std::unique_ptr<std::filebuf> buffer(new std::filebuf);
+    if (!buffer->open(filename_, std::ios_base::in | std::ios_base::binary))
+    {
+        return std::unique_ptr<std::streambuf>();
+    }
+    return std::unique_ptr<std::streambuf>(buffer.release());
+}
+
 template<typename T>
 template<typename ImageData>
 void tiff_reader<T>::read_stripped(std::size_t x0, std::size_t y0, ImageData& image)
@@ -0,0 +1,326 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/tiff_tile_cache.hpp>
+#include <mapnik/debug.hpp>
+
+// stl
+#include <algorithm>
+#include <exception>
+
+namespace mapnik {
+
+template class singleton<tiff_tile_cache, CreateStatic>;
+
+#ifdef MAPNIK_THREADSAFE
+// one run_decode() call waiting for pool threads
+struct tiff_tile_cache::decode_batch
+{
+    std::function<void()> const* helper;
+    unsigned queued;
+    unsigned running;
+};
+#endif
+
+tiff_tile_cache::tiff_tile_cache()
+    : tiles_()
+    , index_()
+    , max_size_(0)
+    , stats_()
+#ifdef MAPNIK_THREADSAFE
+    , pool_mutex_()
+    , pool_wake_()
+    , pool_done_()
+    , queue_()
+    , workers_()
+    , stop_(false)
+#endif
+    , decode_threads_(1)
+{}
+
+tiff_tile_cache::~tiff_tile_cache()
+{
+#ifdef MAPNIK_THREADSAFE
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stop_ = true;
+    }
+    pool_wake_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+#endif
+}
+
+std::size_t tiff_tile_cache::key_hash::operator()(key_type const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.file);
+    seed ^= std::hash<std::uint32_t>()(key.directory) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<std::uint32_t>()(key.tile) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<std::uint32_t>()(key.layout) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+void tiff_tile_cache::set_max_size(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    max_size_ = bytes;
+    evict(max_size_);
+}
+
+std::size_t tiff_tile_cache::max_size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return max_size_;
+}
+
+void tiff_tile_cache::set_decode_threads(unsigned threads)
+{
+#ifdef MAPNIK_THREADSAFE
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        decode_threads_ = std::max(1u, threads);
+    }
+    // workers above the new bound go idle
+    pool_wake_.notify_all();
+#else
+    decode_threads_ = std::max(1u, threads);
+#endif
+}
+
+unsigned tiff_tile_cache::decode_threads() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+#endif
+    return decode_threads_;
+}
+
+void tiff_tile_cache::run_decode(unsigned helpers,
+                                 std::function<void()> const& helper,
+                                 std::function<void()> const& job)
+{
+#ifdef MAPNIK_THREADSAFE
+    decode_batch batch{&helper, 0, 0};
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        batch.queued = std::min(helpers, decode_threads_ - 1);
+        queued = batch.queued > 0;
+        if (queued)
+        {
+            // workers only ever get added, a lower bound idles the extra ones
+            while (workers_.size() < decode_threads_ - 1)
+            {
+                workers_.emplace_back(&tiff_tile_cache::decode_worker, this, static_cast<unsigned>(workers_.size()));
+            }
+            queue_.push_back(&batch);
+        }
+    }
+    if (queued)
+    {
+        pool_wake_.notify_all();
+    }
+    std::exception_ptr error;
+    try
+    {
+        job();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    {
+        std::unique_lock<std::mutex> lock(pool_mutex_);
+        if (batch.queued > 0)
+        {
+            batch.queued = 0;
+            queue_.remove(&batch);
+        }
+        pool_done_.wait(lock, [&batch] { return batch.running == 0; });
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+#else
+    (void)helpers;
+    (void)helper;
+    job();
+#endif
+}
+
+bool tiff_tile_cache::enabled() const
+{
+    return max_size() > 0;
+}
+
+tiff_tile_cache::tile_ptr tiff_tile_cache::find(key_type const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto itr = index_.find(key);
+    if (itr == index_.end())
+    {
+        ++stats_.misses;
+        return tile_ptr();
+    }
+    ++stats_.hits;
+    tiles_.splice(tiles_.begin(), tiles_, itr->second);
+    return itr->second->second;
+}
+
+void tiff_tile_cache::insert(key_type const& key, tile_ptr tile)
+{
+    if (!tile)
+        return;
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    if (tile->size() > max_size_)
+        return;
+    auto itr = index_.find(key);
+    if (itr != index_.end())
+    {
+        // decoded concurrently by another reader, keep the one already cached
+        tiles_.splice(tiles_.begin(), tiles_, itr->second);
+        return;
+    }
+    evict(max_size_ - tile->size());
+    tiles_.emplace_front(key, std::move(tile));
+    index_.emplace(key, tiles_.begin());
+    stats_.size += tiles_.front().second->size();
+    ++stats_.tiles;
+}
+
+bool tiff_tile_cache::remove(std::string const& file)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    bool removed = false;
+    for (auto itr = tiles_.begin(); itr != tiles_.end();)
+    {
+        if (itr->first.file == file)
+        {
+            stats_.size -= itr->second->size();
+            --stats_.tiles;
+            index_.erase(itr->first);
+            itr = tiles_.erase(itr);
+            removed = true;
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+    return removed;
+}
+
+void tiff_tile_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    index_.clear();
+    tiles_.clear();
+    stats_.size = 0;
+    stats_.tiles = 0;
+}
+
+tiff_tile_cache::statistics tiff_tile_cache::stats() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return stats_;
+}
+
+void tiff_tile_cache::reset_stats()
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    stats_.hits = 0;
+    stats_.misses = 0;
+    stats_.evictions = 0;
+}
+
+#ifdef MAPNIK_THREADSAFE
+void tiff_tile_cache::decode_worker(unsigned index)
+{
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    for (;;)
+    {
+        pool_wake_.wait(lock, [this, index] { return stop_ || (!queue_.empty() && index + 1 < decode_threads_); });
+        if (stop_)
+            return;
+        decode_batch* batch = queue_.front();
+        if (--batch->queued == 0)
+        {
+            queue_.pop_front();
+        }
+        ++batch->running;
+        lock.unlock();
+        try
+        {
+            (*batch->helper)();
+        }
+        catch (std::exception const& ex)
+        {
+            MAPNIK_LOG_ERROR(tiff_tile_cache) << "tiff_tile_cache: decode failed: " << ex.what();
+        }
+        catch (...)
+        {
+            MAPNIK_LOG_ERROR(tiff_tile_cache) << "tiff_tile_cache: decode failed";
+        }
+        lock.lock();
+        --batch->running;
+        pool_done_.notify_all();
+    }
+}
+#endif
+
+// drops least recently used tiles until at most max_size bytes are cached,
+// expects the lock to be held
+void tiff_tile_cache::evict(std::size_t max_size)
+{
+    while (!tiles_.empty() && stats_.size > max_size)
+    {
+        auto const& entry = tiles_.back();
+        stats_.size -= entry.second->size();
+        --stats_.tiles;
+        ++stats_.evictions;
+        index_.erase(entry.first);
+        tiles_.pop_back();
+    }
+}
+
+} // namespace mapnik
@@ -9,7 +9,7 @@ namespace mapnik {
 namespace util {
 mapped_memory_file::mapped_memory_file() {}
 
-mapped_memory_file::mapped_memory_file(std::string const& file_name)
+mapped_memory_file::mapped_memory_file(std::string const& file_name, mapped_access access)
     : file_name_{file_name}
     ,
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
@@ -21,7 +21,8 @@ mapped_memory_file::mapped_memory_file(std::string const& file_name)
 #endif
 {
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
-    boost::optional<mapnik::mapped_region_ptr> memory = mapnik::mapped_memory_cache::instance().find(file_name, true);
+    boost::optional<mapnik::mapped_region_ptr> memory =
+      mapnik::mapped_memory_cache::instance().find(file_name, true, access);
 
     if (memory)
     {
@@ -32,6 +33,8 @@ mapped_memory_file::mapped_memory_file(std::string const& file_name)
     {
         throw std::runtime_error("could not create file mapping for " + file_name);
     }
+#else
+    (void)access;
 #endif
 }
 
@@ -29,6 +29,10 @@ else:
     if test_env['PLATFORM'] == 'Linux':
         test_env['LINKFLAGS'].append('-pthread')
     test_env.AppendUnique(LIBS='boost_program_options%s' % env['BOOST_APPEND'])
+    # unit/datasource/sqlite.cpp drives the sqlite plugin's connection classes directly
+    test_env.AppendUnique(CPPPATH=env['SQLITE_INCLUDES'])
+    test_env.AppendUnique(LIBPATH=env['SQLITE_LIBS'])
+    test_env.AppendUnique(LIBS='sqlite3')
     test_env_local = test_env.Clone()
 
 
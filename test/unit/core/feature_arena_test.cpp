@@ -0,0 +1,103 @@
+#include "catch.hpp"
+
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_arena.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/value/types.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("feature arena")
+{
+    SECTION("features are heap allocated outside of a scope")
+    {
+        REQUIRE(mapnik::feature_arena::current() == nullptr);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("name");
+        auto feature = mapnik::feature_factory::create(ctx, 1);
+        feature->put("name", mapnik::value_unicode_string("heap"));
+        CHECK(feature->get("name") == mapnik::value_unicode_string("heap"));
+    }
+
+    SECTION("features are allocated from the scoped arena")
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("name");
+        ctx->push("height");
+        mapnik::feature_arena arena(4096);
+        REQUIRE(arena.bytes_allocated() == 0);
+        mapnik::feature_ptr survivor;
+        {
+            mapnik::feature_arena::scope guard(arena);
+            REQUIRE(mapnik::feature_arena::current() == &arena);
+            for (mapnik::value_integer i = 0; i < 100; ++i)
+            {
+                auto feature = mapnik::feature_factory::create(ctx, i);
+                feature->put("height", i);
+                feature->put_new("extra", mapnik::value_bool(true));
+                if (i == 42)
+                    survivor = feature;
+            }
+        }
+        CHECK(mapnik::feature_arena::current() == nullptr);
+        CHECK(arena.bytes_allocated() > 100 * sizeof(mapnik::feature_impl));
+        CHECK(arena.bytes_reserved() >= arena.bytes_allocated());
+        // features outliving the arena keep their blocks alive
+        arena.release();
+        CHECK(arena.bytes_allocated() == 0);
+        REQUIRE(survivor);
+        CHECK(survivor->id() == 42);
+        CHECK(survivor->get("height") == mapnik::value_integer(42));
+        CHECK(survivor->get("extra") == mapnik::value_bool(true));
+    }
+
+#ifdef MAPNIK_THREADSAFE
+    SECTION("escaped features grow safely on other threads")
+    {
+        mapnik::feature_arena arena(1024);
+        std::vector<mapnik::feature_ptr> features;
+        {
+            mapnik::feature_arena::scope guard(arena);
+            for (mapnik::value_integer i = 0; i < 8; ++i)
+            {
+                // one context each, contexts are not meant to be shared across threads while growing
+                features.push_back(mapnik::feature_factory::create(std::make_shared<mapnik::context_type>(), i));
+            }
+        }
+        // every put_new grows a feature's attribute vector from the shared arena
+        std::vector<std::thread> workers;
+        for (auto const& feature : features)
+        {
+            workers.emplace_back([feature]() {
+                for (mapnik::value_integer j = 0; j < 200; ++j)
+                {
+                    feature->put_new("key" + std::to_string(j), j);
+                }
+            });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        for (auto const& feature : features)
+        {
+            CHECK(feature->size() == 200);
+            CHECK(feature->get("key199") == mapnik::value_integer(199));
+        }
+    }
+#endif
+
+    SECTION("scopes nest")
+    {
+        mapnik::feature_arena outer;
+        mapnik::feature_arena inner;
+        mapnik::feature_arena::scope outer_guard(outer);
+        {
+            mapnik::feature_arena::scope inner_guard(inner);
+            CHECK(mapnik::feature_arena::current() == &inner);
+        }
+        CHECK(mapnik::feature_arena::current() == &outer);
+    }
+}
@@ -0,0 +1,107 @@
+#include "catch.hpp"
+
+#include <mapnik/mapped_memory_cache.hpp>
+
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <vector>
+
+TEST_CASE("mapped memory cache")
+{
+    std::string const filename = "./test/data/mapnik-mapped-memory-cache.bin";
+    {
+        std::ofstream out(filename, std::ios::binary);
+        std::vector<char> data(64 * 1024, 'x');
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    auto& cache = mapnik::mapped_memory_cache::instance();
+    cache.clear();
+
+    SECTION("lookups are shared across threads")
+    {
+        auto region = cache.find(filename, true, mapnik::mapped_access::random);
+        REQUIRE(region.is_initialized());
+        REQUIRE((*region)->get_size() == 64 * 1024);
+
+        std::vector<std::thread> threads;
+        std::vector<int> same(8, 0);
+        for (std::size_t i = 0; i < same.size(); ++i)
+        {
+            threads.emplace_back([&, i]() {
+                bool ok = true;
+                for (int n = 0; n < 1000; ++n)
+                {
+                    auto r = cache.find(filename, true);
+                    ok = ok && r && *r == *region;
+                }
+                same[i] = ok ? 1 : 0;
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        CHECK(std::all_of(same.begin(), same.end(), [](int ok) { return ok == 1; }));
+
+        auto stats = cache.stats();
+        REQUIRE(stats.size() == 1);
+        CHECK(stats[0].key == filename);
+        CHECK(stats[0].size == 64 * 1024);
+        CHECK(stats[0].hits == 1 + 8 * 1000);
+        CHECK(stats[0].resident <= stats[0].size);
+    }
+
+    SECTION("removed files are mapped again")
+    {
+        auto first = cache.find(filename, true, mapnik::mapped_access::populate);
+        REQUIRE(first.is_initialized());
+        CHECK(cache.remove(filename));
+        CHECK(cache.stats().empty());
+        auto second = cache.find(filename, true);
+        REQUIRE(second.is_initialized());
+        CHECK(*first != *second);
+    }
+
+    SECTION("removed files are unmapped while other threads are alive")
+    {
+        std::weak_ptr<boost::interprocess::mapped_region> mapped;
+        {
+            auto region = cache.find(filename, true);
+            REQUIRE(region.is_initialized());
+            mapped = *region;
+        }
+        std::promise<void> looked_up;
+        std::promise<void> removed;
+        bool found = false;
+        std::thread reader([&]() {
+            // leaves the file in this thread's local view
+            found = cache.find(filename, true).is_initialized();
+            looked_up.set_value();
+            removed.get_future().wait();
+        });
+        looked_up.get_future().wait();
+        CHECK(found);
+        CHECK_FALSE(mapped.expired());
+        CHECK(cache.remove(filename));
+        CHECK(mapped.expired());
+        removed.set_value();
+        reader.join();
+    }
+
+    SECTION("uncached lookups don't populate the cache")
+    {
+        auto region = cache.find(filename, false);
+        REQUIRE(region.is_initialized());
+        CHECK(cache.stats().empty());
+        CHECK_FALSE(cache.find("./test/data/mapnik-mapped-memory-cache-missing.bin", true).is_initialized());
+    }
+
+    cache.clear();
+    std::remove(filename.c_str());
+}
+
+#endif
@@ -30,6 +30,7 @@
 #include <mapnik/geometry.hpp>
 #include <mapnik/geometry/geometry_types.hpp>
 #include <mapnik/geometry/geometry_type.hpp>
+#include <mapnik/geometry/envelope.hpp>
 #include <mapnik/expression.hpp>
 #include <mapnik/expression_evaluator.hpp>
 #include <mapnik/debug.hpp>
@@ -44,6 +45,7 @@ MAPNIK_DISABLE_WARNING_PUSH
 #include <boost/algorithm/string.hpp>
 MAPNIK_DISABLE_WARNING_POP
 
+#include <fstream>
 #include <iostream>
 
 namespace {
@@ -479,6 +481,50 @@ TEST_CASE("csv")
             }
         } // END SECTION
 
+        SECTION("parallel parsing")
+        {
+            // large enough to be split into several chunks, with quoted
+            // newlines and blank rows to exercise the chunk boundaries
+            std::string filename = "/tmp/mapnik-csv-parallel-test.csv";
+            {
+                std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+                out << "x,y,name\n";
+                for (int i = 0; i < 200000; ++i)
+                {
+                    out << (i % 360) - 180 << "," << (i % 170) - 85 << ",\"line\n" << i << "\"\n";
+                    if (i % 1000 == 0)
+                        out << "\n";
+                }
+            }
+            auto make_ds = [&](int threads) {
+                mapnik::parameters params;
+                params["type"] = std::string("csv");
+                params["file"] = filename;
+                params["strict"] = mapnik::value_bool(true);
+                params["threads"] = mapnik::value_integer(threads);
+                return mapnik::datasource_cache::instance().create(params);
+            };
+            auto serial = make_ds(1);
+            auto parallel = make_ds(4);
+            CHECK(serial->envelope() == parallel->envelope());
+            require_field_names(parallel->get_descriptor().get_descriptors(), {"x", "y", "name"});
+            auto fs0 = all_features(serial);
+            auto fs1 = all_features(parallel);
+            std::size_t count = 0;
+            while (auto f0 = fs0->next())
+            {
+                auto f1 = fs1->next();
+                REQUIRE(f1);
+                CHECK(f0->id() == f1->id());
+                CHECK(f0->get("name") == f1->get("name"));
+                CHECK(mapnik::geometry::envelope(f0->get_geometry()) == mapnik::geometry::envelope(f1->get_geometry()));
+                ++count;
+            }
+            CHECK(!fs1->next());
+            CHECK(count == 200000);
+            mapnik::util::remove(filename);
+        } // END SECTION
+
         SECTION("handling of missing header")
         {
             for (auto create_index : {false, true})
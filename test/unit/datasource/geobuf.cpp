@@ -246,5 +246,51 @@ TEST_CASE("Geobuf")
             REQUIRE(line[1].y == 1);
             CHECK(fs->next() == nullptr);
         }
+
+        SECTION("cache_features=false decodes the same features")
+        {
+            auto files = {"./test/data/geobuf/point.geobuf",
+                          "./test/data/geobuf/multipoint.geobuf",
+                          "./test/data/geobuf/linestring.geobuf",
+                          "./test/data/geobuf/multilinestring.geobuf",
+                          "./test/data/geobuf/polygon.geobuf",
+                          "./test/data/geobuf/multipolygon.geobuf",
+                          "./test/data/geobuf/geometrycollection.geobuf",
+                          "./test/data/geobuf/standalone-feature.geobuf",
+                          "./test/data/geobuf/standalone-geometry.geobuf"};
+            for (auto const& filename : files)
+            {
+                mapnik::parameters params;
+                params["type"] = "geobuf";
+                params["file"] = filename;
+                auto cached_ds = mapnik::datasource_cache::instance().create(params);
+                params["cache_features"] = false;
+                auto ds = mapnik::datasource_cache::instance().create(params);
+                CHECK(ds->envelope() == cached_ds->envelope());
+                CHECK(ds->get_geometry_type() == cached_ds->get_geometry_type());
+                CHECK(vector_to_string(ds->get_descriptor().get_descriptors()) ==
+                      vector_to_string(cached_ds->get_descriptor().get_descriptors()));
+
+                auto cached_fs = all_features(cached_ds);
+                auto fs = all_features(ds);
+                std::size_t count = 0;
+                while (auto cached_feature = cached_fs->next())
+                {
+                    auto feature = fs->next();
+                    REQUIRE(feature != nullptr);
+                    CHECK(feature->id() == cached_feature->id());
+                    CHECK(feature->envelope() == cached_feature->envelope());
+                    CHECK(mapnik::geometry::geometry_type(feature->get_geometry()) ==
+                          mapnik::geometry::geometry_type(cached_feature->get_geometry()));
+                    for (auto const& kv : *cached_feature)
+                    {
+                        CHECK(feature->get(std::get<0>(kv)) == std::get<1>(kv));
+                    }
+                    ++count;
+                }
+                CHECK(fs->next() == nullptr);
+                CHECK(count > 0);
+            }
+        }
     }
 }
@@ -32,6 +32,7 @@
 #include <mapnik/util/geometry_to_geojson.hpp>
 #include <mapnik/util/fs.hpp>
 #include <cstdlib>
+#include <fstream>
 #include <algorithm>
 #include <cctype>
 #include <locale>
@@ -160,6 +161,54 @@ TEST_CASE("geojson")
             }
         }
 
+        SECTION("GeoJSON parallel bounding box extraction")
+        {
+            // large enough to be split across threads, strings contain brackets
+            // to make sure feature boundaries are found correctly
+            std::string filename = "/tmp/mapnik-geojson-parallel-test.json";
+            {
+                std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+                out << "{\"type\":\"FeatureCollection\",\"features\":[";
+                for (int i = 0; i < 50000; ++i)
+                {
+                    if (i > 0)
+                        out << ",\n";
+                    out << "{\"type\":\"Feature\",\"properties\":{\"name\":\"}]{[\\\"" << i << "\"},"
+                        << "\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[" << (i % 360) - 180 << ","
+                        << (i % 170) - 85 << "],[" << (i % 360) - 179.5 << "," << (i % 170) - 84.5 << "]]}}";
+                }
+                out << "]}\n";
+            }
+            for (auto cache_features : {true, false})
+            {
+                auto make_ds = [&](int threads) {
+                    mapnik::parameters params;
+                    params["type"] = "geojson";
+                    params["file"] = filename;
+                    params["cache_features"] = cache_features;
+                    params["threads"] = mapnik::value_integer(threads);
+                    return mapnik::datasource_cache::instance().create(params);
+                };
+                auto serial = make_ds(1);
+                auto parallel = make_ds(4);
+                CHECK(serial->envelope() == parallel->envelope());
+                auto fs0 = all_features(serial);
+                auto fs1 = all_features(parallel);
+                std::size_t count = 0;
+                while (auto f0 = fs0->next())
+                {
+                    auto f1 = fs1->next();
+                    REQUIRE(f1);
+                    CHECK(f0->id() == f1->id());
+                    CHECK(f0->get("name") == f1->get("name"));
+                    ++count;
+                }
+                CHECK(!fs1->next());
+                CHECK(count == 50000);
+            }
+            mapnik::util::remove(filename);
+        }
+
         SECTION("GeoJSON num_features_to_query")
         {
             std::string filename = "./test/data/json/featurecollection-multipleprops.geojson";
@@ -27,6 +27,30 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/memory_datasource.hpp>
 #include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/query.hpp>
+
+namespace {
+
+std::vector<mapnik::value_integer> query_ids(mapnik::datasource_ptr const& ds, mapnik::box2d<double> const& box)
+{
+    std::vector<mapnik::value_integer> ids;
+    auto fs = ds->features(mapnik::query(box));
+    while (auto f = fs->next())
+    {
+        ids.push_back(f->id());
+    }
+    return ids;
+}
+
+void push_point(mapnik::memory_datasource& ds, mapnik::context_ptr const& ctx, mapnik::value_integer id, double x, double y)
+{
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id));
+    feature->set_geometry(mapnik::geometry::point<double>(x, y));
+    ds.push(feature);
+}
+
+} // namespace
 
 TEST_CASE("memory datasource")
 {
@@ -42,4 +66,49 @@ TEST_CASE("memory datasource")
             CHECK(false); // shouldn't get here
         }
     }
+
+    SECTION("spatial index")
+    {
+        mapnik::parameters params;
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        auto ctx = std::make_shared<mapnik::context_type>();
+        for (int i = 0; i < 100; ++i)
+        {
+            push_point(*ds, ctx, i, i, i);
+        }
+        // empty geometries are never returned by a bbox query
+        ds->push(mapnik::feature_factory::create(ctx, 1000));
+
+        using ids = std::vector<mapnik::value_integer>;
+        CHECK(query_ids(ds, mapnik::box2d<double>(10, 10, 12, 12)) == ids{10, 11, 12});
+        CHECK(query_ids(ds, mapnik::box2d<double>(200, 200, 300, 300)).empty());
+
+        // features pushed after the index was built are found, in push order
+        push_point(*ds, ctx, 101, 10.5, 10.5);
+        CHECK(query_ids(ds, mapnik::box2d<double>(10, 10, 11, 11)) == ids{10, 11, 101});
+
+        auto fs = ds->features_at_point(mapnik::coord2d(50, 50), 0.5);
+        REQUIRE(mapnik::is_valid(fs));
+        auto f = fs->next();
+        REQUIRE(f);
+        CHECK(f->id() == 50);
+        CHECK(!fs->next());
+
+        ds->clear();
+        CHECK(ds->size() == 0);
+        push_point(*ds, ctx, 7, 10, 10);
+        CHECK(query_ids(ds, mapnik::box2d<double>(0, 0, 100, 100)) == ids{7});
+    }
+
+    SECTION("bbox_check=false returns everything")
+    {
+        mapnik::parameters params;
+        params["bbox_check"] = false;
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        auto ctx = std::make_shared<mapnik::context_type>();
+        push_point(*ds, ctx, 1, 0, 0);
+        push_point(*ds, ctx, 2, 100, 100);
+        using ids = std::vector<mapnik::value_integer>;
+        CHECK(query_ids(ds, mapnik::box2d<double>(-1, -1, 1, 1)) == ids{1, 2});
+    }
 }
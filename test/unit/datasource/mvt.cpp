@@ -0,0 +1,228 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+#include "ds_test_util.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/geometry/envelope.hpp>
+#include <mapnik/geometry/geometry_type.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/well_known_srs.hpp>
+
+#include <boost/optional/optional_io.hpp>
+
+#include <fstream>
+#include <map>
+
+namespace {
+
+// tile 0/0/0 with a layer "places" of extent 4096 holding, in tile coordinates:
+//   1: point (2048, 2048), name=centre, rank=7
+//   2: point (1024, 1024), name=corner
+//   3: line string (1024, 3072) (3072, 3072), name=road
+//   4: polygon (1024, 1024) (3072, 1024) (3072, 3072) (1024, 3072), name=square, rank=7
+unsigned char const tile[] = {
+    0x1a, 0x9a, 0x01, 0x78, 0x02, 0x0a, 0x06, 0x70, 0x6c, 0x61, 0x63, 0x65, 0x73, 0x12, 0x11, 0x08,
+    0x01, 0x12, 0x04, 0x00, 0x00, 0x01, 0x04, 0x18, 0x01, 0x22, 0x05, 0x09, 0x80, 0x20, 0x80, 0x20,
+    0x12, 0x0f, 0x08, 0x02, 0x12, 0x02, 0x00, 0x01, 0x18, 0x01, 0x22, 0x05, 0x09, 0x80, 0x10, 0x80,
+    0x10, 0x12, 0x13, 0x08, 0x03, 0x12, 0x02, 0x00, 0x02, 0x18, 0x02, 0x22, 0x09, 0x09, 0x80, 0x10,
+    0x80, 0x30, 0x0a, 0x80, 0x20, 0x00, 0x12, 0x1c, 0x08, 0x04, 0x12, 0x04, 0x00, 0x03, 0x01, 0x04,
+    0x18, 0x03, 0x22, 0x10, 0x09, 0x80, 0x10, 0x80, 0x10, 0x1a, 0x80, 0x20, 0x00, 0x00, 0x80, 0x20,
+    0xff, 0x1f, 0x00, 0x0f, 0x1a, 0x04, 0x6e, 0x61, 0x6d, 0x65, 0x1a, 0x04, 0x72, 0x61, 0x6e, 0x6b,
+    0x22, 0x08, 0x0a, 0x06, 0x63, 0x65, 0x6e, 0x74, 0x72, 0x65, 0x22, 0x08, 0x0a, 0x06, 0x63, 0x6f,
+    0x72, 0x6e, 0x65, 0x72, 0x22, 0x06, 0x0a, 0x04, 0x72, 0x6f, 0x61, 0x64, 0x22, 0x08, 0x0a, 0x06,
+    0x73, 0x71, 0x75, 0x61, 0x72, 0x65, 0x22, 0x02, 0x20, 0x07, 0x28, 0x80, 0x20};
+
+unsigned char const gzipped_tile[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x25, 0xcb, 0xc1, 0x0e, 0xc2, 0x20,
+    0x10, 0x04, 0xd0, 0x65, 0xc1, 0x4a, 0xb9, 0x14, 0xe9, 0xa5, 0x21, 0x26, 0x6e, 0x38, 0x79, 0xf4,
+    0x97, 0x48, 0xe5, 0xa4, 0x52, 0xa5, 0x9a, 0x78, 0xdc, 0xef, 0xf0, 0x67, 0x95, 0xd6, 0xdb, 0xe4,
+    0xcd, 0x8c, 0xff, 0x88, 0x37, 0x9a, 0xe6, 0x7e, 0x8d, 0x63, 0x9a, 0xdd, 0x4e, 0x0b, 0xa7, 0x00,
+    0x84, 0x1a, 0x44, 0xd8, 0xb4, 0x4c, 0x4c, 0xae, 0xd3, 0xe8, 0x10, 0xc4, 0x1f, 0x2c, 0x5b, 0xd7,
+    0x6b, 0x59, 0x01, 0x07, 0x0c, 0xed, 0x02, 0x27, 0xc3, 0x04, 0x6e, 0xaf, 0x55, 0x3d, 0xca, 0x7a,
+    0x94, 0xc1, 0xae, 0x3b, 0x5f, 0x19, 0x98, 0xbe, 0x07, 0xe8, 0xbc, 0xca, 0xf1, 0x96, 0xbc, 0x2a,
+    0x31, 0x5f, 0x82, 0x36, 0xcd, 0x98, 0xf2, 0xb3, 0xa4, 0x35, 0x4d, 0x25, 0xa7, 0x12, 0x1a, 0xa3,
+    0xca, 0x14, 0xcf, 0x8b, 0xcc, 0x8f, 0x57, 0xac, 0x1d, 0xd2, 0xf6, 0xc8, 0xf4, 0x03, 0x9d, 0x63,
+    0x39, 0x2c, 0x9d, 0x00, 0x00, 0x00};
+
+std::string const tile_file = "./test/data/mvt-fixture.mvt";
+std::string const gzipped_tile_file = "./test/data/mvt-fixture-gzipped.mvt";
+
+template<std::size_t N>
+void write_fixture(std::string const& file_name, unsigned char const (&data)[N])
+{
+    std::ofstream out(file_name, std::ios::binary);
+    out.write(reinterpret_cast<char const*>(data), N);
+}
+
+mapnik::datasource_ptr get_mvt_ds(std::string const& file_name)
+{
+    const bool have_mvt_plugin = mapnik::datasource_cache::instance().plugin_registered("mvt");
+    if (!have_mvt_plugin)
+    {
+        return mapnik::datasource_ptr();
+    }
+
+    mapnik::parameters params;
+    params["type"] = std::string("mvt");
+    params["file"] = file_name;
+    params["layer"] = std::string("places");
+    params["z"] = mapnik::value_integer(0);
+    params["x"] = mapnik::value_integer(0);
+    params["y"] = mapnik::value_integer(0);
+
+    auto ds = mapnik::datasource_cache::instance().create(params);
+    REQUIRE(ds != nullptr);
+
+    return ds;
+}
+
+std::map<mapnik::value_integer, mapnik::feature_ptr> query_features(mapnik::datasource_ptr const& ds,
+                                                                    mapnik::box2d<double> const& bbox)
+{
+    std::map<mapnik::value_integer, mapnik::feature_ptr> result;
+    mapnik::query q(bbox);
+    q.add_property_name("name");
+    q.add_property_name("rank");
+    auto features = ds->features(q);
+    REQUIRE(features);
+    while (auto feature = features->next())
+    {
+        result.emplace(feature->id(), feature);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+TEST_CASE("mvt")
+{
+    write_fixture(tile_file, tile);
+    write_fixture(gzipped_tile_file, gzipped_tile);
+
+    mapnik::datasource_ptr ds = get_mvt_ds(tile_file);
+    if (!ds)
+    {
+        // mvt plugin not built.
+        mapnik::util::remove(tile_file);
+        mapnik::util::remove(gzipped_tile_file);
+        return;
+    }
+
+    double const half = mapnik::MERC_MAX_EXTENT / 2;
+
+    SECTION("layer description")
+    {
+        CHECK(ds->envelope() == mapnik::box2d<double>(-mapnik::MERC_MAX_EXTENT,
+                                                      -mapnik::MERC_MAX_EXTENT,
+                                                      mapnik::MERC_MAX_EXTENT,
+                                                      mapnik::MERC_MAX_EXTENT));
+        auto fields = ds->get_descriptor().get_descriptors();
+        require_field_names(fields, {"name", "rank"});
+        require_field_types(fields, {mapnik::String, mapnik::Integer});
+        CHECK(ds->get_geometry_type() == mapnik::datasource_geometry_t::Collection);
+    }
+
+    SECTION("features")
+    {
+        auto features = query_features(ds, ds->envelope());
+        REQUIRE(features.size() == 4);
+
+        mapnik::feature_ptr const& centre = features[1];
+        REQUIRE(centre->get_geometry().is<mapnik::geometry::point<double>>());
+        auto const& pt = centre->get_geometry().get<mapnik::geometry::point<double>>();
+        CHECK(pt.x == 0.0);
+        CHECK(pt.y == 0.0);
+        CHECK(centre->get("name") == mapnik::value_unicode_string("centre"));
+        CHECK(centre->get("rank") == mapnik::value_integer(7));
+
+        mapnik::feature_ptr const& corner = features[2];
+        REQUIRE(corner->get_geometry().is<mapnik::geometry::point<double>>());
+        auto const& corner_pt = corner->get_geometry().get<mapnik::geometry::point<double>>();
+        CHECK(corner_pt.x == -half);
+        CHECK(corner_pt.y == half);
+        CHECK(corner->get("name") == mapnik::value_unicode_string("corner"));
+        CHECK(corner->get("rank").is_null());
+
+        mapnik::feature_ptr const& road = features[3];
+        REQUIRE(road->get_geometry().is<mapnik::geometry::line_string<double>>());
+        auto const& line = road->get_geometry().get<mapnik::geometry::line_string<double>>();
+        REQUIRE(line.size() == 2);
+        CHECK(line[0].x == Approx(-half));
+        CHECK(line[0].y == Approx(-half));
+        CHECK(line[1].x == Approx(half));
+        CHECK(line[1].y == Approx(-half));
+
+        mapnik::feature_ptr const& square = features[4];
+        REQUIRE(square->get_geometry().is<mapnik::geometry::polygon<double>>());
+        auto const& poly = square->get_geometry().get<mapnik::geometry::polygon<double>>();
+        REQUIRE(poly.size() == 1);
+        REQUIRE(poly.front().size() == 5);
+        CHECK(poly.front().front().x == poly.front().back().x);
+        CHECK(poly.front().front().y == poly.front().back().y);
+        auto const bbox = mapnik::geometry::envelope(poly);
+        CHECK(bbox.minx() == Approx(-half));
+        CHECK(bbox.miny() == Approx(-half));
+        CHECK(bbox.maxx() == Approx(half));
+        CHECK(bbox.maxy() == Approx(half));
+        CHECK(square->get("rank") == mapnik::value_integer(7));
+    }
+
+    SECTION("bbox queries")
+    {
+        auto features = query_features(ds, mapnik::box2d<double>(-1000, -1000, 1000, 1000));
+        REQUIRE(features.size() == 2);
+        CHECK(features.count(1) == 1);
+        CHECK(features.count(4) == 1);
+        CHECK(query_features(ds, mapnik::box2d<double>(-half - 1, half - 1, -half + 1, half + 1)).size() == 2);
+        CHECK(query_features(ds, mapnik::box2d<double>(half + 1000, half + 1000, half + 2000, half + 2000)).empty());
+    }
+
+    SECTION("gzip compressed tile")
+    {
+        mapnik::datasource_ptr gzipped_ds = get_mvt_ds(gzipped_tile_file);
+        require_field_names(gzipped_ds->get_descriptor().get_descriptors(), {"name", "rank"});
+        auto features = query_features(gzipped_ds, gzipped_ds->envelope());
+        REQUIRE(features.size() == 4);
+        CHECK(features[1]->get("name") == mapnik::value_unicode_string("centre"));
+        CHECK(mapnik::geometry::geometry_type(features[4]->get_geometry()) ==
+              mapnik::geometry::geometry_types::Polygon);
+    }
+
+    SECTION("tile coordinates are required")
+    {
+        mapnik::parameters params;
+        params["type"] = std::string("mvt");
+        params["file"] = tile_file;
+        params["z"] = mapnik::value_integer(1);
+        params["x"] = mapnik::value_integer(0);
+        CHECK_THROWS(mapnik::datasource_cache::instance().create(params));
+        params["y"] = mapnik::value_integer(2);
+        CHECK_THROWS(mapnik::datasource_cache::instance().create(params));
+    }
+
+    ds.reset();
+    mapnik::util::remove(tile_file);
+    mapnik::util::remove(gzipped_tile_file);
+} // END TEST CASE
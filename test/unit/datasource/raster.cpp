@@ -0,0 +1,124 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/util/fs.hpp>
+
+namespace {
+
+mapnik::datasource_ptr get_raster_ds(std::string const& file_name, bool reduced_resolution)
+{
+    const bool have_raster_plugin = mapnik::datasource_cache::instance().plugin_registered("raster");
+    if (!have_raster_plugin)
+    {
+        return mapnik::datasource_ptr();
+    }
+
+    mapnik::parameters params;
+    params["type"] = std::string("raster");
+    params["file"] = file_name;
+    params["lox"] = 0.0;
+    params["loy"] = 0.0;
+    params["hix"] = 256.0;
+    params["hiy"] = 256.0;
+    params["reduced_resolution"] = reduced_resolution;
+
+    auto ds = mapnik::datasource_cache::instance().create(params);
+    REQUIRE(ds != nullptr);
+
+    return ds;
+}
+
+mapnik::raster_ptr read_raster(mapnik::datasource_ptr const& ds, double resolution)
+{
+    mapnik::query::resolution_type res(resolution, resolution);
+    mapnik::query query(ds->envelope(), res, 1.0);
+    auto features = ds->features(query);
+    REQUIRE(features);
+    auto feature = features->next();
+    REQUIRE(feature);
+    mapnik::raster_ptr raster = feature->get_raster();
+    REQUIRE(raster != nullptr);
+    return raster;
+}
+
+} // anonymous namespace
+
+TEST_CASE("raster")
+{
+#if defined(HAVE_PNG)
+    SECTION("reduced resolution")
+    {
+        std::string dataset = "./test/data/raster-reduced-resolution-test.png";
+        mapnik::image_rgba8 im(256, 256);
+        for (unsigned y = 0; y < im.height(); ++y)
+        {
+            for (unsigned x = 0; x < im.width(); ++x)
+            {
+                im(x, y) = x | (y << 8) | (0xffu << 24);
+            }
+        }
+        mapnik::save_to_file(im, dataset, "png32");
+
+        mapnik::datasource_ptr full_ds = get_raster_ds(dataset, false);
+        if (!full_ds)
+        {
+            // raster plugin not built.
+            mapnik::util::remove(dataset);
+            return;
+        }
+        mapnik::datasource_ptr reduced_ds = get_raster_ds(dataset, true);
+
+        // off by default, the whole image is read whatever the output resolution
+        mapnik::raster_ptr full = read_raster(full_ds, 0.25);
+        CHECK(full->data_.width() == 256);
+        CHECK(full->data_.height() == 256);
+
+        // the output is four times coarser than the source
+        mapnik::raster_ptr reduced = read_raster(reduced_ds, 0.25);
+        CHECK(reduced->data_.width() == 64);
+        CHECK(reduced->data_.height() == 64);
+        CHECK(reduced->ext_ == full->ext_);
+        REQUIRE(reduced->data_.is<mapnik::image_rgba8>());
+        auto const& data = reduced->data_.get<mapnik::image_rgba8>();
+        for (unsigned y = 0; y < data.height(); ++y)
+        {
+            for (unsigned x = 0; x < data.width(); ++x)
+            {
+                REQUIRE(data(x, y) == im(x * 4, y * 4));
+            }
+        }
+
+        // reductions are powers of two up to 8
+        CHECK(read_raster(reduced_ds, 0.1)->data_.width() == 32);
+        // not coarse enough to read less
+        CHECK(read_raster(reduced_ds, 0.75)->data_.width() == 256);
+
+        mapnik::util::remove(dataset);
+    }
+#endif
+} // END TEST CASE
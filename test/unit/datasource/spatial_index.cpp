@@ -92,4 +92,101 @@ TEST_CASE("spatial_index")
         REQUIRE(results[3] == 2);
         REQUIRE(results.size() == 4);
     }
+
+    SECTION("bulk loaded mapnik::quad_tree<T>")
+    {
+        using value_type = std::int32_t;
+        using tree_type = mapnik::quad_tree<value_type>;
+        mapnik::box2d<double> extent(0, 0, 100, 100);
+        std::vector<tree_type::item_type> items;
+        for (int i = 0; i < 100; ++i)
+        {
+            double x = (i * 37) % 97;
+            double y = (i * 61) % 89;
+            double size = 1 + (i % 7);
+            items.emplace_back(i, mapnik::box2d<double>(x, y, x + size, y + size));
+        }
+        tree_type tree(extent);
+        for (auto const& item : items)
+        {
+            tree.insert(item.first, item.second);
+        }
+        tree.trim();
+        tree_type packed(extent, items);
+
+        REQUIRE(packed.extent() == tree.extent());
+        REQUIRE(packed.count() == tree.count());
+        REQUIRE(packed.count_items() == tree.count_items());
+        REQUIRE(packed.begin() == packed.end());
+        REQUIRE_THROWS(packed.insert(0, extent));
+
+        // queries return the same items in the same order
+        for (auto const& box : {mapnik::box2d<double>(0, 0, 100, 100),
+                                mapnik::box2d<double>(10, 10, 30, 30),
+                                mapnik::box2d<double>(60, 5, 62, 95),
+                                mapnik::box2d<double>(200, 200, 300, 300)})
+        {
+            std::vector<value_type> expected;
+            for (auto itr = tree.query_in_box(box); itr != tree.query_end(); ++itr)
+            {
+                expected.push_back(*itr);
+            }
+            std::vector<value_type> queried;
+            for (auto itr = packed.query_in_box(box); itr != packed.query_end(); ++itr)
+            {
+                queried.push_back(*itr);
+            }
+            std::vector<value_type> visited;
+            packed.visit_in_box(box, [&visited](value_type const& v) { visited.push_back(v); });
+            std::vector<value_type> visited_tree;
+            tree.visit_in_box(box, [&visited_tree](value_type const& v) { visited_tree.push_back(v); });
+            CHECK(queried == expected);
+            CHECK(visited == expected);
+            CHECK(visited_tree == expected);
+        }
+
+        // serialises to the same index
+        std::ostringstream out(std::ios::binary);
+        tree.write(out);
+        std::ostringstream packed_out(std::ios::binary);
+        packed.write(packed_out);
+        REQUIRE(packed_out.str() == out.str());
+
+        // clustered items collapse the upper levels, the root included, as trim() does
+        for (auto const& cluster : {std::vector<tree_type::item_type>(),
+                                    std::vector<tree_type::item_type>(items.begin(), items.begin() + 1)})
+        {
+            std::vector<tree_type::item_type> clustered(cluster);
+            for (int i = 0; i < 50; ++i)
+            {
+                double x = 1 + (i * 7) % 5;
+                double y = 1 + (i * 3) % 5;
+                clustered.emplace_back(i, mapnik::box2d<double>(x, y, x + 0.1 * (i % 3), y + 0.1));
+            }
+            tree_type clustered_tree(extent);
+            for (auto const& item : clustered)
+            {
+                clustered_tree.insert(item.first, item.second);
+            }
+            clustered_tree.trim();
+            tree_type clustered_packed(extent, clustered);
+            CHECK(clustered_packed.extent() == clustered_tree.extent());
+            CHECK(clustered_packed.count() == clustered_tree.count());
+            std::ostringstream clustered_out(std::ios::binary);
+            clustered_tree.write(clustered_out);
+            std::ostringstream clustered_packed_out(std::ios::binary);
+            clustered_packed.write(clustered_packed_out);
+            CHECK(clustered_packed_out.str() == clustered_out.str());
+        }
+
+        tree_type empty(extent, std::vector<tree_type::item_type>());
+        CHECK(empty.count() == 1);
+        CHECK(empty.count_items() == 0);
+
+        packed.clear();
+        REQUIRE(packed.count() == 1);
+        REQUIRE(packed.count_items() == 0);
+        packed.insert(1, mapnik::box2d<double>(10, 10, 20, 20));
+        REQUIRE(packed.count_items() == 1);
+    }
 }
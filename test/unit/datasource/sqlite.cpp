@@ -0,0 +1,279 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2021 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/util/geometry_to_wkb.hpp>
+#include "../../../plugins/input/sqlite/sqlite_pool.hpp"
+#include "../../../plugins/input/sqlite/sqlite_utils.hpp"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string const dataset = "./test/data/sqlite-pool-test.sqlite";
+
+// 100 points on a 10x10 grid, the point at (x, y) has id y * 10 + x + 1
+void create_points(std::string const& file_name)
+{
+    mapnik::util::remove(file_name);
+    mapnik::util::remove(file_name + ".index");
+    sqlite_connection conn(file_name, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    conn.execute("CREATE TABLE points (id INTEGER PRIMARY KEY, name TEXT, geometry BLOB)");
+    conn.execute("BEGIN");
+    sqlite3_stmt* stmt = conn.prepare_cached("INSERT INTO points VALUES (?1, ?2, ?3)");
+    for (int y = 0; y < 10; ++y)
+    {
+        for (int x = 0; x < 10; ++x)
+        {
+            int id = y * 10 + x + 1;
+            std::string name = "point " + std::to_string(id);
+            auto wkb = mapnik::util::to_wkb(mapnik::geometry::geometry<double>(mapnik::geometry::point<double>(x, y)),
+                                            mapnik::wkbNDR);
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_blob(stmt, 3, wkb->buffer(), static_cast<int>(wkb->size()), SQLITE_TRANSIENT);
+            REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+            conn.release_statement(stmt);
+            stmt = conn.prepare_cached("INSERT INTO points VALUES (?1, ?2, ?3)");
+        }
+    }
+    conn.release_statement(stmt);
+    conn.execute("COMMIT");
+}
+
+mapnik::datasource_ptr get_sqlite_ds(std::string const& file_name, bool use_spatial_index)
+{
+    const bool have_sqlite_plugin = mapnik::datasource_cache::instance().plugin_registered("sqlite");
+    if (!have_sqlite_plugin)
+    {
+        return mapnik::datasource_ptr();
+    }
+
+    mapnik::parameters params;
+    params["type"] = std::string("sqlite");
+    params["file"] = file_name;
+    params["table"] = std::string("points");
+    params["use_spatial_index"] = use_spatial_index;
+    params["initial_size"] = mapnik::value_integer(1);
+    params["max_size"] = mapnik::value_integer(2);
+
+    auto ds = mapnik::datasource_cache::instance().create(params);
+    REQUIRE(ds != nullptr);
+
+    return ds;
+}
+
+std::set<mapnik::value_integer> query_ids(mapnik::datasource_ptr const& ds, mapnik::box2d<double> const& bbox)
+{
+    std::set<mapnik::value_integer> ids;
+    mapnik::query q(bbox);
+    q.add_property_name("name");
+    auto features = ds->features(q);
+    REQUIRE(features);
+    while (auto feature = features->next())
+    {
+        CHECK(feature->get("name").to_string() == "point " + std::to_string(feature->id()));
+        ids.insert(feature->id());
+    }
+    return ids;
+}
+
+std::set<mapnik::value_integer> expected_ids(int minx, int miny, int maxx, int maxy)
+{
+    std::set<mapnik::value_integer> ids;
+    for (int y = miny; y <= maxy; ++y)
+    {
+        for (int x = minx; x <= maxx; ++x)
+        {
+            ids.insert(y * 10 + x + 1);
+        }
+    }
+    return ids;
+}
+
+} // anonymous namespace
+
+TEST_CASE("sqlite")
+{
+    SECTION("statement cache")
+    {
+        sqlite_connection conn(":memory:");
+        std::string const sql = "SELECT ?1, ?2, ?3, ?4";
+        sqlite3_stmt* stmt = conn.prepare_cached(sql);
+        REQUIRE(stmt != nullptr);
+        sqlite_utils::bind_spatial_filter(stmt, mapnik::box2d<double>(1, 2, 3, 4));
+        REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+        CHECK(sqlite3_column_double(stmt, 0) == 1.0);
+        CHECK(sqlite3_column_double(stmt, 1) == 3.0);
+        CHECK(sqlite3_column_double(stmt, 2) == 2.0);
+        CHECK(sqlite3_column_double(stmt, 3) == 4.0);
+        conn.release_statement(stmt);
+
+        // a released statement is handed out again, reset with its bindings cleared
+        sqlite3_stmt* again = conn.prepare_cached(sql);
+        CHECK(again == stmt);
+        REQUIRE(sqlite3_step(again) == SQLITE_ROW);
+        CHECK(sqlite3_column_type(again, 0) == SQLITE_NULL);
+        // a statement that is not handed back is never shared
+        sqlite3_stmt* other = conn.prepare_cached(sql);
+        CHECK(other != again);
+        conn.release_statement(other);
+        conn.release_statement(again);
+        stmt = conn.prepare_cached(sql);
+        CHECK(stmt == other);
+        conn.release_statement(stmt);
+    }
+
+    SECTION("spatial filter")
+    {
+        std::string const filter = "id IN (SELECT pkid FROM idx_points_geometry"
+                                   " WHERE xmax>=?1 AND xmin<=?2 AND ymax>=?3 AND ymin<=?4)";
+        std::string query = "points";
+        CHECK(
+          sqlite_utils::apply_spatial_filter(query, "points", "id", "idx_points_geometry", "points", "!intersects!"));
+        CHECK(query == "points WHERE " + filter);
+
+        query = "(SELECT * FROM points WHERE name IS NOT NULL)";
+        CHECK(sqlite_utils::apply_spatial_filter(query, query, "id", "idx_points_geometry", "points", "!intersects!"));
+        CHECK(query == "(SELECT * FROM points  WHERE " + filter + " AND  name IS NOT NULL)");
+
+        query = "(SELECT * FROM points WHERE !intersects!)";
+        CHECK(sqlite_utils::apply_spatial_filter(query, query, "id", "idx_points_geometry", "points", "!intersects!"));
+        CHECK(query == "(SELECT * FROM points WHERE " + filter + ")");
+
+        query = "(SELECT * FROM lines)";
+        CHECK_FALSE(
+          sqlite_utils::apply_spatial_filter(query, query, "id", "idx_points_geometry", "points", "!intersects!"));
+    }
+
+    create_points(dataset);
+
+    SECTION("pool")
+    {
+        sqlite_connection_creator<sqlite_connection> creator(dataset, {"PRAGMA cache_size=100"}, 0);
+        sqlite_pool pool(creator, 1, 2);
+        CHECK(pool.size() == 1);
+        {
+            auto first = pool.borrowObject();
+            auto second = pool.borrowObject();
+            REQUIRE(first);
+            REQUIRE(second);
+            CHECK(first != second);
+            // both are borrowed and the pool is full
+            CHECK_FALSE(pool.borrowObject());
+            // pooled connections are read-only
+            CHECK_THROWS(first->execute("DELETE FROM points"));
+        }
+        CHECK(pool.size() == 2);
+        CHECK(pool.borrowObject());
+    }
+
+    mapnik::datasource_ptr indexed_ds = get_sqlite_ds(dataset, true);
+    if (!indexed_ds)
+    {
+        // sqlite plugin not built.
+        mapnik::util::remove(dataset);
+        return;
+    }
+    mapnik::datasource_ptr plain_ds = get_sqlite_ds(dataset, false);
+
+    SECTION("bbox queries")
+    {
+        CHECK(indexed_ds->envelope() == mapnik::box2d<double>(0, 0, 9, 9));
+        mapnik::box2d<double> const boxes[] = {mapnik::box2d<double>(2.5, 2.5, 5.5, 5.5),
+                                               mapnik::box2d<double>(-1, -1, 0.5, 0.5),
+                                               mapnik::box2d<double>(7, 0, 12, 3),
+                                               mapnik::box2d<double>(20, 20, 30, 30)};
+        std::set<mapnik::value_integer> const expected[] = {expected_ids(3, 3, 5, 5),
+                                                            expected_ids(0, 0, 0, 0),
+                                                            expected_ids(7, 0, 9, 3),
+                                                            std::set<mapnik::value_integer>()};
+        // repeated queries reuse the statements prepared on the pooled connections
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                CHECK(query_ids(indexed_ds, boxes[i]) == expected[i]);
+                CHECK(query_ids(plain_ds, boxes[i]) == expected[i]);
+            }
+        }
+    }
+
+    SECTION("concurrent queries")
+    {
+        // more open featuresets than pooled connections
+        mapnik::query q(mapnik::box2d<double>(0, 0, 9, 9));
+        std::vector<mapnik::featureset_ptr> featuresets;
+        for (int i = 0; i < 4; ++i)
+        {
+            featuresets.push_back(indexed_ds->features(q));
+            REQUIRE(featuresets.back());
+        }
+        for (auto const& features : featuresets)
+        {
+            std::size_t count = 0;
+            while (features->next())
+                ++count;
+            CHECK(count == 100);
+        }
+        featuresets.clear();
+
+        std::vector<std::thread> threads;
+        std::vector<int> failures(4, 0);
+        for (std::size_t t = 0; t < failures.size(); ++t)
+        {
+            threads.emplace_back([&indexed_ds, &failures, t] {
+                for (int i = 0; i < 20; ++i)
+                {
+                    int x = static_cast<int>(t + i) % 8;
+                    mapnik::query query(mapnik::box2d<double>(x - 0.5, x - 0.5, x + 1.5, x + 1.5));
+                    auto features = indexed_ds->features(query);
+                    std::set<mapnik::value_integer> ids;
+                    while (auto feature = features->next())
+                    {
+                        ids.insert(feature->id());
+                    }
+                    if (ids != expected_ids(x, x, x + 1, x + 1))
+                    {
+                        ++failures[t];
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        CHECK(failures == std::vector<int>(4, 0));
+    }
+
+    indexed_ds.reset();
+    plain_ds.reset();
+    mapnik::util::remove(dataset);
+    mapnik::util::remove(dataset + ".index");
+} // END TEST CASE
@@ -0,0 +1,65 @@
+#include "catch.hpp"
+
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/text/face.hpp>
+#include <mapnik/text/glyph_info.hpp>
+#include <mapnik/text/text_properties.hpp>
+
+#include <thread>
+
+TEST_CASE("face cache")
+{
+    REQUIRE(mapnik::freetype_engine::register_font("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf"));
+    std::string const face_name("DejaVu Sans Book");
+    mapnik::freetype_engine::font_file_mapping_type font_file_mapping;
+    mapnik::freetype_engine::font_memory_cache_type font_memory_cache;
+
+    SECTION("faces are shared by face managers on the same thread")
+    {
+        mapnik::font_library library1;
+        mapnik::font_library library2;
+        mapnik::face_manager fm1(library1, font_file_mapping, font_memory_cache);
+        mapnik::face_manager fm2(library2, font_file_mapping, font_memory_cache);
+        mapnik::face_ptr face = fm1.get_face(face_name);
+        REQUIRE(face);
+        CHECK(fm2.get_face(face_name) == face);
+        CHECK_FALSE(fm1.get_face("No Such Face"));
+
+        mapnik::face_ptr other_thread_face;
+        std::thread t([&]() {
+            mapnik::font_library library;
+            mapnik::face_manager fm(library, font_file_mapping, font_memory_cache);
+            other_thread_face = fm.get_face(face_name);
+        });
+        t.join();
+        REQUIRE(other_thread_face);
+        CHECK(other_thread_face != face);
+        // still usable after its thread has gone
+        CHECK(other_thread_face->family_name() == "DejaVu Sans");
+    }
+
+    SECTION("glyph metrics are remembered")
+    {
+        mapnik::font_library library;
+        mapnik::face_manager fm(library, font_file_mapping, font_memory_cache);
+        mapnik::face_ptr face = fm.get_face(face_name);
+        REQUIRE(face);
+        unsigned glyph_index = FT_Get_Char_Index(face->get_face(), 'g');
+        mapnik::evaluated_format_properties_ptr format;
+        REQUIRE(face->set_unscaled_character_sizes());
+        mapnik::glyph_info first(glyph_index, 0, format);
+        REQUIRE(face->glyph_dimensions(first));
+        CHECK(first.unscaled_advance > 0);
+        CHECK(first.unscaled_ymin < 0);
+
+        // a scaled render in between must not leak into later measurements
+        face->set_character_sizes(32);
+        REQUIRE(face->set_unscaled_character_sizes());
+        mapnik::glyph_info second(glyph_index, 0, format);
+        REQUIRE(face->glyph_dimensions(second));
+        CHECK(second.unscaled_ymin == first.unscaled_ymin);
+        CHECK(second.unscaled_ymax == first.unscaled_ymax);
+        CHECK(second.unscaled_advance == first.unscaled_advance);
+        CHECK(second.unscaled_line_height == first.unscaled_line_height);
+    }
+}
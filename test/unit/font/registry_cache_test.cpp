@@ -0,0 +1,99 @@
+#include "catch.hpp"
+
+#include <mapnik/map.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::string read_file(std::string const& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    std::ostringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+void write_file(std::string const& filename, std::string const& content)
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+} // namespace
+
+TEST_CASE("font registry cache")
+{
+    std::string const font_file("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf");
+    std::string const cache_file("/tmp/mapnik-font-registry-test.cache");
+    std::remove(cache_file.c_str());
+    mapnik::freetype_engine::set_registry_cache(cache_file);
+
+    {
+        mapnik::Map m(256, 256);
+        REQUIRE(m.register_fonts(font_file));
+        CHECK(m.get_font_file_mapping().count("DejaVu Sans Book") == 1);
+    }
+    std::string const content = read_file(cache_file);
+    REQUIRE(content.find(font_file) != std::string::npos);
+    REQUIRE(content.find("DejaVu Sans Book") != std::string::npos);
+
+    SECTION("unchanged files are not reopened")
+    {
+        // a name that can only come from the cache
+        std::string tampered = content;
+        tampered.replace(tampered.find("DejaVu Sans Book"), 16, "Cached Face Book");
+        write_file(cache_file, tampered);
+        mapnik::freetype_engine::set_registry_cache(cache_file);
+
+        mapnik::Map m(256, 256);
+        REQUIRE(m.register_fonts(font_file));
+        CHECK(m.get_font_file_mapping().count("Cached Face Book") == 1);
+        CHECK(m.get_font_file_mapping().count("DejaVu Sans Book") == 0);
+    }
+
+    SECTION("damaged cache is ignored")
+    {
+        write_file(cache_file, "mapnik-font-registry 1\ngarbage\n");
+        mapnik::freetype_engine::set_registry_cache(cache_file);
+
+        mapnik::Map m(256, 256);
+        REQUIRE(m.register_fonts(font_file));
+        CHECK(m.get_font_file_mapping().count("DejaVu Sans Book") == 1);
+        // and rewritten
+        CHECK(read_file(cache_file).find("DejaVu Sans Book") != std::string::npos);
+    }
+
+    SECTION("truncated cache is ignored")
+    {
+        // as seen by a process starting while another one is writing the cache
+        std::string const truncated = content.substr(0, content.find("DejaVu Sans Book") + 6);
+        write_file(cache_file, truncated);
+        mapnik::freetype_engine::set_registry_cache(cache_file);
+
+        mapnik::Map m(256, 256);
+        REQUIRE(m.register_fonts(font_file));
+        CHECK(m.get_font_file_mapping().count("DejaVu") == 0);
+        CHECK(m.get_font_file_mapping().count("DejaVu Sans Book") == 1);
+        CHECK(read_file(cache_file) == content);
+    }
+
+    SECTION("cache with a mismatched trailer is ignored")
+    {
+        std::string tampered = content;
+        tampered.replace(tampered.find("DejaVu Sans Book"), 16, "Cached Face");
+        write_file(cache_file, tampered);
+        mapnik::freetype_engine::set_registry_cache(cache_file);
+
+        mapnik::Map m(256, 256);
+        REQUIRE(m.register_fonts(font_file));
+        CHECK(m.get_font_file_mapping().count("Cached Face") == 0);
+        CHECK(m.get_font_file_mapping().count("DejaVu Sans Book") == 1);
+    }
+
+    mapnik::freetype_engine::set_registry_cache("");
+    std::remove(cache_file.c_str());
+}
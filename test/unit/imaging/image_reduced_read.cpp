@@ -0,0 +1,227 @@
+
+#include "catch.hpp"
+
+#include <mapnik/image.hpp>
+#include <mapnik/image_any.hpp>
+#include <mapnik/image_reader.hpp>
+#include <mapnik/image_util.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// smooth enough for lossy codecs to keep it close to the source
+mapnik::image_rgba8 make_gradient(unsigned width, unsigned height)
+{
+    mapnik::image_rgba8 im(width, height);
+    for (unsigned y = 0; y < height; ++y)
+    {
+        for (unsigned x = 0; x < width; ++x)
+        {
+            std::uint32_t r = (x * 255) / width;
+            std::uint32_t g = (y * 255) / height;
+            std::uint32_t b = ((x + y) * 255) / (width + height);
+            im(x, y) = r | (g << 8) | (b << 16) | (0xffu << 24);
+        }
+    }
+    return im;
+}
+
+std::string encode(mapnik::image_rgba8 const& im, std::string const& format)
+{
+    std::ostringstream ss(std::ios::binary);
+    mapnik::save_to_stream(im, ss, format);
+    return ss.str();
+}
+
+// every reduction'th pixel of the window, as decoders that skip rows and columns produce
+mapnik::image_rgba8 subsample(mapnik::image_rgba8 const& im, unsigned reduction)
+{
+    mapnik::image_rgba8 out((im.width() + reduction - 1) / reduction, (im.height() + reduction - 1) / reduction);
+    for (unsigned y = 0; y < out.height(); ++y)
+    {
+        for (unsigned x = 0; x < out.width(); ++x)
+        {
+            out(x, y) = im(x * reduction, y * reduction);
+        }
+    }
+    return out;
+}
+
+// average of each reduction x reduction block, as decoders that scale the DCT produce
+mapnik::image_rgba8 box_filter(mapnik::image_rgba8 const& im, unsigned reduction)
+{
+    mapnik::image_rgba8 out(im.width() / reduction, im.height() / reduction);
+    for (unsigned y = 0; y < out.height(); ++y)
+    {
+        for (unsigned x = 0; x < out.width(); ++x)
+        {
+            std::uint32_t sum[4] = {0, 0, 0, 0};
+            for (unsigned j = 0; j < reduction; ++j)
+            {
+                for (unsigned i = 0; i < reduction; ++i)
+                {
+                    std::uint32_t pixel = im(x * reduction + i, y * reduction + j);
+                    for (unsigned c = 0; c < 4; ++c)
+                    {
+                        sum[c] += (pixel >> (c * 8)) & 0xff;
+                    }
+                }
+            }
+            std::uint32_t pixel = 0;
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                pixel |= (sum[c] / (reduction * reduction)) << (c * 8);
+            }
+            out(x, y) = pixel;
+        }
+    }
+    return out;
+}
+
+// 16x12 Adam7 interlaced RGBA image, pixel (x, y) is (x * 16, y * 20, (x + y) * 8, 255)
+unsigned char const interlaced_png[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x0c, 0x08, 0x06, 0x00, 0x00, 0x01, 0x1c, 0xe0, 0x0d,
+    0x17, 0x00, 0x00, 0x02, 0x03, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x15, 0x92, 0x91, 0xb6, 0xc4,
+    0x30, 0x14, 0x45, 0x83, 0x0f, 0x0b, 0x81, 0x87, 0xc5, 0x60, 0x71, 0x20, 0x50, 0x1c, 0xbc, 0x58,
+    0x0c, 0x04, 0x8a, 0xc1, 0x60, 0x70, 0x20, 0x50, 0x1c, 0x0c, 0x0e, 0x16, 0x02, 0x0f, 0x8b, 0xc1,
+    0x7e, 0x40, 0xa0, 0x9f, 0xd0, 0x3f, 0x38, 0xef, 0x8c, 0x75, 0xa5, 0x27, 0x77, 0xdd, 0xbd, 0x4f,
+    0x94, 0x52, 0x0a, 0x49, 0xcd, 0x50, 0xaa, 0xcc, 0x48, 0x25, 0x41, 0xcd, 0x6a, 0xc4, 0xa1, 0x1c,
+    0x3f, 0x8a, 0xc3, 0x51, 0x0a, 0x7f, 0xc9, 0x88, 0x59, 0xf8, 0x5b, 0x78, 0x20, 0x8c, 0x8c, 0x6a,
+    0x80, 0x53, 0x13, 0x8a, 0x12, 0x5c, 0x2a, 0xf0, 0x40, 0x26, 0x38, 0x11, 0x14, 0x09, 0xb8, 0x64,
+    0xe3, 0x41, 0x11, 0xb8, 0x12, 0x50, 0xca, 0x86, 0xab, 0xec, 0x9c, 0x61, 0x06, 0x8c, 0x86, 0x73,
+    0x0c, 0x93, 0x86, 0xb3, 0x0c, 0xd3, 0x86, 0xf3, 0x0c, 0x6f, 0x18, 0xce, 0x54, 0x71, 0xc2, 0x18,
+    0x67, 0xcc, 0x91, 0x37, 0xa3, 0x43, 0x8a, 0xbc, 0x1d, 0x13, 0x8e, 0xc8, 0x09, 0xf1, 0xbb, 0x45,
+    0x13, 0x8c, 0xcd, 0x61, 0x6e, 0x01, 0xae, 0x25, 0xa4, 0xb6, 0xa1, 0xb4, 0x82, 0xa3, 0xed, 0xb8,
+    0xda, 0x01, 0x35, 0xa8, 0x1f, 0x4c, 0xea, 0x17, 0xa2, 0x0c, 0x82, 0x7a, 0x60, 0x53, 0x4f, 0xec,
+    0x6a, 0xc1, 0xa9, 0x56, 0xdc, 0x2a, 0x32, 0x60, 0x7e, 0x31, 0x19, 0x03, 0x31, 0x0f, 0x04, 0xf3,
+    0xc4, 0x66, 0x16, 0xec, 0x66, 0xc5, 0x69, 0x22, 0x6e, 0xf3, 0x62, 0x40, 0x0c, 0x26, 0x79, 0x40,
+    0xe4, 0x89, 0x20, 0x0b, 0x36, 0x59, 0xb1, 0x4b, 0xc4, 0x29, 0x2f, 0xdc, 0xf2, 0x66, 0x20, 0x3e,
+    0x30, 0xc5, 0x27, 0x24, 0x2e, 0x08, 0x71, 0xc5, 0x16, 0x23, 0xf6, 0xf8, 0xc2, 0x19, 0xdf, 0xb8,
+    0xe3, 0x87, 0x81, 0xf2, 0xc4, 0x54, 0x16, 0x48, 0x59, 0x11, 0x4a, 0xc4, 0x56, 0x5e, 0xd8, 0xcb,
+    0x1b, 0x67, 0xf9, 0xe0, 0x2e, 0x7f, 0x0c, 0xb4, 0x05, 0x53, 0x5b, 0x21, 0x2d, 0x22, 0xb4, 0x17,
+    0xb6, 0xf6, 0xc6, 0xde, 0x3e, 0x38, 0xdb, 0x1f, 0xee, 0xd6, 0x88, 0xa9, 0x7f, 0x30, 0x68, 0xca,
+    0xd2, 0x5c, 0x56, 0x53, 0x98, 0xe6, 0xc2, 0x9a, 0xd2, 0x34, 0x97, 0xd6, 0x14, 0xa7, 0xb9, 0xb8,
+    0xa6, 0x3c, 0xcd, 0xe5, 0x35, 0x05, 0x6a, 0x02, 0x68, 0x4a, 0xd4, 0x84, 0xd0, 0x5f, 0x91, 0xf6,
+    0x17, 0x83, 0x1d, 0x31, 0x5a, 0xc2, 0xd8, 0x09, 0xb3, 0x25, 0x90, 0x9d, 0xe1, 0x2c, 0xa1, 0xac,
+    0x20, 0x59, 0x82, 0x59, 0x87, 0x62, 0x09, 0x67, 0x03, 0x0e, 0x4b, 0x40, 0x9b, 0x70, 0x59, 0x42,
+    0x5a, 0x76, 0xa7, 0xbc, 0xc1, 0xe0, 0xd9, 0x86, 0x27, 0xac, 0x67, 0x23, 0x9e, 0xc0, 0x9e, 0xad,
+    0x78, 0x42, 0x7b, 0x36, 0xe3, 0x09, 0xee, 0xd9, 0x8e, 0x27, 0xbc, 0x67, 0x43, 0x9e, 0x02, 0x3c,
+    0x5b, 0xf2, 0x94, 0xe0, 0xbf, 0x4d, 0xe5, 0x07, 0x86, 0x3c, 0x63, 0xcc, 0x94, 0x91, 0x05, 0x73,
+    0xa6, 0x90, 0xec, 0xe0, 0x32, 0xa5, 0xe4, 0x80, 0x94, 0x29, 0x26, 0x27, 0x94, 0x4c, 0x39, 0x79,
+    0xc3, 0x91, 0x29, 0x28, 0x17, 0x5c, 0x99, 0x92, 0xf2, 0xf7, 0xb1, 0xd4, 0x27, 0x86, 0xca, 0xba,
+    0x2b, 0x65, 0x55, 0x56, 0x5e, 0x29, 0xac, 0xb2, 0xf6, 0x4a, 0x69, 0x95, 0xd5, 0x57, 0x8a, 0xab,
+    0xac, 0xbf, 0x52, 0x5e, 0xe5, 0x13, 0xa8, 0x14, 0x58, 0xf9, 0x0c, 0x2a, 0x25, 0x56, 0x3e, 0x05,
+    0xd5, 0x17, 0x0c, 0xdd, 0x61, 0xec, 0x2b, 0xa6, 0x1e, 0x30, 0xf7, 0x08, 0xe9, 0x09, 0xae, 0xbf,
+    0x10, 0xfa, 0x86, 0xd4, 0xdf, 0xd8, 0x7a, 0x41, 0xe9, 0x1f, 0xec, 0x7d, 0xc7, 0xd1, 0xff, 0x70,
+    0xf6, 0x03, 0x57, 0x6f, 0xb8, 0xfb, 0x89, 0x7f, 0x79, 0x1c, 0xb9, 0xd0, 0x19, 0x36, 0x22, 0xea,
+    0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82};
+
+std::uint32_t interlaced_pixel(unsigned x, unsigned y)
+{
+    return (x * 16) | ((y * 20) << 8) | (((x + y) * 8) << 16) | (0xffu << 24);
+}
+
+unsigned max_channel_difference(mapnik::image_rgba8 const& a, mapnik::image_rgba8 const& b)
+{
+    unsigned result = 0;
+    for (unsigned y = 0; y < a.height(); ++y)
+    {
+        for (unsigned x = 0; x < a.width(); ++x)
+        {
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                int da = (a(x, y) >> (c * 8)) & 0xff;
+                int db = (b(x, y) >> (c * 8)) & 0xff;
+                result = std::max(result, static_cast<unsigned>(std::abs(da - db)));
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("image reduced read")
+{
+#if defined(HAVE_PNG)
+    SECTION("png skips rows and columns")
+    {
+        std::string data = encode(make_gradient(256, 200), "png32");
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(data.data(), data.size()));
+        REQUIRE(reader);
+        for (unsigned reduction : {2u, 4u, 8u})
+        {
+            auto full = mapnik::util::get<mapnik::image_rgba8>(reader->read(16, 32, 101, 61));
+            auto reduced = mapnik::util::get<mapnik::image_rgba8>(reader->read_reduced(16, 32, 101, 61, reduction));
+            REQUIRE(reduced.width() == (101 + reduction - 1) / reduction);
+            REQUIRE(reduced.height() == (61 + reduction - 1) / reduction);
+            CHECK(mapnik::compare(reduced, subsample(full, reduction)) == 0);
+        }
+        // a window reaching the bottom right corner
+        auto full = mapnik::util::get<mapnik::image_rgba8>(reader->read(128, 100, 128, 100));
+        auto reduced = mapnik::util::get<mapnik::image_rgba8>(reader->read_reduced(128, 100, 128, 100, 4));
+        CHECK(mapnik::compare(reduced, subsample(full, 4)) == 0);
+    }
+
+    SECTION("interlaced png windows")
+    {
+        std::unique_ptr<mapnik::image_reader> reader(
+          mapnik::get_image_reader(reinterpret_cast<char const*>(interlaced_png), sizeof(interlaced_png)));
+        REQUIRE(reader);
+        auto window = mapnik::util::get<mapnik::image_rgba8>(reader->read(3, 2, 9, 7));
+        REQUIRE(window.width() == 9);
+        REQUIRE(window.height() == 7);
+        for (unsigned y = 0; y < window.height(); ++y)
+        {
+            for (unsigned x = 0; x < window.width(); ++x)
+            {
+                REQUIRE(window(x, y) == interlaced_pixel(x + 3, y + 2));
+            }
+        }
+        for (unsigned reduction : {2u, 4u})
+        {
+            auto reduced = mapnik::util::get<mapnik::image_rgba8>(reader->read_reduced(3, 2, 9, 7, reduction));
+            REQUIRE(reduced.width() == (9 + reduction - 1) / reduction);
+            REQUIRE(reduced.height() == (7 + reduction - 1) / reduction);
+            CHECK(mapnik::compare(reduced, subsample(window, reduction)) == 0);
+        }
+        // a window reaching the bottom right corner
+        auto corner = mapnik::util::get<mapnik::image_rgba8>(reader->read(10, 8, 6, 4));
+        CHECK(corner(5, 3) == interlaced_pixel(15, 11));
+    }
+#endif
+
+#if defined(HAVE_JPEG)
+    SECTION("jpeg decodes at a reduced scale")
+    {
+        std::string data = encode(make_gradient(256, 256), "jpeg100");
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(data.data(), data.size()));
+        REQUIRE(reader);
+        auto full = mapnik::util::get<mapnik::image_rgba8>(reader->read(0, 0, 256, 256));
+        for (unsigned reduction : {2u, 4u, 8u})
+        {
+            auto reduced = mapnik::util::get<mapnik::image_rgba8>(reader->read_reduced(0, 0, 256, 256, reduction));
+            REQUIRE(reduced.width() == 256 / reduction);
+            REQUIRE(reduced.height() == 256 / reduction);
+            CHECK(max_channel_difference(reduced, box_filter(full, reduction)) <= 4);
+        }
+        // windows are in full resolution pixels, aligned to the reduction
+        auto window = mapnik::util::get<mapnik::image_rgba8>(reader->read_reduced(64, 128, 64, 32, 4));
+        REQUIRE(window.width() == 16);
+        REQUIRE(window.height() == 8);
+        auto whole = mapnik::util::get<mapnik::image_rgba8>(reader->read_reduced(0, 0, 256, 256, 4));
+        CHECK(window(0, 0) == whole(16, 32));
+        CHECK(window(15, 7) == whole(31, 39));
+        // unsupported reductions fall back to a full resolution read
+        auto fallback = reader->read_reduced(0, 0, 256, 256, 3);
+        CHECK(fallback.width() == 256);
+    }
+#endif
+}
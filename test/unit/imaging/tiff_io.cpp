@@ -9,6 +9,7 @@
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_view.hpp>
 #include <mapnik/image_reader.hpp>
+#include <mapnik/tiff_tile_cache.hpp>
 #include <mapnik/util/file_io.hpp>
 #include <mapnik/util/fs.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
@@ -163,6 +164,46 @@ void test_tiff_reader(std::string const& pattern)
     }
 }
 
+// average of each reduction x reduction block, as overviews are usually made
+mapnik::image_gray8 box_filter(mapnik::image_gray8 const& im, unsigned reduction)
+{
+    mapnik::image_gray8 out(im.width() / reduction, im.height() / reduction);
+    for (std::size_t y = 0; y < out.height(); ++y)
+    {
+        for (std::size_t x = 0; x < out.width(); ++x)
+        {
+            unsigned sum = 0;
+            for (unsigned j = 0; j < reduction; ++j)
+            {
+                for (unsigned i = 0; i < reduction; ++i)
+                {
+                    sum += im(x * reduction + i, y * reduction + j);
+                }
+            }
+            out(x, y) = static_cast<std::uint8_t>(sum / (reduction * reduction));
+        }
+    }
+    return out;
+}
+
+void write_gray8_directory(TIFF* tif, mapnik::image_gray8 const& im, std::uint32_t subfile_type)
+{
+    TIFFSetField(tif, TIFFTAG_SUBFILETYPE, subfile_type);
+    TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<std::uint32_t>(im.width()));
+    TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<std::uint32_t>(im.height()));
+    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
+    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+    TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, 16);
+    for (std::size_t y = 0; y < im.height(); ++y)
+    {
+        TIFFWriteScanline(tif, const_cast<std::uint8_t*>(im.get_row(y)), static_cast<std::uint32_t>(y), 0);
+    }
+    TIFFWriteDirectory(tif);
+}
+
 } // namespace
 
 TEST_CASE("tiff io")
@@ -177,6 +218,74 @@ TEST_CASE("tiff io")
         test_tiff_reader<mapnik::image_gray8>("tiff_gray");
     }
 
+    SECTION("tiff-reader tile cache")
+    {
+        mapnik::tiff_tile_cache& cache = mapnik::tiff_tile_cache::instance();
+        std::size_t const max_size = cache.max_size();
+        unsigned const decode_threads = cache.decode_threads();
+        cache.clear();
+        cache.reset_stats();
+        cache.set_max_size(16 * 1024 * 1024);
+        cache.set_decode_threads(4);
+        // first pass decodes in parallel and fills the cache, second pass reads from it
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            test_tiff_reader<mapnik::image_rgba8>("tiff_rgb");
+            test_tiff_reader<mapnik::image_gray8>("tiff_gray");
+        }
+        auto stats = cache.stats();
+        CHECK(stats.tiles > 0);
+        CHECK(stats.hits > 0);
+        cache.clear();
+        cache.reset_stats();
+        cache.set_max_size(max_size);
+        cache.set_decode_threads(decode_threads);
+    }
+
+    SECTION("tiff-reader overviews")
+    {
+        std::string filename("./test/data/tiff-overview-test.tif");
+        mapnik::image_gray8 full(256, 256);
+        for (std::size_t y = 0; y < full.height(); ++y)
+        {
+            for (std::size_t x = 0; x < full.width(); ++x)
+            {
+                full(x, y) = static_cast<std::uint8_t>((x * 7 + y * 3) & 0xff);
+            }
+        }
+        mapnik::image_gray8 overview = box_filter(full, 2);
+        {
+            TIFF* out = TIFFOpen(filename.c_str(), "w");
+            REQUIRE(out);
+            write_gray8_directory(out, full, 0);
+            write_gray8_directory(out, overview, FILETYPE_REDUCEDIMAGE);
+            TIFFClose(out);
+        }
+        {
+            std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(filename, "tiff"));
+            REQUIRE(reader);
+            REQUIRE(reader->width() == 256);
+            // read from the 1/2 overview, the same as a full read downsampled
+            mapnik::image_any reduced = reader->read_reduced(32, 64, 128, 96, 2);
+            REQUIRE(reduced.is<mapnik::image_gray8>());
+            REQUIRE(reduced.width() == 64);
+            REQUIRE(reduced.height() == 48);
+            mapnik::image_any window = reader->read(32, 64, 128, 96);
+            REQUIRE(window.is<mapnik::image_gray8>());
+            CHECK(identical(reduced.get<mapnik::image_gray8>(), box_filter(window.get<mapnik::image_gray8>(), 2)));
+            CHECK(identical(reduced.get<mapnik::image_gray8>(),
+                            mapnik::image_view<mapnik::image_gray8>(16, 32, 64, 48, overview)));
+            // the first directory is current again
+            mapnik::image_any whole = reader->read(0, 0, 256, 256);
+            REQUIRE(whole.is<mapnik::image_gray8>());
+            CHECK(identical(whole.get<mapnik::image_gray8>(), full));
+            // there is no 1/4 overview, the window is read at full resolution
+            mapnik::image_any fallback = reader->read_reduced(0, 0, 256, 256, 4);
+            CHECK(fallback.width() == 256);
+        }
+        mapnik::util::remove(filename);
+    }
+
     SECTION("scan rgb8 striped")
     {
         std::string filename("./test/data/tiff/scan_512x512_rgb8_striped.tif");
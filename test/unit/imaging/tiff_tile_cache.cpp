@@ -0,0 +1,135 @@
+#include "catch.hpp"
+
+#include <mapnik/tiff_tile_cache.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+mapnik::tiff_tile_cache::tile_ptr make_tile(std::size_t size)
+{
+    return std::make_shared<std::vector<std::uint8_t> const>(size, std::uint8_t(0));
+}
+
+} // namespace
+
+TEST_CASE("tiff tile cache")
+{
+    mapnik::tiff_tile_cache& cache = mapnik::tiff_tile_cache::instance();
+    std::size_t const max_size = cache.max_size();
+    cache.clear();
+    cache.reset_stats();
+
+    SECTION("disabled by default")
+    {
+        CHECK(cache.decode_threads() == 1);
+        cache.set_max_size(0);
+        CHECK_FALSE(cache.enabled());
+        cache.insert({"a.tif", 0, 0, 8}, make_tile(16));
+        CHECK_FALSE(cache.find({"a.tif", 0, 0, 8}));
+        CHECK(cache.stats().tiles == 0);
+    }
+
+    SECTION("least recently used tiles are evicted")
+    {
+        cache.set_max_size(300);
+        REQUIRE(cache.enabled());
+        cache.insert({"a.tif", 0, 0, 8}, make_tile(100));
+        cache.insert({"a.tif", 0, 1, 8}, make_tile(100));
+        cache.insert({"a.tif", 0, 2, 8}, make_tile(100));
+        // touch tile 0 so tile 1 is the oldest
+        CHECK(cache.find({"a.tif", 0, 0, 8}));
+        cache.insert({"a.tif", 0, 3, 8}, make_tile(100));
+        CHECK(cache.find({"a.tif", 0, 0, 8}));
+        CHECK_FALSE(cache.find({"a.tif", 0, 1, 8}));
+        CHECK(cache.find({"a.tif", 0, 2, 8}));
+        CHECK(cache.find({"a.tif", 0, 3, 8}));
+        // keys differing only in directory, layout or file are distinct tiles
+        CHECK_FALSE(cache.find({"a.tif", 1, 0, 8}));
+        CHECK_FALSE(cache.find({"a.tif", 0, 0, 9}));
+        CHECK_FALSE(cache.find({"b.tif", 0, 0, 8}));
+
+        auto stats = cache.stats();
+        CHECK(stats.hits == 4);
+        CHECK(stats.misses == 4);
+        CHECK(stats.evictions == 1);
+        CHECK(stats.tiles == 3);
+        CHECK(stats.size == 300);
+        CHECK(stats.hit_rate() == Approx(0.5));
+
+        // tiles larger than the cache are not kept
+        cache.insert({"a.tif", 0, 4, 8}, make_tile(400));
+        CHECK(cache.stats().tiles == 3);
+
+        cache.set_max_size(100);
+        CHECK(cache.stats().tiles == 1);
+        CHECK(cache.find({"a.tif", 0, 3, 8}));
+    }
+
+    SECTION("tiles are removed by file")
+    {
+        cache.set_max_size(1000);
+        cache.insert({"a.tif", 0, 0, 8}, make_tile(10));
+        cache.insert({"b.tif", 0, 0, 8}, make_tile(10));
+        CHECK(cache.remove("a.tif"));
+        CHECK_FALSE(cache.remove("a.tif"));
+        CHECK_FALSE(cache.find({"a.tif", 0, 0, 8}));
+        CHECK(cache.find({"b.tif", 0, 0, 8}));
+        CHECK(cache.stats().size == 10);
+    }
+
+#ifdef MAPNIK_THREADSAFE
+    SECTION("decode pool is bounded and shared")
+    {
+        unsigned const decode_threads = cache.decode_threads();
+        // no helpers unless asked for
+        cache.set_decode_threads(1);
+        std::atomic<unsigned> helped(0);
+        cache.run_decode(8, [&] { ++helped; }, [] {});
+        CHECK(helped == 0);
+
+        cache.set_decode_threads(3);
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        std::atomic<unsigned> running(0);
+        std::atomic<unsigned> peak(0);
+        auto helper = [&] {
+            unsigned now = ++running;
+            unsigned seen = peak;
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --running;
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+        };
+        // the calling thread waits for the helpers that started
+        for (int i = 0; i < 4; ++i)
+        {
+            cache.run_decode(8, helper, [] { std::this_thread::sleep_for(std::chrono::milliseconds(5)); });
+            CHECK(running == 0);
+        }
+        CHECK(peak <= 2);
+        // helpers run on the same pool threads from one call to the next
+        CHECK(threads.size() <= 2);
+        CHECK(threads.count(std::this_thread::get_id()) == 0);
+
+        // errors on the calling thread are rethrown, those of helpers are not
+        CHECK_THROWS_AS(cache.run_decode(
+                          2,
+                          [] { throw std::runtime_error("helper"); },
+                          [] { throw std::runtime_error("job"); }),
+                        std::runtime_error);
+        CHECK_NOTHROW(cache.run_decode(2, [] { throw std::runtime_error("helper"); }, [] {}));
+        cache.set_decode_threads(decode_threads);
+    }
+#endif
+
+    cache.clear();
+    cache.reset_stats();
+    cache.set_max_size(max_size);
+}
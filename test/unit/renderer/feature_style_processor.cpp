@@ -9,6 +9,8 @@
 #include <mapnik/layer.hpp>
 #include <mapnik/rule.hpp>
 #include <mapnik/feature_style_processor_impl.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/view_transform.hpp>
 #include <mapnik/value/types.hpp>
 #include <mapnik/symbolizer.hpp>
 #include <mapnik/geometry/geometry_type.hpp>
@@ -37,6 +39,15 @@ class test_renderer : public mapnik::feature_style_processor<test_renderer>
         , result_(result)
         , painted_(false)
         , vars_()
+        , t_(map.width(), map.height(), map.get_current_extent())
+    {}
+
+    test_renderer(mapnik::Map const& map, mapnik::request const& req, rendering_result& result)
+        : mapnik::feature_style_processor<test_renderer>(map)
+        , result_(result)
+        , painted_(false)
+        , vars_()
+        , t_(req.width(), req.height(), req.extent())
     {}
 
     void start_map_processing(mapnik::Map const& map) { result_.start_map_processing++; }
@@ -69,6 +80,8 @@ class test_renderer : public mapnik::feature_style_processor<test_renderer>
 
     mapnik::attributes const& variables() const { return vars_; }
 
+    mapnik::view_transform const& transform() const { return t_; }
+
     mapnik::eAttributeCollectionPolicy attribute_collection_policy() const
     {
         return mapnik::eAttributeCollectionPolicy::DEFAULT;
@@ -82,6 +95,7 @@ class test_renderer : public mapnik::feature_style_processor<test_renderer>
     rendering_result& result_;
     bool painted_;
     mapnik::attributes vars_;
+    mapnik::view_transform t_;
 };
 
 std::shared_ptr<mapnik::memory_datasource> prepare_datasource()
@@ -221,4 +235,58 @@ TEST_CASE("feature_style_processor")
         REQUIRE(mapnik::geometry::geometry_type(result.geometries[0]) == mapnik::geometry::geometry_types::Point);
         REQUIRE(mapnik::geometry::geometry_type(result.geometries[1]) == mapnik::geometry::geometry_types::LineString);
     }
+
+    SECTION("test_renderer - apply() with request")
+    {
+        mapnik::Map const map(prepare_map());
+        const mapnik::box2d<double> map_extent = map.get_current_extent();
+        mapnik::request req(128, 256, mapnik::box2d<double>(-10, 0, 0, 20));
+        rendering_result result;
+        test_renderer renderer(map, req, result);
+        renderer.apply(req);
+
+        REQUIRE(renderer.painted());
+        REQUIRE(map.get_current_extent() == map_extent);
+
+        REQUIRE(result.start_map_processing == 1);
+        REQUIRE(result.end_map_processing == 1);
+        REQUIRE(result.end_layer_processing == 1);
+
+        REQUIRE(result.layer_query_extents.size() == 1);
+        const mapnik::box2d<double> reference_query_extent(-10, 0, 0, 20);
+        REQUIRE(result.layer_query_extents.front() == reference_query_extent);
+
+        // the point at (1, 2) is outside of the request extent
+        REQUIRE(result.geometries.size() == 1);
+        REQUIRE(mapnik::geometry::geometry_type(result.geometries[0]) == mapnik::geometry::geometry_types::LineString);
+    }
+
+    SECTION("test_renderer - apply() with request and disabled layer")
+    {
+        mapnik::Map const map(prepare_map());
+        mapnik::request req(map.width(), map.height(), map.get_current_extent());
+        req.set_layer_enabled(0, false);
+        REQUIRE(!req.layer_enabled(0));
+        REQUIRE(req.layer_enabled(1));
+        rendering_result result;
+        test_renderer renderer(map, req, result);
+        renderer.apply(req);
+
+        REQUIRE(!renderer.painted());
+        REQUIRE(result.start_map_processing == 1);
+        REQUIRE(result.end_map_processing == 1);
+        REQUIRE(result.end_layer_processing == 0);
+        REQUIRE(result.geometries.empty());
+    }
+
+    SECTION("test_renderer - apply() with a request the renderer was not constructed with")
+    {
+        mapnik::Map const map(prepare_map());
+        mapnik::request req(128, 256, mapnik::box2d<double>(-10, 0, 0, 20));
+        rendering_result result;
+        test_renderer renderer(map, result);
+        REQUIRE_THROWS_AS(renderer.apply(req), std::runtime_error);
+        REQUIRE(result.start_map_processing == 0);
+        REQUIRE(result.layer_query_extents.empty());
+    }
 }
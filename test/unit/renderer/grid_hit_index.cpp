@@ -0,0 +1,214 @@
+#include "catch.hpp"
+
+#if defined(GRID_RENDERER)
+
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_encoder.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/vertex.hpp>
+
+#include <vector>
+
+namespace {
+
+struct test_path
+{
+    struct cmd
+    {
+        double x;
+        double y;
+        unsigned c;
+    };
+
+    test_path& move_to(double x, double y)
+    {
+        cmds.push_back(cmd{x, y, mapnik::SEG_MOVETO});
+        return *this;
+    }
+
+    test_path& line_to(double x, double y)
+    {
+        cmds.push_back(cmd{x, y, mapnik::SEG_LINETO});
+        return *this;
+    }
+
+    test_path& close_path()
+    {
+        cmds.push_back(cmd{0, 0, mapnik::SEG_CLOSE});
+        return *this;
+    }
+
+    void rewind(unsigned) { pos = 0; }
+
+    unsigned vertex(double* x, double* y)
+    {
+        if (pos >= cmds.size())
+            return mapnik::SEG_END;
+        cmd const& c = cmds[pos++];
+        *x = c.x;
+        *y = c.y;
+        return c.c;
+    }
+
+    std::vector<cmd> cmds;
+    std::size_t pos = 0;
+};
+
+} // namespace
+
+TEST_CASE("grid_hit_index")
+{
+    SECTION("polygons honour the fill rule and drawing order")
+    {
+        mapnik::grid_hit_index index(64, 64, 4);
+        // square with a hole
+        test_path donut;
+        donut.move_to(0, 0).line_to(32, 0).line_to(32, 32).line_to(0, 32).close_path();
+        donut.move_to(8, 8).line_to(24, 8).line_to(24, 24).line_to(8, 24).close_path();
+        index.start_polygon(1);
+        index.add_path(donut);
+        CHECK(index.hit(0, 0) == 1);
+        CHECK(index.hit(4, 4) == mapnik::grid::base_mask); // sample (16.5, 16.5) in the hole
+        CHECK(index.hit(10, 10) == mapnik::grid::base_mask);
+        // drawn later, wins over the first polygon
+        index.add_box(2, mapnik::box2d<double>(0, 0, 6, 6));
+        CHECK(index.hit(0, 0) == 2);
+        CHECK(index.hit(1, 1) == 2); // (4.5, 4.5)
+        CHECK(index.hit(1, 2) == 1); // (4.5, 8.5)
+
+        mapnik::grid g(16, 16, "__id__");
+        CHECK(index.fill(g));
+        for (std::size_t y = 0; y < 16; ++y)
+        {
+            for (std::size_t x = 0; x < 16; ++x)
+            {
+                INFO(x << "," << y);
+                CHECK(g.data()(x, y) == index.hit(x, y));
+            }
+        }
+    }
+
+    SECTION("lines are hit within their half width")
+    {
+        mapnik::grid_hit_index index(64, 64, 4);
+        test_path line;
+        line.move_to(0, 16.5).line_to(64, 16.5);
+        index.start_line(7, 2.0);
+        index.add_path(line);
+        CHECK(index.hit(3, 4) == 7);
+        CHECK(index.hit(3, 3) == mapnik::grid::base_mask);
+        CHECK(index.hit(3, 5) == mapnik::grid::base_mask);
+        // hairlines are widened to half a pixel
+        mapnik::grid_hit_index hairline(64, 64, 4);
+        hairline.start_line(8, 0.1);
+        test_path vertical;
+        vertical.move_to(20.9, 0).line_to(20.9, 64);
+        hairline.add_path(vertical);
+        CHECK(hairline.hit(5, 0) == 8);
+        CHECK(hairline.hit(4, 0) == mapnik::grid::base_mask);
+    }
+
+    SECTION("fill agrees with the per cell hit test")
+    {
+        mapnik::grid_hit_index index(96, 80, 3);
+        // self intersecting star, inside by winding but not by crossing count in the centre
+        test_path star;
+        star.move_to(48, 2).line_to(76, 76).line_to(2, 28).line_to(94, 28).line_to(20, 76).close_path();
+        index.start_polygon(1, mapnik::grid_hit_index::fill_non_zero);
+        index.add_path(star);
+        index.start_polygon(2, mapnik::grid_hit_index::fill_even_odd);
+        test_path shifted;
+        shifted.move_to(30, 10).line_to(58, 70).line_to(-10, 40).line_to(70, 40).line_to(10, 70).close_path();
+        index.add_path(shifted);
+        // zigzag line over both, partly outside of the grid
+        test_path zigzag;
+        zigzag.move_to(-5, 50).line_to(20, 5).line_to(45, 60).line_to(70, 15).line_to(101, 79);
+        zigzag.move_to(60, 60); // single point
+        index.start_line(3, 1.7);
+        index.add_path(zigzag);
+
+        mapnik::grid g(32, 27, "__id__");
+        CHECK(index.fill(g));
+        std::size_t hits[4] = {0, 0, 0, 0};
+        for (std::size_t y = 0; y < 27; ++y)
+        {
+            for (std::size_t x = 0; x < 32; ++x)
+            {
+                INFO(x << "," << y);
+                mapnik::grid::value_type const id = index.hit(x, y);
+                CHECK(g.data()(x, y) == id);
+                if (id >= 1 && id <= 3)
+                    ++hits[id];
+            }
+        }
+        CHECK(hits[1] > 0);
+        CHECK(hits[2] > 0);
+        CHECK(hits[3] > 0);
+        CHECK(index.hit(20, 20) == 3); // sample (60.5, 60.5) next to the single point
+    }
+
+    SECTION("shapes outside of the grid are ignored")
+    {
+        mapnik::grid_hit_index index(16, 16, 4);
+        index.add_box(3, mapnik::box2d<double>(100, 100, 200, 200));
+        mapnik::grid g(4, 4, "__id__");
+        CHECK_FALSE(index.fill(g));
+        CHECK(g.data()(3, 3) == mapnik::grid::base_mask);
+    }
+}
+
+TEST_CASE("utfgrid encoder")
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::transcoder tr("utf-8");
+    mapnik::grid g(4, 2, "name");
+    g.add_field("name");
+    g.add_field("__id__");
+    mapnik::feature_ptr f1(mapnik::feature_factory::create(ctx, 1));
+    f1->put("name", tr.transcode("a \"quoted\" name"));
+    mapnik::feature_ptr f2(mapnik::feature_factory::create(ctx, 2));
+    f2->put("name", tr.transcode("b"));
+    g.add_feature(*f1);
+    g.add_feature(*f2);
+    g.setPixel(1, 0, 1);
+    g.setPixel(2, 0, 1);
+    g.setPixel(3, 1, 2);
+
+    SECTION("full resolution")
+    {
+        std::string json = mapnik::encode_utfgrid(g);
+        CHECK(json == "{\"grid\":[\" !! \",\"   #\"],\"keys\":[\"\",\"a \\\"quoted\\\" name\",\"b\"],"
+                      "\"data\":{\"a \\\"quoted\\\" name\":{\"__id__\":1,\"name\":\"a \\\"quoted\\\" name\"},"
+                      "\"b\":{\"__id__\":2,\"name\":\"b\"}}}");
+    }
+
+    SECTION("downsampled without feature data")
+    {
+        std::string json = mapnik::encode_utfgrid(g, 2, false);
+        CHECK(json == "{\"grid\":[\" !\"],\"keys\":[\"\",\"a \\\"quoted\\\" name\"],\"data\":{}}");
+    }
+
+    SECTION("codepoints skip characters that need escaping")
+    {
+        mapnik::grid wide(80, 1, "__id__");
+        for (int i = 1; i < 80; ++i)
+        {
+            mapnik::feature_ptr f(mapnik::feature_factory::create(ctx, i));
+            wide.add_feature(*f);
+            wide.setPixel(i, 0, i);
+        }
+        std::string json = mapnik::encode_utfgrid(wide, 1, false);
+        std::string row = json.substr(10, json.find('"', 10) - 10);
+        CHECK(row.find('\\') == std::string::npos);
+        CHECK(row.size() == 80u);
+        CHECK(row[0] == ' ');
+        CHECK(row[1] == '!');
+        CHECK(row[2] == '#');
+    }
+}
+
+#endif
@@ -0,0 +1,202 @@
+#include "catch.hpp"
+
+#if defined(GRID_RENDERER)
+
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_encoder.hpp>
+#include <mapnik/grid/grid_hit_index.hpp>
+#include <mapnik/grid/grid_renderer.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/parse_path.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/text/glyph_info.hpp>
+#include <mapnik/text/glyph_positions.hpp>
+#include <mapnik/text/text_properties.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+std::string const marker_file = "./test/data/grid-renderer-marker.svg";
+
+void add_layer(mapnik::Map& m,
+               std::string const& name,
+               mapnik::value_integer id,
+               mapnik::geometry::geometry<double> geom,
+               mapnik::symbolizer sym)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id));
+    feature->set_geometry(std::move(geom));
+    ds->push(feature);
+
+    mapnik::layer lyr(name);
+    lyr.set_datasource(ds);
+    lyr.add_style(name);
+    m.add_layer(lyr);
+
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style(name, std::move(style));
+}
+
+// Map and pixel coordinates only differ by the flipped y axis. Edges are on
+// whole pixels and clear of the pixels kept by a 4x downsample, so both hit
+// testing modes must agree exactly.
+mapnik::Map make_map()
+{
+    mapnik::Map m(256, 256);
+
+    // a polygon with a hole, pixels 22..150 x 106..234
+    mapnik::geometry::polygon<double> poly;
+    mapnik::geometry::linear_ring<double> exterior;
+    exterior.emplace_back(22, 22);
+    exterior.emplace_back(150, 22);
+    exterior.emplace_back(150, 150);
+    exterior.emplace_back(22, 150);
+    exterior.emplace_back(22, 22);
+    mapnik::geometry::linear_ring<double> hole;
+    hole.emplace_back(54, 54);
+    hole.emplace_back(54, 118);
+    hole.emplace_back(118, 118);
+    hole.emplace_back(118, 54);
+    hole.emplace_back(54, 54);
+    poly.push_back(std::move(exterior));
+    poly.push_back(std::move(hole));
+    add_layer(m, "polygon", 1, std::move(poly), mapnik::polygon_symbolizer());
+
+    // a vertical line across the polygon and its hole, pixels 99..105
+    mapnik::geometry::line_string<double> line;
+    line.emplace_back(102, -20);
+    line.emplace_back(102, 280);
+    mapnik::line_symbolizer line_sym;
+    mapnik::put(line_sym, mapnik::keys::stroke_width, 6.0);
+    add_layer(m, "line", 2, std::move(line), std::move(line_sym));
+
+    // a 16x16 square marker centred on pixel (130, 130)
+    mapnik::markers_symbolizer markers_sym;
+    mapnik::put(markers_sym, mapnik::keys::file, mapnik::parse_path(marker_file));
+    add_layer(m, "marker", 3, mapnik::geometry::point<double>(130, 126), std::move(markers_sym));
+
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 256, 256));
+    return m;
+}
+
+} // namespace
+
+TEST_CASE("grid_renderer")
+{
+    {
+        std::ofstream svg(marker_file);
+        svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"16\" height=\"16\">"
+            << "<rect x=\"0\" y=\"0\" width=\"16\" height=\"16\" fill=\"#000000\"/></svg>";
+    }
+    mapnik::Map m = make_map();
+
+    SECTION("hit resolution matches a downsampled raster grid")
+    {
+        mapnik::grid raster(256, 256, "__id__");
+        mapnik::grid_renderer<mapnik::grid> raster_ren(m, raster);
+        raster_ren.apply();
+        std::string expected = mapnik::encode_utfgrid(raster, 4);
+
+        mapnik::grid coarse(64, 64, "__id__");
+        mapnik::grid_renderer<mapnik::grid> vector_ren(m, coarse);
+        vector_ren.set_hit_resolution(4);
+        REQUIRE(vector_ren.hit_resolution() == 4);
+        REQUIRE(vector_ren.hit_index() != nullptr);
+        vector_ren.apply();
+        CHECK(vector_ren.hit_index()->empty());
+        std::string actual = mapnik::encode_utfgrid(coarse, 1);
+        CHECK(actual == expected);
+
+        // polygon, its hole, the line on top and the marker box on top of both
+        CHECK(coarse.data()(8, 40) == 1);
+        CHECK(coarse.data()(20, 50) == mapnik::grid::base_mask);
+        CHECK(coarse.data()(25, 50) == 2);
+        CHECK(coarse.data()(26, 10) == 2);
+        CHECK(coarse.data()(31, 31) == 3);
+        CHECK(coarse.data()(34, 31) == 3);
+        CHECK(coarse.data()(35, 31) == 1);
+        CHECK(coarse.get_grid_features().size() == 3);
+    }
+
+    SECTION("the grid must match the hit resolution")
+    {
+        mapnik::grid full(256, 256, "__id__");
+        mapnik::grid_renderer<mapnik::grid> ren(m, full);
+        CHECK_THROWS_AS(ren.set_hit_resolution(4), std::runtime_error);
+        CHECK(ren.hit_index() == nullptr);
+        mapnik::grid odd(43, 43, "__id__");
+        mapnik::grid_renderer<mapnik::grid> odd_ren(m, odd);
+        CHECK_NOTHROW(odd_ren.set_hit_resolution(6));
+        CHECK(odd_ren.hit_index() != nullptr);
+        odd_ren.set_hit_resolution(0);
+        CHECK(odd_ren.hit_index() == nullptr);
+    }
+
+    SECTION("glyph boxes")
+    {
+        mapnik::grid coarse(64, 64, "__id__");
+        mapnik::grid_renderer<mapnik::grid> ren(m, coarse);
+        // ignored while rasterizing
+        mapnik::glyph_positions none;
+        ren.record_glyphs(none, 1);
+        ren.set_hit_resolution(4);
+        mapnik::grid_hit_index& index = *ren.hit_index();
+
+        mapnik::evaluated_format_properties_ptr format =
+          std::make_unique<mapnik::detail::evaluated_format_properties>();
+        format->halo_radius = 0.0;
+        mapnik::glyph_info glyph(0, 0, format);
+        glyph.unscaled_advance = 40.0;
+        glyph.unscaled_ymin = 0.0;
+        glyph.unscaled_ymax = 10.0 / 64.0;
+
+        // horizontal, the box sits on the baseline: pixels 100..140 x 90..100
+        mapnik::glyph_positions horizontal;
+        horizontal.set_base_point(mapnik::pixel_position(100, 100));
+        horizontal.emplace_back(glyph, mapnik::pixel_position(0, 0), mapnik::rotation(0.0));
+        ren.record_glyphs(horizontal, 1);
+        CHECK(index.hit(25, 23) == 1);
+        CHECK(index.hit(34, 24) == 1);
+        CHECK(index.hit(24, 23) == mapnik::grid::base_mask);
+        CHECK(index.hit(35, 23) == mapnik::grid::base_mask);
+        CHECK(index.hit(25, 22) == mapnik::grid::base_mask);
+        CHECK(index.hit(25, 25) == mapnik::grid::base_mask);
+
+        // rotated a quarter turn, the glyph runs up from the pen position:
+        // pixels 190..200 x 160..200, padded by the halo
+        format->halo_radius = 2.0;
+        mapnik::glyph_positions rotated;
+        rotated.set_base_point(mapnik::pixel_position(200, 200));
+        rotated.emplace_back(glyph, mapnik::pixel_position(0, 0), mapnik::rotation(M_PI / 2.0));
+        ren.record_glyphs(rotated, 2);
+        CHECK(index.hit(48, 45) == 2);
+        CHECK(index.hit(47, 40) == 2);
+        CHECK(index.hit(47, 49) == 2);
+        CHECK(index.hit(50, 45) == 2); // 200.5 is on the halo
+        CHECK(index.hit(51, 45) == mapnik::grid::base_mask);
+        CHECK(index.hit(46, 45) == mapnik::grid::base_mask);
+        CHECK(index.hit(48, 39) == mapnik::grid::base_mask);
+        CHECK(index.hit(48, 51) == mapnik::grid::base_mask);
+    }
+
+    mapnik::util::remove(marker_file);
+}
+
+#endif
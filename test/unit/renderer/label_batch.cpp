@@ -0,0 +1,181 @@
+#include "catch.hpp"
+
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/renderer_common/label_worker_pool.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/value/types.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/text/formatting/text.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+mapnik::Map make_map(mapnik::label_placement_enum placement)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::transcoder tr("utf-8");
+    // dense enough for most labels to collide with earlier ones
+    for (int i = 0; i < 200; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i));
+        feature->put("name", tr.transcode(("label " + std::to_string(i)).c_str()));
+        double x = -240 + (i * 37) % 480;
+        double y = -240 + (i * 53) % 480;
+        if (placement == mapnik::label_placement_enum::LINE_PLACEMENT)
+        {
+            mapnik::geometry::line_string<double> line;
+            line.emplace_back(x, y);
+            line.emplace_back(x + 160, y + 40);
+            line.emplace_back(x + 320, y - 20);
+            feature->set_geometry(std::move(line));
+        }
+        else
+        {
+            feature->set_geometry(mapnik::geometry::point<double>(x, y));
+        }
+        ds->push(feature);
+    }
+
+    mapnik::Map m(256, 256);
+    mapnik::layer lyr("layer");
+    lyr.set_datasource(ds);
+    lyr.add_style("style");
+    m.add_layer(lyr);
+    mapnik::feature_type_style the_style;
+    mapnik::rule r;
+    mapnik::text_symbolizer text_sym;
+    mapnik::text_placements_ptr placement_finder = std::make_shared<mapnik::text_placements_dummy>();
+    placement_finder->defaults.format_defaults.face_name = "DejaVu Sans Book";
+    placement_finder->defaults.format_defaults.text_size = 10.0;
+    placement_finder->defaults.format_defaults.fill = mapnik::color(0, 0, 0);
+    placement_finder->defaults.expressions.label_placement = mapnik::enumeration_wrapper(placement);
+    placement_finder->defaults.set_format_tree(
+      std::make_shared<mapnik::formatting::text_node>(mapnik::parse_expression("[name]")));
+    mapnik::put<mapnik::text_placements_ptr>(text_sym, mapnik::keys::text_placements_, placement_finder);
+    r.append(std::move(text_sym));
+    the_style.add_rule(std::move(r));
+    m.insert_style("style", std::move(the_style));
+    m.zoom_to_box(mapnik::box2d<double>(-256, -256, 256, 256));
+    return m;
+}
+
+mapnik::image_rgba8 render(mapnik::Map const& m, unsigned threads)
+{
+    mapnik::image_rgba8 buf(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, buf);
+    ren.set_label_threads(threads);
+    ren.apply();
+    return buf;
+}
+
+} // namespace
+
+TEST_CASE("label_batch")
+{
+    REQUIRE(mapnik::freetype_engine::register_font("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf"));
+
+    SECTION("point placement matches serial placement")
+    {
+        mapnik::Map m = make_map(mapnik::label_placement_enum::POINT_PLACEMENT);
+        mapnik::image_rgba8 serial = render(m, 1);
+        mapnik::image_rgba8 batched = render(m, 4);
+        CHECK(serial.painted());
+        CHECK(mapnik::compare(serial, batched) == 0);
+    }
+
+    SECTION("line placement matches serial placement")
+    {
+        mapnik::Map m = make_map(mapnik::label_placement_enum::LINE_PLACEMENT);
+        mapnik::image_rgba8 serial = render(m, 1);
+        mapnik::image_rgba8 batched = render(m, 4);
+        CHECK(serial.painted());
+        CHECK(mapnik::compare(serial, batched) == 0);
+    }
+
+    SECTION("pooled renders keep their label workers")
+    {
+        mapnik::Map m = make_map(mapnik::label_placement_enum::POINT_PLACEMENT);
+        mapnik::image_rgba8 serial = render(m, 1);
+        mapnik::agg_renderer_pool<mapnik::image_rgba8> pool;
+        mapnik::label_worker_pool const* workers = nullptr;
+        for (int i = 0; i < 3; ++i)
+        {
+            mapnik::image_rgba8 buf(m.width(), m.height());
+            mapnik::request req(m.width(), m.height(), m.get_current_extent());
+            auto scratch = pool.acquire(m.width(), m.height());
+            {
+                mapnik::agg_renderer<mapnik::image_rgba8> ren(m, req, mapnik::attributes(), buf, scratch);
+                ren.set_label_threads(4);
+                ren.apply();
+            }
+            CHECK(mapnik::compare(serial, buf) == 0);
+            REQUIRE(scratch->label_workers);
+            CHECK(scratch->label_workers->size() == 3);
+            if (workers)
+                CHECK(scratch->label_workers.get() == workers);
+            workers = scratch->label_workers.get();
+        }
+        CHECK(pool.created() == 1);
+        CHECK(pool.reused() == 2);
+    }
+}
+
+TEST_CASE("label_worker_pool")
+{
+    mapnik::label_worker_pool pool;
+
+    SECTION("runs every slot once per run")
+    {
+        for (unsigned threads : {4u, 2u, 6u, 1u})
+        {
+            std::vector<std::atomic<int>> calls(threads);
+            std::atomic<bool> on_caller(false);
+            auto const caller = std::this_thread::get_id();
+            pool.run(threads, [&](unsigned slot) {
+                ++calls[slot];
+                if (slot == 0)
+                    on_caller = std::this_thread::get_id() == caller;
+            });
+            for (auto const& count : calls)
+            {
+                CHECK(count == 1);
+            }
+            CHECK(on_caller);
+        }
+        CHECK(pool.size() == 5);
+    }
+
+    SECTION("rethrows worker exceptions")
+    {
+        CHECK_THROWS_AS(pool.run(3,
+                                 [](unsigned slot) {
+                                     if (slot == 2)
+                                         throw std::runtime_error("worker failed");
+                                 }),
+                        std::runtime_error);
+        // the pool stays usable
+        std::atomic<int> calls(0);
+        pool.run(3, [&](unsigned) { ++calls; });
+        CHECK(calls == 3);
+    }
+}
@@ -0,0 +1,297 @@
+#include "catch.hpp"
+
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/mvt/mvt.hpp>
+#include <mapnik/mvt/mvt_renderer.hpp>
+
+#include <protozero/pbf_reader.hpp>
+
+#include <map>
+
+namespace {
+
+struct decoded_feature
+{
+    std::uint64_t id = 0;
+    std::uint32_t type = 0;
+    std::vector<std::uint32_t> tags;
+    std::vector<std::uint32_t> geometry;
+};
+
+struct decoded_layer
+{
+    std::string name;
+    std::uint32_t version = 0;
+    std::uint32_t extent = 0;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    std::vector<decoded_feature> features;
+};
+
+std::map<std::string, decoded_layer> decode_tile(std::string const& tile)
+{
+    std::map<std::string, decoded_layer> layers;
+    protozero::pbf_reader tile_reader(tile);
+    while (tile_reader.next(mapnik::mvt::TILE_LAYERS))
+    {
+        decoded_layer lyr;
+        protozero::pbf_reader layer_reader = tile_reader.get_message();
+        while (layer_reader.next())
+        {
+            switch (layer_reader.tag())
+            {
+                case mapnik::mvt::LAYER_NAME:
+                    lyr.name = layer_reader.get_string();
+                    break;
+                case mapnik::mvt::LAYER_VERSION:
+                    lyr.version = layer_reader.get_uint32();
+                    break;
+                case mapnik::mvt::LAYER_EXTENT:
+                    lyr.extent = layer_reader.get_uint32();
+                    break;
+                case mapnik::mvt::LAYER_KEYS:
+                    lyr.keys.push_back(layer_reader.get_string());
+                    break;
+                case mapnik::mvt::LAYER_VALUES:
+                    lyr.values.push_back(layer_reader.get_string());
+                    break;
+                case mapnik::mvt::LAYER_FEATURES: {
+                    decoded_feature feat;
+                    protozero::pbf_reader feature_reader = layer_reader.get_message();
+                    while (feature_reader.next())
+                    {
+                        switch (feature_reader.tag())
+                        {
+                            case mapnik::mvt::FEATURE_ID:
+                                feat.id = feature_reader.get_uint64();
+                                break;
+                            case mapnik::mvt::FEATURE_TYPE:
+                                feat.type = static_cast<std::uint32_t>(feature_reader.get_enum());
+                                break;
+                            case mapnik::mvt::FEATURE_TAGS: {
+                                for (auto val : feature_reader.get_packed_uint32())
+                                    feat.tags.push_back(val);
+                                break;
+                            }
+                            case mapnik::mvt::FEATURE_GEOMETRY: {
+                                for (auto val : feature_reader.get_packed_uint32())
+                                    feat.geometry.push_back(val);
+                                break;
+                            }
+                            default:
+                                feature_reader.skip();
+                        }
+                    }
+                    lyr.features.push_back(std::move(feat));
+                    break;
+                }
+                default:
+                    layer_reader.skip();
+            }
+        }
+        layers.emplace(lyr.name, std::move(lyr));
+    }
+    return layers;
+}
+
+std::shared_ptr<mapnik::memory_datasource> prepare_datasource()
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    ctx->push("kind");
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        feature->put("name", mapnik::value_unicode_string("a"));
+        feature->put("kind", mapnik::value_integer(1));
+        feature->set_geometry(mapnik::geometry::point<double>(25, 25));
+        ds->push(feature);
+    }
+    {
+        // partially outside of the tile, gets clipped at the buffer
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 2));
+        feature->put("name", mapnik::value_unicode_string("b"));
+        feature->put("kind", mapnik::value_integer(1));
+        mapnik::geometry::line_string<double> line;
+        line.emplace_back(-50, 50);
+        line.emplace_back(50, 50);
+        feature->set_geometry(std::move(line));
+        ds->push(feature);
+    }
+    {
+        // counter-clockwise exterior ring, reversed in the tile
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 3));
+        feature->put("name", mapnik::value_unicode_string("a"));
+        feature->put("kind", mapnik::value_integer(2));
+        mapnik::geometry::polygon<double> poly;
+        mapnik::geometry::linear_ring<double> ring;
+        ring.emplace_back(0, 0);
+        ring.emplace_back(50, 0);
+        ring.emplace_back(50, 50);
+        ring.emplace_back(0, 50);
+        ring.emplace_back(0, 0);
+        poly.push_back(std::move(ring));
+        feature->set_geometry(std::move(poly));
+        ds->push(feature);
+    }
+    {
+        // collapses to nothing once snapped to the tile grid
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 4));
+        feature->put("kind", mapnik::value_integer(3));
+        mapnik::geometry::polygon<double> poly;
+        mapnik::geometry::linear_ring<double> ring;
+        ring.emplace_back(10, 10);
+        ring.emplace_back(10.001, 10);
+        ring.emplace_back(10.001, 10.001);
+        ring.emplace_back(10, 10);
+        poly.push_back(std::move(ring));
+        feature->set_geometry(std::move(poly));
+        ds->push(feature);
+    }
+    {
+        // entirely outside of the buffered tile
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 5));
+        feature->put("kind", mapnik::value_integer(1));
+        feature->set_geometry(mapnik::geometry::point<double>(500, 500));
+        ds->push(feature);
+    }
+    return ds;
+}
+
+mapnik::Map prepare_map(bool two_styles)
+{
+    mapnik::Map map(256, 256);
+    map.set_buffer_size(4);
+
+    mapnik::feature_type_style style;
+    {
+        mapnik::rule r;
+        r.set_filter(mapnik::parse_expression("[kind] < 3"));
+        r.append(mapnik::line_symbolizer());
+        style.add_rule(std::move(r));
+    }
+    {
+        mapnik::rule r;
+        r.set_filter(mapnik::parse_expression("[kind] = 1"));
+        r.append(mapnik::point_symbolizer());
+        style.add_rule(std::move(r));
+    }
+    map.insert_style("style", std::move(style));
+
+    mapnik::layer lyr("layer");
+    lyr.set_datasource(prepare_datasource());
+    lyr.add_style("style");
+    if (two_styles)
+    {
+        mapnik::feature_type_style all;
+        mapnik::rule r;
+        r.append(mapnik::polygon_symbolizer());
+        all.add_rule(std::move(r));
+        map.insert_style("all", std::move(all));
+        lyr.add_style("all");
+    }
+    map.add_layer(lyr);
+    map.zoom_to_box(mapnik::box2d<double>(0, 0, 100, 100));
+    return map;
+}
+
+std::vector<std::uint64_t> feature_ids(decoded_layer const& lyr)
+{
+    std::vector<std::uint64_t> ids;
+    for (auto const& feat : lyr.features)
+        ids.push_back(feat.id);
+    return ids;
+}
+
+} // namespace
+
+TEST_CASE("mvt_renderer")
+{
+    SECTION("encodes features matched by the style rules")
+    {
+        mapnik::Map map(prepare_map(false));
+        std::string tile;
+        mapnik::mvt_renderer renderer(map, tile);
+        renderer.apply();
+        REQUIRE(renderer.painted());
+
+        auto layers = decode_tile(tile);
+        REQUIRE(layers.size() == 1);
+        decoded_layer const& lyr = layers["layer"];
+        CHECK(lyr.version == 2);
+        CHECK(lyr.extent == 4096);
+        // filtered out by the rules, collapsed or outside of the tile
+        REQUIRE(feature_ids(lyr) == std::vector<std::uint64_t>{1, 2, 3});
+
+        // point at the tile coordinate (1024, 3072)
+        decoded_feature const& point = lyr.features[0];
+        CHECK(point.type == mapnik::mvt::GEOM_POINT);
+        CHECK(point.geometry == std::vector<std::uint32_t>{9, 2048, 6144});
+
+        // line clipped at the 64 unit buffer (4 pixels at 256 pixels per tile)
+        decoded_feature const& line = lyr.features[1];
+        CHECK(line.type == mapnik::mvt::GEOM_LINESTRING);
+        CHECK(line.geometry == std::vector<std::uint32_t>{9, 127, 4096, 10, 4224, 0});
+
+        // exterior ring has a positive area in tile coordinates, closing vertex omitted
+        decoded_feature const& poly = lyr.features[2];
+        CHECK(poly.type == mapnik::mvt::GEOM_POLYGON);
+        REQUIRE(poly.geometry.size() == 11);
+        CHECK(poly.geometry[0] == mapnik::mvt::command_integer(mapnik::mvt::CMD_MOVE_TO, 1));
+        CHECK(poly.geometry[3] == mapnik::mvt::command_integer(mapnik::mvt::CMD_LINE_TO, 3));
+        CHECK(poly.geometry[10] == mapnik::mvt::command_integer(mapnik::mvt::CMD_CLOSE_PATH, 1));
+        std::int32_t x = 0, y = 0;
+        std::int64_t area = 0;
+        std::vector<std::pair<std::int32_t, std::int32_t>> ring;
+        for (std::size_t i : {1, 4, 6, 8})
+        {
+            x += mapnik::mvt::zigzag_decode(poly.geometry[i]);
+            y += mapnik::mvt::zigzag_decode(poly.geometry[i + 1]);
+            ring.emplace_back(x, y);
+        }
+        for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+        {
+            area += std::int64_t(ring[j].first) * ring[i].second - std::int64_t(ring[i].first) * ring[j].second;
+        }
+        CHECK(area > 0);
+
+        // keys and values are stored once per layer
+        CHECK(lyr.keys.size() == 2);
+        CHECK(lyr.values.size() == 4); // 1, "a", "b", 2
+        REQUIRE(lyr.features[0].tags.size() == 4);
+        REQUIRE(lyr.features[2].tags.size() == 4);
+        CHECK(lyr.features[0].tags[3] == lyr.features[2].tags[3]);
+    }
+
+    SECTION("features matched by several styles are encoded once")
+    {
+        mapnik::Map map(prepare_map(true));
+        std::string tile;
+        mapnik::mvt_renderer renderer(map, tile);
+        renderer.apply();
+        auto layers = decode_tile(tile);
+        REQUIRE(layers.size() == 1);
+        CHECK(feature_ids(layers["layer"]) == std::vector<std::uint64_t>{1, 2, 3});
+    }
+
+    SECTION("layers without features are omitted")
+    {
+        mapnik::Map map(prepare_map(false));
+        map.zoom_to_box(mapnik::box2d<double>(1000, 1000, 1100, 1100));
+        std::string tile;
+        mapnik::mvt_renderer renderer(map, tile);
+        renderer.apply();
+        CHECK(tile.empty());
+    }
+}
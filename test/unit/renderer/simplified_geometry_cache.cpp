@@ -0,0 +1,314 @@
+#include "catch.hpp"
+
+#include <mapnik/simplified_geometry_cache.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/transform/parse_transform.hpp>
+#include <mapnik/symbolizer.hpp>
+
+#include <cmath>
+#include <new>
+
+namespace {
+
+mapnik::parameters memory_params()
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    return params;
+}
+
+mapnik::simplified_path make_path(std::size_t size)
+{
+    mapnik::simplified_path path;
+    path.type = mapnik::geometry::geometry_types::LineString;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        path.vertices.push_back({double(i), 0.0, i == 0 ? unsigned(mapnik::SEG_MOVETO) : unsigned(mapnik::SEG_LINETO)});
+    }
+    return path;
+}
+
+mapnik::simplified_geometry_cache::key_type key(mapnik::value_integer id, int scale = 0)
+{
+    return mapnik::simplified_geometry_cache::key_type{id, scale, 2.0, mapnik::radial_distance};
+}
+
+// wobbly rings and lines with far more vertices than the cache's minimum
+mapnik::geometry::polygon<double> make_polygon(double cx, double cy, double radius)
+{
+    mapnik::geometry::polygon<double> poly;
+    mapnik::geometry::linear_ring<double> ring;
+    for (int i = 0; i <= 1000; ++i)
+    {
+        double angle = (i % 1000) * 2.0 * M_PI / 1000.0;
+        double r = radius * (1.0 + 0.05 * std::sin(angle * 37.0));
+        ring.emplace_back(cx + r * std::cos(angle), cy + r * std::sin(angle));
+    }
+    poly.push_back(std::move(ring));
+    return poly;
+}
+
+mapnik::geometry::line_string<double> make_line(double y)
+{
+    mapnik::geometry::line_string<double> line;
+    for (int i = 0; i < 1000; ++i)
+    {
+        double x = -250.0 + i * 0.5;
+        line.emplace_back(x, y + 10.0 * std::sin(x / 7.3));
+    }
+    return line;
+}
+
+// features with the same id have different geometries when unique_ids is false
+mapnik::Map make_map(bool unique_ids)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    auto ds = std::make_shared<mapnik::memory_datasource>(memory_params());
+    for (int i = 0; i < 4; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, unique_ids ? i : 1));
+        feature->set_geometry(make_polygon(-120.0 + i * 80.0, -100.0 + i * 60.0, 40.0 + i * 10.0));
+        ds->push(feature);
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, unique_ids ? 10 + i : 1));
+        feature->set_geometry(make_line(-150.0 + i * 140.0));
+        ds->push(feature);
+    }
+
+    mapnik::Map m(256, 256);
+    mapnik::layer lyr("layer");
+    lyr.set_datasource(ds);
+    lyr.add_style("style");
+    m.add_layer(lyr);
+    mapnik::feature_type_style the_style;
+    mapnik::rule r;
+    // without clipping the cached and the converter pipeline simplify the
+    // same vertices, so the images must be identical
+    mapnik::polygon_symbolizer poly_sym;
+    mapnik::put(poly_sym, mapnik::keys::fill, mapnik::color(40, 80, 160));
+    mapnik::put(poly_sym, mapnik::keys::simplify_tolerance, 2.0);
+    mapnik::put(poly_sym, mapnik::keys::clip, false);
+    r.append(std::move(poly_sym));
+    mapnik::line_symbolizer line_sym;
+    mapnik::put(line_sym, mapnik::keys::stroke, mapnik::color(200, 30, 30));
+    mapnik::put(line_sym, mapnik::keys::stroke_width, 1.5);
+    mapnik::put(line_sym, mapnik::keys::simplify_tolerance, 2.0);
+    mapnik::put(line_sym, mapnik::keys::clip, false);
+    r.append(std::move(line_sym));
+    the_style.add_rule(std::move(r));
+    m.insert_style("style", std::move(the_style));
+    return m;
+}
+
+mapnik::image_rgba8 render(mapnik::Map& m,
+                           mapnik::box2d<double> const& tile,
+                           std::shared_ptr<mapnik::simplified_geometry_cache> const& cache)
+{
+    m.zoom_to_box(tile);
+    mapnik::image_rgba8 buf(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, buf);
+    if (cache)
+        ren.set_simplified_geometry_cache(cache);
+    ren.apply();
+    return buf;
+}
+
+} // namespace
+
+TEST_CASE("simplified_geometry_cache")
+{
+    SECTION("static datasources only")
+    {
+        mapnik::simplified_geometry_cache cache;
+        auto ds = std::make_shared<mapnik::memory_datasource>(memory_params());
+        CHECK(cache.attach(ds) == 0);
+        cache.insert(0, key(1), make_path(10));
+        CHECK(!cache.find(0, key(1)));
+        CHECK(cache.stats().vertices == 0);
+
+        // the GeoJSON plugin only numbers features the same way on every
+        // query when it holds them in memory
+        mapnik::simplified_geometry_cache geojson_cache;
+        mapnik::parameters params;
+        params["type"] = "geojson";
+        params["inline"] = "{}";
+        CHECK(geojson_cache.attach(std::make_shared<mapnik::memory_datasource>(params)) != 0);
+        params = mapnik::parameters();
+        params["type"] = "geojson";
+        params["file"] = "test/data/json/escaped.geojson";
+        params["cache_features"] = false;
+        CHECK(geojson_cache.attach(std::make_shared<mapnik::memory_datasource>(params)) == 0);
+        params["type"] = "geobuf";
+        CHECK(geojson_cache.attach(std::make_shared<mapnik::memory_datasource>(params)) == 0);
+
+        cache.add_static_type("memory");
+        CHECK(cache.attach(ds) != 0);
+    }
+
+    SECTION("find and insert")
+    {
+        mapnik::simplified_geometry_cache cache;
+        cache.add_static_type("memory");
+        auto ds = std::make_shared<mapnik::memory_datasource>(memory_params());
+        auto source = cache.attach(ds);
+        REQUIRE(source != 0);
+        CHECK(cache.attach(ds) == source);
+        CHECK(!cache.find(source, key(1)));
+        cache.insert(source, key(1), make_path(10));
+        auto path = cache.find(source, key(1));
+        REQUIRE(path);
+        CHECK(path->vertices.size() == 10);
+        // other scales and tolerances are separate
+        CHECK(!cache.find(source, key(1, 1)));
+        CHECK(!cache.find(source, mapnik::simplified_geometry_cache::key_type{1, 0, 3.0, mapnik::radial_distance}));
+        // the first geometry stored wins
+        CHECK(cache.insert(source, key(1), make_path(20))->vertices.size() == 10);
+
+        // reading through the adapter
+        mapnik::geometry::simplified_path_adapter va(*path);
+        CHECK(va.type() == mapnik::geometry::geometry_types::LineString);
+        double x, y;
+        unsigned count = 0;
+        va.rewind(0);
+        while (va.vertex(&x, &y) != mapnik::SEG_END)
+            ++count;
+        CHECK(count == 10);
+        CHECK(x == 9.0);
+
+        cache.clear();
+        CHECK(!cache.find(source, key(1)));
+        CHECK(cache.stats().vertices == 0);
+    }
+
+    SECTION("replaced datasource")
+    {
+        mapnik::simplified_geometry_cache cache;
+        cache.add_static_type("memory");
+        // construct both datasources at the same address
+        alignas(mapnik::memory_datasource) unsigned char storage[sizeof(mapnik::memory_datasource)];
+        auto destroy = [](mapnik::memory_datasource* ds) { ds->~memory_datasource(); };
+        std::shared_ptr<mapnik::memory_datasource> ds(new (storage) mapnik::memory_datasource(memory_params()),
+                                                      destroy);
+        auto first = cache.attach(ds);
+        REQUIRE(first != 0);
+        cache.insert(first, key(1), make_path(10));
+        ds.reset();
+
+        std::shared_ptr<mapnik::memory_datasource> other(new (storage) mapnik::memory_datasource(memory_params()),
+                                                         destroy);
+        auto second = cache.attach(other);
+        REQUIRE(second != 0);
+        CHECK(second != first);
+        CHECK(!cache.find(second, key(1)));
+        CHECK(!cache.find(first, key(1)));
+        // the geometries of the destroyed datasource are gone
+        CHECK(cache.stats().vertices == 0);
+        cache.insert(second, key(1), make_path(20));
+        CHECK(cache.find(second, key(1))->vertices.size() == 20);
+        CHECK(cache.stats().vertices == 20);
+        CHECK(cache.stats().evictions == 0);
+    }
+
+    SECTION("eviction")
+    {
+        // 16 shards of 100 vertices each
+        mapnik::simplified_geometry_cache cache(1600);
+        cache.add_static_type("memory");
+        auto ds = std::make_shared<mapnik::memory_datasource>(memory_params());
+        auto source = cache.attach(ds);
+        for (int i = 0; i < 1000; ++i)
+        {
+            cache.insert(source, key(i), make_path(10));
+        }
+        auto stats = cache.stats();
+        CHECK(stats.vertices <= 1600);
+        CHECK(stats.evictions >= 1000 - 160);
+        CHECK(stats.vertices + stats.evictions * 10 == 10000);
+        CHECK(cache.find(source, key(999)));
+    }
+
+    SECTION("scale buckets")
+    {
+        using mapnik::simplified_geometry_cache;
+        CHECK(simplified_geometry_cache::scale_bucket(1.0) == 0);
+        CHECK(simplified_geometry_cache::scale_bucket(2.0) == 16);
+        CHECK(simplified_geometry_cache::scale_bucket(0.5) == -16);
+        CHECK(simplified_geometry_cache::scale_bucket(1.001) == simplified_geometry_cache::scale_bucket(1.0));
+    }
+
+    SECTION("rendering with the cache matches rendering without it")
+    {
+        mapnik::Map m = make_map(true);
+        auto cache = std::make_shared<mapnik::simplified_geometry_cache>();
+        cache->add_static_type("memory");
+        // the four tiles of one zoom level, twice: filling and reusing the cache
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (int tile = 0; tile < 4; ++tile)
+            {
+                double minx = -256.0 + (tile % 2) * 256.0;
+                double miny = -256.0 + (tile / 2) * 256.0;
+                mapnik::box2d<double> box(minx, miny, minx + 256.0, miny + 256.0);
+                mapnik::image_rgba8 expected = render(m, box, nullptr);
+                mapnik::image_rgba8 actual = render(m, box, cache);
+                CHECK(expected.painted());
+                CHECK(mapnik::compare(expected, actual) == 0);
+            }
+        }
+        auto stats = cache->stats();
+        CHECK(stats.vertices > 0);
+        CHECK(stats.hits > stats.misses);
+    }
+
+    SECTION("offset and transformed geometries are not cached")
+    {
+        mapnik::Map m = make_map(true);
+        m.remove_style("style");
+        mapnik::feature_type_style the_style;
+        mapnik::rule r;
+        mapnik::polygon_symbolizer poly_sym;
+        mapnik::put(poly_sym, mapnik::keys::fill, mapnik::color(40, 80, 160));
+        mapnik::put(poly_sym, mapnik::keys::simplify_tolerance, 2.0);
+        mapnik::put(poly_sym, mapnik::keys::geometry_transform, mapnik::parse_transform("rotate(10)"));
+        r.append(std::move(poly_sym));
+        mapnik::line_symbolizer line_sym;
+        mapnik::put(line_sym, mapnik::keys::stroke, mapnik::color(200, 30, 30));
+        mapnik::put(line_sym, mapnik::keys::simplify_tolerance, 2.0);
+        mapnik::put(line_sym, mapnik::keys::offset, 3.0);
+        r.append(std::move(line_sym));
+        the_style.add_rule(std::move(r));
+        m.insert_style("style", std::move(the_style));
+
+        auto cache = std::make_shared<mapnik::simplified_geometry_cache>();
+        cache->add_static_type("memory");
+        mapnik::box2d<double> box(-256.0, -256.0, 256.0, 256.0);
+        mapnik::image_rgba8 expected = render(m, box, nullptr);
+        mapnik::image_rgba8 actual = render(m, box, cache);
+        CHECK(expected.painted());
+        CHECK(mapnik::compare(expected, actual) == 0);
+        CHECK(cache->stats().vertices == 0);
+    }
+
+    SECTION("features without unique ids are not cached")
+    {
+        mapnik::Map m = make_map(false);
+        // "memory" datasources aren't static by default
+        auto cache = std::make_shared<mapnik::simplified_geometry_cache>();
+        mapnik::box2d<double> box(-256.0, -256.0, 256.0, 256.0);
+        mapnik::image_rgba8 expected = render(m, box, nullptr);
+        mapnik::image_rgba8 actual = render(m, box, cache);
+        CHECK(mapnik::compare(expected, actual) == 0);
+        CHECK(cache->stats().vertices == 0);
+    }
+}
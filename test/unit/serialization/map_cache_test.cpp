@@ -0,0 +1,140 @@
+#include "catch.hpp"
+
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/load_map.hpp>
+#include <mapnik/save_map.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <fstream>
+
+namespace {
+
+void write_file(std::string const& filename, std::string const& content)
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+std::string const xml_head("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                           "<!DOCTYPE Map [<!ENTITY width \"2.5\">]>\n"
+                           "<Map srs=\"epsg:4326\" background-color=\"#abcdef\" buffer-size=\"16\"");
+
+std::string const xml_body(
+  "  <Parameters><Parameter name=\"scale\">2</Parameter><Parameter name=\"label\">roads</Parameter></Parameters>\n"
+  "  <Style name=\"lines\" filter-mode=\"first\" comp-op=\"multiply\" opacity=\"0.5\"\n"
+  "         image-filters=\"agg-stack-blur(2,3)\">\n"
+  "    <Rule name=\"major\">\n"
+  "      <MaxScaleDenominator>500000</MaxScaleDenominator>\n"
+  "      <Filter>([class] = 'motorway' or [lanes] &gt;= 4) and not ([name].match('^A[0-9]+'))</Filter>\n"
+  "      <LineSymbolizer stroke=\"#ff6666\" stroke-width=\"&width;\" stroke-dasharray=\"5, 5\"\n"
+  "                      geometry-transform=\"translate(1, [dy]) rotate(45)\" />\n"
+  "    </Rule>\n"
+  "    <Rule>\n"
+  "      <ElseFilter />\n"
+  "      <PolygonSymbolizer fill=\"rgba(10,20,30,0.5)\" gamma=\"0.7\" />\n"
+  "      <MarkersSymbolizer file=\"shape://ellipse\" width=\"[size] * pow(2, @zoom)\" allow-overlap=\"true\" />\n"
+  "    </Rule>\n"
+  "  </Style>\n"
+  "  <Style name=\"labels\">\n"
+  "    <Rule>\n"
+  "      <TextSymbolizer face-name=\"DejaVu Sans Book\" size=\"10\"\n"
+  "                      placement-type=\"simple\" placements=\"N,S,E,W,12\" dy=\"2\">\n"
+  "        [name].replace('(\\w+) (\\w+)', '$2 $1') + ' ' + length([ref])</TextSymbolizer>\n"
+  "    </Rule>\n"
+  "  </Style>\n"
+  "  <Style name=\"raster\">\n"
+  "    <Rule>\n"
+  "      <RasterSymbolizer opacity=\"0.8\">\n"
+  "        <RasterColorizer default-mode=\"linear\" default-color=\"white\" epsilon=\"0.01\">\n"
+  "          <stop color=\"blue\" value=\"0\" />\n"
+  "          <stop color=\"red\" value=\"100\" mode=\"discrete\" label=\"high\" />\n"
+  "        </RasterColorizer>\n"
+  "      </RasterSymbolizer>\n"
+  "    </Rule>\n"
+  "  </Style>\n"
+  "  <Layer name=\"roads\" srs=\"epsg:3857\" maximum-scale-denominator=\"1000000\" group-by=\"class\">\n"
+  "    <StyleName>lines</StyleName>\n"
+  "    <StyleName>labels</StyleName>\n"
+  "    <Layer name=\"nested\" status=\"off\"><StyleName>raster</StyleName></Layer>\n"
+  "  </Layer>\n");
+
+std::string map_xml(std::string const& include = "")
+{
+    return xml_head + (include.empty() ? ">\n" : " xmlns:xi=\"http://www.w3.org/2001/XInclude\">\n") + xml_body +
+           include + "</Map>\n";
+}
+
+std::string load(std::string const& xml_file, std::string const& cache_file, bool strict = false)
+{
+    mapnik::Map m(256, 256);
+    mapnik::load_map(m, xml_file, strict, "", cache_file);
+    return mapnik::save_map_to_string(m);
+}
+
+} // namespace
+
+TEST_CASE("map cache")
+{
+    std::string const xml_file("./test/data/mapnik-map-cache-test.xml");
+    std::string const include_file("./test/data/mapnik-map-cache-test-include.xml");
+    std::string const cache_file("./test/data/mapnik-map-cache-test.cache");
+    mapnik::util::remove(cache_file);
+
+    SECTION("a compiled map loads like the stylesheet")
+    {
+        write_file(xml_file, map_xml());
+        std::string const expected = load(xml_file, "");
+        REQUIRE_NOTHROW(mapnik::compile_map(xml_file, cache_file));
+        REQUIRE(mapnik::util::exists(cache_file));
+        CHECK(load(xml_file, cache_file) == expected);
+        // compiled for non-strict loading, a strict load parses the stylesheet
+        CHECK(load(xml_file, cache_file, true) == expected);
+    }
+
+    SECTION("a changed stylesheet invalidates the cache")
+    {
+        write_file(xml_file, map_xml());
+        REQUIRE_NOTHROW(mapnik::compile_map(xml_file, cache_file));
+        std::string const changed = map_xml() + "<!-- changed -->\n";
+        write_file(xml_file, changed);
+        mapnik::Map m(256, 256);
+        mapnik::load_map(m, xml_file, false, "", cache_file);
+        mapnik::Map reference(256, 256);
+        mapnik::load_map(reference, xml_file);
+        CHECK(mapnik::save_map_to_string(m) == mapnik::save_map_to_string(reference));
+    }
+
+    SECTION("a damaged cache is ignored")
+    {
+        write_file(xml_file, map_xml());
+        write_file(cache_file, "MAPNIKMC garbage");
+        CHECK(load(xml_file, cache_file) == load(xml_file, ""));
+    }
+
+#if defined(HAVE_LIBXML2)
+    SECTION("a changed XInclude invalidates the cache")
+    {
+        write_file(include_file, "<Layer name=\"included\"><StyleName>lines</StyleName></Layer>");
+        write_file(xml_file, map_xml("  <xi:include href=\"mapnik-map-cache-test-include.xml\" />\n"));
+        REQUIRE_NOTHROW(mapnik::compile_map(xml_file, cache_file));
+        {
+            mapnik::Map m(256, 256);
+            mapnik::load_map(m, xml_file, false, "", cache_file);
+            REQUIRE(m.layer_count() == 2);
+            CHECK(m.get_layer(1).name() == "included");
+        }
+        write_file(include_file, "<Layer name=\"included-changed\"><StyleName>lines</StyleName></Layer>");
+        {
+            mapnik::Map m(256, 256);
+            mapnik::load_map(m, xml_file, false, "", cache_file);
+            REQUIRE(m.layer_count() == 2);
+            CHECK(m.get_layer(1).name() == "included-changed");
+        }
+        mapnik::util::remove(include_file);
+    }
+#endif
+
+    mapnik::util::remove(xml_file);
+    mapnik::util::remove(cache_file);
+}
@@ -31,6 +31,7 @@
 #include <mapnik/svg/svg_path_adapter.hpp>
 #include <mapnik/svg/svg_renderer_agg.hpp>
 #include <mapnik/svg/svg_path_attributes.hpp>
+#include <mapnik/svg/svg_flattened_path.hpp>
 #include <boost/range/combine.hpp>
 
 #include <mapnik/warning.hpp>
@@ -80,6 +81,56 @@ mapnik::image_rgba8 render_svg(std::string const& filename, double scale_factor)
     return im;
 }
 
+mapnik::image_rgba8 render_marker(mapnik::marker_svg const& svg, double scale_factor, bool flattened)
+{
+    using pixfmt = agg::pixfmt_rgba32_pre;
+    using renderer_base = agg::renderer_base<pixfmt>;
+    using renderer_solid = agg::renderer_scanline_aa_solid<renderer_base>;
+
+    agg::rasterizer_scanline_aa<> ras_ptr;
+    agg::scanline_u8 sl;
+    mapnik::box2d<double> const& bbox = svg.bounding_box();
+    int size = static_cast<int>(std::ceil(std::max(bbox.width(), bbox.height()) * scale_factor)) + 4;
+    mapnik::image_rgba8 im(size, size, true, true);
+    agg::rendering_buffer buf(im.bytes(), im.width(), im.height(), im.row_size());
+    pixfmt pixf(buf);
+    renderer_base renb(pixf);
+
+    agg::trans_affine mtx = agg::trans_affine_translation(-bbox.center().x, -bbox.center().y);
+    mtx.scale(scale_factor);
+    mtx.translate(0.5 * size, 0.5 * size);
+
+    mapnik::svg::vertex_stl_adapter<mapnik::svg::svg_path_storage> stl_storage(svg.get_data()->source());
+    mapnik::svg::svg_path_adapter svg_path(stl_storage);
+    mapnik::svg::
+      renderer_agg<mapnik::svg_path_adapter, mapnik::svg_attribute_type, renderer_solid, agg::pixfmt_rgba32_pre>
+        renderer(svg_path, svg.get_data()->attributes());
+    if (flattened)
+    {
+        auto path = mapnik::marker_cache::instance().find_flattened(svg.get_data(), mtx.scale());
+        REQUIRE(path);
+        renderer.set_flattened(path);
+    }
+    renderer.render(ras_ptr, sl, renb, mtx, 1.0, bbox);
+    return im;
+}
+
+// largest difference of any channel between two images of the same size
+int max_difference(mapnik::image_rgba8 const& im1, mapnik::image_rgba8 const& im2)
+{
+    int diff = 0;
+    for (auto tup : boost::combine(im1, im2))
+    {
+        std::uint32_t a = boost::get<0>(tup);
+        std::uint32_t b = boost::get<1>(tup);
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            diff = std::max(diff, std::abs(static_cast<int>((a >> shift) & 0xff) - static_cast<int>((b >> shift) & 0xff)));
+        }
+    }
+    return diff;
+}
+
 bool equal(mapnik::image_rgba8 const& im1, mapnik::image_rgba8 const& im2)
 {
     if (im1.width() != im2.width() || im1.height() != im2.height())
@@ -105,4 +156,31 @@ TEST_CASE("SVG renderer")
         auto image2 = render_svg(octocat_css, 1.0);
         REQUIRE(equal(image1, image2));
     }
+
+    SECTION("flattened marker paths")
+    {
+        for (std::string const uri : {"shape://ellipse", "shape://arrow"})
+        {
+            auto marker = mapnik::marker_cache::instance().find(uri, true);
+            REQUIRE(marker->is<mapnik::marker_svg>());
+            mapnik::marker_svg const& svg = mapnik::util::get<mapnik::marker_svg>(*marker);
+            for (double scale : {1.0, 2.0, 3.7})
+            {
+                INFO(uri << " scale " << scale);
+                auto image1 = render_marker(svg, scale, false);
+                auto image2 = render_marker(svg, scale, true);
+                // differs only by rounding of the two step transform
+                // and, off bucket, by slightly finer curve flattening
+                CHECK(max_difference(image1, image2) <= 8);
+            }
+            // one flattening per scale bucket
+            auto path1 = mapnik::marker_cache::instance().find_flattened(svg.get_data(), 3.7);
+            auto path2 = mapnik::marker_cache::instance().find_flattened(svg.get_data(), 3.6);
+            CHECK(path1 == path2);
+            CHECK(path1 != mapnik::marker_cache::instance().find_flattened(svg.get_data(), 2.0));
+        }
+        // svg data that isn't owned by the cache isn't flattened
+        auto storage = std::make_shared<mapnik::svg_storage_type>();
+        CHECK_FALSE(mapnik::marker_cache::instance().find_flattened(storage, 1.0));
+    }
 }
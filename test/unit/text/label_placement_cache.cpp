@@ -0,0 +1,187 @@
+#include "catch.hpp"
+
+#include <mapnik/text/label_placement_cache.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/text/formatting/text.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/unicode.hpp>
+
+namespace {
+
+mapnik::cached_labels make_labels(mapnik::box2d<double> const& box, char const* text)
+{
+    mapnik::cached_label label;
+    label.position = 1;
+    label.anchor.set(box.center().x, box.center().y);
+    label.glyphs.push_back(mapnik::cached_label::glyph{0, mapnik::pixel_position(1, 2), mapnik::rotation()});
+    label.boxes.push_back(box);
+    label.text = mapnik::value_unicode_string::fromUTF8(text);
+    return mapnik::cached_labels{label};
+}
+
+mapnik::label_placement_cache::key_type key(mapnik::value_integer id, int zoom = 10)
+{
+    return mapnik::label_placement_cache::key_type{"roads", zoom, id, 0, 0};
+}
+
+// one point labelled with name, always feature id 1
+mapnik::Map make_map(std::string const& name, double y)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    mapnik::transcoder tr("utf-8");
+    feature->put("name", tr.transcode(name.c_str()));
+    feature->set_geometry(mapnik::geometry::point<double>(0, y));
+    ds->push(feature);
+
+    mapnik::Map m(256, 256);
+    mapnik::layer lyr("layer");
+    lyr.set_datasource(ds);
+    lyr.add_style("style");
+    m.add_layer(lyr);
+    mapnik::feature_type_style the_style;
+    mapnik::rule r;
+    mapnik::text_symbolizer text_sym;
+    mapnik::text_placements_ptr placements = std::make_shared<mapnik::text_placements_dummy>();
+    placements->defaults.format_defaults.face_name = "DejaVu Sans Book";
+    placements->defaults.format_defaults.text_size = 10.0;
+    placements->defaults.format_defaults.fill = mapnik::color(0, 0, 0);
+    placements->defaults.set_format_tree(
+      std::make_shared<mapnik::formatting::text_node>(mapnik::parse_expression("[name]")));
+    mapnik::put<mapnik::text_placements_ptr>(text_sym, mapnik::keys::text_placements_, placements);
+    r.append(std::move(text_sym));
+    the_style.add_rule(std::move(r));
+    m.insert_style("style", std::move(the_style));
+    m.zoom_to_box(mapnik::box2d<double>(-128, -128, 128, 128));
+    return m;
+}
+
+mapnik::image_rgba8 render(mapnik::Map const& m, std::shared_ptr<mapnik::label_placement_cache> cache)
+{
+    mapnik::image_rgba8 buf(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, buf);
+    if (cache)
+        ren.set_label_placement_cache(cache, 10);
+    ren.apply();
+    return buf;
+}
+
+} // namespace
+
+TEST_CASE("label_placement_cache")
+{
+    SECTION("find and insert")
+    {
+        mapnik::label_placement_cache cache;
+        CHECK(!cache.find(key(1)));
+        cache.insert(key(1), make_labels(mapnik::box2d<double>(0, 0, 10, 2), "first"));
+        auto labels = cache.find(key(1));
+        REQUIRE(labels);
+        REQUIRE(labels->size() == 1);
+        CHECK(labels->front().glyphs.size() == 1);
+        CHECK(labels->front().text == mapnik::value_unicode_string::fromUTF8("first"));
+        // other zoom levels, symbolizers and features are separate
+        CHECK(!cache.find(key(1, 11)));
+        CHECK(!cache.find(mapnik::label_placement_cache::key_type{"roads", 10, 1, 0, 1}));
+        CHECK(!cache.find(key(2)));
+        // the first placement stored wins
+        cache.insert(key(1), make_labels(mapnik::box2d<double>(50, 50, 60, 52), "second"));
+        CHECK(cache.find(key(1))->front().text == mapnik::value_unicode_string::fromUTF8("first"));
+
+        auto stats = cache.stats();
+        CHECK(stats.hits == 2);
+        CHECK(stats.misses == 4);
+        CHECK(stats.features == 1);
+    }
+
+    SECTION("query")
+    {
+        mapnik::label_placement_cache cache;
+        for (int i = 0; i < 100; ++i)
+        {
+            cache.insert(key(i), make_labels(mapnik::box2d<double>(i * 10, 0, i * 10 + 8, 2), "label"));
+        }
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(95, -1, 125, 1)).size() == 4);
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(-1000, -1000, 2000, 1000)).size() == 100);
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(0, 10, 1000, 20)).empty());
+        CHECK(cache.query("roads", 11, mapnik::box2d<double>(95, -1, 125, 1)).empty());
+        CHECK(cache.query("water", 10, mapnik::box2d<double>(95, -1, 125, 1)).empty());
+        cache.clear();
+        CHECK(!cache.find(key(1)));
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(-1000, -1000, 2000, 1000)).empty());
+    }
+
+    SECTION("eviction")
+    {
+        mapnik::label_placement_cache cache(10);
+        for (int i = 0; i < 25; ++i)
+        {
+            cache.insert(key(i), make_labels(mapnik::box2d<double>(i * 10, 0, i * 10 + 8, 2), "label"));
+        }
+        CHECK(!cache.find(key(0)));
+        CHECK(!cache.find(key(14)));
+        CHECK(cache.find(key(15)));
+        CHECK(cache.find(key(24)));
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(-1000, -1000, 2000, 1000)).size() == 10);
+        auto stats = cache.stats();
+        CHECK(stats.evictions == 15);
+        CHECK(stats.features == 10);
+    }
+
+    SECTION("large labels")
+    {
+        mapnik::label_placement_cache cache;
+        cache.insert(key(1), make_labels(mapnik::box2d<double>(0, 0, 1, 1), "small"));
+        // spans far more cells than the first label sized the grid for
+        cache.insert(key(2), make_labels(mapnik::box2d<double>(-1e7, -10, 1e7, 10), "large"));
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(5e6, -1, 5e6 + 1, 1)).size() == 1);
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(0, 0, 1, 1)).size() == 2);
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(5e6, 20, 5e6 + 1, 30)).empty());
+    }
+
+    SECTION("cell size")
+    {
+        mapnik::label_placement_cache cache(2);
+        cache.set_cell_size("roads", 10, 100.0);
+        cache.insert(key(1), make_labels(mapnik::box2d<double>(0, 0, 10, 2), "first"));
+        cache.insert(key(2), make_labels(mapnik::box2d<double>(-5000, 0, 5000, 2), "second"));
+        cache.insert(key(3), make_labels(mapnik::box2d<double>(250, 0, 260, 2), "third"));
+        // key 1 was evicted, key 2 is found through the large list
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(0, 0, 300, 2)).size() == 2);
+        // evicting key 2 takes it off the large list
+        cache.insert(key(4), make_labels(mapnik::box2d<double>(5, 0, 10, 2), "fourth"));
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(-4000, 0, -3000, 2)).empty());
+        CHECK(cache.query("roads", 10, mapnik::box2d<double>(0, 0, 300, 2)).size() == 2);
+    }
+}
+
+TEST_CASE("label_placement_cache replay")
+{
+    REQUIRE(mapnik::freetype_engine::register_font("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf"));
+
+    // an id reused by a feature with another label can not be replayed, the
+    // search that follows still has to find its only placement
+    auto cache = std::make_shared<mapnik::label_placement_cache>();
+    mapnik::image_rgba8 first = render(make_map("first", 0), cache);
+    CHECK(first.painted());
+    REQUIRE(cache->stats().features == 1);
+    // clear of the first label, which is seeded into the detector
+    mapnik::Map m = make_map("second label", 60);
+    mapnik::image_rgba8 replayed = render(m, cache);
+    CHECK(cache->stats().hits == 1);
+    CHECK(mapnik::compare(render(m, nullptr), replayed) == 0);
+}
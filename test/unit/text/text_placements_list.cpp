@@ -61,4 +61,9 @@ TEST_CASE("text_placements_list")
     }
 
     CHECK(!info->next());
+
+    // back to the defaults
+    info->reset();
+    REQUIRE(info->next());
+    CHECK(info->properties.format_defaults.text_size.get<mapnik::value_double>() == Approx(12.0));
 }
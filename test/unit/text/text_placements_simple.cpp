@@ -30,4 +30,10 @@ TEST_CASE("text_placements_simple")
     CHECK(info->properties.format_defaults.text_size.get<mapnik::value_double>() == Approx(8.0));
 
     CHECK(!info->next());
+
+    // back to the first placement
+    info->reset();
+    REQUIRE(info->next());
+    CHECK(info->properties.layout_defaults.dir == mapnik::NORTH);
+    CHECK(info->properties.format_defaults.text_size.get<mapnik::value_double>() == Approx(12.0));
 }
@@ -118,4 +118,61 @@ TEST_CASE("transform_path_adapter")
     }
 
 #endif // MAPNIK_USE_PROJ
+
+    SECTION("batched reprojection matches per vertex reprojection")
+    {
+        // more rings and vertices than fit in a single batch
+        mapnik::geometry::polygon<double> g;
+        for (int r = 0; r < 3; ++r)
+        {
+            g.emplace_back();
+            auto& ring = g.back();
+            for (int i = 0; i < 200; ++i)
+            {
+                ring.emplace_back(-170.0 + i * 1.5 + r, -80.0 + (i % 17) * 9.0 + r);
+            }
+            ring.emplace_back(ring.front());
+        }
+
+        using va_type = mapnik::geometry::polygon_vertex_adapter<double>;
+        using path_type = mapnik::transform_path_adapter<mapnik::view_transform, va_type>;
+
+        mapnik::box2d<double> extent(-20037508.34, -20037508.34, 20037508.34, 20037508.34);
+        mapnik::view_transform tr(512, 512, extent);
+        mapnik::projection merc("epsg:3857");
+        mapnik::projection wgs84("epsg:4326");
+        mapnik::proj_transform prj_trans(merc, wgs84);
+
+        va_type va(g);
+        path_type path(tr, va, prj_trans);
+        va_type expected_va(g);
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            path.rewind(0);
+            expected_va.rewind(0);
+            std::size_t vertices = 0;
+            while (true)
+            {
+                double ex = 0, ey = 0;
+                unsigned expected_cmd = expected_va.vertex(&ex, &ey);
+                if (expected_cmd != mapnik::SEG_END && expected_cmd != mapnik::SEG_CLOSE)
+                {
+                    double z = 0;
+                    REQUIRE(prj_trans.backward(ex, ey, z));
+                    tr.forward(&ex, &ey);
+                }
+                double x, y;
+                unsigned cmd = path.vertex(&x, &y);
+                REQUIRE(cmd == expected_cmd);
+                CHECK(x == Approx(ex));
+                CHECK(y == Approx(ey));
+                if (cmd == mapnik::SEG_END)
+                    break;
+                ++vertices;
+            }
+            // the repeated closing vertex is replaced by SEG_CLOSE
+            CHECK(vertices == 3 * 201);
+        }
+    }
 }
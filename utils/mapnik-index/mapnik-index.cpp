@@ -24,6 +24,8 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <algorithm>
+#include <thread>
 #include <mapnik/mapnik.hpp>
 #include <mapnik/version.hpp>
 #include <mapnik/util/fs.hpp>
@@ -74,6 +76,7 @@ int main(int argc, char** argv)
     std::string manual_headers;
     mapnik::box2d<float> bbox;
     bool use_bbox = false;
+    std::size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
     po::variables_map vm;
     try
     {
@@ -90,6 +93,7 @@ int main(int argc, char** argv)
             ("manual-headers,H", po::value<std::string>(), "CSV manual headers string")
             ("files",po::value<std::vector<std::string> >(),"Files to index: file1 file2 ...fileN")
             ("validate-features", "Validate GeoJSON features")
+            ("threads,t", po::value<std::size_t>(), "Number of threads used to parse large files\n(default: number of cores)")
             ("bbox,b", po::value<std::string>(), "Only index features within bounding box: --bbox=minx,miny,maxx,maxy")
             ;
         // clang-format on
@@ -121,6 +125,10 @@ int main(int argc, char** argv)
         {
             validate_features = true;
         }
+        if (vm.count("threads"))
+        {
+            num_threads = std::max(std::size_t(1), vm["threads"].as<std::size_t>());
+        }
         if (vm.count("depth"))
         {
             depth = vm["depth"].as<unsigned int>();
@@ -196,7 +204,7 @@ int main(int argc, char** argv)
         if (mapnik::detail::is_csv(filename))
         {
             std::clog << "processing '" << filename << "' as CSV\n";
-            auto result = mapnik::detail::process_csv_file(boxes, filename, manual_headers, separator, quote);
+            auto result = mapnik::detail::process_csv_file(boxes, filename, manual_headers, separator, quote, num_threads);
             if (!result.first)
             {
                 std::clog << "Error: failed to process " << filename << std::endl;
@@ -208,7 +216,7 @@ int main(int argc, char** argv)
         {
             std::clog << "processing '" << filename << "' as GeoJSON\n";
             std::pair<bool, mapnik::box2d<float>> result;
-            result = mapnik::detail::process_geojson_file_x3(boxes, filename, validate_features, verbose);
+            result = mapnik::detail::process_geojson_file_x3(boxes, filename, validate_features, verbose, num_threads);
             if (!result.first)
             {
                 std::clog << "Error: failed to process " << filename << std::endl;
@@ -221,14 +229,16 @@ int main(int argc, char** argv)
         {
             auto tree_extent = use_bbox ? bbox : extent;
             std::clog << tree_extent << std::endl;
-            mapnik::quad_tree<mapnik::util::index_record, mapnik::box2d<float>> tree(tree_extent, depth, ratio);
+            using tree_type = mapnik::quad_tree<mapnik::util::index_record, mapnik::box2d<float>>;
+            std::vector<tree_type::item_type> items;
+            items.reserve(boxes.size());
             for (auto const& item : boxes)
             {
                 auto ext_f = std::get<0>(item);
                 if (use_bbox && !bbox.intersects(ext_f))
                     continue;
                 mapnik::util::index_record rec = {std::get<1>(item).first, std::get<1>(item).second, ext_f};
-                tree.insert(rec, ext_f);
+                items.emplace_back(rec, ext_f);
             }
 
             std::fstream file((filename + ".index").c_str(),
@@ -239,7 +249,7 @@ int main(int argc, char** argv)
             }
             else
             {
-                tree.trim();
+                tree_type tree(tree_extent, items, depth, ratio);
                 std::clog << "number nodes=" << tree.count() << std::endl;
                 std::clog << "number element=" << tree.count_items() << std::endl;
                 file.exceptions(std::ios::failbit | std::ios::badbit);
@@ -41,13 +41,19 @@ namespace detail {
 
 template<typename T>
 std::pair<bool, typename T::value_type::first_type>
-  process_csv_file(T& boxes, std::string const& filename, std::string const& manual_headers, char separator, char quote)
+  process_csv_file(T& boxes,
+                   std::string const& filename,
+                   std::string const& manual_headers,
+                   char separator,
+                   char quote,
+                   std::size_t num_threads)
 {
     using box_type = typename T::value_type::first_type;
     csv_utils::csv_file_parser p;
     p.manual_headers_ = manual_headers;
     p.separator_ = separator;
     p.quote_ = quote;
+    p.num_threads_ = num_threads;
 
     util::mapped_memory_file csv_file{filename};
     try
@@ -65,7 +71,8 @@ std::pair<bool, typename T::value_type::first_type>
 using box_type = mapnik::box2d<float>;
 using item_type = std::pair<box_type, std::pair<std::uint64_t, std::uint64_t>>;
 using boxes_type = std::vector<item_type>;
-template std::pair<bool, box_type> process_csv_file(boxes_type&, std::string const&, std::string const&, char, char);
+template std::pair<bool, box_type>
+  process_csv_file(boxes_type&, std::string const&, std::string const&, char, char, std::size_t);
 
 } // namespace detail
 } // namespace mapnik
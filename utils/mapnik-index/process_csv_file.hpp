@@ -23,6 +23,7 @@
 #ifndef MAPNIK_UTILS_PROCESS_CSV_FILE_HPP
 #define MAPNIK_UTILS_PROCESS_CSV_FILE_HPP
 
+#include <cstddef>
 #include <utility>
 #include <mapnik/geometry/box2d.hpp>
 
@@ -34,7 +35,8 @@ std::pair<bool, typename T::value_type::first_type> process_csv_file(T& boxes,
                                                                      std::string const& filename,
                                                                      std::string const& manual_headers,
                                                                      char separator,
-                                                                     char quote);
+                                                                     char quote,
+                                                                     std::size_t num_threads = 1);
 
 }
 } // namespace mapnik
@@ -245,7 +245,11 @@ namespace detail {
 
 template<typename T>
 std::pair<bool, typename T::value_type::first_type>
-  process_geojson_file_x3(T& boxes, std::string const& filename, bool validate_features, bool verbose)
+  process_geojson_file_x3(T& boxes,
+                          std::string const& filename,
+                          bool validate_features,
+                          bool verbose,
+                          std::size_t num_threads)
 {
     using box_type = typename T::value_type::first_type;
     box_type extent;
@@ -279,7 +283,7 @@ std::pair<bool, typename T::value_type::first_type>
     base_iterator_type itr = start; // make a copy to preserve `start` iterator state
     try
     {
-        mapnik::json::extract_bounding_boxes(itr, end, boxes);
+        mapnik::json::extract_bounding_boxes(itr, end, boxes, num_threads);
     }
     catch (boost::spirit::x3::expectation_failure<base_iterator_type> const& ex)
     {
@@ -359,7 +363,8 @@ std::pair<bool, typename T::value_type::first_type>
     return std::make_pair(true, extent);
 }
 
-template std::pair<bool, box_type> process_geojson_file_x3(boxes_type&, std::string const&, bool, bool);
+template std::pair<bool, box_type>
+  process_geojson_file_x3(boxes_type&, std::string const&, bool, bool, std::size_t);
 
 } // namespace detail
 } // namespace mapnik
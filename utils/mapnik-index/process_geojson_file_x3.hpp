@@ -23,6 +23,7 @@
 #ifndef MAPNIK_UTILS_PROCESS_GEOJSON_FILE_X3_HPP
 #define MAPNIK_UTILS_PROCESS_GEOJSON_FILE_X3_HPP
 
+#include <cstddef>
 #include <utility>
 #include <string>
 
@@ -31,7 +32,11 @@ namespace detail {
 
 template<typename T>
 std::pair<bool, typename T::value_type::first_type>
-  process_geojson_file_x3(T& boxes, std::string const& filename, bool validate_features, bool verbose);
+  process_geojson_file_x3(T& boxes,
+                          std::string const& filename,
+                          bool validate_features,
+                          bool verbose,
+                          std::size_t num_threads = 1);
 
 }
 } // namespace mapnik
@@ -31,6 +31,7 @@ int main(int argc, char** argv)
     std::string img_file;
     double scale_factor = 1;
     bool params_as_variables = false;
+    std::string cache_file;
     mapnik::logger logger;
     logger.set_severity(mapnik::logger::error);
     int map_width = 600;
@@ -51,6 +52,8 @@ int main(int argc, char** argv)
             ("map-width",po::value<int>(),"map width in pixels")
             ("map-height",po::value<int>(),"map height in pixels")
             ("variables","make map parameters available as render-time variables")
+            ("compile",po::value<std::string>(),"write a compiled cache of the xml map to this file and exit")
+            ("cache",po::value<std::string>(),"load the xml map from this compiled cache while it is up to date")
             ;
         // clang-format on
         po::positional_options_description p;
@@ -92,6 +95,22 @@ int main(int argc, char** argv)
             return -1;
         }
 
+        mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
+        mapnik::freetype_engine::register_fonts("./fonts", true);
+
+        if (vm.count("compile"))
+        {
+            std::string const& compiled_file = vm["compile"].as<std::string>();
+            mapnik::compile_map(xml_file, compiled_file, true);
+            std::clog << "compiled to: " << compiled_file << "\n";
+            return 0;
+        }
+
+        if (vm.count("cache"))
+        {
+            cache_file = vm["cache"].as<std::string>();
+        }
+
         if (vm.count("img"))
         {
             img_file = vm["img"].as<std::string>();
@@ -122,10 +141,8 @@ int main(int argc, char** argv)
             map_height = vm["map-height"].as<int>();
         }
 
-        mapnik::datasource_cache::instance().register_datasources("./plugins/input/");
-        mapnik::freetype_engine::register_fonts("./fonts", true);
         mapnik::Map map(map_width, map_height);
-        mapnik::load_map(map, xml_file, true);
+        mapnik::load_map(map, xml_file, true, "", cache_file);
         map.zoom_all();
         mapnik::image_rgba8 im(map.width(), map.height());
         mapnik::request req(map.width(), map.height(), map.get_current_extent());
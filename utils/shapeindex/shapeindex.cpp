@@ -194,8 +194,8 @@ int main(int argc, char** argv)
                                       static_cast<float>(extent.maxx()),
                                       static_cast<float>(extent.maxy())};
 
-        mapnik::quad_tree<mapnik::detail::node, mapnik::box2d<float>> tree(extent_f, depth, ratio);
-        int count = 0;
+        using tree_type = mapnik::quad_tree<mapnik::detail::node, mapnik::box2d<float>>;
+        std::vector<tree_type::item_type> items;
 
         if (shape_type != shape_io::shape_null)
         {
@@ -267,8 +267,7 @@ int main(int argc, char** argv)
                                                        static_cast<float>(item_ext.miny()),
                                                        static_cast<float>(item_ext.maxx()),
                                                        static_cast<float>(item_ext.maxy())};
-                            tree.insert(mapnik::detail::node(offset * 2, start, end, std::move(ext_f)), ext_f);
-                            ++count;
+                            items.emplace_back(mapnik::detail::node(offset * 2, start, end, std::move(ext_f)), ext_f);
                         }
                     }
                     item_ext = mapnik::box2d<double>(); // invalid
@@ -289,15 +288,14 @@ int main(int argc, char** argv)
                                                static_cast<float>(item_ext.maxx()),
                                                static_cast<float>(item_ext.maxy())};
 
-                    tree.insert(mapnik::detail::node(offset * 2, -1, 0, std::move(ext_f)), ext_f);
-                    ++count;
+                    items.emplace_back(mapnik::detail::node(offset * 2, -1, 0, std::move(ext_f)), ext_f);
                 }
             }
         }
 
-        if (count > 0)
+        if (!items.empty())
         {
-            std::clog << " number shapes=" << count << std::endl;
+            std::clog << " number shapes=" << items.size() << std::endl;
 #ifdef _WIN32
             std::ofstream file(mapnik::utf8_to_utf16(shapename + ".index").c_str(), std::ios::trunc | std::ios::binary);
 #else
@@ -310,7 +308,7 @@ int main(int argc, char** argv)
             }
             else
             {
-                tree.trim();
+                tree_type tree(extent_f, items, depth, ratio);
                 std::clog << " number nodes=" << tree.count() << std::endl;
                 file.exceptions(std::ios::failbit | std::ios::badbit);
                 tree.write(file);